@@ -27,12 +27,17 @@
 #ifndef __WINH_OBJ_H__
 #define __WINH_OBJ_H__
 
+#include <atomic>
 #include <boost/chrono/duration.hpp>
 #include <boost/thread/condition_variable.hpp>
 #include <boost/thread/locks.hpp>
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/recursive_mutex.hpp>
+#include <boost/thread/shared_mutex.hpp>
 #include <boost/thread/thread.hpp>
+#include <boost/thread/tss.hpp>
+#include <stdexcept>
+#include <thread>
 
 namespace epee
 {
@@ -116,6 +121,114 @@ class critical_section
 	}
 };
 
+// Reader/writer lock that is recursive for both modes. The exclusive owner can also take the
+// lock shared, and keeps it shared if it releases the exclusive lock first, but a thread that
+// only holds it shared must not ask for it exclusively.
+class rw_critical_section
+{
+	struct shared_state
+	{
+		unsigned depth = 0;
+		bool locked = false;
+	};
+
+	boost::shared_mutex m_section;
+	std::atomic<std::thread::id> m_owner;
+	unsigned m_owner_depth;
+	boost::thread_specific_ptr<shared_state> m_shared;
+
+	shared_state &get_shared_state()
+	{
+		shared_state *state = m_shared.get();
+		if(state == nullptr)
+		{
+			state = new shared_state();
+			m_shared.reset(state);
+		}
+		return *state;
+	}
+
+	bool is_owner() const
+	{
+		return m_owner.load(std::memory_order_relaxed) == std::this_thread::get_id();
+	}
+
+  public:
+	rw_critical_section() : m_owner(std::thread::id()), m_owner_depth(0)
+	{
+	}
+
+	rw_critical_section(const rw_critical_section &) = delete;
+	rw_critical_section &operator=(const rw_critical_section &) = delete;
+
+	void lock()
+	{
+		if(is_owner())
+		{
+			++m_owner_depth;
+			return;
+		}
+		if(get_shared_state().depth != 0)
+			throw std::logic_error("rw_critical_section: exclusive lock requested by a shared holder");
+		m_section.lock();
+		m_owner.store(std::this_thread::get_id(), std::memory_order_relaxed);
+		m_owner_depth = 1;
+	}
+
+	void unlock()
+	{
+		if(--m_owner_depth == 0)
+		{
+			m_owner.store(std::thread::id(), std::memory_order_relaxed);
+			shared_state &state = get_shared_state();
+			if(state.depth != 0)
+			{
+				// a shared region taken while exclusive is still open, it keeps the lock shared
+				state.locked = true;
+				m_section.unlock_and_lock_shared();
+			}
+			else
+				m_section.unlock();
+		}
+	}
+
+	bool tryLock()
+	{
+		if(is_owner())
+		{
+			++m_owner_depth;
+			return true;
+		}
+		if(get_shared_state().depth != 0 || !m_section.try_lock())
+			return false;
+		m_owner.store(std::this_thread::get_id(), std::memory_order_relaxed);
+		m_owner_depth = 1;
+		return true;
+	}
+
+	void lock_shared()
+	{
+		shared_state &state = get_shared_state();
+		if(state.depth++ == 0)
+		{
+			// the exclusive owner already keeps every other thread out
+			state.locked = !is_owner();
+			if(state.locked)
+				m_section.lock_shared();
+		}
+	}
+
+	void unlock_shared()
+	{
+		shared_state &state = get_shared_state();
+		if(--state.depth == 0 && state.locked)
+		{
+			state.locked = false;
+			m_section.unlock_shared();
+		}
+	}
+};
+
 template <class t_lock>
 class critical_region_t
 {
@@ -145,6 +258,35 @@ class critical_region_t
 	}
 };
 
+template <class t_lock>
+class shared_region_t
+{
+	t_lock &m_locker;
+	bool m_unlocked;
+
+	shared_region_t(const shared_region_t &) {}
+
+  public:
+	shared_region_t(t_lock &cs) : m_locker(cs), m_unlocked(false)
+	{
+		m_locker.lock_shared();
+	}
+
+	~shared_region_t()
+	{
+		unlock();
+	}
+
+	void unlock()
+	{
+		if(!m_unlocked)
+		{
+			m_locker.unlock_shared();
+			m_unlocked = true;
+		}
+	}
+};
+
 #if defined(WINDWOS_PLATFORM)
 class shared_critical_section
 {
@@ -243,6 +385,12 @@ class exclusive_guard
 		boost::this_thread::sleep_for(boost::chrono::milliseconds(epee::debug::g_test_dbg_lock_sleep())); \
 	epee::critical_region_t<decltype(x)> critical_region_var1(x)
 
+#define SHARED_CRITICAL_REGION_LOCAL(x)                                                                   \
+	{                                                                                                     \
+		boost::this_thread::sleep_for(boost::chrono::milliseconds(epee::debug::g_test_dbg_lock_sleep())); \
+	}                                                                                                     \
+	epee::shared_region_t<decltype(x)> shared_region_var(x)
+
 #define CRITICAL_REGION_END() }
 
 #if defined(WINDWOS_PLATFORM)
@@ -1376,6 +1376,37 @@ class BlockchainDB
    */
 	virtual bool for_all_txpool_txes(std::function<bool(const crypto::hash &, const txpool_tx_meta_t &, const cryptonote::blobdata *)>, bool include_blob = false, bool include_unrelayed_txes = true) const = 0;
 
+	/**
+   * @brief remember the proof-of-work hash of a block
+   *
+   * The PoW cache survives restarts, so blocks seen again after a pop,
+   * a reorganization or a resumed import do not need their slow hash
+   * recomputed.  Adding an entry that already exists is not an error.
+   *
+   * @param blk_hash the hash of the block
+   * @param height the height of the block
+   * @param pow the proof-of-work hash of the block
+   */
+	virtual void add_pow_hash(const crypto::hash &blk_hash, uint64_t height, const crypto::hash &pow) = 0;
+
+	/**
+   * @brief fetch a block's proof-of-work hash from the PoW cache
+   *
+   * @param blk_hash the hash of the block
+   * @param height the height of the block
+   * @param pow return-by-reference the proof-of-work hash of the block
+   *
+   * @return true if the block was found in the PoW cache, false otherwise
+   */
+	virtual bool get_pow_hash(const crypto::hash &blk_hash, uint64_t height, crypto::hash &pow) const = 0;
+
+	/**
+   * @brief drop PoW cache entries for blocks below a given height
+   *
+   * @param min_height the lowest height to keep
+   */
+	virtual void prune_pow_hashes(uint64_t min_height) = 0;
+
 	/**
    * @brief runs a function over all key images stored
    *
@@ -191,6 +191,8 @@ int compare_string(const MDB_val *a, const MDB_val *b)
  * txpool_meta      txn hash     txn metadata
  * txpool_blob      txn hash     txn blob
  *
+ * pow_hashes       block height {block hash, PoW hash}
+ *
  * Note: where the data items are of uniform size, DUPFIXED tables have
  * been used to save space. In most of these cases, a dummy "zerokval"
  * key is used when accessing the table; the Key listed above will be
@@ -217,6 +219,8 @@ const char *const LMDB_TXPOOL_BLOB = "txpool_blob";
 const char *const LMDB_HF_STARTING_HEIGHTS = "hf_starting_heights";
 const char *const LMDB_HF_VERSIONS = "hf_versions";
 
+const char *const LMDB_POW_HASHES = "pow_hashes";
+
 const char *const LMDB_PROPERTIES = "properties";
 
 const char zerokey[8] = {0};
@@ -280,6 +284,12 @@ typedef struct blk_height
 	uint64_t bh_height;
 } blk_height;
 
+typedef struct blk_pow
+{
+	crypto::hash bp_hash;
+	crypto::hash bp_pow;
+} blk_pow;
+
 typedef struct txindex
 {
 	crypto::hash key;
@@ -1251,6 +1261,14 @@ void BlockchainLMDB::open(const std::string &filename, const int db_flags)
 
 	lmdb_db_open(txn, LMDB_HF_VERSIONS, MDB_INTEGERKEY | MDB_CREATE, m_hf_versions, "Failed to open db handle for m_hf_versions");
 
+	// databases made by older versions have no PoW cache, and we can't create it when read-only.
+	// It is only a cache, so carry on without it in that case.
+	m_has_pow_hashes = true;
+	if(!(mdb_flags & MDB_RDONLY))
+		lmdb_db_open(txn, LMDB_POW_HASHES, MDB_INTEGERKEY | MDB_CREATE | MDB_DUPSORT | MDB_DUPFIXED, m_pow_hashes, "Failed to open db handle for m_pow_hashes");
+	else if(mdb_dbi_open(txn, LMDB_POW_HASHES, MDB_INTEGERKEY | MDB_DUPSORT | MDB_DUPFIXED, &m_pow_hashes))
+		m_has_pow_hashes = false;
+
 	lmdb_db_open(txn, LMDB_PROPERTIES, MDB_CREATE, m_properties, "Failed to open db handle for m_properties");
 
 	mdb_set_dupsort(txn, m_spent_keys, compare_hash32);
@@ -1259,6 +1277,8 @@ void BlockchainLMDB::open(const std::string &filename, const int db_flags)
 	mdb_set_dupsort(txn, m_output_amounts, compare_uint64);
 	mdb_set_dupsort(txn, m_output_txs, compare_uint64);
 	mdb_set_dupsort(txn, m_block_info, compare_uint64);
+	if(m_has_pow_hashes)
+		mdb_set_dupsort(txn, m_pow_hashes, compare_hash32);
 
 	mdb_set_compare(txn, m_txpool_meta, compare_hash32);
 	mdb_set_compare(txn, m_txpool_blob, compare_hash32);
@@ -1413,6 +1433,8 @@ void BlockchainLMDB::reset()
 	(void)mdb_drop(txn, m_hf_starting_heights, 0); // this one is dropped in new code
 	if(auto result = mdb_drop(txn, m_hf_versions, 0))
 		throw0(DB_ERROR(lmdb_error("Failed to drop m_hf_versions: ", result).c_str()));
+	if(auto result = mdb_drop(txn, m_pow_hashes, 0))
+		throw0(DB_ERROR(lmdb_error("Failed to drop m_pow_hashes: ", result).c_str()));
 	if(auto result = mdb_drop(txn, m_properties, 0))
 		throw0(DB_ERROR(lmdb_error("Failed to drop m_properties: ", result).c_str()));
 
@@ -1773,6 +1795,79 @@ bool BlockchainLMDB::for_all_txpool_txes(std::function<bool(const crypto::hash &
 	return ret;
 }
 
+void BlockchainLMDB::add_pow_hash(const crypto::hash &blk_hash, uint64_t height, const crypto::hash &pow)
+{
+	LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+	check_open();
+
+	TXN_BLOCK_PREFIX(0);
+
+	MDB_val_copy<uint64_t> k(height);
+	blk_pow bp = {blk_hash, pow};
+	MDB_val_set(v, bp);
+	auto result = mdb_put(*txn_ptr, m_pow_hashes, &k, &v, MDB_NODUPDATA);
+	if(result && result != MDB_KEYEXIST)
+		throw1(DB_ERROR(lmdb_error("Error adding PoW hash to db transaction: ", result).c_str()));
+
+	TXN_BLOCK_POSTFIX_SUCCESS();
+}
+
+bool BlockchainLMDB::get_pow_hash(const crypto::hash &blk_hash, uint64_t height, crypto::hash &pow) const
+{
+	LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+	check_open();
+
+	if(!m_has_pow_hashes)
+		return false;
+
+	TXN_PREFIX_RDONLY();
+	RCURSOR(pow_hashes)
+
+	MDB_val_copy<uint64_t> k(height);
+	blk_pow bp = {blk_hash, crypto::null_hash};
+	MDB_val_set(v, bp);
+	auto result = mdb_cursor_get(m_cur_pow_hashes, &k, &v, MDB_GET_BOTH);
+	if(result == MDB_NOTFOUND)
+		return false;
+	if(result != 0)
+		throw1(DB_ERROR(lmdb_error("Error finding PoW hash: ", result).c_str()));
+
+	pow = ((const blk_pow *)v.mv_data)->bp_pow;
+	TXN_POSTFIX_RDONLY();
+	return true;
+}
+
+void BlockchainLMDB::prune_pow_hashes(uint64_t min_height)
+{
+	LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+	check_open();
+
+	TXN_BLOCK_PREFIX(0);
+
+	MDB_cursor *cur;
+	auto result = mdb_cursor_open(*txn_ptr, m_pow_hashes, &cur);
+	if(result)
+		throw0(DB_ERROR(lmdb_error("Failed to open cursor: ", result).c_str()));
+
+	// keys are heights, so the entries to drop are all at the front
+	MDB_val k, v;
+	uint64_t pruned = 0;
+	while((result = mdb_cursor_get(cur, &k, &v, MDB_FIRST)) == 0 && *(const uint64_t *)k.mv_data < min_height)
+	{
+		if((result = mdb_cursor_del(cur, MDB_NODUPDATA)))
+			break;
+		++pruned;
+	}
+	mdb_cursor_close(cur);
+	if(result && result != MDB_NOTFOUND)
+		throw1(DB_ERROR(lmdb_error("Error pruning PoW hashes: ", result).c_str()));
+
+	TXN_BLOCK_POSTFIX_SUCCESS();
+
+	if(pruned)
+		LOG_PRINT_L2("Pruned PoW hashes at " << pruned << " heights below " << min_height);
+}
+
 bool BlockchainLMDB::block_exists(const crypto::hash &h, uint64_t *height) const
 {
 	LOG_PRINT_L3("BlockchainLMDB::" << __func__);
@@ -75,6 +75,8 @@ typedef struct mdb_txn_cursors
 	MDB_cursor *m_txc_txpool_blob;
 
 	MDB_cursor *m_txc_hf_versions;
+
+	MDB_cursor *m_txc_pow_hashes;
 } mdb_txn_cursors;
 
 #define m_cur_blocks m_cursors->m_txc_blocks
@@ -89,6 +91,7 @@ typedef struct mdb_txn_cursors
 #define m_cur_txpool_meta m_cursors->m_txc_txpool_meta
 #define m_cur_txpool_blob m_cursors->m_txc_txpool_blob
 #define m_cur_hf_versions m_cursors->m_txc_hf_versions
+#define m_cur_pow_hashes m_cursors->m_txc_pow_hashes
 
 typedef struct mdb_rflags
 {
@@ -105,6 +108,7 @@ typedef struct mdb_rflags
 	bool m_rf_txpool_meta;
 	bool m_rf_txpool_blob;
 	bool m_rf_hf_versions;
+	bool m_rf_pow_hashes;
 } mdb_rflags;
 
 typedef struct mdb_threadinfo
@@ -267,6 +271,10 @@ class BlockchainLMDB : public BlockchainDB
 	virtual cryptonote::blobdata get_txpool_tx_blob(const crypto::hash &txid) const;
 	virtual bool for_all_txpool_txes(std::function<bool(const crypto::hash &, const txpool_tx_meta_t &, const cryptonote::blobdata *)> f, bool include_blob = false, bool include_unrelayed_txes = true) const;
 
+	virtual void add_pow_hash(const crypto::hash &blk_hash, uint64_t height, const crypto::hash &pow);
+	virtual bool get_pow_hash(const crypto::hash &blk_hash, uint64_t height, crypto::hash &pow) const;
+	virtual void prune_pow_hashes(uint64_t min_height);
+
 	virtual bool for_all_key_images(std::function<bool(const crypto::key_image &)>) const;
 	virtual bool for_blocks_range(const uint64_t &h1, const uint64_t &h2, std::function<bool(uint64_t, const crypto::hash &, const cryptonote::block &)>) const;
 	virtual bool for_all_transactions(std::function<bool(const crypto::hash &, const cryptonote::transaction &)>) const;
@@ -400,6 +408,9 @@ class BlockchainLMDB : public BlockchainDB
 	MDB_dbi m_hf_starting_heights;
 	MDB_dbi m_hf_versions;
 
+	MDB_dbi m_pow_hashes;
+	bool m_has_pow_hashes;
+
 	MDB_dbi m_properties;
 
 	mutable uint64_t m_cum_size; // used in batch size estimation
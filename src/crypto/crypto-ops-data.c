@@ -48,6 +48,10 @@
 
 #include "crypto-ops.h"
 
+#if defined(CRYPTO_FE51)
+#include "crypto-ops-data-fe51.inl"
+#else
+
 /* sqrt(x) is such an integer y that 0 <= y <= p - 1, y % 2 = 0, and y^2 = x (mod p). */
 /* d = -121665 / 121666 */
 const fe fe_d = {-10913610, 13857413, -15372611, 6949391, 114729, -8787816, -6275908, -3247719, -18696448, -12055116};  /* d */
@@ -866,3 +870,5 @@ const ge_p3 ge_p3_H = {
   {1, 0, 0, 0, 0, 0, 0, 0, 0, 0},
   {23443568, -5110398, -8776029, -4345135, 6889568, -14710814, 7474843, 3279062, 14550766, -7453428}
 };
+
+#endif
@@ -0,0 +1,384 @@
+// Copyright (c) 2019, Ryo Currency Project
+// Portions copyright (c) 2014-2018, The Monero Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2020
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*
+Field arithmetic in radix 2^51, for targets with a native 64x64->128 multiply.
+
+A field element is h[0]+2^51 h[1]+2^102 h[2]+2^153 h[3]+2^204 h[4]. Outputs of
+fe_mul, fe_sq and fe_sq2 have limbs just above 2^51, fe_sub adds 2p to its
+result and the point formulas add at most a handful of those together, so
+every input stays below 2^56 and the 19x and 38x products never overflow.
+
+This file is included by crypto-ops.c in place of the ref10 fe_* functions.
+*/
+
+__extension__ typedef unsigned __int128 fe_uint128;
+
+#define FE51_MASK 0x7ffffffffffffULL
+
+static uint64_t load_8(const unsigned char *in)
+{
+	return load_4(in) | (load_4(in + 4) << 32);
+}
+
+static void store_8(unsigned char *out, uint64_t in)
+{
+	int i;
+	for(i = 0; i < 8; i++)
+	{
+		out[i] = (unsigned char)(in >> (8 * i));
+	}
+}
+
+/*
+h = 0
+*/
+
+static void fe_0(fe h)
+{
+	h[0] = 0;
+	h[1] = 0;
+	h[2] = 0;
+	h[3] = 0;
+	h[4] = 0;
+}
+
+/*
+h = 1
+*/
+
+static void fe_1(fe h)
+{
+	h[0] = 1;
+	h[1] = 0;
+	h[2] = 0;
+	h[3] = 0;
+	h[4] = 0;
+}
+
+/*
+h = f + g
+Can overlap h with f or g.
+*/
+
+void fe_add(fe h, const fe f, const fe g)
+{
+	h[0] = f[0] + g[0];
+	h[1] = f[1] + g[1];
+	h[2] = f[2] + g[2];
+	h[3] = f[3] + g[3];
+	h[4] = f[4] + g[4];
+}
+
+/*
+Replace (f,g) with (g,g) if b == 1;
+replace (f,g) with (f,g) if b == 0.
+
+Preconditions: b in {0,1}.
+*/
+
+static void fe_cmov(fe f, const fe g, unsigned int b)
+{
+	uint64_t mask = (uint64_t)(-(int64_t)b);
+	f[0] ^= (f[0] ^ g[0]) & mask;
+	f[1] ^= (f[1] ^ g[1]) & mask;
+	f[2] ^= (f[2] ^ g[2]) & mask;
+	f[3] ^= (f[3] ^ g[3]) & mask;
+	f[4] ^= (f[4] ^ g[4]) & mask;
+}
+
+/*
+h = f
+*/
+
+static void fe_copy(fe h, const fe f)
+{
+	h[0] = f[0];
+	h[1] = f[1];
+	h[2] = f[2];
+	h[3] = f[3];
+	h[4] = f[4];
+}
+
+/*
+Carry the 128-bit column sums r0..r4 of a product into h.
+2^255 = 19 mod p, so the carry out of the top limb re-enters at the bottom.
+*/
+
+static void fe_carry_wide(fe h, fe_uint128 r0, fe_uint128 r1, fe_uint128 r2, fe_uint128 r3, fe_uint128 r4)
+{
+	uint64_t h0, h1, h2, h3, h4;
+
+	r1 += r0 >> 51;
+	r2 += r1 >> 51;
+	h1 = (uint64_t)r1 & FE51_MASK;
+	r3 += r2 >> 51;
+	h2 = (uint64_t)r2 & FE51_MASK;
+	r4 += r3 >> 51;
+	h3 = (uint64_t)r3 & FE51_MASK;
+	h4 = (uint64_t)r4 & FE51_MASK;
+	r0 = ((uint64_t)r0 & FE51_MASK) + 19 * (r4 >> 51);
+	h0 = (uint64_t)r0 & FE51_MASK;
+	h1 += (uint64_t)(r0 >> 51);
+
+	h[0] = h0;
+	h[1] = h1;
+	h[2] = h2;
+	h[3] = h3;
+	h[4] = h4;
+}
+
+/*
+h = f * g
+Can overlap h with f or g.
+*/
+
+static void fe_mul(fe h, const fe f, const fe g)
+{
+	uint64_t f0 = f[0];
+	uint64_t f1 = f[1];
+	uint64_t f2 = f[2];
+	uint64_t f3 = f[3];
+	uint64_t f4 = f[4];
+	uint64_t g0 = g[0];
+	uint64_t g1 = g[1];
+	uint64_t g2 = g[2];
+	uint64_t g3 = g[3];
+	uint64_t g4 = g[4];
+	uint64_t g1_19 = 19 * g1;
+	uint64_t g2_19 = 19 * g2;
+	uint64_t g3_19 = 19 * g3;
+	uint64_t g4_19 = 19 * g4;
+	fe_uint128 r0, r1, r2, r3, r4;
+
+	r0 = (fe_uint128)f0 * g0 + (fe_uint128)f1 * g4_19 + (fe_uint128)f2 * g3_19 + (fe_uint128)f3 * g2_19 + (fe_uint128)f4 * g1_19;
+	r1 = (fe_uint128)f0 * g1 + (fe_uint128)f1 * g0 + (fe_uint128)f2 * g4_19 + (fe_uint128)f3 * g3_19 + (fe_uint128)f4 * g2_19;
+	r2 = (fe_uint128)f0 * g2 + (fe_uint128)f1 * g1 + (fe_uint128)f2 * g0 + (fe_uint128)f3 * g4_19 + (fe_uint128)f4 * g3_19;
+	r3 = (fe_uint128)f0 * g3 + (fe_uint128)f1 * g2 + (fe_uint128)f2 * g1 + (fe_uint128)f3 * g0 + (fe_uint128)f4 * g4_19;
+	r4 = (fe_uint128)f0 * g4 + (fe_uint128)f1 * g3 + (fe_uint128)f2 * g2 + (fe_uint128)f3 * g1 + (fe_uint128)f4 * g0;
+
+	fe_carry_wide(h, r0, r1, r2, r3, r4);
+}
+
+/*
+h = -f
+*/
+
+static void fe_sub(fe h, const fe f, const fe g);
+
+static void fe_neg(fe h, const fe f)
+{
+	fe zero;
+	fe_0(zero);
+	fe_sub(h, zero, f);
+}
+
+/*
+h = f * f
+Can overlap h with f.
+*/
+
+static void fe_sq(fe h, const fe f)
+{
+	uint64_t f0 = f[0];
+	uint64_t f1 = f[1];
+	uint64_t f2 = f[2];
+	uint64_t f3 = f[3];
+	uint64_t f4 = f[4];
+	uint64_t f0_2 = 2 * f0;
+	uint64_t f1_2 = 2 * f1;
+	uint64_t f1_38 = 38 * f1;
+	uint64_t f2_38 = 38 * f2;
+	uint64_t f3_38 = 38 * f3;
+	uint64_t f3_19 = 19 * f3;
+	uint64_t f4_19 = 19 * f4;
+	fe_uint128 r0, r1, r2, r3, r4;
+
+	r0 = (fe_uint128)f0 * f0 + (fe_uint128)f1_38 * f4 + (fe_uint128)f2_38 * f3;
+	r1 = (fe_uint128)f0_2 * f1 + (fe_uint128)f2_38 * f4 + (fe_uint128)f3_19 * f3;
+	r2 = (fe_uint128)f0_2 * f2 + (fe_uint128)f1 * f1 + (fe_uint128)f3_38 * f4;
+	r3 = (fe_uint128)f0_2 * f3 + (fe_uint128)f1_2 * f2 + (fe_uint128)f4_19 * f4;
+	r4 = (fe_uint128)f0_2 * f4 + (fe_uint128)f1_2 * f3 + (fe_uint128)f2 * f2;
+
+	fe_carry_wide(h, r0, r1, r2, r3, r4);
+}
+
+/*
+h = 2 * f * f
+Can overlap h with f.
+*/
+
+static void fe_sq2(fe h, const fe f)
+{
+	uint64_t f0 = f[0];
+	uint64_t f1 = f[1];
+	uint64_t f2 = f[2];
+	uint64_t f3 = f[3];
+	uint64_t f4 = f[4];
+	uint64_t f0_2 = 2 * f0;
+	uint64_t f1_2 = 2 * f1;
+	uint64_t f1_38 = 38 * f1;
+	uint64_t f2_38 = 38 * f2;
+	uint64_t f3_38 = 38 * f3;
+	uint64_t f3_19 = 19 * f3;
+	uint64_t f4_19 = 19 * f4;
+	fe_uint128 r0, r1, r2, r3, r4;
+
+	r0 = (fe_uint128)f0 * f0 + (fe_uint128)f1_38 * f4 + (fe_uint128)f2_38 * f3;
+	r1 = (fe_uint128)f0_2 * f1 + (fe_uint128)f2_38 * f4 + (fe_uint128)f3_19 * f3;
+	r2 = (fe_uint128)f0_2 * f2 + (fe_uint128)f1 * f1 + (fe_uint128)f3_38 * f4;
+	r3 = (fe_uint128)f0_2 * f3 + (fe_uint128)f1_2 * f2 + (fe_uint128)f4_19 * f4;
+	r4 = (fe_uint128)f0_2 * f4 + (fe_uint128)f1_2 * f3 + (fe_uint128)f2 * f2;
+
+	fe_carry_wide(h, r0 << 1, r1 << 1, r2 << 1, r3 << 1, r4 << 1);
+}
+
+/*
+h = f - g
+Can overlap h with f or g.
+
+g is carried first so that each limb is below 2^51 + 2^13 * 19, then
+2p is added to f to keep every limb of the difference non-negative.
+*/
+
+static void fe_sub(fe h, const fe f, const fe g)
+{
+	uint64_t h0 = g[0];
+	uint64_t h1 = g[1];
+	uint64_t h2 = g[2];
+	uint64_t h3 = g[3];
+	uint64_t h4 = g[4];
+
+	h1 += h0 >> 51;
+	h0 &= FE51_MASK;
+	h2 += h1 >> 51;
+	h1 &= FE51_MASK;
+	h3 += h2 >> 51;
+	h2 &= FE51_MASK;
+	h4 += h3 >> 51;
+	h3 &= FE51_MASK;
+	h0 += 19 * (h4 >> 51);
+	h4 &= FE51_MASK;
+
+	h[0] = (f[0] + 0xfffffffffffdaULL) - h0;
+	h[1] = (f[1] + 0xffffffffffffeULL) - h1;
+	h[2] = (f[2] + 0xffffffffffffeULL) - h2;
+	h[3] = (f[3] + 0xffffffffffffeULL) - h3;
+	h[4] = (f[4] + 0xffffffffffffeULL) - h4;
+}
+
+/*
+Fully reduce h mod p and write it out little-endian.
+*/
+
+void fe_tobytes(unsigned char *s, const fe h)
+{
+	uint64_t t0 = h[0];
+	uint64_t t1 = h[1];
+	uint64_t t2 = h[2];
+	uint64_t t3 = h[3];
+	uint64_t t4 = h[4];
+	uint64_t q;
+
+	/* Two carry passes leave 0 <= t < 2^255 with every limb below 2^51 */
+	t1 += t0 >> 51;
+	t0 &= FE51_MASK;
+	t2 += t1 >> 51;
+	t1 &= FE51_MASK;
+	t3 += t2 >> 51;
+	t2 &= FE51_MASK;
+	t4 += t3 >> 51;
+	t3 &= FE51_MASK;
+	t0 += 19 * (t4 >> 51);
+	t4 &= FE51_MASK;
+
+	t1 += t0 >> 51;
+	t0 &= FE51_MASK;
+	t2 += t1 >> 51;
+	t1 &= FE51_MASK;
+	t3 += t2 >> 51;
+	t2 &= FE51_MASK;
+	t4 += t3 >> 51;
+	t3 &= FE51_MASK;
+	t0 += 19 * (t4 >> 51);
+	t4 &= FE51_MASK;
+
+	/* q = 1 iff t >= p, i.e. iff t + 19 overflows 2^255 */
+	q = (t0 + 19) >> 51;
+	q = (t1 + q) >> 51;
+	q = (t2 + q) >> 51;
+	q = (t3 + q) >> 51;
+	q = (t4 + q) >> 51;
+
+	/* t -= q * p, by adding 19 q and dropping bit 255 */
+	t0 += 19 * q;
+	t1 += t0 >> 51;
+	t0 &= FE51_MASK;
+	t2 += t1 >> 51;
+	t1 &= FE51_MASK;
+	t3 += t2 >> 51;
+	t2 &= FE51_MASK;
+	t4 += t3 >> 51;
+	t3 &= FE51_MASK;
+	t4 &= FE51_MASK;
+
+	store_8(s, t0 | (t1 << 51));
+	store_8(s + 8, (t1 >> 13) | (t2 << 38));
+	store_8(s + 16, (t2 >> 26) | (t3 << 25));
+	store_8(s + 24, (t3 >> 39) | (t4 << 12));
+}
+
+/*
+h = s, using all 256 bits of s. The value is not reduced; callers that
+need the top bit cleared or a canonical encoding check the limbs themselves.
+*/
+
+static void fe_frombytes(fe h, const unsigned char *s)
+{
+	h[0] = load_8(s) & FE51_MASK;
+	h[1] = (load_8(s + 6) >> 3) & FE51_MASK;
+	h[2] = (load_8(s + 12) >> 6) & FE51_MASK;
+	h[3] = (load_8(s + 19) >> 1) & FE51_MASK;
+	h[4] = load_8(s + 24) >> 12;
+}
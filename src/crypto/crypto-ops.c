@@ -83,6 +83,10 @@ uint64_t load_4(const unsigned char *in)
 	return result;
 }
 
+#if defined(CRYPTO_FE51)
+#include "crypto-ops-fe51.inl"
+#else
+
 /* From fe_0.c */
 
 /*
@@ -276,6 +280,8 @@ static void fe_copy(fe h, const fe f)
 	h[9] = f9;
 }
 
+#endif
+
 /* From fe_invert.c */
 
 void fe_invert(fe out, const fe z)
@@ -377,6 +383,8 @@ static int fe_isnonzero(const fe f)
 		   1;
 }
 
+#if !defined(CRYPTO_FE51)
+
 /* From fe_mul.c */
 
 /*
@@ -1254,6 +1262,8 @@ void fe_tobytes(unsigned char *s, const fe h)
 	s[31] = h9 >> 18;
 }
 
+#endif
+
 /* From ge_add.c */
 
 void ge_add(ge_p1p1 *r, const ge_p3 *p, const ge_cached *q)
@@ -1471,6 +1481,17 @@ int ge_frombytes_vartime(ge_p3 *h, const unsigned char *s)
 	fe vxx;
 	fe check;
 
+#if defined(CRYPTO_FE51)
+	fe_frombytes(h->Y, s);
+	h->Y[4] &= FE51_MASK;
+
+	/* Validate the number to be canonical */
+	if(h->Y[4] == FE51_MASK && h->Y[3] == FE51_MASK && h->Y[2] == FE51_MASK &&
+	   h->Y[1] == FE51_MASK && h->Y[0] >= FE51_MASK - 18)
+	{
+		return -1;
+	}
+#else
 	/* From fe_frombytes.c */
 
 	int64_t h0 = load_4(s);
@@ -1546,6 +1567,7 @@ int ge_frombytes_vartime(ge_p3 *h, const unsigned char *s)
 	h->Y[9] = h9;
 
 	/* End fe_frombytes.c */
+#endif
 
 	fe_1(h->Z);
 	fe_sq(u, h->Y);
@@ -1781,21 +1803,21 @@ static void ge_precomp_cmov(ge_precomp *t, const ge_precomp *u, unsigned char b)
 	fe_cmov(t->xy2d, u->xy2d, b);
 }
 
-static void select(ge_precomp *t, int pos, signed char b)
+static void select(ge_precomp *t, const ge_precomp (*table)[8], int pos, signed char b)
 {
 	ge_precomp minust;
 	unsigned char bnegative = negative(b);
 	unsigned char babs = b - (((-bnegative) & b) << 1);
 
 	ge_precomp_0(t);
-	ge_precomp_cmov(t, &ge_base[pos][0], equal(babs, 1));
-	ge_precomp_cmov(t, &ge_base[pos][1], equal(babs, 2));
-	ge_precomp_cmov(t, &ge_base[pos][2], equal(babs, 3));
-	ge_precomp_cmov(t, &ge_base[pos][3], equal(babs, 4));
-	ge_precomp_cmov(t, &ge_base[pos][4], equal(babs, 5));
-	ge_precomp_cmov(t, &ge_base[pos][5], equal(babs, 6));
-	ge_precomp_cmov(t, &ge_base[pos][6], equal(babs, 7));
-	ge_precomp_cmov(t, &ge_base[pos][7], equal(babs, 8));
+	ge_precomp_cmov(t, &table[pos][0], equal(babs, 1));
+	ge_precomp_cmov(t, &table[pos][1], equal(babs, 2));
+	ge_precomp_cmov(t, &table[pos][2], equal(babs, 3));
+	ge_precomp_cmov(t, &table[pos][3], equal(babs, 4));
+	ge_precomp_cmov(t, &table[pos][4], equal(babs, 5));
+	ge_precomp_cmov(t, &table[pos][5], equal(babs, 6));
+	ge_precomp_cmov(t, &table[pos][6], equal(babs, 7));
+	ge_precomp_cmov(t, &table[pos][7], equal(babs, 8));
 	fe_copy(minust.yplusx, t->yminusx);
 	fe_copy(minust.yminusx, t->yplusx);
 	fe_neg(minust.xy2d, t->xy2d);
@@ -1812,6 +1834,16 @@ Preconditions:
 */
 
 void ge_scalarmult_base(ge_p3 *h, const unsigned char *a)
+{
+	ge_scalarmult_precomp(h, a, ge_base);
+}
+
+/*
+h = a * A, with the table built by ge_precomp_table_init for A
+Same preconditions as ge_scalarmult_base, which is this function with A = B
+*/
+
+void ge_scalarmult_precomp(ge_p3 *h, const unsigned char *a, const ge_precomp (*table)[8])
 {
 	signed char e[64];
 	signed char carry;
@@ -1842,7 +1874,7 @@ void ge_scalarmult_base(ge_p3 *h, const unsigned char *a)
 	ge_p3_0(h);
 	for(i = 1; i < 64; i += 2)
 	{
-		select(&t, i / 2, e[i]);
+		select(&t, table, i / 2, e[i]);
 		ge_madd(&r, h, &t);
 		ge_p1p1_to_p3(h, &r);
 	}
@@ -1858,12 +1890,77 @@ void ge_scalarmult_base(ge_p3 *h, const unsigned char *a)
 
 	for(i = 0; i < 64; i += 2)
 	{
-		select(&t, i / 2, e[i]);
+		select(&t, table, i / 2, e[i]);
 		ge_madd(&r, h, &t);
 		ge_p1p1_to_p3(h, &r);
 	}
 }
 
+/*
+table[i][j] = (j + 1) * 256^i * A, in the layout of ge_base, for ge_scalarmult_precomp
+Each row of eight points is converted to affine coordinates with a single field inversion
+*/
+
+void ge_precomp_table_init(ge_precomp (*table)[8], const ge_p3 *A)
+{
+	ge_p3 row[8];
+	ge_p3 base;
+	ge_cached base_cached;
+	ge_p1p1 t;
+	ge_p2 s;
+	fe prod[8];
+	fe inv;
+	fe recip;
+	fe x;
+	fe y;
+	int i, j;
+
+	base = *A;
+	for(i = 0; i < 32; i++)
+	{
+		ge_p3_to_cached(&base_cached, &base);
+		row[0] = base;
+		for(j = 1; j < 8; j++)
+		{
+			ge_add(&t, &row[j - 1], &base_cached);
+			ge_p1p1_to_p3(&row[j], &t);
+		}
+
+		fe_copy(prod[0], row[0].Z);
+		for(j = 1; j < 8; j++)
+			fe_mul(prod[j], prod[j - 1], row[j].Z);
+		fe_invert(inv, prod[7]);
+		for(j = 7; j >= 0; j--)
+		{
+			if(j > 0)
+			{
+				fe_mul(recip, inv, prod[j - 1]);
+				fe_mul(inv, inv, row[j].Z);
+			}
+			else
+			{
+				fe_copy(recip, inv);
+			}
+			fe_mul(x, row[j].X, recip);
+			fe_mul(y, row[j].Y, recip);
+			fe_add(table[i][j].yplusx, y, x);
+			fe_sub(table[i][j].yminusx, y, x);
+			fe_mul(table[i][j].xy2d, x, y);
+			fe_mul(table[i][j].xy2d, table[i][j].xy2d, fe_d2);
+		}
+
+		/* base = 256 * base */
+		ge_p3_to_p2(&s, &base);
+		for(j = 0; j < 7; j++)
+		{
+			ge_p2_dbl(&t, &s);
+			ge_p1p1_to_p2(&s, &t);
+		}
+		ge_p2_dbl(&t, &s);
+		ge_p1p1_to_p3(&base, &t);
+	}
+}
+
 /* From ge_sub.c */
 
 /*
@@ -1901,6 +1998,44 @@ void ge_tobytes(unsigned char *s, const ge_p2 *h)
 	s[31] ^= fe_isnegative(x) << 7;
 }
 
+/* ge_tobytes of count points into s[32 * i] with a single field inversion (Montgomery's trick),
+   scratch has to hold count field elements */
+void ge_tobytes_batch(unsigned char *s, const ge_p2 *h, size_t count, fe *scratch)
+{
+	fe inv;
+	fe recip;
+	fe x;
+	fe y;
+	size_t i;
+
+	if(count == 0)
+		return;
+
+	/* scratch[i] = Z_0 * ... * Z_i */
+	fe_copy(scratch[0], h[0].Z);
+	for(i = 1; i < count; i++)
+		fe_mul(scratch[i], scratch[i - 1], h[i].Z);
+
+	fe_invert(inv, scratch[count - 1]);
+	/* inv = 1 / (Z_0 * ... * Z_i) at the start of each step */
+	for(i = count; i-- > 0;)
+	{
+		if(i > 0)
+		{
+			fe_mul(recip, inv, scratch[i - 1]);
+			fe_mul(inv, inv, h[i].Z);
+		}
+		else
+		{
+			fe_copy(recip, inv);
+		}
+		fe_mul(x, h[i].X, recip);
+		fe_mul(y, h[i].Y, recip);
+		fe_tobytes(s + 32 * i, y);
+		s[32 * i + 31] ^= fe_isnegative(x) << 7;
+	}
+}
+
 /* From sc_reduce.c */
 
 /*
@@ -2326,13 +2461,10 @@ static void ge_cached_cmov(ge_cached *t, const ge_cached *u, unsigned char b)
 }
 
 /* Assumes that a[31] <= 127 */
-void ge_scalarmult(ge_p2 *r, const unsigned char *a, const ge_p3 *A)
+/* Signed radix-16 digits of a, e[i] in -8..8, as consumed by ge_scalarmult_recoded */
+void ge_scalarmult_recode(signed char *e, const unsigned char *a)
 {
-	signed char e[64];
 	int carry, carry2, i;
-	ge_cached Ai[8]; /* 1 * A, 2 * A, ..., 8 * A */
-	ge_p1p1 t;
-	ge_p3 u;
 
 	carry = 0; /* 0..1 */
 	for(i = 0; i < 31; i++)
@@ -2347,6 +2479,22 @@ void ge_scalarmult(ge_p2 *r, const unsigned char *a, const ge_p3 *A)
 	carry2 = (carry + 8) >> 4;	 /* 0..8 */
 	e[62] = carry - (carry2 << 4); /* -8..7 */
 	e[63] = carry2;				   /* 0..8 */
+}
+
+void ge_scalarmult(ge_p2 *r, const unsigned char *a, const ge_p3 *A)
+{
+	signed char e[64];
+	ge_scalarmult_recode(e, a);
+	ge_scalarmult_recoded(r, e, A);
+}
+
+/* Same as ge_scalarmult, for a scalar recoded once with ge_scalarmult_recode and used with many points */
+void ge_scalarmult_recoded(ge_p2 *r, const signed char *e, const ge_p3 *A)
+{
+	int i;
+	ge_cached Ai[8]; /* 1 * A, 2 * A, ..., 8 * A */
+	ge_p1p1 t;
+	ge_p3 u;
 
 	ge_p3_to_cached(&Ai[0], A);
 	for(i = 0; i < 7; i++)
@@ -2393,25 +2541,13 @@ void ge_scalarmult(ge_p2 *r, const unsigned char *a, const ge_p3 *A)
 void ge_scalarmult_p3(ge_p3 *r3, const unsigned char *a, const ge_p3 *A)
 {
 	signed char e[64];
-	int carry, carry2, i;
+	int i;
 	ge_cached Ai[8]; /* 1 * A, 2 * A, ..., 8 * A */
 	ge_p1p1 t;
 	ge_p3 u;
 	ge_p2 r;
 
-	carry = 0; /* 0..1 */
-	for(i = 0; i < 31; i++)
-	{
-		carry += a[i];						  /* 0..256 */
-		carry2 = (carry + 8) >> 4;			  /* 0..16 */
-		e[2 * i] = carry - (carry2 << 4);	 /* -8..7 */
-		carry = (carry2 + 8) >> 4;			  /* 0..1 */
-		e[2 * i + 1] = carry2 - (carry << 4); /* -8..7 */
-	}
-	carry += a[31];				   /* 0..128 */
-	carry2 = (carry + 8) >> 4;	 /* 0..8 */
-	e[62] = carry - (carry2 << 4); /* -8..7 */
-	e[63] = carry2;				   /* 0..8 */
+	ge_scalarmult_recode(e, a);
 
 	ge_p3_to_cached(&Ai[0], A);
 	for(i = 0; i < 7; i++)
@@ -2583,6 +2719,9 @@ void ge_fromfe_frombytes_vartime(ge_p2 *r, const unsigned char *s)
 	fe u, v, w, x, y, z;
 	unsigned char sign;
 
+#if defined(CRYPTO_FE51)
+	fe_frombytes(u, s);
+#else
 	/* From fe_frombytes.c */
 
 	int64_t h0 = load_4(s);
@@ -2650,6 +2789,7 @@ void ge_fromfe_frombytes_vartime(ge_p2 *r, const unsigned char *s)
 	u[9] = h9;
 
 	/* End fe_frombytes.c */
+#endif
 
 	fe_sq2(v, u); /* 2 * u^2 */
 	fe_1(w);
@@ -4773,14 +4913,8 @@ int sc_isnonzero(const unsigned char *s)
 
 int ge_p3_is_point_at_infinity(const ge_p3 *p)
 {
-	// X = 0 and Y == Z
-	int n;
-	for (n = 0; n < 10; ++n)
-	{
-		if (p->X[n] | p->T[n])
-			return 0;
-		if (p->Y[n] != p->Z[n])
-		return 0;
-	}
-	return 1;
+	// X = 0 and Y == Z, by value since neither backend keeps its limbs reduced
+	fe d;
+	fe_sub(d, p->Y, p->Z);
+	return !fe_isnonzero(p->X) && !fe_isnonzero(p->T) && !fe_isnonzero(d);
 }
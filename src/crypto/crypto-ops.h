@@ -46,9 +46,22 @@
 
 #pragma once
 
+#include <stddef.h>
+#include <stdint.h>
+
 /* From fe.h */
 
+/* Radix 2^51 limbs where the compiler has a 128-bit integer type, ref10's
+   radix 2^25.5 otherwise. Define CRYPTO_FE25 to force the latter. */
+#if !defined(CRYPTO_FE25) && defined(__SIZEOF_INT128__)
+#define CRYPTO_FE51
+#endif
+
+#if defined(CRYPTO_FE51)
+typedef uint64_t fe[5];
+#else
 typedef int32_t fe[10];
+#endif
 
 /* From ge.h */
 
@@ -137,10 +150,13 @@ void ge_p3_tobytes(unsigned char *, const ge_p3 *);
 
 extern const ge_precomp ge_base[32][8];
 void ge_scalarmult_base(ge_p3 *, const unsigned char *);
+void ge_scalarmult_precomp(ge_p3 *, const unsigned char *, const ge_precomp (*)[8]);
+void ge_precomp_table_init(ge_precomp (*)[8], const ge_p3 *);
 
 /* From ge_tobytes.c */
 
 void ge_tobytes(unsigned char *, const ge_p2 *);
+void ge_tobytes_batch(unsigned char *, const ge_p2 *, size_t, fe *);
 
 /* From sc_reduce.c */
 
@@ -148,6 +164,8 @@ void sc_reduce(unsigned char *);
 
 /* New code */
 
+void ge_scalarmult_recode(signed char *, const unsigned char *);
+void ge_scalarmult_recoded(ge_p2 *, const signed char *, const ge_p3 *);
 void ge_scalarmult(ge_p2 *, const unsigned char *, const ge_p3 *);
 void ge_scalarmult_p3(ge_p3 *, const unsigned char *, const ge_p3 *);
 void ge_double_scalarmult_precomp_vartime(ge_p2 *, const unsigned char *, const ge_p3 *, const unsigned char *, const ge_dsmp);
@@ -325,6 +325,75 @@ bool crypto_ops::derive_subaddress_public_key(const public_key &out_key, const k
 	return true;
 }
 
+// Converts points[k] to bytes into out[slots[k]], sharing one field inversion between all of them
+template <typename T>
+static void batch_tobytes(const std::vector<ge_p2> &points, const std::vector<size_t> &slots, T *out)
+{
+	std::vector<ec_point> bytes(points.size());
+	std::unique_ptr<fe[]> scratch(new fe[points.size()]);
+	ge_tobytes_batch(reinterpret_cast<unsigned char *>(bytes.data()), points.data(), points.size(), scratch.get());
+	for(size_t k = 0; k < points.size(); k++)
+		memcpy(&out[slots[k]], &bytes[k], sizeof(ec_point));
+}
+
+void crypto_ops::generate_key_derivations(const public_key *keys, size_t count, const secret_key &sec, key_derivation *derivations, bool *valid)
+{
+	signed char e[64];
+	std::vector<ge_p2> points;
+	std::vector<size_t> slots;
+	assert(sc_check(&sec) == 0);
+	points.reserve(count);
+	slots.reserve(count);
+
+	ge_scalarmult_recode(e, &unwrap(sec));
+	for(size_t i = 0; i < count; i++)
+	{
+		ge_p3 point;
+		ge_p2 point2;
+		ge_p1p1 point3;
+		valid[i] = ge_frombytes_vartime(&point, &keys[i]) == 0;
+		if(!valid[i])
+			continue;
+		ge_scalarmult_recoded(&point2, e, &point);
+		ge_mul8(&point3, &point2);
+		points.emplace_back();
+		ge_p1p1_to_p2(&points.back(), &point3);
+		slots.push_back(i);
+	}
+	memwipe(e, sizeof(e));
+
+	batch_tobytes(points, slots, derivations);
+}
+
+bool crypto_ops::derive_public_keys(const key_derivation *derivations, const size_t *output_indexes, size_t count,
+									const public_key &base, public_key *derived_keys)
+{
+	ge_p3 point1;
+	ge_cached base_cached;
+	std::vector<ge_p2> points(count);
+	std::vector<size_t> slots(count);
+	if(ge_frombytes_vartime(&point1, &base) != 0)
+	{
+		return false;
+	}
+	ge_p3_to_cached(&base_cached, &point1);
+
+	for(size_t i = 0; i < count; i++)
+	{
+		ec_scalar scalar;
+		ge_p3 point2;
+		ge_p1p1 point4;
+		derivation_to_scalar(derivations[i], output_indexes[i], scalar);
+		ge_scalarmult_base(&point2, &scalar);
+		ge_add(&point4, &point2, &base_cached);
+		ge_p1p1_to_p2(&points[i], &point4);
+		slots[i] = i;
+	}
+
+	batch_tobytes(points, slots, derived_keys);
+	return true;
+}
+
 struct s_comm
 {
 	hash h;
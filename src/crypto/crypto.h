@@ -170,6 +170,10 @@ class crypto_ops
 	friend void derive_secret_key(const key_derivation &, std::size_t, const secret_key &, secret_key &);
 	static bool derive_subaddress_public_key(const public_key &, const key_derivation &, std::size_t, public_key &);
 	friend bool derive_subaddress_public_key(const public_key &, const key_derivation &, std::size_t, public_key &);
+	static void generate_key_derivations(const public_key *, std::size_t, const secret_key &, key_derivation *, bool *);
+	friend void generate_key_derivations(const public_key *, std::size_t, const secret_key &, key_derivation *, bool *);
+	static bool derive_public_keys(const key_derivation *, const std::size_t *, std::size_t, const public_key &, public_key *);
+	friend bool derive_public_keys(const key_derivation *, const std::size_t *, std::size_t, const public_key &, public_key *);
 	static void generate_signature(const hash &, const public_key &, const secret_key &, signature &);
 	friend void generate_signature(const hash &, const public_key &, const secret_key &, signature &);
 	static bool check_signature(const hash &, const public_key &, const signature &);
@@ -276,6 +280,21 @@ inline bool derive_subaddress_public_key(const public_key &out_key, const key_de
 	return crypto_ops::derive_subaddress_public_key(out_key, derivation, output_index, result);
 }
 
+/* Batched forms of generate_key_derivation and derive_public_key, giving the same results as
+   * calling them for every element. The secret key is recoded and the base is decompressed only
+   * once, and all results are converted to bytes with a single field inversion.
+   * valid[i] is false where generate_key_derivation would have failed, derivations[i] is left untouched then.
+   */
+inline void generate_key_derivations(const public_key *keys, std::size_t count, const secret_key &sec, key_derivation *derivations, bool *valid)
+{
+	crypto_ops::generate_key_derivations(keys, count, sec, derivations, valid);
+}
+inline bool derive_public_keys(const key_derivation *derivations, const std::size_t *output_indexes, std::size_t count,
+							   const public_key &base, public_key *derived_keys)
+{
+	return crypto_ops::derive_public_keys(derivations, output_indexes, count, base, derived_keys);
+}
+
 /* Generation and checking of a standard signature.
    */
 inline void generate_signature(const hash &prefix_hash, const public_key &pub, const secret_key &sec, signature &sig)
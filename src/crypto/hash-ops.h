@@ -101,4 +101,10 @@ enum
 };
 
 void cn_fast_hash(const void *data, size_t length, char *hash);
+// hashes[i * HASH_SIZE] receives the hash of data[i]. A hash may overwrite the data of the
+// same or an earlier input as long as every input is shorter than HASH_DATA_AREA
+void cn_fast_hash_batch(const void *const *data, const size_t *length, size_t count, char *hashes);
 void tree_hash(const char (*hashes)[HASH_SIZE], size_t count, char *root_hash);
+size_t tree_hash_cnt(size_t count);
+// Hashes the pairs in[2 * j], in[2 * j + 1] into out[j] for j < count, out may be in
+void tree_hash_level(const char (*in)[HASH_SIZE], size_t count, char (*out)[HASH_SIZE]);
@@ -55,3 +55,15 @@ void cn_fast_hash(const void* data, size_t length, char* hash)
 {
 	keccak((const uint8_t*)data, length, (uint8_t*)hash, 32);
 }
+
+void cn_fast_hash_batch(const void* const* data, const size_t* length, size_t count, char* hashes)
+{
+	if(count > 1 && keccak_x4_available())
+	{
+		keccak_x4_batch((const uint8_t* const*)data, length, count, (uint8_t*)hashes);
+		return;
+	}
+
+	for(size_t i = 0; i < count; i++)
+		cn_fast_hash(data[i], length[i], hashes + i * HASH_SIZE);
+}
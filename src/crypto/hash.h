@@ -91,6 +91,12 @@ inline hash cn_fast_hash(const void *data, std::size_t length)
 	return h;
 }
 
+// Hashes count independent inputs, four at a time on CPUs with AVX2
+inline void cn_fast_hash_batch(const void *const *data, const std::size_t *length, std::size_t count, hash *hashes)
+{
+	cn_fast_hash_batch(data, length, count, reinterpret_cast<char *>(hashes));
+}
+
 inline void tree_hash(const hash *hashes, std::size_t count, hash &root_hash)
 {
 	tree_hash(reinterpret_cast<const char(*)[HASH_SIZE]>(hashes), count, reinterpret_cast<char *>(&root_hash));
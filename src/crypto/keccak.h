@@ -17,6 +17,12 @@ void keccak(const uint8_t *in, size_t inlen, uint8_t *md, int mdlen);
 // update the state
 void keccakf(uint64_t st[25]);
 
+// whether keccak_x4_batch runs four hashes at once on this CPU
+int keccak_x4_available(void);
+
+// compute count 32 byte keccak hashes, md receives them back to back
+void keccak_x4_batch(const uint8_t *const *in, const size_t *inlen, size_t count, uint8_t *md);
+
 #ifdef __cplusplus
 }
 #endif
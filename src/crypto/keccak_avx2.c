@@ -0,0 +1,315 @@
+// Copyright (c) 2019, Ryo Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2020
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Four independent Keccak-256 hashes per AVX2 permutation. Each of the four lanes
+// is refilled with the next input as soon as its hash is done, so inputs of mixed
+// lengths keep all lanes busy. The last input left in flight is finished in scalar code.
+
+#include <stdint.h>
+#include <string.h>
+
+#include "hash-ops.h"
+#include "keccak.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+
+#ifndef __clang__
+#pragma GCC target("avx2")
+#endif
+#include <cpuid.h>
+#include <immintrin.h>
+
+extern const uint64_t keccakf_rndc[24];
+
+#define XOR(a, b) _mm256_xor_si256(a, b)
+#define ANDN(a, b) _mm256_andnot_si256(a, b) // ~a & b
+#define ROTL64x4(x, y) _mm256_or_si256(_mm256_slli_epi64(x, y), _mm256_srli_epi64(x, 64 - (y)))
+
+static void keccakf_x4(__m256i st[25])
+{
+	for(size_t round = 0; round < 24; round++)
+	{
+		__m256i t0, t1, bc0, bc1, bc2, bc3, bc4;
+		// Theta
+		bc0 = XOR(XOR(XOR(st[0], st[5]), XOR(st[10], st[15])), st[20]);
+		bc1 = XOR(XOR(XOR(st[1], st[6]), XOR(st[11], st[16])), st[21]);
+		bc2 = XOR(XOR(XOR(st[2], st[7]), XOR(st[12], st[17])), st[22]);
+		bc3 = XOR(XOR(XOR(st[3], st[8]), XOR(st[13], st[18])), st[23]);
+		bc4 = XOR(XOR(XOR(st[4], st[9]), XOR(st[14], st[19])), st[24]);
+
+		t0 = bc0;
+		t1 = bc1;
+		bc0 = XOR(bc0, ROTL64x4(bc2, 1));
+		bc1 = XOR(bc1, ROTL64x4(bc3, 1));
+		bc2 = XOR(bc2, ROTL64x4(bc4, 1));
+		bc3 = XOR(bc3, ROTL64x4(t0, 1));
+		bc4 = XOR(bc4, ROTL64x4(t1, 1));
+
+		// Rho Pi
+		t0 = XOR(st[1], bc0);
+		st[ 0] = XOR(st[0], bc4);
+		st[ 1] = ROTL64x4(XOR(st[ 6], bc0), 44);
+		st[ 6] = ROTL64x4(XOR(st[ 9], bc3), 20);
+		st[ 9] = ROTL64x4(XOR(st[22], bc1), 61);
+		st[22] = ROTL64x4(XOR(st[14], bc3), 39);
+		st[14] = ROTL64x4(XOR(st[20], bc4), 18);
+		st[20] = ROTL64x4(XOR(st[ 2], bc1), 62);
+		st[ 2] = ROTL64x4(XOR(st[12], bc1), 43);
+		st[12] = ROTL64x4(XOR(st[13], bc2), 25);
+		st[13] = ROTL64x4(XOR(st[19], bc3),  8);
+		st[19] = ROTL64x4(XOR(st[23], bc2), 56);
+		st[23] = ROTL64x4(XOR(st[15], bc4), 41);
+		st[15] = ROTL64x4(XOR(st[ 4], bc3), 27);
+		st[ 4] = ROTL64x4(XOR(st[24], bc3), 14);
+		st[24] = ROTL64x4(XOR(st[21], bc0),  2);
+		st[21] = ROTL64x4(XOR(st[ 8], bc2), 55);
+		st[ 8] = ROTL64x4(XOR(st[16], bc0), 45);
+		st[16] = ROTL64x4(XOR(st[ 5], bc4), 36);
+		st[ 5] = ROTL64x4(XOR(st[ 3], bc2), 28);
+		st[ 3] = ROTL64x4(XOR(st[18], bc2), 21);
+		st[18] = ROTL64x4(XOR(st[17], bc1), 15);
+		st[17] = ROTL64x4(XOR(st[11], bc0), 10);
+		st[11] = ROTL64x4(XOR(st[ 7], bc1),  6);
+		st[ 7] = ROTL64x4(XOR(st[10], bc4),  3);
+		st[10] = ROTL64x4(t0, 1);
+
+		// Chi
+		for(size_t i = 0; i < 25; i += 5)
+		{
+			bc0 = st[i + 0];
+			bc1 = st[i + 1];
+			bc2 = st[i + 2];
+			bc3 = st[i + 3];
+			bc4 = st[i + 4];
+			st[i + 0] = XOR(bc0, ANDN(bc1, bc2));
+			st[i + 1] = XOR(bc1, ANDN(bc2, bc3));
+			st[i + 2] = XOR(bc2, ANDN(bc3, bc4));
+			st[i + 3] = XOR(bc3, ANDN(bc4, bc0));
+			st[i + 4] = XOR(bc4, ANDN(bc0, bc1));
+		}
+
+		// Iota
+		st[0] = XOR(st[0], _mm256_set1_epi64x(keccakf_rndc[round]));
+	}
+}
+
+typedef struct
+{
+	const uint8_t *in; // unabsorbed input
+	size_t inlen;
+	size_t idx; // which input, SIZE_MAX when the lane is idle
+} keccak_lane;
+
+// Absorbs the last (padded) block of a hash whose state is in st and writes the hash
+static void keccak_finish(uint64_t st[25], const uint8_t *in, size_t inlen, uint8_t *md)
+{
+	uint64_t temp[HASH_DATA_AREA / 8];
+	size_t i;
+
+	for(; inlen >= HASH_DATA_AREA; inlen -= HASH_DATA_AREA, in += HASH_DATA_AREA)
+	{
+		memcpy(temp, in, HASH_DATA_AREA);
+		for(i = 0; i < HASH_DATA_AREA / 8; i++)
+			st[i] ^= temp[i];
+		keccakf(st);
+	}
+
+	memset(temp, 0, sizeof(temp));
+	memcpy(temp, in, inlen);
+	((uint8_t *)temp)[inlen] = 1;
+	((uint8_t *)temp)[HASH_DATA_AREA - 1] |= 0x80;
+	for(i = 0; i < HASH_DATA_AREA / 8; i++)
+		st[i] ^= temp[i];
+	keccakf(st);
+
+	memcpy(md, st, HASH_SIZE);
+}
+
+// AVX2 needs the OS to save the YMM registers as well, which cpuid alone does not tell
+static int cpu_has_avx2(void)
+{
+	uint32_t eax, ebx, ecx, edx;
+
+	if(!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & bit_OSXSAVE))
+		return 0;
+
+	__asm__ volatile("xgetbv"
+					 : "=a"(eax), "=d"(edx)
+					 : "c"(0));
+	if((eax & 6) != 6)
+		return 0;
+
+	if(__get_cpuid_max(0, NULL) < 7)
+		return 0;
+	__cpuid_count(7, 0, eax, ebx, ecx, edx);
+	return (ebx & bit_AVX2) != 0;
+}
+
+int keccak_x4_available(void)
+{
+	static int available = -1;
+	if(available < 0)
+		available = cpu_has_avx2();
+	return available;
+}
+
+void keccak_x4_batch(const uint8_t *const *in, const size_t *inlen, size_t count, uint8_t *md)
+{
+	__m256i st[25];
+	uint64_t block[4][HASH_DATA_AREA / 8];
+	uint64_t lane_st[4][25];
+	keccak_lane lanes[4];
+	size_t next = 0, active = 0, i, l;
+
+	memset(st, 0, sizeof(st));
+	for(l = 0; l < 4; l++)
+	{
+		lanes[l].idx = SIZE_MAX;
+		if(next < count)
+		{
+			lanes[l].in = in[next];
+			lanes[l].inlen = inlen[next];
+			lanes[l].idx = next++;
+			active++;
+		}
+	}
+
+	// Keep going in SIMD while it does more than one hash at a time
+	while(active > 1 || next < count)
+	{
+		int done[4] = {0, 0, 0, 0};
+
+		for(l = 0; l < 4; l++)
+		{
+			keccak_lane *ln = &lanes[l];
+			if(ln->idx == SIZE_MAX)
+			{
+				memset(block[l], 0, sizeof(block[l]));
+			}
+			else if(ln->inlen >= HASH_DATA_AREA)
+			{
+				memcpy(block[l], ln->in, HASH_DATA_AREA);
+				ln->in += HASH_DATA_AREA;
+				ln->inlen -= HASH_DATA_AREA;
+			}
+			else
+			{
+				memset(block[l], 0, sizeof(block[l]));
+				memcpy(block[l], ln->in, ln->inlen);
+				((uint8_t *)block[l])[ln->inlen] = 1;
+				((uint8_t *)block[l])[HASH_DATA_AREA - 1] |= 0x80;
+				done[l] = 1;
+			}
+		}
+
+		for(i = 0; i < HASH_DATA_AREA / 8; i++)
+			st[i] = XOR(st[i], _mm256_set_epi64x(block[3][i], block[2][i], block[1][i], block[0][i]));
+		keccakf_x4(st);
+
+		if(!(done[0] | done[1] | done[2] | done[3]))
+			continue;
+
+		for(i = 0; i < 4; i++)
+		{
+			uint64_t w[4];
+			_mm256_storeu_si256((__m256i *)w, st[i]);
+			for(l = 0; l < 4; l++)
+				lane_st[l][i] = w[l];
+		}
+
+		// Write out the finished hashes and start the next inputs in their lanes
+		__m256i keep = _mm256_set_epi64x(done[3] ? 0 : -1, done[2] ? 0 : -1, done[1] ? 0 : -1, done[0] ? 0 : -1);
+		for(i = 0; i < 25; i++)
+			st[i] = _mm256_and_si256(st[i], keep);
+
+		for(l = 0; l < 4; l++)
+		{
+			if(!done[l])
+				continue;
+			memcpy(md + lanes[l].idx * HASH_SIZE, lane_st[l], HASH_SIZE);
+			if(next < count)
+			{
+				lanes[l].in = in[next];
+				lanes[l].inlen = inlen[next];
+				lanes[l].idx = next++;
+			}
+			else
+			{
+				lanes[l].idx = SIZE_MAX;
+				active--;
+			}
+		}
+	}
+
+	if(active == 0)
+		return;
+
+	// One hash left, take its state out of the vectors and finish it with the scalar permutation
+	for(i = 0; i < 25; i++)
+	{
+		uint64_t w[4];
+		_mm256_storeu_si256((__m256i *)w, st[i]);
+		for(l = 0; l < 4; l++)
+			lane_st[l][i] = w[l];
+	}
+	for(l = 0; l < 4; l++)
+	{
+		if(lanes[l].idx != SIZE_MAX)
+			keccak_finish(lane_st[l], lanes[l].in, lanes[l].inlen, md + lanes[l].idx * HASH_SIZE);
+	}
+}
+
+#else
+
+int keccak_x4_available(void)
+{
+	return 0;
+}
+
+void keccak_x4_batch(const uint8_t *const *in, const size_t *inlen, size_t count, uint8_t *md)
+{
+	for(size_t i = 0; i < count; i++)
+		keccak(in[i], inlen[i], md + i * HASH_SIZE, HASH_SIZE);
+}
+
+#endif
@@ -71,52 +71,45 @@ using cn_pow_hash_v1 = cn_v1_hash_t;
 using cn_pow_hash_v2 = cn_v2_hash_t;
 using cn_pow_hash_v3 = cn_v3_hash_t;
 
-#ifdef HAS_INTEL_HW
-inline void cpuid(uint32_t eax, int32_t ecx, int32_t val[4])
+// Instruction set extensions usable by the PoW kernels, probed once per process
+struct cn_cpu_features
 {
-	val[0] = 0;
-	val[1] = 0;
-	val[2] = 0;
-	val[3] = 0;
+	bool sse2;
+	bool aes; // AES-NI on x86, crypto extensions on ARMv8
+	bool avx2;
+	bool bmi2;
+};
 
-#if defined(HAS_WIN_INTRIN_API)
-	__cpuidex(val, eax, ecx);
-#else
-	__cpuid_count(eax, ecx, val[0], val[1], val[2], val[3]);
-#endif
-}
+const cn_cpu_features& cn_get_cpu_features();
 
-inline bool hw_check_aes()
+// PoW kernels, ordered from the slowest to the fastest
+enum class cn_kernel : int
 {
-	int32_t cpu_info[4];
-	cpuid(1, 0, cpu_info);
-	return (cpu_info[2] & (1 << 25)) != 0;
-}
+	soft, // software AES, works everywhere
+	aes,  // hardware AES
+	avx2  // hardware AES with the AVX2 cn-gpu loop, only used by v3
+};
 
-inline bool check_avx2()
-{
-	int32_t cpu_info[4];
-	cpuid(7, 0, cpu_info);
-	const bool has_avx2 = (cpu_info[1] & (1 << 5)) != 0;
-	cpuid(1, 0, cpu_info);
-	const bool osxsave = (cpu_info[2] & (1 << 27)) != 0;
-	return has_avx2 && osxsave;
-}
-#endif
+const char* cn_kernel_str(cn_kernel kernel);
 
-#ifdef HAS_ARM_HW
-inline bool hw_check_aes()
+// Where the scratchpad memory came from, ordered from the least to the most preferred
+enum class cn_pad_mode : int
 {
-	return (getauxval(AT_HWCAP) & HWCAP_AES) != 0;
-}
-#endif
+	aligned,  // regular aligned heap allocation
+	huge_thp, // transparent huge pages (Linux)
+	huge_tlb  // explicit huge pages from the hugetlb pool (Linux)
+};
 
-#if !defined(HAS_INTEL_HW) && !defined(HAS_ARM_HW)
-inline bool hw_check_aes()
-{
-	return false;
-}
-#endif
+const char* cn_pad_mode_str(cn_pad_mode mode);
+
+// Sets the best mode new scratchpads try to get, weaker modes are used as a fallback.
+// Defaults to huge_tlb, the RYO_PAD_ALLOC environment variable ("aligned", "thp") can lower it
+void cn_set_pad_policy(cn_pad_mode best);
+
+// Huge pages are tried first and bound to the NUMA node of the calling thread, on any failure
+// we fall back to the aligned heap allocation. mode returns what we actually got
+void* cn_pad_alloc(size_t size, cn_pad_mode& mode);
+void cn_pad_free(void* ptr, size_t size, cn_pad_mode mode);
 
 // This cruft avoids casting-galore and allows us not to worry about sizeof(void*)
 class cn_sptr
@@ -159,11 +152,11 @@ class cn_slow_hash
   public:
 	cn_slow_hash() : borrowed_pad(false)
 	{
-		lpad.set(boost::alignment::aligned_alloc(4096, MEMORY));
+		lpad.set(cn_pad_alloc(MEMORY, pad_mode));
 		spad.set(boost::alignment::aligned_alloc(4096, 4096));
 	}
 
-	cn_slow_hash(cn_slow_hash&& other) noexcept : lpad(other.lpad.as_byte()), spad(other.spad.as_byte()), borrowed_pad(other.borrowed_pad)
+	cn_slow_hash(cn_slow_hash&& other) noexcept : lpad(other.lpad.as_byte()), spad(other.spad.as_byte()), borrowed_pad(other.borrowed_pad), pad_mode(other.pad_mode)
 	{
 		other.lpad.set(nullptr);
 		other.spad.set(nullptr);
@@ -190,6 +183,9 @@ class cn_slow_hash
 		lpad.set(other.lpad.as_void());
 		spad.set(other.spad.as_void());
 		borrowed_pad = other.borrowed_pad;
+		pad_mode = other.pad_mode;
+		other.lpad.set(nullptr);
+		other.spad.set(nullptr);
 		return *this;
 	}
 
@@ -202,22 +198,40 @@ class cn_slow_hash
 		free_mem();
 	}
 
+	// How the scratchpad was allocated, borrowed contexts report the aligned mode
+	cn_pad_mode get_pad_mode() const { return pad_mode; }
+
 	void hash(const void* in, size_t len, void* out)
 	{
-		if(VERSION <= 1)
-		{
-			if(hw_check_aes() && !check_override())
-				hardware_hash(in, len, out);
-			else
-				software_hash(in, len, out);
-		}
-		else
-		{
-			if(hw_check_aes() && !check_override())
-				hardware_hash_3(in, len, out);
-			else
-				software_hash_3(in, len, out);
-		}
+		cn_slow_hash* self = this;
+		get_kernel().lanes_1(&self, &in, &len, &out);
+	}
+
+	// Hash N independent inputs, each one with its own context. With hardware AES the lanes are
+	// interleaved so that the scratchpad latency of one lane is hidden behind the work of the others.
+	// Contexts must be distinct and the caller must ensure that none of them is hashing at the same time!!
+	template <size_t N>
+	static void hash_n(cn_slow_hash* const* ctx, const void* const* in, const size_t* len, void* const* out)
+	{
+		static_assert(N == 1 || N == 2 || N == 4, "Unsupported number of lanes");
+		const kernel_table& k = get_kernel();
+		(N == 1 ? k.lanes_1 : N == 2 ? k.lanes_2 : k.lanes_4)(ctx, in, len, out);
+	}
+
+	// Kernel picked for this variant, the first call probes the CPU and self-tests the candidates
+	static cn_kernel kernel_id() { return get_kernel().id; }
+	// False if even the kernel we fell back to failed the self-test
+	static bool kernel_verified() { return get_kernel().verified; }
+	// True if the kernel applies to this variant and the CPU can run it
+	static bool kernel_supported(cn_kernel kernel);
+	// Hashes the known vector with this kernel, whether or not dispatch would pick it. Check kernel_supported first!!
+	static bool kernel_self_test(cn_kernel kernel) { return self_test(make_kernel_table(kernel)); }
+
+	// Bypasses the dispatch table, meant for benchmarks. Check kernel_supported first!!
+	void hash_with(cn_kernel kernel, const void* in, size_t len, void* out)
+	{
+		cn_slow_hash* self = this;
+		make_kernel_table(kernel).lanes_1(&self, &in, &len, &out);
 	}
 
 	void software_hash(const void* in, size_t len, void* out);
@@ -234,7 +248,38 @@ class cn_slow_hash
 	void hardware_hash_3(const void* in, size_t len, void* pout);
 #endif
 
+#if defined(HAS_INTEL_HW)
+	template <size_t N>
+	static void hardware_hash_n(cn_slow_hash* const* ctx, const void* const* in, const size_t* len, void* const* out);
+	template <size_t N, bool AVX2>
+	static void hardware_hash_3_n(cn_slow_hash* const* ctx, const void* const* in, const size_t* len, void* const* out);
+#endif
+
   private:
+	typedef void (*lanes_fn)(cn_slow_hash* const* ctx, const void* const* in, const size_t* len, void* const* out);
+
+	// Dispatch table, filled once per variant by get_kernel
+	struct kernel_table
+	{
+		cn_kernel id;
+		bool verified;
+		lanes_fn lanes_1;
+		lanes_fn lanes_2;
+		lanes_fn lanes_4;
+	};
+
+	static const kernel_table& get_kernel();
+	static kernel_table make_kernel_table(cn_kernel id);
+	static bool self_test(const kernel_table& k);
+
+	// Lanes of kernels without an interleaved implementation are hashed one after another
+	template <size_t N, void (cn_slow_hash::*HASH)(const void*, size_t, void*)>
+	static void serial_lanes(cn_slow_hash* const* ctx, const void* const* in, const size_t* len, void* const* out)
+	{
+		for(size_t i = 0; i < N; i++)
+			(ctx[i]->*HASH)(in[i], len[i], out[i]);
+	}
+
 	static constexpr size_t MASK = VERSION <= 1 ? ((MEMORY - 1) >> 4) << 4 : ((MEMORY - 1) >> 6) << 6;
 
 	friend cn_pow_hash_v1;
@@ -247,32 +292,15 @@ class cn_slow_hash
 		lpad.set(lptr);
 		spad.set(sptr);
 		borrowed_pad = true;
-	}
-
-	inline bool check_override()
-	{
-		const char* env = getenv("RYO_USE_SOFTWARE_AES");
-		if(!env)
-		{
-			return false;
-		}
-		else if(!strcmp(env, "0") || !strcmp(env, "no"))
-		{
-			return false;
-		}
-		else
-		{
-			return true;
-		}
+		pad_mode = cn_pad_mode::aligned;
 	}
 
 	inline void free_mem()
 	{
 		if(!borrowed_pad)
 		{
-			if(lpad.as_void() != nullptr)
-				boost::alignment::aligned_free(lpad.as_void());
-			if(lpad.as_void() != nullptr)
+			cn_pad_free(lpad.as_void(), MEMORY, pad_mode);
+			if(spad.as_void() != nullptr)
 				boost::alignment::aligned_free(spad.as_void());
 		}
 
@@ -299,11 +327,16 @@ class cn_slow_hash
 	void implode_scratchpad_soft();
 
 	void inner_hash_3();
-	void inner_hash_3_avx();
+
+	template <size_t N>
+	static void inner_hash_3_n(cn_slow_hash* const* ctx);
+	template <size_t N>
+	static void inner_hash_3_avx_n(cn_slow_hash* const* ctx);
 
 	cn_sptr lpad;
 	cn_sptr spad;
 	bool borrowed_pad;
+	cn_pad_mode pad_mode;
 };
 
 extern template class cn_v1_hash_t;
@@ -0,0 +1,206 @@
+// Copyright (c) 2019, Ryo Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2020
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "cn_slow_hash.hpp"
+#include <atomic>
+
+#if defined(__linux__)
+#include <fstream>
+#include <string>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+cn_pad_mode env_pad_policy()
+{
+	const char* env = getenv("RYO_PAD_ALLOC");
+	if(env == nullptr)
+		return cn_pad_mode::huge_tlb;
+	else if(!strcmp(env, "aligned"))
+		return cn_pad_mode::aligned;
+	else if(!strcmp(env, "thp"))
+		return cn_pad_mode::huge_thp;
+	else
+		return cn_pad_mode::huge_tlb;
+}
+
+std::atomic<int> pad_policy(-1);
+
+cn_pad_mode get_pad_policy()
+{
+	static const cn_pad_mode env_policy = env_pad_policy();
+	int policy = pad_policy.load();
+	return policy < 0 ? env_policy : static_cast<cn_pad_mode>(policy);
+}
+
+#if defined(__linux__)
+// Prefer the NUMA node of the calling thread for pages that are not faulted in yet
+void bind_to_local_node(void* ptr, size_t size)
+{
+#if defined(SYS_getcpu) && defined(SYS_mbind)
+	unsigned int cpu, node;
+	if(syscall(SYS_getcpu, &cpu, &node, nullptr) != 0 || node >= sizeof(unsigned long) * 8)
+		return;
+
+	constexpr int MPOL_PREFERRED_MODE = 1;
+	unsigned long nodemask = 1ul << node;
+	syscall(SYS_mbind, ptr, size, MPOL_PREFERRED_MODE, &nodemask, sizeof(nodemask) * 8 + 1, 0);
+#endif
+}
+
+bool thp_available()
+{
+	std::ifstream f("/sys/kernel/mm/transparent_hugepage/enabled");
+	std::string line;
+	if(!std::getline(f, line))
+		return false;
+	return line.find("[never]") == std::string::npos;
+}
+
+void* alloc_huge_tlb(size_t size)
+{
+	// MAP_POPULATE makes a shortage of huge pages fail here and not with SIGBUS on first access,
+	// the pages are faulted in by this thread so they follow its (local) NUMA policy
+	void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+	return ptr == MAP_FAILED ? nullptr : ptr;
+}
+
+void* alloc_huge_thp(size_t size)
+{
+	static const bool has_thp = thp_available();
+	if(!has_thp)
+		return nullptr;
+
+	// THP only backs 2MB aligned ranges, so map more and trim the excess
+	size_t map_size = size + HUGE_PAGE_SIZE;
+	void* raw = mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(raw == MAP_FAILED)
+		return nullptr;
+
+	uintptr_t start = reinterpret_cast<uintptr_t>(raw);
+	uintptr_t aligned = (start + HUGE_PAGE_SIZE - 1) & ~uintptr_t(HUGE_PAGE_SIZE - 1);
+	size_t head = aligned - start;
+	size_t tail = map_size - head - size;
+	if(head != 0)
+		munmap(raw, head);
+	if(tail != 0)
+		munmap(reinterpret_cast<void*>(aligned + size), tail);
+
+	void* ptr = reinterpret_cast<void*>(aligned);
+	if(madvise(ptr, size, MADV_HUGEPAGE) != 0)
+	{
+		munmap(ptr, size);
+		return nullptr;
+	}
+
+	bind_to_local_node(ptr, size);
+	return ptr;
+}
+#endif
+} // namespace
+
+const char* cn_pad_mode_str(cn_pad_mode mode)
+{
+	switch(mode)
+	{
+	case cn_pad_mode::aligned:
+		return "aligned";
+	case cn_pad_mode::huge_thp:
+		return "transparent huge pages";
+	case cn_pad_mode::huge_tlb:
+		return "huge pages";
+	}
+	return "unknown";
+}
+
+void cn_set_pad_policy(cn_pad_mode best)
+{
+	pad_policy = static_cast<int>(best);
+}
+
+void* cn_pad_alloc(size_t size, cn_pad_mode& mode)
+{
+#if defined(__linux__)
+	cn_pad_mode policy = get_pad_policy();
+	void* ptr = nullptr;
+
+	if(size % HUGE_PAGE_SIZE == 0)
+	{
+		if(policy >= cn_pad_mode::huge_tlb && (ptr = alloc_huge_tlb(size)) != nullptr)
+		{
+			mode = cn_pad_mode::huge_tlb;
+			return ptr;
+		}
+
+		if(policy >= cn_pad_mode::huge_thp && (ptr = alloc_huge_thp(size)) != nullptr)
+		{
+			mode = cn_pad_mode::huge_thp;
+			return ptr;
+		}
+	}
+#endif
+
+	mode = cn_pad_mode::aligned;
+	return boost::alignment::aligned_alloc(4096, size);
+}
+
+void cn_pad_free(void* ptr, size_t size, cn_pad_mode mode)
+{
+	if(ptr == nullptr)
+		return;
+
+#if defined(__linux__)
+	if(mode != cn_pad_mode::aligned)
+	{
+		munmap(ptr, size);
+		return;
+	}
+#endif
+
+	boost::alignment::aligned_free(ptr);
+}
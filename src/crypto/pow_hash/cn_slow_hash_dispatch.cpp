@@ -0,0 +1,259 @@
+// Copyright (c) 2019, Ryo Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2020
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "cn_slow_hash.hpp"
+
+namespace
+{
+#ifdef HAS_INTEL_HW
+inline void cpuid(uint32_t eax, int32_t ecx, int32_t val[4])
+{
+	val[0] = 0;
+	val[1] = 0;
+	val[2] = 0;
+	val[3] = 0;
+
+#if defined(HAS_WIN_INTRIN_API)
+	__cpuidex(val, eax, ecx);
+#else
+	__cpuid_count(eax, ecx, val[0], val[1], val[2], val[3]);
+#endif
+}
+
+// The OS has to save the YMM registers on context switch for AVX2 to be usable
+inline bool os_saves_ymm()
+{
+#if defined(HAS_WIN_INTRIN_API)
+	return (_xgetbv(0) & 6) == 6;
+#else
+	uint32_t eax, edx;
+	__asm__ volatile("xgetbv"
+					 : "=a"(eax), "=d"(edx)
+					 : "c"(0));
+	return (eax & 6) == 6;
+#endif
+}
+
+cn_cpu_features probe_cpu_features()
+{
+	cn_cpu_features f = {};
+	int32_t cpu_info[4];
+
+	cpuid(1, 0, cpu_info);
+	f.sse2 = (cpu_info[3] & (1 << 26)) != 0;
+	f.aes = (cpu_info[2] & (1 << 25)) != 0;
+	const bool osxsave = (cpu_info[2] & (1 << 27)) != 0;
+
+	cpuid(7, 0, cpu_info);
+	f.avx2 = (cpu_info[1] & (1 << 5)) != 0 && osxsave && os_saves_ymm();
+	f.bmi2 = (cpu_info[1] & (1 << 8)) != 0;
+	return f;
+}
+#elif defined(HAS_ARM_HW)
+cn_cpu_features probe_cpu_features()
+{
+	cn_cpu_features f = {};
+	f.aes = (getauxval(AT_HWCAP) & HWCAP_AES) != 0;
+	return f;
+}
+#else
+cn_cpu_features probe_cpu_features()
+{
+	return cn_cpu_features{};
+}
+#endif
+
+// RYO_USE_SOFTWARE_AES forces the software kernel, RYO_POW_KERNEL ("soft", "aes", "avx2")
+// caps the fastest kernel we are allowed to pick
+cn_kernel kernel_override()
+{
+	const char* env = getenv("RYO_USE_SOFTWARE_AES");
+	if(env != nullptr && strcmp(env, "0") != 0 && strcmp(env, "no") != 0)
+		return cn_kernel::soft;
+
+	env = getenv("RYO_POW_KERNEL");
+	if(env == nullptr)
+		return cn_kernel::avx2;
+	else if(!strcmp(env, "soft"))
+		return cn_kernel::soft;
+	else if(!strcmp(env, "aes"))
+		return cn_kernel::aes;
+	else
+		return cn_kernel::avx2;
+}
+
+// "caveat emptor" hashed with v1, v2 and v3
+const char self_test_input[] = "caveat emptor";
+const uint8_t self_test_hashes[3][32] = {
+	{0xbb, 0xec, 0x2c, 0xac, 0xf6, 0x98, 0x66, 0xa8, 0xe7, 0x40, 0x38, 0x0f, 0xe7, 0xb8, 0x18, 0xfc,
+	 0x78, 0xf8, 0x57, 0x12, 0x21, 0x74, 0x2d, 0x72, 0x9d, 0x9d, 0x02, 0xd7, 0xf8, 0x98, 0x9b, 0x87},
+	{0x45, 0xf1, 0xfb, 0xd7, 0xec, 0xdb, 0xbf, 0x9a, 0x94, 0xc1, 0xd5, 0x5c, 0xe7, 0xe5, 0xaa, 0x9c,
+	 0xa3, 0x7d, 0xe9, 0xf7, 0x75, 0x68, 0xcd, 0xde, 0x24, 0x3f, 0x77, 0xf6, 0x66, 0x3c, 0xc2, 0x78},
+	{0x3b, 0xed, 0xc0, 0x05, 0x5a, 0x24, 0x35, 0x1c, 0x20, 0xd5, 0x50, 0x4c, 0x11, 0x82, 0xd6, 0x70,
+	 0x98, 0x89, 0xd0, 0xf0, 0xa1, 0xe0, 0xe5, 0xd8, 0xf9, 0x4d, 0x5f, 0x97, 0xc2, 0x49, 0x43, 0xba}};
+} // namespace
+
+const cn_cpu_features& cn_get_cpu_features()
+{
+	static const cn_cpu_features features = probe_cpu_features();
+	return features;
+}
+
+const char* cn_kernel_str(cn_kernel kernel)
+{
+	switch(kernel)
+	{
+	case cn_kernel::soft:
+		return "soft";
+	case cn_kernel::aes:
+		return "aes";
+	case cn_kernel::avx2:
+		return "avx2";
+	}
+	return "unknown";
+}
+
+template <size_t MEMORY, size_t ITER, size_t VERSION>
+bool cn_slow_hash<MEMORY, ITER, VERSION>::kernel_supported(cn_kernel kernel)
+{
+	const cn_cpu_features& cpu = cn_get_cpu_features();
+	switch(kernel)
+	{
+	case cn_kernel::soft:
+		return true;
+	case cn_kernel::aes:
+		return cpu.aes;
+	case cn_kernel::avx2:
+		return VERSION > 1 && cpu.aes && cpu.avx2;
+	}
+	return false;
+}
+
+template <size_t MEMORY, size_t ITER, size_t VERSION>
+typename cn_slow_hash<MEMORY, ITER, VERSION>::kernel_table cn_slow_hash<MEMORY, ITER, VERSION>::make_kernel_table(cn_kernel id)
+{
+	kernel_table k;
+	k.id = id;
+	k.verified = false;
+
+	switch(id)
+	{
+#if defined(HAS_INTEL_HW)
+	case cn_kernel::avx2:
+		k.lanes_1 = &hardware_hash_3_n<1, true>;
+		k.lanes_2 = &hardware_hash_3_n<2, true>;
+		k.lanes_4 = &hardware_hash_3_n<4, true>;
+		break;
+	case cn_kernel::aes:
+		k.lanes_1 = VERSION <= 1 ? &hardware_hash_n<1> : &hardware_hash_3_n<1, false>;
+		k.lanes_2 = VERSION <= 1 ? &hardware_hash_n<2> : &hardware_hash_3_n<2, false>;
+		k.lanes_4 = VERSION <= 1 ? &hardware_hash_n<4> : &hardware_hash_3_n<4, false>;
+		break;
+#elif defined(HAS_ARM_HW)
+	case cn_kernel::avx2:
+	case cn_kernel::aes:
+		k.lanes_1 = VERSION <= 1 ? &serial_lanes<1, &cn_slow_hash::hardware_hash> : &serial_lanes<1, &cn_slow_hash::hardware_hash_3>;
+		k.lanes_2 = VERSION <= 1 ? &serial_lanes<2, &cn_slow_hash::hardware_hash> : &serial_lanes<2, &cn_slow_hash::hardware_hash_3>;
+		k.lanes_4 = VERSION <= 1 ? &serial_lanes<4, &cn_slow_hash::hardware_hash> : &serial_lanes<4, &cn_slow_hash::hardware_hash_3>;
+		break;
+#endif
+	default:
+		k.id = cn_kernel::soft;
+		k.lanes_1 = VERSION <= 1 ? &serial_lanes<1, &cn_slow_hash::software_hash> : &serial_lanes<1, &cn_slow_hash::software_hash_3>;
+		k.lanes_2 = VERSION <= 1 ? &serial_lanes<2, &cn_slow_hash::software_hash> : &serial_lanes<2, &cn_slow_hash::software_hash_3>;
+		k.lanes_4 = VERSION <= 1 ? &serial_lanes<4, &cn_slow_hash::software_hash> : &serial_lanes<4, &cn_slow_hash::software_hash_3>;
+		break;
+	}
+	return k;
+}
+
+template <size_t MEMORY, size_t ITER, size_t VERSION>
+bool cn_slow_hash<MEMORY, ITER, VERSION>::self_test(const kernel_table& k)
+{
+	cn_slow_hash ctx;
+	cn_slow_hash* lane = &ctx;
+	const void* in = self_test_input;
+	size_t len = sizeof(self_test_input) - 1;
+	uint8_t hash[32];
+	void* out = hash;
+
+	k.lanes_1(&lane, &in, &len, &out);
+	return memcmp(hash, self_test_hashes[VERSION], sizeof(hash)) == 0;
+}
+
+template <size_t MEMORY, size_t ITER, size_t VERSION>
+const typename cn_slow_hash<MEMORY, ITER, VERSION>::kernel_table& cn_slow_hash<MEMORY, ITER, VERSION>::get_kernel()
+{
+	static const kernel_table kernel = []() {
+		const cn_kernel max_kernel = kernel_override();
+
+		// Candidates from the fastest one, the first that passes the self-test wins
+		const cn_kernel candidates[] = {cn_kernel::avx2, cn_kernel::aes, cn_kernel::soft};
+		for(cn_kernel candidate : candidates)
+		{
+			if(candidate > max_kernel || !kernel_supported(candidate))
+				continue;
+
+			kernel_table k = make_kernel_table(candidate);
+			if(self_test(k))
+			{
+				k.verified = true;
+				return k;
+			}
+		}
+
+		// Nothing passed, there is no better option than the portable code
+		return make_kernel_table(cn_kernel::soft);
+	}();
+	return kernel;
+}
+
+#define CN_INSTANTIATE_DISPATCH(cn_hash_t)                                    \
+	template bool cn_hash_t::kernel_supported(cn_kernel);                     \
+	template const cn_hash_t::kernel_table& cn_hash_t::get_kernel();          \
+	template cn_hash_t::kernel_table cn_hash_t::make_kernel_table(cn_kernel); \
+	template bool cn_hash_t::self_test(const cn_hash_t::kernel_table&);
+
+CN_INSTANTIATE_DISPATCH(cn_v1_hash_t)
+CN_INSTANTIATE_DISPATCH(cn_v2_hash_t)
+CN_INSTANTIATE_DISPATCH(cn_v3_hash_t)
@@ -333,72 +333,98 @@ inline uint64_t xmm_extract_64(__m128i x)
 template <size_t MEMORY, size_t ITER, size_t VERSION>
 void cn_slow_hash<MEMORY, ITER, VERSION>::hardware_hash(const void* in, size_t len, void* out)
 {
-	keccak((const uint8_t*)in, len, spad.as_byte(), 200);
+	cn_slow_hash* self = this;
+	hardware_hash_n<1>(&self, &in, &len, &out);
+}
 
-	explode_scratchpad_hard();
+template <size_t MEMORY, size_t ITER, size_t VERSION>
+template <size_t N>
+void cn_slow_hash<MEMORY, ITER, VERSION>::hardware_hash_n(cn_slow_hash* const* ctx, const void* const* in, const size_t* len, void* const* out)
+{
+	uint64_t al[N], ah[N], idx[N];
+	__m128i bx[N];
 
-	uint64_t* h0 = spad.as_uqword();
+	for(size_t l = 0; l < N; l++)
+	{
+		keccak((const uint8_t*)in[l], len[l], ctx[l]->spad.as_byte(), 200);
 
-	uint64_t al0 = h0[0] ^ h0[4];
-	uint64_t ah0 = h0[1] ^ h0[5];
-	__m128i bx0 = _mm_set_epi64x(h0[3] ^ h0[7], h0[2] ^ h0[6]);
+		ctx[l]->explode_scratchpad_hard();
 
-	uint64_t idx0 = h0[0] ^ h0[4];
+		uint64_t* h0 = ctx[l]->spad.as_uqword();
+
+		al[l] = h0[0] ^ h0[4];
+		ah[l] = h0[1] ^ h0[5];
+		bx[l] = _mm_set_epi64x(h0[3] ^ h0[7], h0[2] ^ h0[6]);
+		idx[l] = h0[0] ^ h0[4];
+	}
 
 	// Optim - 90% time boundary
+	// Every step is done for all lanes before moving to the next one, the scratchpad
+	// accesses of the lanes are independent so their latency overlaps
 	for(size_t i = 0; i < ITER; i++)
 	{
-		__m128i cx;
-		cx = _mm_load_si128(scratchpad_ptr(idx0).template as_ptr<__m128i>());
+		uint64_t cl[N], ch[N];
 
-		cx = _mm_aesenc_si128(cx, _mm_set_epi64x(ah0, al0));
+		for(size_t l = 0; l < N; l++)
+		{
+			__m128i cx;
+			cx = _mm_load_si128(ctx[l]->scratchpad_ptr(idx[l]).template as_ptr<__m128i>());
 
-		_mm_store_si128(scratchpad_ptr(idx0).template as_ptr<__m128i>(), _mm_xor_si128(bx0, cx));
-		idx0 = xmm_extract_64(cx);
-		bx0 = cx;
+			cx = _mm_aesenc_si128(cx, _mm_set_epi64x(ah[l], al[l]));
 
-		uint64_t hi, lo, cl, ch;
-		cl = scratchpad_ptr(idx0).as_uqword(0);
-		ch = scratchpad_ptr(idx0).as_uqword(1);
+			_mm_store_si128(ctx[l]->scratchpad_ptr(idx[l]).template as_ptr<__m128i>(), _mm_xor_si128(bx[l], cx));
+			idx[l] = xmm_extract_64(cx);
+			bx[l] = cx;
 
-		lo = _umul128(idx0, cl, &hi);
+			cl[l] = ctx[l]->scratchpad_ptr(idx[l]).as_uqword(0);
+			ch[l] = ctx[l]->scratchpad_ptr(idx[l]).as_uqword(1);
+		}
 
-		al0 += hi;
-		ah0 += lo;
-		scratchpad_ptr(idx0).as_uqword(0) = al0;
-		scratchpad_ptr(idx0).as_uqword(1) = ah0;
-		ah0 ^= ch;
-		al0 ^= cl;
-		idx0 = al0;
+		for(size_t l = 0; l < N; l++)
+		{
+			uint64_t hi, lo;
+			lo = _umul128(idx[l], cl[l], &hi);
+
+			al[l] += hi;
+			ah[l] += lo;
+			ctx[l]->scratchpad_ptr(idx[l]).as_uqword(0) = al[l];
+			ctx[l]->scratchpad_ptr(idx[l]).as_uqword(1) = ah[l];
+			ah[l] ^= ch[l];
+			al[l] ^= cl[l];
+			idx[l] = al[l];
+		}
 
-		if(VERSION > 0)
+		for(size_t l = 0; VERSION > 0 && l < N; l++)
 		{
-			int64_t n = scratchpad_ptr(idx0).as_qword(0);
-			int32_t d = scratchpad_ptr(idx0).as_dword(2);
+			int64_t n = ctx[l]->scratchpad_ptr(idx[l]).as_qword(0);
+			int32_t d = ctx[l]->scratchpad_ptr(idx[l]).as_dword(2);
 			int64_t q = n / (d | 5);
-			scratchpad_ptr(idx0).as_qword(0) = n ^ q;
-			idx0 = d ^ q;
+			ctx[l]->scratchpad_ptr(idx[l]).as_qword(0) = n ^ q;
+			idx[l] = d ^ q;
 		}
 	}
 
-	implode_scratchpad_hard();
+	for(size_t l = 0; l < N; l++)
+	{
+		ctx[l]->implode_scratchpad_hard();
 
-	keccakf(spad.as_uqword());
+		keccakf(ctx[l]->spad.as_uqword());
 
-	switch(spad.as_byte(0) & 3)
-	{
-	case 0:
-		blake256_hash(spad.as_byte(), (uint8_t*)out);
-		break;
-	case 1:
-		groestl_hash(spad.as_byte(), (uint8_t*)out);
-		break;
-	case 2:
-		jh_hash(spad.as_byte(), (uint8_t*)out);
-		break;
-	case 3:
-		skein_hash(spad.as_byte(), (uint8_t*)out);
-		break;
+		switch(ctx[l]->spad.as_byte(0) & 3)
+		{
+		case 0:
+			blake256_hash(ctx[l]->spad.as_byte(), (uint8_t*)out[l]);
+			break;
+		case 1:
+			groestl_hash(ctx[l]->spad.as_byte(), (uint8_t*)out[l]);
+			break;
+		case 2:
+			jh_hash(ctx[l]->spad.as_byte(), (uint8_t*)out[l]);
+			break;
+		case 3:
+			skein_hash(ctx[l]->spad.as_byte(), (uint8_t*)out[l]);
+			break;
+		}
 	}
 }
 
@@ -501,99 +527,134 @@ inline void single_comupte_wrap(__m128 n0, __m128 n1, __m128 n2, __m128 n3, floa
 template <size_t MEMORY, size_t ITER, size_t VERSION>
 void cn_slow_hash<MEMORY, ITER, VERSION>::inner_hash_3()
 {
-	uint32_t s = spad.as_dword(0) >> 8;
-	cn_sptr idx0 = scratchpad_ptr(s, 0);
-	cn_sptr idx1 = scratchpad_ptr(s, 1);
-	cn_sptr idx2 = scratchpad_ptr(s, 2);
-	cn_sptr idx3 = scratchpad_ptr(s, 3);
-	__m128 sum0 = _mm_setzero_ps();
+	cn_slow_hash* self = this;
+	inner_hash_3_n<1>(&self);
+}
+
+template <size_t MEMORY, size_t ITER, size_t VERSION>
+template <size_t N>
+void cn_slow_hash<MEMORY, ITER, VERSION>::inner_hash_3_n(cn_slow_hash* const* ctx)
+{
+	cn_sptr idx0[N], idx1[N], idx2[N], idx3[N];
+	__m128 sum0[N];
+
+	for(size_t l = 0; l < N; l++)
+	{
+		uint32_t s = ctx[l]->spad.as_dword(0) >> 8;
+		idx0[l] = ctx[l]->scratchpad_ptr(s, 0);
+		idx1[l] = ctx[l]->scratchpad_ptr(s, 1);
+		idx2[l] = ctx[l]->scratchpad_ptr(s, 2);
+		idx3[l] = ctx[l]->scratchpad_ptr(s, 3);
+		sum0[l] = _mm_setzero_ps();
+	}
 
 	for(size_t i = 0; i < ITER; i++)
 	{
-		__m128 n0, n1, n2, n3;
-		__m128i v0, v1, v2, v3;
-		__m128 suma, sumb, sum1, sum2, sum3;
-
-		prep_dv(idx0, v0, n0);
-		prep_dv(idx1, v1, n1);
-		prep_dv(idx2, v2, n2);
-		prep_dv(idx3, v3, n3);
-		__m128 rc = sum0;
-
-		__m128i out, out2;
-		out = _mm_setzero_si128();
-		single_comupte_wrap<0>(n0, n1, n2, n3, 1.3437500f, rc, suma, out);
-		single_comupte_wrap<1>(n0, n2, n3, n1, 1.2812500f, rc, suma, out);
-		single_comupte_wrap<2>(n0, n3, n1, n2, 1.3593750f, rc, sumb, out);
-		single_comupte_wrap<3>(n0, n3, n2, n1, 1.3671875f, rc, sumb, out);
-		sum0 = _mm_add_ps(suma, sumb);
-		_mm_store_si128(idx0.as_ptr<__m128i>(), _mm_xor_si128(v0, out));
-		out2 = out;
-
-		out = _mm_setzero_si128();
-		single_comupte_wrap<0>(n1, n0, n2, n3, 1.4296875f, rc, suma, out);
-		single_comupte_wrap<1>(n1, n2, n3, n0, 1.3984375f, rc, suma, out);
-		single_comupte_wrap<2>(n1, n3, n0, n2, 1.3828125f, rc, sumb, out);
-		single_comupte_wrap<3>(n1, n3, n2, n0, 1.3046875f, rc, sumb, out);
-		sum1 = _mm_add_ps(suma, sumb);
-		_mm_store_si128(idx1.as_ptr<__m128i>(), _mm_xor_si128(v1, out));
-		out2 = _mm_xor_si128(out2, out);
-
-		out = _mm_setzero_si128();
-		single_comupte_wrap<0>(n2, n1, n0, n3, 1.4140625f, rc, suma, out);
-		single_comupte_wrap<1>(n2, n0, n3, n1, 1.2734375f, rc, suma, out);
-		single_comupte_wrap<2>(n2, n3, n1, n0, 1.2578125f, rc, sumb, out);
-		single_comupte_wrap<3>(n2, n3, n0, n1, 1.2890625f, rc, sumb, out);
-		sum2 = _mm_add_ps(suma, sumb);
-		_mm_store_si128(idx2.as_ptr<__m128i>(), _mm_xor_si128(v2, out));
-		out2 = _mm_xor_si128(out2, out);
-
-		out = _mm_setzero_si128();
-		single_comupte_wrap<0>(n3, n1, n2, n0, 1.3203125f, rc, suma, out);
-		single_comupte_wrap<1>(n3, n2, n0, n1, 1.3515625f, rc, suma, out);
-		single_comupte_wrap<2>(n3, n0, n1, n2, 1.3359375f, rc, sumb, out);
-		single_comupte_wrap<3>(n3, n0, n2, n1, 1.4609375f, rc, sumb, out);
-		sum3 = _mm_add_ps(suma, sumb);
-		_mm_store_si128(idx3.as_ptr<__m128i>(), _mm_xor_si128(v3, out));
-		out2 = _mm_xor_si128(out2, out);
-		sum0 = _mm_add_ps(sum0, sum1);
-		sum2 = _mm_add_ps(sum2, sum3);
-		sum0 = _mm_add_ps(sum0, sum2);
-
-		sum0 = _mm_and_ps(_mm_set1_ps_epi32(0x7fffffff), sum0); // take abs(va) by masking the float sign bit
-		// vs range 0 - 64
-		n0 = _mm_mul_ps(sum0, _mm_set1_ps(16777216.0f));
-		v0 = _mm_cvttps_epi32(n0);
-		v0 = _mm_xor_si128(v0, out2);
-		v1 = _mm_shuffle_epi32(v0, _MM_SHUFFLE(0, 1, 2, 3));
-		v0 = _mm_xor_si128(v0, v1);
-		v1 = _mm_shuffle_epi32(v0, _MM_SHUFFLE(0, 1, 0, 1));
-		v0 = _mm_xor_si128(v0, v1);
-
-		// vs is now between 0 and 1
-		sum0 = _mm_div_ps(sum0, _mm_set1_ps(64.0f));
-		uint32_t n = _mm_cvtsi128_si32(v0);
-		idx0 = scratchpad_ptr(n, 0);
-		idx1 = scratchpad_ptr(n, 1);
-		idx2 = scratchpad_ptr(n, 2);
-		idx3 = scratchpad_ptr(n, 3);
+		for(size_t l = 0; l < N; l++)
+		{
+			__m128 n0, n1, n2, n3;
+			__m128i v0, v1, v2, v3;
+			__m128 suma, sumb, sum1, sum2, sum3;
+
+			prep_dv(idx0[l], v0, n0);
+			prep_dv(idx1[l], v1, n1);
+			prep_dv(idx2[l], v2, n2);
+			prep_dv(idx3[l], v3, n3);
+			__m128 rc = sum0[l];
+
+			__m128i out, out2;
+			out = _mm_setzero_si128();
+			single_comupte_wrap<0>(n0, n1, n2, n3, 1.3437500f, rc, suma, out);
+			single_comupte_wrap<1>(n0, n2, n3, n1, 1.2812500f, rc, suma, out);
+			single_comupte_wrap<2>(n0, n3, n1, n2, 1.3593750f, rc, sumb, out);
+			single_comupte_wrap<3>(n0, n3, n2, n1, 1.3671875f, rc, sumb, out);
+			sum0[l] = _mm_add_ps(suma, sumb);
+			_mm_store_si128(idx0[l].template as_ptr<__m128i>(), _mm_xor_si128(v0, out));
+			out2 = out;
+
+			out = _mm_setzero_si128();
+			single_comupte_wrap<0>(n1, n0, n2, n3, 1.4296875f, rc, suma, out);
+			single_comupte_wrap<1>(n1, n2, n3, n0, 1.3984375f, rc, suma, out);
+			single_comupte_wrap<2>(n1, n3, n0, n2, 1.3828125f, rc, sumb, out);
+			single_comupte_wrap<3>(n1, n3, n2, n0, 1.3046875f, rc, sumb, out);
+			sum1 = _mm_add_ps(suma, sumb);
+			_mm_store_si128(idx1[l].template as_ptr<__m128i>(), _mm_xor_si128(v1, out));
+			out2 = _mm_xor_si128(out2, out);
+
+			out = _mm_setzero_si128();
+			single_comupte_wrap<0>(n2, n1, n0, n3, 1.4140625f, rc, suma, out);
+			single_comupte_wrap<1>(n2, n0, n3, n1, 1.2734375f, rc, suma, out);
+			single_comupte_wrap<2>(n2, n3, n1, n0, 1.2578125f, rc, sumb, out);
+			single_comupte_wrap<3>(n2, n3, n0, n1, 1.2890625f, rc, sumb, out);
+			sum2 = _mm_add_ps(suma, sumb);
+			_mm_store_si128(idx2[l].template as_ptr<__m128i>(), _mm_xor_si128(v2, out));
+			out2 = _mm_xor_si128(out2, out);
+
+			out = _mm_setzero_si128();
+			single_comupte_wrap<0>(n3, n1, n2, n0, 1.3203125f, rc, suma, out);
+			single_comupte_wrap<1>(n3, n2, n0, n1, 1.3515625f, rc, suma, out);
+			single_comupte_wrap<2>(n3, n0, n1, n2, 1.3359375f, rc, sumb, out);
+			single_comupte_wrap<3>(n3, n0, n2, n1, 1.4609375f, rc, sumb, out);
+			sum3 = _mm_add_ps(suma, sumb);
+			_mm_store_si128(idx3[l].template as_ptr<__m128i>(), _mm_xor_si128(v3, out));
+			out2 = _mm_xor_si128(out2, out);
+			sum0[l] = _mm_add_ps(sum0[l], sum1);
+			sum2 = _mm_add_ps(sum2, sum3);
+			sum0[l] = _mm_add_ps(sum0[l], sum2);
+
+			sum0[l] = _mm_and_ps(_mm_set1_ps_epi32(0x7fffffff), sum0[l]); // take abs(va) by masking the float sign bit
+			// vs range 0 - 64
+			n0 = _mm_mul_ps(sum0[l], _mm_set1_ps(16777216.0f));
+			v0 = _mm_cvttps_epi32(n0);
+			v0 = _mm_xor_si128(v0, out2);
+			v1 = _mm_shuffle_epi32(v0, _MM_SHUFFLE(0, 1, 2, 3));
+			v0 = _mm_xor_si128(v0, v1);
+			v1 = _mm_shuffle_epi32(v0, _MM_SHUFFLE(0, 1, 0, 1));
+			v0 = _mm_xor_si128(v0, v1);
+
+			// vs is now between 0 and 1
+			sum0[l] = _mm_div_ps(sum0[l], _mm_set1_ps(64.0f));
+			uint32_t n = _mm_cvtsi128_si32(v0);
+			idx0[l] = ctx[l]->scratchpad_ptr(n, 0);
+			idx1[l] = ctx[l]->scratchpad_ptr(n, 1);
+			idx2[l] = ctx[l]->scratchpad_ptr(n, 2);
+			idx3[l] = ctx[l]->scratchpad_ptr(n, 3);
+		}
 	}
 }
 
 template <size_t MEMORY, size_t ITER, size_t VERSION>
 void cn_slow_hash<MEMORY, ITER, VERSION>::hardware_hash_3(const void* in, size_t len, void* pout)
 {
-	keccak((const uint8_t*)in, len, spad.as_byte(), 200);
+	cn_slow_hash* self = this;
+	if(cn_get_cpu_features().avx2)
+		hardware_hash_3_n<1, true>(&self, &in, &len, &pout);
+	else
+		hardware_hash_3_n<1, false>(&self, &in, &len, &pout);
+}
 
-	explode_scratchpad_3();
-	if(check_avx2())
-		inner_hash_3_avx();
+template <size_t MEMORY, size_t ITER, size_t VERSION>
+template <size_t N, bool AVX2>
+void cn_slow_hash<MEMORY, ITER, VERSION>::hardware_hash_3_n(cn_slow_hash* const* ctx, const void* const* in, const size_t* len, void* const* out)
+{
+	for(size_t l = 0; l < N; l++)
+	{
+		keccak((const uint8_t*)in[l], len[l], ctx[l]->spad.as_byte(), 200);
+		ctx[l]->explode_scratchpad_3();
+	}
+
+	if(AVX2)
+		inner_hash_3_avx_n<N>(ctx);
 	else
-		inner_hash_3();
-	implode_scratchpad_hard();
+		inner_hash_3_n<N>(ctx);
 
-	keccakf(spad.as_uqword());
-	memcpy(pout, spad.as_byte(), 32);
+	for(size_t l = 0; l < N; l++)
+	{
+		ctx[l]->implode_scratchpad_hard();
+
+		keccakf(ctx[l]->spad.as_uqword());
+		memcpy(out[l], ctx[l]->spad.as_byte(), 32);
+	}
 }
 
 template <size_t MEMORY, size_t ITER, size_t VERSION>
@@ -601,17 +662,31 @@ void cn_slow_hash<MEMORY, ITER, VERSION>::software_hash_3(const void* in, size_t
 {
 	keccak((const uint8_t*)in, len, spad.as_byte(), 200);
 
+	// the portable loop even on AVX2 hosts, the avx2 kernel has its own table entry
 	explode_scratchpad_3();
-	if(check_avx2())
-		inner_hash_3_avx();
-	else
-		inner_hash_3();
+	inner_hash_3();
 	implode_scratchpad_soft();
 
 	keccakf(spad.as_uqword());
 	memcpy(pout, spad.as_byte(), 32);
 }
 
+#define CN_INSTANTIATE_HASH_N(cn_hash_t, N)                                                                                               \
+	template void cn_hash_t::hardware_hash_n<N>(cn_hash_t* const* ctx, const void* const* in, const size_t* len, void* const* out);         \
+	template void cn_hash_t::hardware_hash_3_n<N, false>(cn_hash_t* const* ctx, const void* const* in, const size_t* len, void* const* out); \
+	template void cn_hash_t::hardware_hash_3_n<N, true>(cn_hash_t* const* ctx, const void* const* in, const size_t* len, void* const* out);  \
+	template void cn_hash_t::inner_hash_3_n<N>(cn_hash_t* const* ctx);
+
+CN_INSTANTIATE_HASH_N(cn_v1_hash_t, 1)
+CN_INSTANTIATE_HASH_N(cn_v1_hash_t, 2)
+CN_INSTANTIATE_HASH_N(cn_v1_hash_t, 4)
+CN_INSTANTIATE_HASH_N(cn_v2_hash_t, 1)
+CN_INSTANTIATE_HASH_N(cn_v2_hash_t, 2)
+CN_INSTANTIATE_HASH_N(cn_v2_hash_t, 4)
+CN_INSTANTIATE_HASH_N(cn_v3_hash_t, 1)
+CN_INSTANTIATE_HASH_N(cn_v3_hash_t, 2)
+CN_INSTANTIATE_HASH_N(cn_v3_hash_t, 4)
+
 template class cn_v1_hash_t;
 template class cn_v2_hash_t;
 template class cn_v3_hash_t;
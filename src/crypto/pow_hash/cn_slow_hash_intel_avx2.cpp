@@ -157,79 +157,102 @@ inline void double_comupte_wrap(const __m256& n0, const __m256& n1, const __m256
 }
 
 template <size_t MEMORY, size_t ITER, size_t VERSION>
-void cn_slow_hash<MEMORY, ITER, VERSION>::inner_hash_3_avx()
+template <size_t N>
+void cn_slow_hash<MEMORY, ITER, VERSION>::inner_hash_3_avx_n(cn_slow_hash* const* ctx)
 {
-	uint32_t s = spad.as_dword(0) >> 8;
-	cn_sptr idx0 = scratchpad_ptr(s, 0);
-	cn_sptr idx2 = scratchpad_ptr(s, 2);
-	__m256 sum0 = _mm256_setzero_ps();
+	cn_sptr idx0[N], idx2[N];
+	__m256 sum0[N];
+
+	for(size_t l = 0; l < N; l++)
+	{
+		uint32_t s = ctx[l]->spad.as_dword(0) >> 8;
+		idx0[l] = ctx[l]->scratchpad_ptr(s, 0);
+		idx2[l] = ctx[l]->scratchpad_ptr(s, 2);
+		sum0[l] = _mm256_setzero_ps();
+	}
 
 	for(size_t i = 0; i < ITER; i++)
 	{
-		__m256i v01, v23;
-		__m256 suma, sumb, sum1;
-		__m256 rc = sum0;
-
-		__m256 n01, n23;
-		prep_dv_avx(idx0, v01, n01);
-		prep_dv_avx(idx2, v23, n23);
-
-		__m256i out, out2;
-		__m256 n10, n22, n33;
-		n10 = _mm256_permute2f128_ps(n01, n01, 0x01);
-		n22 = _mm256_permute2f128_ps(n23, n23, 0x00);
-		n33 = _mm256_permute2f128_ps(n23, n23, 0x11);
-
-		out = _mm256_setzero_si256();
-		double_comupte_wrap<0>(n01, n10, n22, n33, 1.3437500f, 1.4296875f, rc, suma, out);
-		double_comupte_wrap<1>(n01, n22, n33, n10, 1.2812500f, 1.3984375f, rc, suma, out);
-		double_comupte_wrap<2>(n01, n33, n10, n22, 1.3593750f, 1.3828125f, rc, sumb, out);
-		double_comupte_wrap<3>(n01, n33, n22, n10, 1.3671875f, 1.3046875f, rc, sumb, out);
-		_mm256_store_si256(idx0.as_ptr<__m256i>(), _mm256_xor_si256(v01, out));
-		sum0 = _mm256_add_ps(suma, sumb);
-		out2 = out;
-
-		__m256 n11, n02, n30;
-		n11 = _mm256_permute2f128_ps(n01, n01, 0x11);
-		n02 = _mm256_permute2f128_ps(n01, n23, 0x20);
-		n30 = _mm256_permute2f128_ps(n01, n23, 0x03);
-
-		out = _mm256_setzero_si256();
-		double_comupte_wrap<0>(n23, n11, n02, n30, 1.4140625f, 1.3203125f, rc, suma, out);
-		double_comupte_wrap<1>(n23, n02, n30, n11, 1.2734375f, 1.3515625f, rc, suma, out);
-		double_comupte_wrap<2>(n23, n30, n11, n02, 1.2578125f, 1.3359375f, rc, sumb, out);
-		double_comupte_wrap<3>(n23, n30, n02, n11, 1.2890625f, 1.4609375f, rc, sumb, out);
-		_mm256_store_si256(idx2.as_ptr<__m256i>(), _mm256_xor_si256(v23, out));
-		sum1 = _mm256_add_ps(suma, sumb);
-
-		out2 = _mm256_xor_si256(out2, out);
-		out2 = _mm256_xor_si256(_mm256_permute2x128_si256(out2, out2, 0x41), out2);
-		suma = _mm256_permute2f128_ps(sum0, sum1, 0x30);
-		sumb = _mm256_permute2f128_ps(sum0, sum1, 0x21);
-		sum0 = _mm256_add_ps(suma, sumb);
-		sum0 = _mm256_add_ps(sum0, _mm256_permute2f128_ps(sum0, sum0, 0x41));
-
-		// Clear the high 128 bits
-		__m128 sum = _mm256_castps256_ps128(sum0);
-
-		sum = _mm_and_ps(_mm_set1_ps_epi32(0x7fffffff), sum); // take abs(va) by masking the float sign bit
-		// vs range 0 - 64
-		__m128i v0 = _mm_cvttps_epi32(_mm_mul_ps(sum, _mm_set1_ps(16777216.0f)));
-		v0 = _mm_xor_si128(v0, _mm256_castsi256_si128(out2));
-		__m128i v1 = _mm_shuffle_epi32(v0, _MM_SHUFFLE(0, 1, 2, 3));
-		v0 = _mm_xor_si128(v0, v1);
-		v1 = _mm_shuffle_epi32(v0, _MM_SHUFFLE(0, 1, 0, 1));
-		v0 = _mm_xor_si128(v0, v1);
-
-		// vs is now between 0 and 1
-		sum = _mm_div_ps(sum, _mm_set1_ps(64.0f));
-		sum0 = _mm256_insertf128_ps(_mm256_castps128_ps256(sum), sum, 1);
-		uint32_t n = _mm_cvtsi128_si32(v0);
-		idx0 = scratchpad_ptr(n, 0);
-		idx2 = scratchpad_ptr(n, 2);
+		for(size_t l = 0; l < N; l++)
+		{
+			__m256i v01, v23;
+			__m256 suma, sumb, sum1;
+			__m256 rc = sum0[l];
+
+			__m256 n01, n23;
+			prep_dv_avx(idx0[l], v01, n01);
+			prep_dv_avx(idx2[l], v23, n23);
+
+			__m256i out, out2;
+			__m256 n10, n22, n33;
+			n10 = _mm256_permute2f128_ps(n01, n01, 0x01);
+			n22 = _mm256_permute2f128_ps(n23, n23, 0x00);
+			n33 = _mm256_permute2f128_ps(n23, n23, 0x11);
+
+			out = _mm256_setzero_si256();
+			double_comupte_wrap<0>(n01, n10, n22, n33, 1.3437500f, 1.4296875f, rc, suma, out);
+			double_comupte_wrap<1>(n01, n22, n33, n10, 1.2812500f, 1.3984375f, rc, suma, out);
+			double_comupte_wrap<2>(n01, n33, n10, n22, 1.3593750f, 1.3828125f, rc, sumb, out);
+			double_comupte_wrap<3>(n01, n33, n22, n10, 1.3671875f, 1.3046875f, rc, sumb, out);
+			_mm256_store_si256(idx0[l].template as_ptr<__m256i>(), _mm256_xor_si256(v01, out));
+			sum0[l] = _mm256_add_ps(suma, sumb);
+			out2 = out;
+
+			__m256 n11, n02, n30;
+			n11 = _mm256_permute2f128_ps(n01, n01, 0x11);
+			n02 = _mm256_permute2f128_ps(n01, n23, 0x20);
+			n30 = _mm256_permute2f128_ps(n01, n23, 0x03);
+
+			out = _mm256_setzero_si256();
+			double_comupte_wrap<0>(n23, n11, n02, n30, 1.4140625f, 1.3203125f, rc, suma, out);
+			double_comupte_wrap<1>(n23, n02, n30, n11, 1.2734375f, 1.3515625f, rc, suma, out);
+			double_comupte_wrap<2>(n23, n30, n11, n02, 1.2578125f, 1.3359375f, rc, sumb, out);
+			double_comupte_wrap<3>(n23, n30, n02, n11, 1.2890625f, 1.4609375f, rc, sumb, out);
+			_mm256_store_si256(idx2[l].template as_ptr<__m256i>(), _mm256_xor_si256(v23, out));
+			sum1 = _mm256_add_ps(suma, sumb);
+
+			out2 = _mm256_xor_si256(out2, out);
+			out2 = _mm256_xor_si256(_mm256_permute2x128_si256(out2, out2, 0x41), out2);
+			suma = _mm256_permute2f128_ps(sum0[l], sum1, 0x30);
+			sumb = _mm256_permute2f128_ps(sum0[l], sum1, 0x21);
+			sum0[l] = _mm256_add_ps(suma, sumb);
+			sum0[l] = _mm256_add_ps(sum0[l], _mm256_permute2f128_ps(sum0[l], sum0[l], 0x41));
+
+			// Clear the high 128 bits
+			__m128 sum = _mm256_castps256_ps128(sum0[l]);
+
+			sum = _mm_and_ps(_mm_set1_ps_epi32(0x7fffffff), sum); // take abs(va) by masking the float sign bit
+			// vs range 0 - 64
+			__m128i v0 = _mm_cvttps_epi32(_mm_mul_ps(sum, _mm_set1_ps(16777216.0f)));
+			v0 = _mm_xor_si128(v0, _mm256_castsi256_si128(out2));
+			__m128i v1 = _mm_shuffle_epi32(v0, _MM_SHUFFLE(0, 1, 2, 3));
+			v0 = _mm_xor_si128(v0, v1);
+			v1 = _mm_shuffle_epi32(v0, _MM_SHUFFLE(0, 1, 0, 1));
+			v0 = _mm_xor_si128(v0, v1);
+
+			// vs is now between 0 and 1
+			sum = _mm_div_ps(sum, _mm_set1_ps(64.0f));
+			sum0[l] = _mm256_insertf128_ps(_mm256_castps128_ps256(sum), sum, 1);
+			uint32_t n = _mm_cvtsi128_si32(v0);
+			idx0[l] = ctx[l]->scratchpad_ptr(n, 0);
+			idx2[l] = ctx[l]->scratchpad_ptr(n, 2);
+		}
 	}
 }
 
+#define CN_INSTANTIATE_HASH_N(cn_hash_t, N) \
+	template void cn_hash_t::inner_hash_3_avx_n<N>(cn_hash_t* const* ctx);
+
+CN_INSTANTIATE_HASH_N(cn_v1_hash_t, 1)
+CN_INSTANTIATE_HASH_N(cn_v1_hash_t, 2)
+CN_INSTANTIATE_HASH_N(cn_v1_hash_t, 4)
+CN_INSTANTIATE_HASH_N(cn_v2_hash_t, 1)
+CN_INSTANTIATE_HASH_N(cn_v2_hash_t, 2)
+CN_INSTANTIATE_HASH_N(cn_v2_hash_t, 4)
+CN_INSTANTIATE_HASH_N(cn_v3_hash_t, 1)
+CN_INSTANTIATE_HASH_N(cn_v3_hash_t, 2)
+CN_INSTANTIATE_HASH_N(cn_v3_hash_t, 4)
+
 template class cn_v1_hash_t;
 template class cn_v2_hash_t;
 template class cn_v3_hash_t;
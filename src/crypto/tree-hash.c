@@ -84,6 +84,25 @@ size_t tree_hash_cnt(size_t count)
 	return pow >> 1;
 }
 
+#define TREE_HASH_BATCH 64
+
+void tree_hash_level(const char (*in)[HASH_SIZE], size_t count, char (*out)[HASH_SIZE])
+{
+	const void *data[TREE_HASH_BATCH];
+	size_t length[TREE_HASH_BATCH];
+	size_t j, k;
+
+	for(j = 0; j < count; j += k)
+	{
+		for(k = 0; k < TREE_HASH_BATCH && j + k < count; ++k)
+		{
+			data[k] = in[2 * (j + k)];
+			length[k] = 2 * HASH_SIZE;
+		}
+		cn_fast_hash_batch(data, length, k, out[j]);
+	}
+}
+
 void tree_hash(const char (*hashes)[HASH_SIZE], size_t count, char *root_hash)
 {
 	assert(count > 0);
@@ -97,7 +116,7 @@ void tree_hash(const char (*hashes)[HASH_SIZE], size_t count, char *root_hash)
 	}
 	else
 	{
-		size_t i, j;
+		size_t i;
 
 		size_t cnt = tree_hash_cnt(count);
 
@@ -108,19 +127,13 @@ void tree_hash(const char (*hashes)[HASH_SIZE], size_t count, char *root_hash)
 
 		memcpy(ints, hashes, (2 * cnt - count) * HASH_SIZE);
 
-		for(i = 2 * cnt - count, j = 2 * cnt - count; j < cnt; i += 2, ++j)
-		{
-			cn_fast_hash(hashes[i], 64, ints[j]);
-		}
-		assert(i == count);
+		i = 2 * cnt - count;
+		tree_hash_level(hashes + i, cnt - i, ints + i);
 
 		while(cnt > 2)
 		{
 			cnt >>= 1;
-			for(i = 0, j = 0; j < cnt; i += 2, ++j)
-			{
-				cn_fast_hash(ints[i], 64, ints[j]);
-			}
+			tree_hash_level(ints, cnt, ints);
 		}
 
 		cn_fast_hash(ints[0], 64, root_hash);
@@ -0,0 +1,143 @@
+// Copyright (c) 2019, Ryo Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2020
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <assert.h>
+#include <string.h>
+
+#include "tree_hash_builder.h"
+
+namespace crypto
+{
+typedef char hash_node[HASH_SIZE];
+
+static inline hash_node *as_nodes(hash *h)
+{
+	return reinterpret_cast<hash_node *>(h);
+}
+
+void tree_hash_builder::assign(const hash *leaves, size_t count)
+{
+	m_leaves.assign(leaves, leaves + count);
+	rebuild();
+}
+
+void tree_hash_builder::push_back(const hash &leaf)
+{
+	m_leaves.push_back(leaf);
+	rebuild();
+}
+
+void tree_hash_builder::clear()
+{
+	m_leaves.clear();
+	m_nodes.clear();
+	m_root = null_hash;
+}
+
+void tree_hash_builder::rebuild()
+{
+	size_t count = m_leaves.size();
+	if(count <= 2)
+	{
+		m_nodes.clear();
+		if(count == 0)
+			m_root = null_hash;
+		else
+			tree_hash(m_leaves.data(), count, m_root);
+		return;
+	}
+
+	size_t cnt = tree_hash_cnt(count);
+	size_t i = 2 * cnt - count;
+	m_nodes.resize(2 * cnt - 2);
+
+	hash_node *leaves = as_nodes(m_leaves.data());
+	hash_node *nodes = as_nodes(m_nodes.data());
+	memcpy(nodes, leaves, i * HASH_SIZE);
+	tree_hash_level(leaves + i, cnt - i, nodes + i);
+
+	size_t offset = 0;
+	for(size_t width = cnt; width > 2; width >>= 1)
+	{
+		tree_hash_level(nodes + offset, width >> 1, nodes + offset + width);
+		offset += width;
+	}
+	cn_fast_hash(nodes + offset, 2 * HASH_SIZE, m_root);
+}
+
+void tree_hash_builder::replace(size_t index, const hash &leaf)
+{
+	assert(index < m_leaves.size());
+	m_leaves[index] = leaf;
+
+	size_t count = m_leaves.size();
+	if(count <= 2)
+	{
+		tree_hash(m_leaves.data(), count, m_root);
+		return;
+	}
+
+	size_t cnt = tree_hash_cnt(count);
+	size_t i = 2 * cnt - count;
+	size_t pos;
+	if(index < i)
+	{
+		pos = index;
+		m_nodes[pos] = leaf;
+	}
+	else
+	{
+		pos = i + (index - i) / 2;
+		cn_fast_hash(&m_leaves[2 * pos - i], 2 * HASH_SIZE, m_nodes[pos]);
+	}
+
+	size_t offset = 0;
+	for(size_t width = cnt; width > 2; width >>= 1)
+	{
+		cn_fast_hash(&m_nodes[offset + (pos & ~size_t(1))], 2 * HASH_SIZE, m_nodes[offset + width + (pos >> 1)]);
+		offset += width;
+		pos >>= 1;
+	}
+	cn_fast_hash(&m_nodes[offset], 2 * HASH_SIZE, m_root);
+}
+}
@@ -0,0 +1,100 @@
+// Copyright (c) 2019, Ryo Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2020
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+
+#include "hash.h"
+
+namespace crypto
+{
+/**
+ * Keeps the leaves and every intermediate level of a transaction tree so the root of
+ * a tree that differs in a single leaf can be had without hashing the whole tree again.
+ * The layout is the one of tree_hash(), so root() always equals tree_hash() of the leaves.
+ */
+class tree_hash_builder
+{
+  public:
+	tree_hash_builder() : m_root(null_hash) {}
+
+	/**
+	 * @brief replaces all leaves and rebuilds the tree, hashing each level in batches
+	 */
+	void assign(const hash *leaves, size_t count);
+
+	/**
+	 * @brief appends a leaf
+	 *
+	 * Adding a leaf moves the boundary between the leaves that are copied into the first
+	 * level and the ones that are paired up, so every pair changes. The levels are
+	 * rebuilt in place with batched hashing.
+	 */
+	void push_back(const hash &leaf);
+
+	/**
+	 * @brief changes a single leaf, rehashing only the log2(size) nodes above it
+	 */
+	void replace(size_t index, const hash &leaf);
+
+	void clear();
+
+	size_t size() const { return m_leaves.size(); }
+	const hash &leaf(size_t index) const { return m_leaves[index]; }
+
+	/**
+	 * @brief the tree root, null_hash while the tree is empty
+	 */
+	const hash &root() const { return m_root; }
+
+  private:
+	void rebuild();
+
+	std::vector<hash> m_leaves;
+	// levels stored back to back, widest first, down to the two nodes under the root
+	std::vector<hash> m_nodes;
+	hash m_root;
+};
+}
@@ -57,6 +57,7 @@ using namespace epee;
 #include "string_tools.h"
 #include "wipeable_string.h"
 #include <atomic>
+#include <numeric>
 #include <boost/algorithm/string.hpp>
 
 //#undef RYO_DEFAULT_LOG_CATEGORY
@@ -135,7 +136,7 @@ static void add_public_key(crypto::public_key &AB, const crypto::public_key &A,
 namespace cryptonote
 {
 //---------------------------------------------------------------
-void get_transaction_prefix_hash(const transaction_prefix &tx, crypto::hash &h)
+static std::string get_transaction_prefix_blob(const transaction_prefix &tx)
 {
 	std::ostringstream s;
 
@@ -144,7 +145,13 @@ void get_transaction_prefix_hash(const transaction_prefix &tx, crypto::hash &h)
 
 	binary_archive<true> a(s);
 	::serialization::serialize(a, const_cast<transaction_prefix &>(tx));
-	crypto::cn_fast_hash(s.str().data(), s.str().size(), h);
+	return s.str();
+}
+//---------------------------------------------------------------
+void get_transaction_prefix_hash(const transaction_prefix &tx, crypto::hash &h)
+{
+	const std::string blob = get_transaction_prefix_blob(tx);
+	crypto::cn_fast_hash(blob.data(), blob.size(), h);
 }
 //---------------------------------------------------------------
 crypto::hash get_transaction_prefix_hash(const transaction_prefix &tx)
@@ -733,16 +740,54 @@ bool lookup_acc_outs(const account_keys &acc, const transaction &tx, const crypt
 {
 	CHECK_AND_ASSERT_MES(additional_tx_pub_keys.empty() || additional_tx_pub_keys.size() == tx.vout.size(), false, "wrong number of additional pubkeys");
 	money_transfered = 0;
-	size_t i = 0;
 	for(const tx_out &o : tx.vout)
-	{
 		CHECK_AND_ASSERT_MES(o.target.type() == typeid(txout_to_key), false, "wrong type id in transaction out");
-		if(is_out_to_acc(acc, boost::get<txout_to_key>(o.target), tx_pub_key, additional_tx_pub_keys, i))
+
+	// Same as is_out_to_acc on every output, with the derivations and output keys computed in batches
+	hw::device &hwdev = acc.get_device();
+	const crypto::public_key &spend_public_key = acc.m_account_address.m_spend_public_key;
+	crypto::key_derivation derivation;
+	if(!hwdev.generate_key_derivation(tx_pub_key, acc.m_view_secret_key, derivation))
+	{
+		LOG_ERROR("Failed to generate key derivation");
+		return true;
+	}
+
+	std::vector<size_t> indexes(tx.vout.size());
+	std::iota(indexes.begin(), indexes.end(), 0);
+	std::vector<crypto::key_derivation> derivations(tx.vout.size(), derivation);
+	std::vector<crypto::public_key> pks;
+	if(!hwdev.derive_public_keys(derivations, indexes, spend_public_key, pks))
+	{
+		LOG_ERROR("Failed to derive public key");
+		return true;
+	}
+
+	std::vector<bool> received(tx.vout.size());
+	for(size_t i = 0; i < tx.vout.size(); i++)
+		received[i] = pks[i] == boost::get<txout_to_key>(tx.vout[i].target).key;
+
+	// try additional tx pubkeys if available
+	if(!additional_tx_pub_keys.empty())
+	{
+		std::vector<bool> valid;
+		hwdev.generate_key_derivations(additional_tx_pub_keys, acc.m_view_secret_key, derivations, valid);
+		if(!hwdev.derive_public_keys(derivations, indexes, spend_public_key, pks))
+		{
+			LOG_ERROR("Failed to derive public key");
+			return true;
+		}
+		for(size_t i = 0; i < tx.vout.size(); i++)
+			received[i] = received[i] || (valid[i] && pks[i] == boost::get<txout_to_key>(tx.vout[i].target).key);
+	}
+
+	for(size_t i = 0; i < tx.vout.size(); i++)
+	{
+		if(received[i])
 		{
 			outs.push_back(i);
-			money_transfered += o.amount;
+			money_transfered += tx.vout[i].amount;
 		}
-		i++;
 	}
 	return true;
 }
@@ -835,9 +880,10 @@ bool calculate_transaction_hash(const transaction &t, crypto::hash &res, size_t
 
 	// v2 transactions hash different parts together, than hash the set of those hashes
 	crypto::hash hashes[3];
+	std::string blobs[3];
 
 	// prefix
-	get_transaction_prefix_hash(t, hashes[0]);
+	blobs[0] = get_transaction_prefix_blob(t);
 
 	transaction &tt = const_cast<transaction &>(t);
 
@@ -849,10 +895,11 @@ bool calculate_transaction_hash(const transaction &t, crypto::hash &res, size_t
 		const size_t outputs = t.vout.size();
 		bool r = tt.rct_signatures.serialize_rctsig_base(ba, inputs, outputs);
 		CHECK_AND_ASSERT_MES(r, false, "Failed to serialize rct signatures base");
-		cryptonote::get_blob_hash(ss.str(), hashes[1]);
+		blobs[1] = ss.str();
 	}
 
 	// prunable rct
+	size_t parts = 2;
 	if(t.rct_signatures.type == rct::RCTTypeNull)
 	{
 		hashes[2] = crypto::null_hash;
@@ -866,8 +913,19 @@ bool calculate_transaction_hash(const transaction &t, crypto::hash &res, size_t
 		const size_t mixin = t.vin.empty() ? 0 : t.vin[0].type() == typeid(txin_to_key) ? boost::get<txin_to_key>(t.vin[0]).key_offsets.size() - 1 : 0;
 		bool r = tt.rct_signatures.p.serialize_rctsig_prunable(ba, t.rct_signatures.type, inputs, outputs, mixin);
 		CHECK_AND_ASSERT_MES(r, false, "Failed to serialize rct signatures prunable");
-		cryptonote::get_blob_hash(ss.str(), hashes[2]);
+		blobs[2] = ss.str();
+		parts = 3;
+	}
+
+	// the parts are independent, so hash them side by side
+	const void *data[3];
+	size_t length[3];
+	for(size_t i = 0; i < parts; ++i)
+	{
+		data[i] = blobs[i].data();
+		length[i] = blobs[i].size();
 	}
+	crypto::cn_fast_hash_batch(data, length, parts, hashes);
 
 	// the tx hash is the hash of the 3 hashes
 	res = cn_fast_hash(hashes, sizeof(hashes));
@@ -919,9 +977,13 @@ bool get_transaction_hash(const transaction &t, crypto::hash &res, size_t &blob_
 }
 //---------------------------------------------------------------
 blobdata get_block_hashing_blob(const block &b)
+{
+	return get_block_hashing_blob(b, get_tx_tree_hash(b));
+}
+//---------------------------------------------------------------
+blobdata get_block_hashing_blob(const block &b, const crypto::hash &tree_root_hash)
 {
 	blobdata blob = t_serializable_object_to_blob(static_cast<block_header>(b));
-	crypto::hash tree_root_hash = get_tx_tree_hash(b);
 	blob.append(reinterpret_cast<const char *>(&tree_root_hash), sizeof(tree_root_hash));
 	blob.append(tools::get_varint_data(b.tx_hashes.size() + 1));
 	return blob;
@@ -961,10 +1023,10 @@ crypto::hash get_block_hash(const block &b)
 	return p;
 }
 //---------------------------------------------------------------
-bool get_block_longhash(network_type nettype, const block &b, cn_pow_hash_v2 &ctx, crypto::hash &res)
+bool get_block_longhash(network_type nettype, const block &b, cn_pow_hash_v2 &ctx, crypto::hash &res, const crypto::hash *tree_root_hash)
 {
 	block b_local = b; //workaround to avoid const errors with do_serialize
-	blobdata bd = get_block_hashing_blob(b);
+	blobdata bd = tree_root_hash ? get_block_hashing_blob(b, *tree_root_hash) : get_block_hashing_blob(b);
 	
 	uint8_t cn_heavy_v = get_fork_v(nettype, FORK_POW_CN_HEAVY);
 	uint8_t cn_gpu_v = get_fork_v(nettype, FORK_POW_CN_GPU);
@@ -986,6 +1048,77 @@ bool get_block_longhash(network_type nettype, const block &b, cn_pow_hash_v2 &ct
 	return true;
 }
 //---------------------------------------------------------------
+bool get_block_longhash_multi(network_type nettype, const block *const *b, cn_pow_hash_v2 *ctx, crypto::hash *res, const crypto::hash *tree_root_hash)
+{
+	constexpr size_t N = BLOCK_LONGHASH_LANES;
+	uint8_t cn_heavy_v = get_fork_v(nettype, FORK_POW_CN_HEAVY);
+	uint8_t cn_gpu_v = get_fork_v(nettype, FORK_POW_CN_GPU);
+
+	auto pow_version = [&](const block &bl) -> size_t {
+		if(cn_gpu_v != hardfork_conf::FORK_ID_DISABLED && bl.major_version >= cn_gpu_v)
+			return 3;
+		else if(cn_heavy_v != hardfork_conf::FORK_ID_DISABLED && bl.major_version >= cn_heavy_v)
+			return 2;
+		else
+			return 1;
+	};
+
+	// Lanes can only be interleaved if they all use the same algorithm
+	size_t pow_v = pow_version(*b[0]);
+	for(size_t l = 1; l < N; l++)
+	{
+		if(pow_version(*b[l]) != pow_v)
+		{
+			for(size_t i = 0; i < N; i++)
+				get_block_longhash(nettype, *b[i], ctx[i], res[i], tree_root_hash);
+			return true;
+		}
+	}
+
+	blobdata bd[N];
+	const void *in[N];
+	size_t len[N];
+	void *out[N];
+	for(size_t l = 0; l < N; l++)
+	{
+		bd[l] = tree_root_hash ? get_block_hashing_blob(*b[l], *tree_root_hash) : get_block_hashing_blob(*b[l]);
+		in[l] = bd[l].data();
+		len[l] = bd[l].size();
+		out[l] = res[l].data;
+	}
+
+	if(pow_v == 3)
+	{
+		std::vector<cn_pow_hash_v3> ctx_v3;
+		cn_pow_hash_v3 *lanes[N];
+		ctx_v3.reserve(N);
+		for(size_t l = 0; l < N; l++)
+			ctx_v3.emplace_back(cn_pow_hash_v3::make_borrowed_v3(ctx[l]));
+		for(size_t l = 0; l < N; l++)
+			lanes[l] = &ctx_v3[l];
+		cn_pow_hash_v3::hash_n<N>(lanes, in, len, out);
+	}
+	else if(pow_v == 2)
+	{
+		cn_pow_hash_v2 *lanes[N];
+		for(size_t l = 0; l < N; l++)
+			lanes[l] = &ctx[l];
+		cn_pow_hash_v2::hash_n<N>(lanes, in, len, out);
+	}
+	else
+	{
+		std::vector<cn_pow_hash_v1> ctx_v1;
+		cn_pow_hash_v1 *lanes[N];
+		ctx_v1.reserve(N);
+		for(size_t l = 0; l < N; l++)
+			ctx_v1.emplace_back(cn_pow_hash_v1::make_borrowed(ctx[l]));
+		for(size_t l = 0; l < N; l++)
+			lanes[l] = &ctx_v1[l];
+		cn_pow_hash_v1::hash_n<N>(lanes, in, len, out);
+	}
+	return true;
+}
+//---------------------------------------------------------------
 std::vector<uint64_t> relative_output_offsets_to_absolute(const std::vector<uint64_t> &off)
 {
 	std::vector<uint64_t> res = off;
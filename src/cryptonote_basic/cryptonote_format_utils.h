@@ -122,10 +122,18 @@ bool get_transaction_hash(const transaction &t, crypto::hash &res, size_t &blob_
 bool get_transaction_hash(const transaction &t, crypto::hash &res, size_t *blob_size);
 bool calculate_transaction_hash(const transaction &t, crypto::hash &res, size_t *blob_size);
 blobdata get_block_hashing_blob(const block &b);
+// Same as above with the tx tree root already known, e.g. from a crypto::tree_hash_builder
+blobdata get_block_hashing_blob(const block &b, const crypto::hash &tree_root_hash);
 bool calculate_block_hash(const block &b, crypto::hash &res);
 bool get_block_hash(const block &b, crypto::hash &res);
 crypto::hash get_block_hash(const block &b);
-bool get_block_longhash(network_type nettype, const block &b, cn_pow_hash_v2 &ctx, crypto::hash &res);
+// tree_root_hash, if given, has to be the tx tree root of b; it saves hashing the miner tx and the tree
+bool get_block_longhash(network_type nettype, const block &b, cn_pow_hash_v2 &ctx, crypto::hash &res, const crypto::hash *tree_root_hash = nullptr);
+// Number of blocks hashed together by get_block_longhash_multi, each lane needs its own context
+constexpr size_t BLOCK_LONGHASH_LANES = 2;
+// ctx has to point to BLOCK_LONGHASH_LANES contexts, b and res to BLOCK_LONGHASH_LANES elements
+// tree_root_hash, if given, is the tx tree root shared by all lanes
+bool get_block_longhash_multi(network_type nettype, const block *const *b, cn_pow_hash_v2 *ctx, crypto::hash *res, const crypto::hash *tree_root_hash = nullptr);
 bool parse_and_validate_block_from_blob(const blobdata &b_blob, block &b);
 bool get_inputs_money_amount(const transaction &tx, uint64_t &money);
 uint64_t get_outs_money_amount(const transaction &tx);
@@ -141,23 +141,24 @@ bool check_hash(const crypto::hash &hash, difficulty_type difficulty)
 	return !carry;
 }
 
-difficulty_type next_difficulty_v1(std::vector<std::uint64_t> timestamps, std::vector<difficulty_type> cumulative_difficulties, size_t target_seconds)
+difficulty_type next_difficulty_v1(epee::span<const std::uint64_t> timestamps, epee::span<const difficulty_type> cumulative_difficulties, size_t target_seconds)
 {
-	if(timestamps.size() > common_config::DIFFICULTY_WINDOW_V1)
-	{
-		timestamps.resize(common_config::DIFFICULTY_WINDOW_V1);
-		cumulative_difficulties.resize(common_config::DIFFICULTY_WINDOW_V1);
-	}
+	assert(timestamps.size() == cumulative_difficulties.size());
+	std::vector<uint64_t> sorted(timestamps.begin(), timestamps.begin() + std::min<size_t>(timestamps.size(), common_config::DIFFICULTY_WINDOW_V1));
+	std::sort(sorted.begin(), sorted.end());
+	return next_difficulty_v1_sorted(epee::to_span(sorted), cumulative_difficulties, target_seconds);
+}
 
+difficulty_type next_difficulty_v1_sorted(epee::span<const std::uint64_t> timestamps, epee::span<const difficulty_type> cumulative_difficulties, size_t target_seconds)
+{
 	size_t length = timestamps.size();
-	assert(length == cumulative_difficulties.size());
+	assert(length <= cumulative_difficulties.size());
 	if(length <= 1)
 	{
 		return 1;
 	}
 	static_assert(common_config::DIFFICULTY_WINDOW_V1 >= 2, "Window is too small");
 	assert(length <= common_config::DIFFICULTY_WINDOW_V1);
-	sort(timestamps.begin(), timestamps.end());
 	size_t cut_begin, cut_end;
 	static_assert(2 * common_config::DIFFICULTY_CUT_V1 <= common_config::DIFFICULTY_WINDOW_V1 - 2, "Cut length is too large");
 	if(length <= common_config::DIFFICULTY_WINDOW_V1 - 2 * common_config::DIFFICULTY_CUT_V1)
@@ -171,12 +172,12 @@ difficulty_type next_difficulty_v1(std::vector<std::uint64_t> timestamps, std::v
 		cut_end = cut_begin + (common_config::DIFFICULTY_WINDOW_V1 - 2 * common_config::DIFFICULTY_CUT_V1);
 	}
 	assert(/*cut_begin >= 0 &&*/ cut_begin + 2 <= cut_end && cut_end <= length);
-	uint64_t time_span = timestamps[cut_end - 1] - timestamps[cut_begin];
+	uint64_t time_span = timestamps.data()[cut_end - 1] - timestamps.data()[cut_begin];
 	if(time_span == 0)
 	{
 		time_span = 1;
 	}
-	difficulty_type total_work = cumulative_difficulties[cut_end - 1] - cumulative_difficulties[cut_begin];
+	difficulty_type total_work = cumulative_difficulties.data()[cut_end - 1] - cumulative_difficulties.data()[cut_begin];
 	assert(total_work > 0);
 	uint64_t low, high;
 	mul(total_work, target_seconds, low, high);
@@ -189,25 +190,27 @@ difficulty_type next_difficulty_v1(std::vector<std::uint64_t> timestamps, std::v
 	return (low + time_span - 1) / time_span;
 }
 
-difficulty_type next_difficulty_v2(std::vector<std::uint64_t> timestamps, std::vector<difficulty_type> cumulative_difficulties, size_t target_seconds)
+difficulty_type next_difficulty_v2(epee::span<const std::uint64_t> timestamps, epee::span<const difficulty_type> cumulative_difficulties, size_t target_seconds)
+{
+	assert(timestamps.size() == cumulative_difficulties.size());
+	std::vector<uint64_t> sorted(timestamps.begin(), timestamps.begin() + std::min<size_t>(timestamps.size(), common_config::DIFFICULTY_BLOCKS_COUNT_V2));
+	std::sort(sorted.begin(), sorted.end());
+	return next_difficulty_v2_sorted(epee::to_span(sorted), cumulative_difficulties, target_seconds);
+}
+
+difficulty_type next_difficulty_v2_sorted(epee::span<const std::uint64_t> timestamps, epee::span<const difficulty_type> cumulative_difficulties, size_t target_seconds)
 {
 	constexpr uint64_t MAX_AVERAGE_TIMESPAN = common_config::DIFFICULTY_TARGET * 6;  // 24 minutes
 	constexpr uint64_t MIN_AVERAGE_TIMESPAN = common_config::DIFFICULTY_TARGET / 24; // 10s
 
-	if(timestamps.size() > common_config::DIFFICULTY_BLOCKS_COUNT_V2)
-	{
-		timestamps.resize(common_config::DIFFICULTY_BLOCKS_COUNT_V2);
-		cumulative_difficulties.resize(common_config::DIFFICULTY_BLOCKS_COUNT_V2);
-	}
-
 	size_t length = timestamps.size();
-	assert(length == cumulative_difficulties.size());
+	assert(length <= cumulative_difficulties.size());
+	assert(length <= common_config::DIFFICULTY_BLOCKS_COUNT_V2);
 	if(length <= 1)
 	{
 		return 1;
 	}
 
-	sort(timestamps.begin(), timestamps.end());
 	size_t cut_begin, cut_end;
 	static_assert(2 * common_config::DIFFICULTY_CUT_V2 <= common_config::DIFFICULTY_BLOCKS_COUNT_V2 - 2, "Cut length is too large");
 	if(length <= common_config::DIFFICULTY_BLOCKS_COUNT_V2 - 2 * common_config::DIFFICULTY_CUT_V2)
@@ -221,7 +224,7 @@ difficulty_type next_difficulty_v2(std::vector<std::uint64_t> timestamps, std::v
 		cut_end = cut_begin + (common_config::DIFFICULTY_BLOCKS_COUNT_V2 - 2 * common_config::DIFFICULTY_CUT_V2);
 	}
 	assert(/*cut_begin >= 0 &&*/ cut_begin + 2 <= cut_end && cut_end <= length);
-	uint64_t total_timespan = timestamps[cut_end - 1] - timestamps[cut_begin];
+	uint64_t total_timespan = timestamps.data()[cut_end - 1] - timestamps.data()[cut_begin];
 	if(total_timespan == 0)
 	{
 		total_timespan = 1;
@@ -233,7 +236,7 @@ difficulty_type next_difficulty_v2(std::vector<std::uint64_t> timestamps, std::v
 		std::vector<std::uint64_t> time_spans;
 		for(size_t i = length - cut_begin * 2 - 3; i < length - 1; i++)
 		{
-			uint64_t time_span = timestamps[i + 1] - timestamps[i];
+			uint64_t time_span = timestamps.data()[i + 1] - timestamps.data()[i];
 			if(time_span == 0)
 			{
 				time_span = 1;
@@ -259,7 +262,7 @@ difficulty_type next_difficulty_v2(std::vector<std::uint64_t> timestamps, std::v
 		adjusted_total_timespan = MIN_AVERAGE_TIMESPAN * timespan_length;
 	}
 
-	difficulty_type total_work = cumulative_difficulties[cut_end - 1] - cumulative_difficulties[cut_begin];
+	difficulty_type total_work = cumulative_difficulties.data()[cut_end - 1] - cumulative_difficulties.data()[cut_begin];
 	assert(total_work > 0);
 
 	uint64_t low, high;
@@ -288,14 +291,16 @@ inline T clamp(T lo, T v, T hi)
 // BSD-3 Licensed
 // https://github.com/zawy12/difficulty-algorithms/issues/3
 
-difficulty_type next_difficulty_v3(const std::vector<std::uint64_t> &timestamps, const std::vector<difficulty_type> &cumulative_difficulties)
+difficulty_type next_difficulty_v3(epee::span<const std::uint64_t> timestamps_span, epee::span<const difficulty_type> cumulative_difficulties_span)
 {
 	constexpr int64_t T = common_config::DIFFICULTY_TARGET;
 	constexpr int64_t N = common_config::DIFFICULTY_WINDOW_V3;
 	constexpr int64_t FTL = common_config::BLOCK_FUTURE_TIME_LIMIT_V3;
 
-	assert(timestamps.size() == N + 1);
-	assert(cumulative_difficulties.size() == N + 1);
+	assert(timestamps_span.size() == N + 1);
+	assert(cumulative_difficulties_span.size() == N + 1);
+	const uint64_t *timestamps = timestamps_span.data();
+	const difficulty_type *cumulative_difficulties = cumulative_difficulties_span.data();
 
 	int64_t L = 0;
 	for(int64_t i = 1; i <= N; i++)
@@ -316,7 +321,7 @@ difficulty_type next_difficulty_v3(const std::vector<std::uint64_t> &timestamps,
 	// 99/100 adds a small bias towards decreasing diff, unlike zawy we do it in a separate step to avoid an overflow at 6GH/s
 	next_D = (next_D * 99ull) / 100ull;
 
-	LOG_PRINT_L2("diff sum: " << (cumulative_difficulties[N] - cumulative_difficulties[0]) << " L " << L << " sizes " << timestamps.size() << " " << cumulative_difficulties.size() << " next_D " << next_D);
+	LOG_PRINT_L2("diff sum: " << (cumulative_difficulties[N] - cumulative_difficulties[0]) << " L " << L << " sizes " << timestamps_span.size() << " " << cumulative_difficulties_span.size() << " next_D " << next_D);
 
 	return next_D;
 }
@@ -381,13 +386,16 @@ template void interpolate_timestamps<4>(std::vector<uint64_t>& timestamps);
 template void interpolate_timestamps<5>(std::vector<uint64_t>& timestamps);
 template void interpolate_timestamps<7>(std::vector<uint64_t>& timestamps);
 
-difficulty_type next_difficulty_v4(std::vector<uint64_t> timestamps, const std::vector<difficulty_type>& cumulative_difficulties)
+difficulty_type next_difficulty_v4(epee::span<const std::uint64_t> timestamps_span, epee::span<const difficulty_type> cumulative_difficulties_span)
 {
 	constexpr uint64_t T = common_config::DIFFICULTY_TARGET;
 	constexpr uint64_t N = common_config::DIFFICULTY_WINDOW_V4;
 
-	assert(timestamps.size() == N + 1);
-	assert(cumulative_difficulties.size() == N + 1);
+	assert(timestamps_span.size() == N + 1);
+	assert(cumulative_difficulties_span.size() == N + 1);
+	// the timestamps are clamped and interpolated in place
+	std::vector<uint64_t> timestamps(timestamps_span.begin(), timestamps_span.end());
+	const difficulty_type *cumulative_difficulties = cumulative_difficulties_span.data();
 
 	// the newest timestamp is not allwed to be older than the previous
 	uint64_t t_last = std::max(timestamps[N], timestamps[N - 1]);
@@ -425,4 +433,93 @@ difficulty_type next_difficulty_v4(std::vector<uint64_t> timestamps, const std::
 
 	return next_D;
 }
+
+void difficulty_window::reset(size_t max_size, size_t sorted_count)
+{
+	m_timestamps.clear();
+	m_difficulties.clear();
+	m_sorted.clear();
+	m_begin = 0;
+	m_max_size = max_size;
+	m_sorted_count = std::min(sorted_count, max_size);
+	m_timestamps.reserve(max_size * 2);
+	m_difficulties.reserve(max_size * 2);
+	m_sorted.reserve(m_sorted_count);
+}
+
+void difficulty_window::sorted_insert(uint64_t timestamp)
+{
+	m_sorted.insert(std::upper_bound(m_sorted.begin(), m_sorted.end(), timestamp), timestamp);
+}
+
+void difficulty_window::sorted_erase(uint64_t timestamp)
+{
+	auto it = std::lower_bound(m_sorted.begin(), m_sorted.end(), timestamp);
+	assert(it != m_sorted.end() && *it == timestamp);
+	m_sorted.erase(it);
+}
+
+void difficulty_window::push_back(uint64_t timestamp, difficulty_type cumulative_difficulty)
+{
+	if(m_max_size == 0)
+		return;
+	if(size() == m_max_size)
+		pop_front();
+	if(size() < m_sorted_count)
+		sorted_insert(timestamp);
+	m_timestamps.push_back(timestamp);
+	m_difficulties.push_back(cumulative_difficulty);
+}
+
+void difficulty_window::push_front(uint64_t timestamp, difficulty_type cumulative_difficulty)
+{
+	assert(size() < m_max_size);
+	if(m_begin == 0)
+	{
+		// make room for the rest of the window in one go so that filling it from the front stays linear
+		const size_t gap = m_max_size - size();
+		m_timestamps.insert(m_timestamps.begin(), gap, 0);
+		m_difficulties.insert(m_difficulties.begin(), gap, 0);
+		m_begin = gap;
+	}
+	if(m_sorted_count > 0)
+	{
+		// the newest sorted block drops out of the sorted part
+		if(size() >= m_sorted_count)
+			sorted_erase(m_timestamps[m_begin + m_sorted_count - 1]);
+		sorted_insert(timestamp);
+	}
+	--m_begin;
+	m_timestamps[m_begin] = timestamp;
+	m_difficulties[m_begin] = cumulative_difficulty;
+}
+
+void difficulty_window::pop_back()
+{
+	assert(size() > 0);
+	if(size() <= m_sorted_count)
+		sorted_erase(m_timestamps.back());
+	m_timestamps.pop_back();
+	m_difficulties.pop_back();
+}
+
+void difficulty_window::pop_front()
+{
+	assert(size() > 0);
+	if(m_sorted_count > 0)
+	{
+		sorted_erase(m_timestamps[m_begin]);
+		// the oldest unsorted block moves into the sorted part
+		if(size() > m_sorted_count)
+			sorted_insert(m_timestamps[m_begin + m_sorted_count]);
+	}
+	++m_begin;
+	// drop the popped entries once they outnumber the live ones
+	if(m_begin >= size())
+	{
+		m_timestamps.erase(m_timestamps.begin(), m_timestamps.begin() + m_begin);
+		m_difficulties.erase(m_difficulties.begin(), m_difficulties.begin() + m_begin);
+		m_begin = 0;
+	}
+}
 }
@@ -50,6 +50,7 @@
 #include <vector>
 
 #include "crypto/hash.h"
+#include "span.h"
 
 namespace cryptonote
 {
@@ -68,10 +69,67 @@ typedef std::uint64_t difficulty_type;
    * @return true if valid, else false
    */
 bool check_hash(const crypto::hash &hash, difficulty_type difficulty);
-difficulty_type next_difficulty_v1(std::vector<std::uint64_t> timestamps, std::vector<difficulty_type> cumulative_difficulties, size_t target_seconds);
-difficulty_type next_difficulty_v2(std::vector<std::uint64_t> timestamps, std::vector<difficulty_type> cumulative_difficulties, size_t target_seconds);
-difficulty_type next_difficulty_v3(const std::vector<std::uint64_t> &timestamps, const std::vector<difficulty_type> &cumulative_difficulties);
-difficulty_type next_difficulty_v4(std::vector<uint64_t> timestamps, const std::vector<difficulty_type>& cumulative_difficulties);
+difficulty_type next_difficulty_v1(epee::span<const std::uint64_t> timestamps, epee::span<const difficulty_type> cumulative_difficulties, size_t target_seconds);
+difficulty_type next_difficulty_v2(epee::span<const std::uint64_t> timestamps, epee::span<const difficulty_type> cumulative_difficulties, size_t target_seconds);
+difficulty_type next_difficulty_v3(epee::span<const std::uint64_t> timestamps, epee::span<const difficulty_type> cumulative_difficulties);
+difficulty_type next_difficulty_v4(epee::span<const std::uint64_t> timestamps, epee::span<const difficulty_type> cumulative_difficulties);
+
+/**
+   * @brief next_difficulty_v1 and next_difficulty_v2 for callers that keep the timestamps sorted
+   *
+   * @param sorted_timestamps the timestamps that next_difficulty_v1 (v2) would sort, that is the
+   *        first DIFFICULTY_WINDOW_V1 (DIFFICULTY_BLOCKS_COUNT_V2) ones, in ascending order
+   * @param cumulative_difficulties the cumulative difficulties in block order
+   */
+difficulty_type next_difficulty_v1_sorted(epee::span<const std::uint64_t> sorted_timestamps, epee::span<const difficulty_type> cumulative_difficulties, size_t target_seconds);
+difficulty_type next_difficulty_v2_sorted(epee::span<const std::uint64_t> sorted_timestamps, epee::span<const difficulty_type> cumulative_difficulties, size_t target_seconds);
+
 template<size_t N>
 void interpolate_timestamps(std::vector<uint64_t>& timestamps);
+
+/**
+   * @brief the timestamps and cumulative difficulties of a sliding window of blocks
+   *
+   * Blocks can be added and removed at both ends in amortized constant time, and the entries
+   * stay contiguous so they can be passed to next_difficulty_* as spans. The timestamps of the
+   * oldest sorted_count blocks are also kept sorted, which is what next_difficulty_v1 and
+   * next_difficulty_v2 would otherwise sort on every call.
+   */
+class difficulty_window
+{
+  public:
+	difficulty_window() : m_begin(0), m_max_size(0), m_sorted_count(0) {}
+
+	//! empties the window and sets its capacity and the number of sorted timestamps
+	void reset(size_t max_size, size_t sorted_count);
+	void clear() { reset(m_max_size, m_sorted_count); }
+
+	//! adds the newest block, dropping the oldest one if the window is full
+	void push_back(uint64_t timestamp, difficulty_type cumulative_difficulty);
+	//! adds a block older than all the others, the window must not be full
+	void push_front(uint64_t timestamp, difficulty_type cumulative_difficulty);
+	void pop_back();
+	void pop_front();
+
+	size_t size() const { return m_timestamps.size() - m_begin; }
+	size_t max_size() const { return m_max_size; }
+	size_t sorted_count() const { return m_sorted_count; }
+
+	epee::span<const uint64_t> timestamps() const { return {m_timestamps.data() + m_begin, size()}; }
+	epee::span<const difficulty_type> cumulative_difficulties() const { return {m_difficulties.data() + m_begin, size()}; }
+	//! the timestamps of the oldest min(size(), sorted_count) blocks in ascending order
+	epee::span<const uint64_t> sorted_timestamps() const { return epee::to_span(m_sorted); }
+
+  private:
+	void sorted_insert(uint64_t timestamp);
+	void sorted_erase(uint64_t timestamp);
+
+	// entries before m_begin are popped, they are erased once they make up half of the vectors
+	std::vector<uint64_t> m_timestamps;
+	std::vector<difficulty_type> m_difficulties;
+	size_t m_begin;
+	size_t m_max_size;
+	size_t m_sorted_count;
+	std::vector<uint64_t> m_sorted;
+};
 }
@@ -138,8 +138,27 @@ miner::~miner()
 //-----------------------------------------------------------------------------------------------------
 bool miner::set_block_template(const block &bl, const difficulty_type &di, uint64_t height)
 {
+	crypto::hash miner_tx_hash = get_transaction_hash(bl.miner_tx);
+
 	CRITICAL_REGION_LOCAL(m_template_lock);
 	m_template = bl;
+
+	// A refreshed template for the same pool only differs in the miner tx, which is leaf 0
+	bool same_txs = m_template_tree.size() == bl.tx_hashes.size() + 1;
+	for(size_t i = 0; same_txs && i < bl.tx_hashes.size(); i++)
+		same_txs = m_template_tree.leaf(i + 1) == bl.tx_hashes[i];
+	if(same_txs)
+	{
+		m_template_tree.replace(0, miner_tx_hash);
+	}
+	else
+	{
+		std::vector<crypto::hash> leaves;
+		leaves.reserve(bl.tx_hashes.size() + 1);
+		leaves.push_back(miner_tx_hash);
+		leaves.insert(leaves.end(), bl.tx_hashes.begin(), bl.tx_hashes.end());
+		m_template_tree.assign(leaves.data(), leaves.size());
+	}
 	m_diffic = di;
 	m_height = height;
 	++m_template_no;
@@ -403,10 +422,11 @@ bool miner::stop()
 bool miner::find_nonce_for_given_block(network_type nettype, block &bl, const difficulty_type &diffic, uint64_t height)
 {
 	cn_pow_hash_v2 hash_ctx;
+	crypto::hash tree_root = get_tx_tree_hash(bl);
 	for(; bl.nonce != std::numeric_limits<uint32_t>::max(); bl.nonce++)
 	{
 		crypto::hash h;
-		get_block_longhash(nettype, bl, hash_ctx, h);
+		get_block_longhash(nettype, bl, hash_ctx, h, &tree_root);
 
 		if(check_hash(h, diffic))
 		{
@@ -460,8 +480,14 @@ bool miner::worker_thread()
 	uint32_t nonce = m_starter_nonce + th_local_index;
 	difficulty_type local_diff = 0;
 	uint32_t local_template_ver = 0;
-	block b;
-	cn_pow_hash_v2 hash_ctx;
+	block b[BLOCK_LONGHASH_LANES];
+	crypto::hash tree_root = crypto::null_hash;
+	cn_pow_hash_v2 hash_ctx[BLOCK_LONGHASH_LANES];
+	const block *lane_blocks[BLOCK_LONGHASH_LANES];
+	crypto::hash h[BLOCK_LONGHASH_LANES];
+	for(size_t l = 0; l < BLOCK_LONGHASH_LANES; l++)
+		lane_blocks[l] = &b[l];
+	MGINFO("Miner thread [" << th_local_index << "] scratchpads allocated with " << cn_pad_mode_str(hash_ctx[0].get_pad_mode()));
 
 	while(!m_stop)
 	{
@@ -489,7 +515,9 @@ bool miner::worker_thread()
 		if(local_template_ver != m_template_no)
 		{
 			CRITICAL_REGION_BEGIN(m_template_lock);
-			b = m_template;
+			for(size_t l = 0; l < BLOCK_LONGHASH_LANES; l++)
+				b[l] = m_template;
+			tree_root = m_template_tree.root();
 			local_diff = m_diffic;
 			CRITICAL_REGION_END();
 			local_template_ver = m_template_no;
@@ -503,16 +531,20 @@ bool miner::worker_thread()
 			continue;
 		}
 
-		b.nonce = nonce;
-		crypto::hash h;
-		get_block_longhash(m_nettype, b, hash_ctx, h);
+		// every lane takes the nonce this thread would have tried next
+		for(size_t l = 0; l < BLOCK_LONGHASH_LANES; l++)
+			b[l].nonce = nonce + l * m_threads_total;
+		get_block_longhash_multi(m_nettype, lane_blocks, hash_ctx, h, &tree_root);
 
-		if(check_hash(h, local_diff))
+		for(size_t l = 0; l < BLOCK_LONGHASH_LANES; l++)
 		{
+			if(!check_hash(h[l], local_diff))
+				continue;
+
 			//we lucky!
 			++m_config.current_extra_message_index;
 			MGINFO_GREEN("Found block for difficulty: " << local_diff);
-			if(!m_phandler->handle_block_found(b))
+			if(!m_phandler->handle_block_found(b[l]))
 			{
 				--m_config.current_extra_message_index;
 			}
@@ -521,10 +553,11 @@ bool miner::worker_thread()
 				//success update, lets update config
 				if(!m_config_folder_path.empty())
 					epee::serialization::store_t_to_json_file(m_config, m_config_folder_path + "/" + MINER_CONFIG_FILE_NAME);
+				break;
 			}
 		}
-		nonce += m_threads_total;
-		++m_hashes;
+		nonce += m_threads_total * BLOCK_LONGHASH_LANES;
+		m_hashes += BLOCK_LONGHASH_LANES;
 	}
 	MGINFO("Miner thread stopped [" << th_local_index << "]");
 	return true;
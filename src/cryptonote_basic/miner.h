@@ -50,6 +50,7 @@
 #include "difficulty.h"
 #include "math_helper.h"
 #include "cryptonote_basic/blobdatatype.h" 
+#include "crypto/tree_hash_builder.h"
 #include <atomic>
 #include <boost/logic/tribool_fwd.hpp>
 #include <boost/program_options.hpp>
@@ -139,6 +140,7 @@ class miner
 	volatile uint32_t m_stop;
 	epee::critical_section m_template_lock;
 	block m_template;
+	crypto::tree_hash_builder m_template_tree; // tx tree of m_template, refreshed templates usually only change the miner tx
 	std::atomic<uint32_t> m_template_no;
 	std::atomic<uint32_t> m_starter_nonce;
 	difficulty_type m_diffic;
@@ -45,6 +45,9 @@
 // Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
 
 #pragma once
+
+#include "crypto/hash.h"
+
 namespace cryptonote
 {
 /************************************************************************/
@@ -73,5 +76,6 @@ struct block_verification_context
 	bool m_marked_as_orphaned;
 	bool m_already_exists;
 	bool m_partial_block_reward;
+	crypto::hash m_bad_tx_id; //the first tx of the block with wrong inputs, if any
 };
 }
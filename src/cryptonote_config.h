@@ -114,6 +114,7 @@
 #define CRYPTONOTE_BLOCKCHAINDATA_FILENAME "data.mdb"
 #define CRYPTONOTE_BLOCKCHAINDATA_LOCK_FILENAME "lock.mdb"
 #define P2P_NET_DATA_FILENAME "p2pstate.bin"
+#define MULTIEXP_TABLES_FILENAME "bulletproof_tables.bin"
 #define MINER_CONFIG_FILE_NAME "miner_conf.json"
 
 #define THREAD_STACK_SIZE 5 * 1024 * 1024
@@ -122,6 +123,14 @@
 
 #define HASH_OF_HASHES_STEP 256
 
+#define BLOCK_POW_HASH_CACHE_DEPTH 10000 // keep verified PoW hashes of blocks this far below the chain tip
+
+#define RCT_VERIFY_BATCH_DEFAULT_SIZE 128 // txs whose range proofs are verified in one multiexp when syncing
+#define RING_POINT_CACHE_DEFAULT_SIZE_MB 64 // decompressed ring members kept for MLSAG verification
+#define TX_VERIFICATION_CACHE_SIZE 16384 // txs whose ring signatures are known to be valid for their rings
+#define RELAY_TX_BATCH_WINDOW_MS 5		// while relayed txs are verified, more from all peers are pooled this long
+#define RELAY_TX_BATCH_MAX_COUNT 64		// or until this many have arrived
+
 #define DEFAULT_TXPOOL_MAX_SIZE 648000000ull // 3 days at 300000, in bytes
 
 // coin emission change interval/speed configs
@@ -68,6 +68,7 @@
 #include "include_base_utils.h"
 #include "misc_language.h"
 #include "profile_tools.h"
+#include "ringct/rctPointCache.h"
 #include "ringct/rctSigs.h"
 #include "tx_pool.h"
 #include "warnings.h"
@@ -153,8 +154,11 @@ static const struct
 };
 
 //------------------------------------------------------------------
-Blockchain::Blockchain(tx_memory_pool &tx_pool) : m_db(), m_tx_pool(tx_pool), m_hardfork(NULL), m_timestamps_and_difficulties_height(0), m_current_block_cumul_sz_limit(0), m_current_block_cumul_sz_median(0),
-												  m_enforce_dns_checkpoints(false), m_max_prepare_blocks_threads(4), m_db_blocks_per_sync(1), m_db_sync_mode(db_async), m_db_default_sync(false), m_fast_sync(true), m_show_time_stats(false), m_sync_counter(0), m_cancel(false)
+Blockchain::Blockchain(tx_memory_pool &tx_pool) : m_db(), m_tx_pool(tx_pool), m_hardfork(NULL), m_difficulty_window_height(0), m_current_block_cumul_sz_limit(0), m_current_block_cumul_sz_median(0),
+												  m_enforce_dns_checkpoints(false), m_max_prepare_blocks_threads(4), m_db_blocks_per_sync(1), m_db_sync_mode(db_async), m_db_default_sync(false), m_fast_sync(true), m_show_time_stats(false), m_rct_batch_size(RCT_VERIFY_BATCH_DEFAULT_SIZE), m_verified_txs(TX_VERIFICATION_CACHE_SIZE), m_sync_counter(0),
+												  m_pow_prefetcher([this](std::vector<cn_pow_hash_v2> &hash_ctxes, const std::vector<block> &blocks, std::unordered_map<crypto::hash, crypto::hash> &map) { block_longhash_worker(hash_ctxes, blocks, map); }),
+												  m_cancel(false),
+												  m_btc(), m_btc_change_count(0)
 {
 	LOG_PRINT_L3("Blockchain::" << __func__);
 }
@@ -359,6 +363,14 @@ bool Blockchain::init(BlockchainDB *db, const network_type nettype, bool offline
 	}
 
 	m_db = db;
+	MINFO("PoW scratchpad allocated with " << cn_pad_mode_str(m_pow_ctx.get_pad_mode()));
+
+	const cn_cpu_features &cpu = cn_get_cpu_features();
+	MINFO("CPU features: sse2 " << cpu.sse2 << ", aes " << cpu.aes << ", avx2 " << cpu.avx2 << ", bmi2 " << cpu.bmi2);
+	MINFO("PoW kernels: v1 " << cn_kernel_str(cn_pow_hash_v1::kernel_id()) << ", v2 " << cn_kernel_str(cn_pow_hash_v2::kernel_id())
+							<< ", v3 " << cn_kernel_str(cn_pow_hash_v3::kernel_id()));
+	if(!cn_pow_hash_v1::kernel_verified() || !cn_pow_hash_v2::kernel_verified() || !cn_pow_hash_v3::kernel_verified())
+		MERROR("PoW kernel self-test failed, block verification results can not be trusted");
 
 	m_nettype = test_options != NULL ? FAKECHAIN : nettype;
 	m_offline = offline;
@@ -496,7 +508,8 @@ bool Blockchain::init(BlockchainDB *db, const network_type nettype, bool offline
 	}
 	if(num_popped_blocks > 0)
 	{
-		m_timestamps_and_difficulties_height = 0;
+		m_difficulty_window.clear();
+		m_difficulty_window_height = 0;
 		m_hardfork->reorganize_from_chain_height(get_current_blockchain_height());
 		m_tx_pool.on_blockchain_dec(m_db->height() - 1, get_tail_id());
 	}
@@ -556,6 +569,12 @@ bool Blockchain::deinit()
 	m_async_pool.join_all();
 	m_async_service.stop();
 
+	// let the hashing of a prefetched span finish
+	m_pow_prefetcher.take();
+
+	// don't keep long polling RPC clients waiting for a template that won't come
+	notify_block_template_change();
+
 	// as this should be called if handling a SIGSEGV, need to check
 	// if m_db is a NULL pointer (and thus may have caused the illegal
 	// memory operation), otherwise we may cause a loop.
@@ -593,10 +612,9 @@ block Blockchain::pop_block_from_blockchain()
 	LOG_PRINT_L3("Blockchain::" << __func__);
 	CRITICAL_REGION_LOCAL(m_blockchain_lock);
 
-	m_timestamps_and_difficulties_height = 0;
-
 	block popped_block;
 	std::vector<transaction> popped_txs;
+	const uint64_t popped_height = m_db->height() - 1;
 
 	try
 	{
@@ -640,6 +658,16 @@ block Blockchain::pop_block_from_blockchain()
 	m_blocks_txs_check.clear();
 	m_check_txin_table.clear();
 
+	// the difficulty window only has to forget the popped block if it reached that far
+	if(m_difficulty_window_height > popped_height)
+	{
+		if(m_difficulty_window.size() > 0)
+			m_difficulty_window.pop_back();
+		m_difficulty_window_height = popped_height;
+	}
+
+	notify_block_template_change();
+
 	update_next_cumulative_size_limit();
 	m_tx_pool.on_blockchain_dec(m_db->height() - 1, get_tail_id());
 
@@ -650,7 +678,8 @@ bool Blockchain::reset_and_set_genesis_block(const block &b)
 {
 	LOG_PRINT_L3("Blockchain::" << __func__);
 	CRITICAL_REGION_LOCAL(m_blockchain_lock);
-	m_timestamps_and_difficulties_height = 0;
+	m_difficulty_window.clear();
+	m_difficulty_window_height = 0;
 	m_alternative_chains.clear();
 	m_db->reset();
 	m_hardfork->init();
@@ -664,7 +693,7 @@ bool Blockchain::reset_and_set_genesis_block(const block &b)
 crypto::hash Blockchain::get_tail_id(uint64_t &height) const
 {
 	LOG_PRINT_L3("Blockchain::" << __func__);
-	CRITICAL_REGION_LOCAL(m_blockchain_lock);
+	SHARED_CRITICAL_REGION_LOCAL(m_blockchain_lock);
 	height = m_db->height() - 1;
 	return get_tail_id();
 }
@@ -694,7 +723,7 @@ crypto::hash Blockchain::get_tail_id() const
 bool Blockchain::get_short_chain_history(std::list<crypto::hash> &ids) const
 {
 	LOG_PRINT_L3("Blockchain::" << __func__);
-	CRITICAL_REGION_LOCAL(m_blockchain_lock);
+	SHARED_CRITICAL_REGION_LOCAL(m_blockchain_lock);
 	uint64_t i = 0;
 	uint64_t current_multiplier = 1;
 	uint64_t sz = m_db->height();
@@ -764,7 +793,7 @@ crypto::hash Blockchain::get_block_id_by_height(uint64_t height) const
 bool Blockchain::get_block_by_hash(const crypto::hash &h, block &blk, bool *orphan) const
 {
 	LOG_PRINT_L3("Blockchain::" << __func__);
-	CRITICAL_REGION_LOCAL(m_blockchain_lock);
+	SHARED_CRITICAL_REGION_LOCAL(m_blockchain_lock);
 
 	// try to find block in main chain
 	try
@@ -807,9 +836,8 @@ bool Blockchain::get_block_by_hash(const crypto::hash &h, block &blk, bool *orph
 difficulty_type Blockchain::get_difficulty_for_next_block()
 {
 	LOG_PRINT_L3("Blockchain::" << __func__);
-	CRITICAL_REGION_LOCAL(m_blockchain_lock);
-	std::vector<uint64_t> timestamps;
-	std::vector<difficulty_type> difficulties;
+	SHARED_CRITICAL_REGION_LOCAL(m_blockchain_lock);
+	boost::lock_guard<boost::mutex> window_lock(m_difficulty_window_lock);
 	uint64_t height = m_db->height();
 
 	if(m_nettype == MAINNET && height >= MAINNET_HARDFORK_V3_HEIGHT && height <= (MAINNET_HARDFORK_V3_HEIGHT + common_config::DIFFICULTY_BLOCKS_COUNT_V2))
@@ -819,62 +847,48 @@ difficulty_type Blockchain::get_difficulty_for_next_block()
 		return (difficulty_type)480000000;
 
 	size_t block_count;
+	size_t sorted_count = 0;
 	if(check_hard_fork_feature(FORK_V4_DIFFICULTY))
 		block_count = common_config::DIFFICULTY_BLOCKS_COUNT_V4;
 	else if(check_hard_fork_feature(FORK_V3_DIFFICULTY))
 		block_count = common_config::DIFFICULTY_BLOCKS_COUNT_V3;
 	else if(check_hard_fork_feature(FORK_V2_DIFFICULTY))
-		block_count = common_config::DIFFICULTY_BLOCKS_COUNT_V2;
+		block_count = sorted_count = common_config::DIFFICULTY_BLOCKS_COUNT_V2;
 	else
+	{
 		block_count = common_config::DIFFICULTY_BLOCKS_COUNT_V1;
+		sorted_count = common_config::DIFFICULTY_WINDOW_V1;
+	}
 
-	// ND: Speedup
-	// 1. Keep a list of the last 735 (or less) blocks that is used to compute difficulty,
-	//    then when the next block difficulty is queried, push the latest height data and
-	//    pop the oldest one from the list. This only requires 1x read per height instead
-	//    of doing 735 (DIFFICULTY_BLOCKS_COUNT).
-	if(m_timestamps_and_difficulties_height != 0 && ((height - m_timestamps_and_difficulties_height) == 1) && timestamps.size() >= block_count && m_difficulties.size() >= block_count)
+	// The window holds the main chain blocks [m_difficulty_window_height - size, m_difficulty_window_height).
+	// It follows the chain one block at a time, pop_block_from_blockchain takes blocks off its end, and it
+	// is only refilled from the db when the difficulty algorithm changes or the chain moved too far.
+	if(m_difficulty_window.max_size() != block_count || m_difficulty_window_height > height || height - m_difficulty_window_height > block_count)
 	{
-		uint64_t index = height - 1;
-		m_timestamps.push_back(m_db->get_block_timestamp(index));
-		m_difficulties.push_back(m_db->get_block_cumulative_difficulty(index));
-
-		while(m_timestamps.size() > block_count)
-			m_timestamps.erase(m_timestamps.begin());
-		while(m_difficulties.size() > block_count)
-			m_difficulties.erase(m_difficulties.begin());
-
-		m_timestamps_and_difficulties_height = height;
-		timestamps = m_timestamps;
-		difficulties = m_difficulties;
+		m_difficulty_window.reset(block_count, sorted_count);
+		m_difficulty_window_height = height;
 	}
-	else
-	{
-		size_t offset = height - std::min<size_t>(height, block_count);
-		if(offset == 0)
-			++offset;
 
-		timestamps.clear();
-		difficulties.clear();
-		for(; offset < height; offset++)
-		{
-			timestamps.push_back(m_db->get_block_timestamp(offset));
-			difficulties.push_back(m_db->get_block_cumulative_difficulty(offset));
-		}
-
-		m_timestamps_and_difficulties_height = height;
-		m_timestamps = timestamps;
-		m_difficulties = difficulties;
+	for(; m_difficulty_window_height < height; ++m_difficulty_window_height)
+	{
+		if(m_difficulty_window_height == 0)
+			continue; // skip genesis block
+		m_difficulty_window.push_back(m_db->get_block_timestamp(m_difficulty_window_height), m_db->get_block_cumulative_difficulty(m_difficulty_window_height));
 	}
 
+	for(uint64_t first = height - m_difficulty_window.size(); m_difficulty_window.size() < block_count && first > 1; --first)
+		m_difficulty_window.push_front(m_db->get_block_timestamp(first - 1), m_db->get_block_cumulative_difficulty(first - 1));
+
+	const epee::span<const uint64_t> timestamps = m_difficulty_window.timestamps();
+	const epee::span<const difficulty_type> difficulties = m_difficulty_window.cumulative_difficulties();
 	if(check_hard_fork_feature(FORK_V4_DIFFICULTY))
 		return next_difficulty_v4(timestamps, difficulties);
 	else if(check_hard_fork_feature(FORK_V3_DIFFICULTY))
 		return next_difficulty_v3(timestamps, difficulties);
 	else if(check_hard_fork_feature(FORK_V2_DIFFICULTY))
-		return next_difficulty_v2(timestamps, difficulties, common_config::DIFFICULTY_TARGET);
+		return next_difficulty_v2_sorted(m_difficulty_window.sorted_timestamps(), difficulties, common_config::DIFFICULTY_TARGET);
 	else
-		return next_difficulty_v1(timestamps, difficulties, common_config::DIFFICULTY_TARGET);
+		return next_difficulty_v1_sorted(m_difficulty_window.sorted_timestamps(), difficulties, common_config::DIFFICULTY_TARGET);
 }
 
 //------------------------------------------------------------------
@@ -892,8 +906,6 @@ bool Blockchain::rollback_blockchain_switching(std::list<block> &original_chain,
 		return true;
 	}
 
-	m_timestamps_and_difficulties_height = 0;
-
 	// remove blocks from blockchain until we get back to where we should be.
 	while(m_db->height() != rollback_height)
 	{
@@ -945,8 +957,6 @@ bool Blockchain::switch_to_alternative_blockchain(std::list<blocks_ext_by_hash::
 	LOG_PRINT_L3("Blockchain::" << __func__);
 	CRITICAL_REGION_LOCAL(m_blockchain_lock);
 
-	m_timestamps_and_difficulties_height = 0;
-
 	// if empty alt chain passed (not sure how that could happen), return false
 	CHECK_AND_ASSERT_MES(alt_chain.size(), false, "switch_to_alternative_blockchain: empty chain passed");
 
@@ -1124,7 +1134,7 @@ difficulty_type Blockchain::get_next_difficulty_for_alternative_chain(const std:
 	// based on its blocks alone, need to get more blocks from the main chain
 	if(alt_chain.size() < block_count)
 	{
-		CRITICAL_REGION_LOCAL(m_blockchain_lock);
+		SHARED_CRITICAL_REGION_LOCAL(m_blockchain_lock);
 
 		// Figure out start and stop offsets for main chain blocks
 		size_t main_chain_stop_offset = alt_chain.size() ? alt_chain.front()->second.height : bei.height;
@@ -1135,7 +1145,19 @@ difficulty_type Blockchain::get_next_difficulty_for_alternative_chain(const std:
 		if(!main_chain_start_offset)
 			++main_chain_start_offset; //skip genesis block
 
-		// get difficulties and timestamps from relevant main chain blocks
+		// get difficulties and timestamps from relevant main chain blocks, the difficulty window
+		// of the main chain usually still holds them when the fork is recent
+		const size_t window_start = m_difficulty_window_height - m_difficulty_window.size();
+		if(main_chain_start_offset < main_chain_stop_offset && main_chain_start_offset >= window_start && main_chain_stop_offset <= m_difficulty_window_height)
+		{
+			const size_t first = main_chain_start_offset - window_start;
+			const size_t count = main_chain_stop_offset - main_chain_start_offset;
+			const epee::span<const uint64_t> window_timestamps = m_difficulty_window.timestamps();
+			const epee::span<const difficulty_type> window_difficulties = m_difficulty_window.cumulative_difficulties();
+			timestamps.assign(window_timestamps.begin() + first, window_timestamps.begin() + first + count);
+			cumulative_difficulties.assign(window_difficulties.begin() + first, window_difficulties.begin() + first + count);
+			main_chain_start_offset = main_chain_stop_offset;
+		}
 		for(; main_chain_start_offset < main_chain_stop_offset; ++main_chain_start_offset)
 		{
 			timestamps.push_back(m_db->get_block_timestamp(main_chain_start_offset));
@@ -1172,13 +1194,13 @@ difficulty_type Blockchain::get_next_difficulty_for_alternative_chain(const std:
 	}
 
 	if(check_hard_fork_feature(FORK_V4_DIFFICULTY))
-		return next_difficulty_v4(timestamps, cumulative_difficulties);
+		return next_difficulty_v4(epee::to_span(timestamps), epee::to_span(cumulative_difficulties));
 	else if(check_hard_fork_feature(FORK_V3_DIFFICULTY))
-		return next_difficulty_v3(timestamps, cumulative_difficulties);
+		return next_difficulty_v3(epee::to_span(timestamps), epee::to_span(cumulative_difficulties));
 	else if(check_hard_fork_feature(FORK_V2_DIFFICULTY))
-		return next_difficulty_v2(timestamps, cumulative_difficulties, common_config::DIFFICULTY_TARGET);
+		return next_difficulty_v2(epee::to_span(timestamps), epee::to_span(cumulative_difficulties), common_config::DIFFICULTY_TARGET);
 	else
-		return next_difficulty_v1(timestamps, cumulative_difficulties, common_config::DIFFICULTY_TARGET);
+		return next_difficulty_v1(epee::to_span(timestamps), epee::to_span(cumulative_difficulties), common_config::DIFFICULTY_TARGET);
 }
 //------------------------------------------------------------------
 // This function does a sanity check on basic things that all miner
@@ -1320,7 +1342,7 @@ bool Blockchain::validate_miner_transaction_v1(const block &b, size_t cumulative
 void Blockchain::get_last_n_blocks_sizes(std::vector<size_t> &sz, size_t count) const
 {
 	LOG_PRINT_L3("Blockchain::" << __func__);
-	CRITICAL_REGION_LOCAL(m_blockchain_lock);
+	SHARED_CRITICAL_REGION_LOCAL(m_blockchain_lock);
 	auto h = m_db->height();
 
 	// this function is meaningless for an empty blockchain...granted it should never be empty
@@ -1361,36 +1383,90 @@ uint64_t Blockchain::get_current_cumulative_blocksize_median() const
 // nor any of the makefiles, howeve.  Need to look into whether or not it's
 // necessary at all.
 bool Blockchain::create_block_template(block &b, const account_public_address &miner_address, difficulty_type &diffic, uint64_t &height, uint64_t &expected_reward, const blobdata &ex_nonce)
+{
+	crypto::hash tree_root;
+	return create_block_template(b, miner_address, diffic, height, expected_reward, ex_nonce, tree_root);
+}
+//------------------------------------------------------------------
+bool Blockchain::create_block_template(block &b, const account_public_address &miner_address, difficulty_type &diffic, uint64_t &height, uint64_t &expected_reward, const blobdata &ex_nonce, crypto::hash &tree_root)
 {
 	LOG_PRINT_L3("Blockchain::" << __func__);
 	size_t median_size;
 	uint64_t already_generated_coins;
 
-	CRITICAL_REGION_BEGIN(m_blockchain_lock);
-	height = m_db->height();
+	// read the cookie before looking at the pool, a change that races with filling the
+	// template then makes the next call rebuild it instead of being missed
+	const uint64_t pool_cookie = m_tx_pool.cookie();
+	const crypto::hash top_id = get_tail_id();
+
+	block_template_cache btc;
+	{
+		CRITICAL_REGION_LOCAL(m_btc_lock);
+		btc = m_btc;
+	}
 
-	b.major_version = m_hardfork->get_current_version_num();
-	b.minor_version = m_hardfork->get_ideal_version();
-	b.prev_id = get_tail_id();
-	b.timestamp = time(NULL);
+	const bool chain_cached = btc.valid && btc.bl.prev_id == top_id;
+	const bool txs_cached = chain_cached && btc.pool_cookie == pool_cookie;
+	if(txs_cached && btc.miner_address == miner_address && btc.ex_nonce == ex_nonce)
+	{
+		MDEBUG("Using cached block template at height " << btc.height);
+		b = btc.bl;
+		// the cached timestamp is already past the median, so moving it forward keeps it valid
+		b.timestamp = std::max<uint64_t>(b.timestamp, time(NULL));
+		diffic = btc.difficulty;
+		height = btc.height;
+		expected_reward = btc.expected_reward;
+		tree_root = btc.tx_tree.root();
+		return true;
+	}
 
-	uint64_t median_ts;
-	if(!check_block_timestamp(b, median_ts))
+	if(chain_cached)
 	{
-		b.timestamp = median_ts;
+		b.major_version = btc.bl.major_version;
+		b.minor_version = btc.bl.minor_version;
+		b.prev_id = btc.bl.prev_id;
+		b.timestamp = std::max<uint64_t>(btc.bl.timestamp, time(NULL));
+		height = btc.height;
+		diffic = btc.difficulty;
+		median_size = btc.median_size;
+		already_generated_coins = btc.already_generated_coins;
 	}
+	else
+	{
+		CRITICAL_REGION_BEGIN(m_blockchain_lock);
+		height = m_db->height();
 
-	diffic = get_difficulty_for_next_block();
-	CHECK_AND_ASSERT_MES(diffic, false, "difficulty overhead.");
+		b.major_version = m_hardfork->get_current_version_num();
+		b.minor_version = m_hardfork->get_ideal_version();
+		b.prev_id = get_tail_id();
+		b.timestamp = time(NULL);
 
-	median_size = m_current_block_cumul_sz_limit / 2;
-	already_generated_coins = m_db->get_block_already_generated_coins(height - 1);
+		uint64_t median_ts;
+		if(!check_block_timestamp(b, median_ts))
+		{
+			b.timestamp = median_ts;
+		}
 
-	CRITICAL_REGION_END();
+		diffic = get_difficulty_for_next_block();
+		CHECK_AND_ASSERT_MES(diffic, false, "difficulty overhead.");
+
+		median_size = m_current_block_cumul_sz_limit / 2;
+		already_generated_coins = m_db->get_block_already_generated_coins(height - 1);
+
+		CRITICAL_REGION_END();
+	}
 
 	size_t txs_size;
 	uint64_t fee;
-	if(!m_tx_pool.fill_block_template(b, median_size, already_generated_coins, txs_size, fee, expected_reward, height))
+	if(txs_cached)
+	{
+		MDEBUG("Using cached block template transactions at height " << height);
+		b.tx_hashes = btc.bl.tx_hashes;
+		txs_size = btc.txs_size;
+		fee = btc.fee;
+		expected_reward = btc.expected_reward;
+	}
+	else if(!m_tx_pool.fill_block_template(b, median_size, already_generated_coins, txs_size, fee, expected_reward, height))
 	{
 		return false;
 	}
@@ -1483,12 +1559,64 @@ bool Blockchain::create_block_template(block &b, const account_public_address &m
 #if defined(DEBUG_CREATE_BLOCK_TEMPLATE)
 		MDEBUG("Creating block template: miner tx size " << coinbase_blob_size << ", cumulative size " << cumulative_size << " is now good");
 #endif
+
+		// with the same transactions only the miner tx leaf has to be hashed up to the root
+		const crypto::hash miner_tx_hash = get_transaction_hash(b.miner_tx);
+		if(txs_cached)
+		{
+			btc.tx_tree.replace(0, miner_tx_hash);
+		}
+		else
+		{
+			std::vector<crypto::hash> leaves;
+			leaves.reserve(b.tx_hashes.size() + 1);
+			leaves.push_back(miner_tx_hash);
+			leaves.insert(leaves.end(), b.tx_hashes.begin(), b.tx_hashes.end());
+			btc.tx_tree.assign(leaves.data(), leaves.size());
+		}
+		tree_root = btc.tx_tree.root();
+
+		btc.valid = true;
+		btc.bl = b;
+		btc.height = height;
+		btc.difficulty = diffic;
+		btc.median_size = median_size;
+		btc.already_generated_coins = already_generated_coins;
+		btc.pool_cookie = pool_cookie;
+		btc.txs_size = txs_size;
+		btc.fee = fee;
+		btc.expected_reward = expected_reward;
+		btc.miner_address = miner_address;
+		btc.ex_nonce = ex_nonce;
+		CRITICAL_REGION_LOCAL(m_btc_lock);
+		m_btc = std::move(btc);
 		return true;
 	}
 	LOG_ERROR("Failed to create_block_template with " << 10 << " tries");
 	return false;
 }
 //------------------------------------------------------------------
+uint64_t Blockchain::get_block_template_change_count() const
+{
+	boost::lock_guard<boost::mutex> lock(m_btc_change_lock);
+	return m_btc_change_count;
+}
+//------------------------------------------------------------------
+bool Blockchain::wait_block_template_change(uint64_t change_count, uint64_t timeout_ms) const
+{
+	boost::unique_lock<boost::mutex> lock(m_btc_change_lock);
+	return m_btc_change_cond.wait_for(lock, boost::chrono::milliseconds(timeout_ms), [&]() { return m_btc_change_count != change_count; });
+}
+//------------------------------------------------------------------
+void Blockchain::notify_block_template_change()
+{
+	{
+		boost::lock_guard<boost::mutex> lock(m_btc_change_lock);
+		++m_btc_change_count;
+	}
+	m_btc_change_cond.notify_all();
+}
+//------------------------------------------------------------------
 // for an alternate chain, get the timestamps from the main chain to complete
 // the needed number of timestamps for the BLOCKCHAIN_TIMESTAMP_CHECK_WINDOW.
 bool Blockchain::complete_timestamps_vector(uint64_t start_top_height, std::vector<uint64_t> &timestamps)
@@ -1523,7 +1651,6 @@ bool Blockchain::handle_alternative_block(const block &b, const crypto::hash &id
 {
 	LOG_PRINT_L3("Blockchain::" << __func__);
 	CRITICAL_REGION_LOCAL(m_blockchain_lock);
-	m_timestamps_and_difficulties_height = 0;
 	uint64_t block_height = get_block_height(b);
 	if(0 == block_height)
 	{
@@ -1629,7 +1756,12 @@ bool Blockchain::handle_alternative_block(const block &b, const crypto::hash &id
 		difficulty_type current_diff = get_next_difficulty_for_alternative_chain(alt_chain, bei);
 		CHECK_AND_ASSERT_MES(current_diff, false, "!!!!!!! DIFFICULTY OVERHEAD !!!!!!!");
 		crypto::hash proof_of_work = null_hash;
-		get_block_longhash(m_nettype, bei.bl, m_pow_ctx, proof_of_work);
+		bool pow_cached = m_db->get_pow_hash(id, bei.height, proof_of_work);
+		if(!pow_cached)
+		{
+			boost::lock_guard<boost::mutex> pow_lock(m_pow_ctx_lock);
+			get_block_longhash(m_nettype, bei.bl, m_pow_ctx, proof_of_work);
+		}
 		if(!check_hash(proof_of_work, current_diff))
 		{
 			MERROR_VER("Block with id: " << id << std::endl
@@ -1638,6 +1770,8 @@ bool Blockchain::handle_alternative_block(const block &b, const crypto::hash &id
 			bvc.m_verifivation_failed = true;
 			return false;
 		}
+		if(!pow_cached)
+			m_pow_hashes_to_store.emplace_back(id, bei.height, proof_of_work);
 
 		if(!prevalidate_miner_transaction(b, bei.height))
 		{
@@ -1719,7 +1853,7 @@ bool Blockchain::handle_alternative_block(const block &b, const crypto::hash &id
 bool Blockchain::get_blocks(uint64_t start_offset, size_t count, std::list<std::pair<cryptonote::blobdata, block>> &blocks, std::list<cryptonote::blobdata> &txs) const
 {
 	LOG_PRINT_L3("Blockchain::" << __func__);
-	CRITICAL_REGION_LOCAL(m_blockchain_lock);
+	SHARED_CRITICAL_REGION_LOCAL(m_blockchain_lock);
 	if(start_offset >= m_db->height())
 		return false;
 
@@ -1741,7 +1875,7 @@ bool Blockchain::get_blocks(uint64_t start_offset, size_t count, std::list<std::
 bool Blockchain::get_blocks(uint64_t start_offset, size_t count, std::list<std::pair<cryptonote::blobdata, block>> &blocks) const
 {
 	LOG_PRINT_L3("Blockchain::" << __func__);
-	CRITICAL_REGION_LOCAL(m_blockchain_lock);
+	SHARED_CRITICAL_REGION_LOCAL(m_blockchain_lock);
 	if(start_offset >= m_db->height())
 		return false;
 
@@ -1767,7 +1901,7 @@ bool Blockchain::get_blocks(uint64_t start_offset, size_t count, std::list<std::
 bool Blockchain::handle_get_objects(NOTIFY_REQUEST_GET_OBJECTS::request &arg, NOTIFY_RESPONSE_GET_OBJECTS::request &rsp)
 {
 	LOG_PRINT_L3("Blockchain::" << __func__);
-	CRITICAL_REGION_LOCAL(m_blockchain_lock);
+	SHARED_CRITICAL_REGION_LOCAL(m_blockchain_lock);
 	m_db->block_txn_start(true);
 	rsp.current_blockchain_height = get_current_blockchain_height();
 	std::list<std::pair<cryptonote::blobdata, block>> blocks;
@@ -1818,7 +1952,7 @@ bool Blockchain::handle_get_objects(NOTIFY_REQUEST_GET_OBJECTS::request &arg, NO
 bool Blockchain::get_alternative_blocks(std::list<block> &blocks) const
 {
 	LOG_PRINT_L3("Blockchain::" << __func__);
-	CRITICAL_REGION_LOCAL(m_blockchain_lock);
+	SHARED_CRITICAL_REGION_LOCAL(m_blockchain_lock);
 
 	for(const auto &alt_bl : m_alternative_chains)
 	{
@@ -1830,7 +1964,7 @@ bool Blockchain::get_alternative_blocks(std::list<block> &blocks) const
 size_t Blockchain::get_alternative_blocks_count() const
 {
 	LOG_PRINT_L3("Blockchain::" << __func__);
-	CRITICAL_REGION_LOCAL(m_blockchain_lock);
+	SHARED_CRITICAL_REGION_LOCAL(m_blockchain_lock);
 	return m_alternative_chains.size();
 }
 //------------------------------------------------------------------
@@ -1839,7 +1973,7 @@ size_t Blockchain::get_alternative_blocks_count() const
 void Blockchain::add_out_to_get_random_outs(COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount &result_outs, uint64_t amount, size_t i) const
 {
 	LOG_PRINT_L3("Blockchain::" << __func__);
-	CRITICAL_REGION_LOCAL(m_blockchain_lock);
+	SHARED_CRITICAL_REGION_LOCAL(m_blockchain_lock);
 
 	COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::out_entry &oen = *result_outs.outs.insert(result_outs.outs.end(), COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::out_entry());
 	oen.global_amount_index = i;
@@ -1946,7 +2080,7 @@ crypto::public_key Blockchain::get_output_key(uint64_t amount, uint64_t global_i
 bool Blockchain::get_random_outs_for_amounts(const COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::request &req, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::response &res) const
 {
 	LOG_PRINT_L3("Blockchain::" << __func__);
-	CRITICAL_REGION_LOCAL(m_blockchain_lock);
+	SHARED_CRITICAL_REGION_LOCAL(m_blockchain_lock);
 
 	// for each amount that we need to get mixins for, get <n> random outputs
 	// from BlockchainDB where <n> is req.outs_count (number of mixins).
@@ -1974,7 +2108,7 @@ bool Blockchain::get_random_outs_for_amounts(const COMMAND_RPC_GET_RANDOM_OUTPUT
 void Blockchain::add_out_to_get_rct_random_outs(std::list<COMMAND_RPC_GET_RANDOM_RCT_OUTPUTS::out_entry> &outs, uint64_t amount, size_t i) const
 {
 	LOG_PRINT_L3("Blockchain::" << __func__);
-	CRITICAL_REGION_LOCAL(m_blockchain_lock);
+	SHARED_CRITICAL_REGION_LOCAL(m_blockchain_lock);
 
 	COMMAND_RPC_GET_RANDOM_RCT_OUTPUTS::out_entry &oen = *outs.insert(outs.end(), COMMAND_RPC_GET_RANDOM_RCT_OUTPUTS::out_entry());
 	oen.amount = amount;
@@ -1991,7 +2125,7 @@ void Blockchain::add_out_to_get_rct_random_outs(std::list<COMMAND_RPC_GET_RANDOM
 bool Blockchain::get_random_rct_outs(const COMMAND_RPC_GET_RANDOM_RCT_OUTPUTS::request &req, COMMAND_RPC_GET_RANDOM_RCT_OUTPUTS::response &res) const
 {
 	LOG_PRINT_L3("Blockchain::" << __func__);
-	CRITICAL_REGION_LOCAL(m_blockchain_lock);
+	SHARED_CRITICAL_REGION_LOCAL(m_blockchain_lock);
 
 	// for each amount that we need to get mixins for, get <n> random outputs
 	// from BlockchainDB where <n> is req.outs_count (number of mixins).
@@ -2105,7 +2239,7 @@ bool Blockchain::get_random_rct_outs(const COMMAND_RPC_GET_RANDOM_RCT_OUTPUTS::r
 bool Blockchain::get_outs(const COMMAND_RPC_GET_OUTPUTS_BIN::request &req, COMMAND_RPC_GET_OUTPUTS_BIN::response &res) const
 {
 	LOG_PRINT_L3("Blockchain::" << __func__);
-	CRITICAL_REGION_LOCAL(m_blockchain_lock);
+	SHARED_CRITICAL_REGION_LOCAL(m_blockchain_lock);
 
 	res.outs.clear();
 	res.outs.reserve(req.outputs.size());
@@ -2148,7 +2282,7 @@ bool Blockchain::get_output_distribution(uint64_t amount, uint64_t from_height,
 bool Blockchain::find_blockchain_supplement(const std::list<crypto::hash> &qblock_ids, uint64_t &starter_offset) const
 {
 	LOG_PRINT_L3("Blockchain::" << __func__);
-	CRITICAL_REGION_LOCAL(m_blockchain_lock);
+	SHARED_CRITICAL_REGION_LOCAL(m_blockchain_lock);
 
 	// make sure the request includes at least the genesis block, otherwise
 	// how can we expect to sync from the client that the block list came from?
@@ -2229,7 +2363,7 @@ template <class t_ids_container, class t_blocks_container, class t_missed_contai
 bool Blockchain::get_blocks(const t_ids_container &block_ids, t_blocks_container &blocks, t_missed_container &missed_bs) const
 {
 	LOG_PRINT_L3("Blockchain::" << __func__);
-	CRITICAL_REGION_LOCAL(m_blockchain_lock);
+	SHARED_CRITICAL_REGION_LOCAL(m_blockchain_lock);
 
 	for(const auto &block_hash : block_ids)
 	{
@@ -2260,7 +2394,7 @@ template <class t_ids_container, class t_tx_container, class t_missed_container>
 bool Blockchain::get_transactions_blobs(const t_ids_container &txs_ids, t_tx_container &txs, t_missed_container &missed_txs) const
 {
 	LOG_PRINT_L3("Blockchain::" << __func__);
-	CRITICAL_REGION_LOCAL(m_blockchain_lock);
+	SHARED_CRITICAL_REGION_LOCAL(m_blockchain_lock);
 
 	for(const auto &tx_hash : txs_ids)
 	{
@@ -2284,7 +2418,7 @@ template <class t_ids_container, class t_tx_container, class t_missed_container>
 bool Blockchain::get_transactions(const t_ids_container &txs_ids, t_tx_container &txs, t_missed_container &missed_txs) const
 {
 	LOG_PRINT_L3("Blockchain::" << __func__);
-	CRITICAL_REGION_LOCAL(m_blockchain_lock);
+	SHARED_CRITICAL_REGION_LOCAL(m_blockchain_lock);
 
 	for(const auto &tx_hash : txs_ids)
 	{
@@ -2317,7 +2451,7 @@ bool Blockchain::get_transactions(const t_ids_container &txs_ids, t_tx_container
 bool Blockchain::find_blockchain_supplement(const std::list<crypto::hash> &qblock_ids, std::list<crypto::hash> &hashes, uint64_t &start_height, uint64_t &current_height) const
 {
 	LOG_PRINT_L3("Blockchain::" << __func__);
-	CRITICAL_REGION_LOCAL(m_blockchain_lock);
+	SHARED_CRITICAL_REGION_LOCAL(m_blockchain_lock);
 
 	// if we can't find the split point, return false
 	if(!find_blockchain_supplement(qblock_ids, start_height))
@@ -2340,7 +2474,7 @@ bool Blockchain::find_blockchain_supplement(const std::list<crypto::hash> &qbloc
 bool Blockchain::find_blockchain_supplement(const std::list<crypto::hash> &qblock_ids, NOTIFY_RESPONSE_CHAIN_ENTRY::request &resp) const
 {
 	LOG_PRINT_L3("Blockchain::" << __func__);
-	CRITICAL_REGION_LOCAL(m_blockchain_lock);
+	SHARED_CRITICAL_REGION_LOCAL(m_blockchain_lock);
 
 	bool result = find_blockchain_supplement(qblock_ids, resp.m_block_ids, resp.start_height, resp.total_height);
 	if(result)
@@ -2356,7 +2490,7 @@ bool Blockchain::find_blockchain_supplement(const std::list<crypto::hash> &qbloc
 bool Blockchain::find_blockchain_supplement(const uint64_t req_start_block, const std::list<crypto::hash> &qblock_ids, std::list<std::pair<cryptonote::blobdata, std::list<cryptonote::blobdata>>> &blocks, uint64_t &total_height, uint64_t &start_height, size_t max_count) const
 {
 	LOG_PRINT_L3("Blockchain::" << __func__);
-	CRITICAL_REGION_LOCAL(m_blockchain_lock);
+	SHARED_CRITICAL_REGION_LOCAL(m_blockchain_lock);
 
 	// if a specific start height has been requested
 	if(req_start_block > 0)
@@ -2418,7 +2552,7 @@ bool Blockchain::add_block_as_invalid(const block_extended_info &bei, const cryp
 bool Blockchain::have_block(const crypto::hash &id) const
 {
 	LOG_PRINT_L3("Blockchain::" << __func__);
-	CRITICAL_REGION_LOCAL(m_blockchain_lock);
+	SHARED_CRITICAL_REGION_LOCAL(m_blockchain_lock);
 
 	if(m_db->block_exists(id))
 	{
@@ -2467,7 +2601,7 @@ size_t Blockchain::get_total_transactions() const
 bool Blockchain::check_for_double_spend(const transaction &tx, key_images_container &keys_this_block) const
 {
 	LOG_PRINT_L3("Blockchain::" << __func__);
-	CRITICAL_REGION_LOCAL(m_blockchain_lock);
+	SHARED_CRITICAL_REGION_LOCAL(m_blockchain_lock);
 	struct add_transaction_input_visitor : public boost::static_visitor<bool>
 	{
 		key_images_container &m_spent_keys;
@@ -2526,7 +2660,7 @@ bool Blockchain::check_for_double_spend(const transaction &tx, key_images_contai
 bool Blockchain::get_tx_outputs_gindexs(const crypto::hash &tx_id, std::vector<uint64_t> &indexs) const
 {
 	LOG_PRINT_L3("Blockchain::" << __func__);
-	CRITICAL_REGION_LOCAL(m_blockchain_lock);
+	SHARED_CRITICAL_REGION_LOCAL(m_blockchain_lock);
 	uint64_t tx_index;
 	if(!m_db->tx_exists(tx_id, tx_index))
 	{
@@ -2748,13 +2882,15 @@ bool Blockchain::expand_transaction_2(transaction &tx, const crypto::hash &tx_pr
 //        check_tx_input() rather than here, and use this function simply
 //        to iterate the inputs as necessary (splitting the task
 //        using threads, etc.)
-bool Blockchain::check_tx_inputs(transaction &tx, tx_verification_context &tvc, uint64_t *pmax_used_block_height)
+bool Blockchain::check_tx_inputs(transaction &tx, tx_verification_context &tvc, uint64_t *pmax_used_block_height, crypto::hash *pdeferred_verification_key)
 {
 	PERF_TIMER(check_tx_inputs);
 	LOG_PRINT_L3("Blockchain::" << __func__);
 	size_t sig_index = 0;
 	if(pmax_used_block_height)
 		*pmax_used_block_height = 0;
+	if(pdeferred_verification_key)
+		*pdeferred_verification_key = null_hash;
 
 	crypto::hash tx_prefix_hash = get_transaction_prefix_hash(tx);
 
@@ -3013,11 +3149,21 @@ bool Blockchain::check_tx_inputs(transaction &tx, tx_verification_context &tvc,
 			}
 		}
 
-		if(!rct::verRctNonSemanticsSimple(rv))
+		const crypto::hash verification_key = get_tx_verification_key(tx, pubkeys);
+		if(m_verified_txs.contains(verification_key))
 		{
-			MERROR_VER("Failed to check ringct signatures!");
-			return false;
+			MDEBUG("Ring signatures of tx " << get_transaction_hash(tx) << " were already verified");
+			break;
 		}
+
+		if(pdeferred_verification_key)
+		{
+			*pdeferred_verification_key = verification_key;
+			break;
+		}
+
+		if(!check_tx_ring_signatures(tx, verification_key))
+			return false;
 		break;
 	}
 	case rct::RCTTypeFull:
@@ -3087,6 +3233,17 @@ bool Blockchain::check_tx_inputs(transaction &tx, tx_verification_context &tvc,
 	return true;
 }
 
+//------------------------------------------------------------------
+bool Blockchain::check_tx_ring_signatures(const transaction &tx, const crypto::hash &verification_key)
+{
+	if(!m_verified_txs.verify(verification_key, [&tx] { return rct::verRctNonSemanticsSimple(tx.rct_signatures); }))
+	{
+		MERROR_VER("Failed to check ringct signatures!");
+		return false;
+	}
+	return true;
+}
+
 //------------------------------------------------------------------
 void Blockchain::check_ring_signature(const crypto::hash &tx_prefix_hash, const crypto::key_image &key_image, const std::vector<rct::ctkey> &pubkeys, const std::vector<crypto::signature> &sig, uint64_t &result)
 {
@@ -3357,7 +3514,7 @@ bool Blockchain::flush_txes_from_pool(const std::list<crypto::hash> &txids)
 //      Needs to validate the block and acquire each transaction from the
 //      transaction mem_pool, then pass the block and transactions to
 //      m_db->add_block()
-bool Blockchain::handle_block_to_main_chain(const block &bl, const crypto::hash &id, block_verification_context &bvc)
+bool Blockchain::handle_block_to_main_chain(const block &bl, const crypto::hash &id, block_verification_context &bvc, const crypto::hash *pow_hash)
 {
 	LOG_PRINT_L3("Blockchain::" << __func__);
 
@@ -3441,6 +3598,7 @@ bool Blockchain::handle_block_to_main_chain(const block &bl, const crypto::hash
 	// be a parameter?
 	// validate proof_of_work versus difficulty target
 	bool precomputed = false;
+	bool pow_cached = false;
 	bool fast_check = false;
 #if defined(PER_BLOCK_CHECKPOINT)
 	if(m_db->height() < m_blocks_hash_check.size())
@@ -3471,8 +3629,18 @@ bool Blockchain::handle_block_to_main_chain(const block &bl, const crypto::hash
 			precomputed = true;
 			proof_of_work = it->second;
 		}
+		else if(m_db->get_pow_hash(id, m_db->height(), proof_of_work))
+		{
+			precomputed = true;
+			pow_cached = true;
+		}
+		else if(pow_hash)
+		{
+			proof_of_work = *pow_hash;
+		}
 		else
 		{
+			boost::lock_guard<boost::mutex> pow_lock(m_pow_ctx_lock);
 			get_block_longhash(m_nettype, bl, m_pow_ctx, proof_of_work);
 		}
 
@@ -3485,6 +3653,8 @@ bool Blockchain::handle_block_to_main_chain(const block &bl, const crypto::hash
 			bvc.m_verifivation_failed = true;
 			goto leave;
 		}
+		if(!pow_cached)
+			m_pow_hashes_to_store.emplace_back(id, m_db->height(), proof_of_work);
 	}
 
 	// If we're at a checkpoint, ensure that our hardcoded checkpoint hash
@@ -3519,6 +3689,11 @@ bool Blockchain::handle_block_to_main_chain(const block &bl, const crypto::hash
 	std::vector<transaction> txs;
 	key_images_container keys;
 
+	// txs whose ring signatures are checked once all the txs of the block passed
+	// the other input checks, with their index in the block and verification key
+	std::vector<transaction> deferred_txs;
+	std::vector<std::pair<size_t, crypto::hash>> deferred_keys;
+
 	uint64_t fee_summary = 0;
 	uint64_t t_checktx = 0;
 	uint64_t t_exists = 0;
@@ -3593,7 +3768,8 @@ bool Blockchain::handle_block_to_main_chain(const block &bl, const crypto::hash
 		{
 			// validate that transaction inputs and the keys spending them are correct.
 			tx_verification_context tvc;
-			if(!check_tx_inputs(tx, tvc))
+			crypto::hash verification_key;
+			if(!check_tx_inputs(tx, tvc, NULL, &verification_key))
 			{
 				MERROR_VER("Block with id: " << id << " has at least one transaction (id: " << tx_id << ") with wrong inputs.");
 
@@ -3601,9 +3777,15 @@ bool Blockchain::handle_block_to_main_chain(const block &bl, const crypto::hash
 				add_block_as_invalid(bl, id);
 				MERROR_VER("Block with id " << id << " added as invalid because of wrong inputs in transactions");
 				bvc.m_verifivation_failed = true;
+				bvc.m_bad_tx_id = tx_id;
 				return_tx_to_pool(txs);
 				goto leave;
 			}
+			if(verification_key != null_hash)
+			{
+				deferred_keys.emplace_back(txs.size() - 1, verification_key);
+				deferred_txs.push_back(std::move(tx));
+			}
 		}
 #if defined(PER_BLOCK_CHECKPOINT)
 		else
@@ -3617,6 +3799,7 @@ bool Blockchain::handle_block_to_main_chain(const block &bl, const crypto::hash
 				add_block_as_invalid(bl, id);
 				MERROR_VER("Block with id " << id << " added as invalid because of wrong inputs in transactions");
 				bvc.m_verifivation_failed = true;
+				bvc.m_bad_tx_id = tx_id;
 				return_tx_to_pool(txs);
 				goto leave;
 			}
@@ -3630,6 +3813,46 @@ bool Blockchain::handle_block_to_main_chain(const block &bl, const crypto::hash
 
 	m_blocks_txs_check.clear();
 
+	// The ring signatures do not depend on the chain, so the txs are checked concurrently.
+	// The first failure in block order is reported, whatever order the checks finish in.
+	if(!deferred_txs.empty())
+	{
+		TIME_MEASURE_START(rs);
+		std::vector<uint64_t> results(deferred_txs.size(), 0);
+		if(deferred_txs.size() > 1)
+		{
+			tools::threadpool &tpool = tools::threadpool::getInstance();
+			tools::threadpool::waiter waiter;
+			for(size_t i = 0; i < deferred_txs.size(); i++)
+			{
+				tpool.submit(&waiter, [this, &deferred_txs, &deferred_keys, &results, i] {
+					results[i] = check_tx_ring_signatures(deferred_txs[i], deferred_keys[i].second) ? 1 : 0;
+				});
+			}
+			waiter.wait();
+		}
+		else
+		{
+			results[0] = check_tx_ring_signatures(deferred_txs[0], deferred_keys[0].second) ? 1 : 0;
+		}
+		TIME_MEASURE_FINISH(rs);
+		t_checktx += rs;
+
+		for(size_t i = 0; i < results.size(); i++)
+		{
+			if(!results[i])
+			{
+				MERROR_VER("Block with id: " << id << " has at least one transaction (id: " << bl.tx_hashes[deferred_keys[i].first] << ") with wrong inputs.");
+				add_block_as_invalid(bl, id);
+				MERROR_VER("Block with id " << id << " added as invalid because of wrong inputs in transactions");
+				bvc.m_verifivation_failed = true;
+				bvc.m_bad_tx_id = bl.tx_hashes[deferred_keys[i].first];
+				return_tx_to_pool(txs);
+				goto leave;
+			}
+		}
+	}
+
 	TIME_MEASURE_START(vmt);
 	uint64_t base_reward = 0;
 	uint64_t already_generated_coins = m_db->height() ? m_db->get_block_already_generated_coins(m_db->height() - 1) : 0;
@@ -3719,10 +3942,21 @@ bool Blockchain::handle_block_to_main_chain(const block &bl, const crypto::hash
 						 << target_calculating_time << "/" << longhash_calculating_time << "/"
 						 << t1 << "/" << t2 << "/" << t3 << "/" << t_exists << "/" << t_pool
 						 << "/" << t_checktx << "/" << t_dblspnd << "/" << vmt << "/" << addblock << ")ms");
+
+		const rct::point_cache &pcache = rct::point_cache::getInstance();
+		if(pcache.enabled())
+		{
+			const rct::point_cache::stats st = pcache.get_stats();
+			const uint64_t lookups = st.hits + st.misses;
+			MINFO("Ring point cache: " << st.entries << " entries, " << st.memory / 1024 << " kB, hit rate "
+									   << (lookups ? st.hits * 100 / lookups : 0) << "% (" << st.hits << "/" << lookups << "), "
+									   << st.evictions << " evictions");
+		}
 	}
 
 	bvc.m_added_to_main_chain = true;
 	++m_sync_counter;
+	notify_block_template_change();
 
 	// appears to be a NOP *and* is called elsewhere.  wat?
 	m_tx_pool.on_blockchain_inc(new_height, id);
@@ -3753,6 +3987,13 @@ bool Blockchain::add_new_block(const block &bl_, block_verification_context &bvc
 	//copy block here to let modify block.target
 	block bl = bl_;
 	crypto::hash id = get_block_hash(bl);
+
+	// The PoW hash depends on nothing but the block, so it is worked out before the exclusive lock
+	// is taken. Checking the block's txs reads chain state that must not change until the block is
+	// stored, so the rest is done under the exclusive lock.
+	crypto::hash proof_of_work;
+	const bool pow_known = precompute_block_pow(bl, id, proof_of_work);
+
 	CRITICAL_REGION_LOCAL(m_tx_pool); //to avoid deadlock lets lock tx_pool for whole add/reorganize process
 	CRITICAL_REGION_LOCAL1(m_blockchain_lock);
 	m_db->block_txn_start(true);
@@ -3778,7 +4019,25 @@ bool Blockchain::add_new_block(const block &bl_, block_verification_context &bvc
 	}
 
 	m_db->block_txn_stop();
-	return handle_block_to_main_chain(bl, id, bvc);
+	return handle_block_to_main_chain(bl, id, bvc, pow_known ? &proof_of_work : nullptr);
+}
+//------------------------------------------------------------------
+bool Blockchain::precompute_block_pow(const block &bl, const crypto::hash &id, crypto::hash &proof_of_work)
+{
+	LOG_PRINT_L3("Blockchain::" << __func__);
+	{
+		SHARED_CRITICAL_REGION_LOCAL(m_blockchain_lock);
+		const uint64_t height = m_db->height();
+#if defined(PER_BLOCK_CHECKPOINT)
+		if(height < m_blocks_hash_check.size())
+			return false;
+#endif
+		if(bl.prev_id != get_tail_id() || m_blocks_longhash_table.find(id) != m_blocks_longhash_table.end() || m_db->get_pow_hash(id, height, proof_of_work))
+			return false;
+	}
+
+	boost::lock_guard<boost::mutex> pow_lock(m_pow_ctx_lock);
+	return get_block_longhash(m_nettype, bl, m_pow_ctx, proof_of_work);
 }
 //------------------------------------------------------------------
 //TODO: Refactor, consider returning a failure height and letting
@@ -3861,17 +4120,38 @@ void Blockchain::set_enforce_dns_checkpoints(bool enforce_checkpoints)
 }
 
 //------------------------------------------------------------------
-void Blockchain::block_longhash_worker(cn_pow_hash_v2 &hash_ctx, const std::vector<block> &blocks, std::unordered_map<crypto::hash, crypto::hash> &map)
+void Blockchain::block_longhash_worker(std::vector<cn_pow_hash_v2> &hash_ctxes, const std::vector<block> &blocks, std::unordered_map<crypto::hash, crypto::hash> &map)
 {
 	TIME_MEASURE_START(t);
 
-	for(const auto &block : blocks)
+	if(hash_ctxes.empty())
+	{
+		hash_ctxes.resize(BLOCK_LONGHASH_LANES);
+		MINFO(BLOCK_LONGHASH_LANES << " PoW scratchpads allocated, last one with " << cn_pad_mode_str(hash_ctxes.back().get_pad_mode()));
+	}
+
+	size_t i = 0;
+	const block *lane_blocks[BLOCK_LONGHASH_LANES];
+	crypto::hash lane_pow[BLOCK_LONGHASH_LANES];
+	for(; i + BLOCK_LONGHASH_LANES <= blocks.size(); i += BLOCK_LONGHASH_LANES)
 	{
 		if(m_cancel)
 			break;
-		crypto::hash id = get_block_hash(block);
+		for(size_t l = 0; l < BLOCK_LONGHASH_LANES; l++)
+			lane_blocks[l] = &blocks[i + l];
+		get_block_longhash_multi(m_nettype, lane_blocks, hash_ctxes.data(), lane_pow);
+		for(size_t l = 0; l < BLOCK_LONGHASH_LANES; l++)
+			map.emplace(get_block_hash(blocks[i + l]), lane_pow[l]);
+	}
+
+	// hash the remainder that does not fill all lanes
+	for(; i < blocks.size(); i++)
+	{
+		if(m_cancel)
+			break;
+		crypto::hash id = get_block_hash(blocks[i]);
 		crypto::hash pow;
-		get_block_longhash(m_nettype, block, hash_ctx, pow);
+		get_block_longhash(m_nettype, blocks[i], hash_ctxes[0], pow);
 		map.emplace(id, pow);
 	}
 
@@ -3889,6 +4169,10 @@ bool Blockchain::cleanup_handle_incoming_blocks(bool force_sync)
 
 	try
 	{
+		for(const auto &entry : m_pow_hashes_to_store)
+			m_db->add_pow_hash(std::get<0>(entry), std::get<1>(entry), std::get<2>(entry));
+		if(m_db->height() > BLOCK_POW_HASH_CACHE_DEPTH)
+			m_db->prune_pow_hashes(m_db->height() - BLOCK_POW_HASH_CACHE_DEPTH);
 		m_db->batch_stop();
 		success = true;
 	}
@@ -3896,6 +4180,11 @@ bool Blockchain::cleanup_handle_incoming_blocks(bool force_sync)
 	{
 		MERROR("Exception in cleanup_handle_incoming_blocks: " << e.what());
 	}
+	m_pow_hashes_to_store.clear();
+	{
+		boost::lock_guard<boost::mutex> lock(m_rct_verified_txs_lock);
+		m_rct_verified_txs.clear();
+	}
 
 	if(success && m_sync_counter > 0)
 	{
@@ -3943,6 +4232,37 @@ bool Blockchain::cleanup_handle_incoming_blocks(bool force_sync)
 	return success;
 }
 
+//------------------------------------------------------------------
+void Blockchain::prefetch_pow_hashes(const std::list<block_complete_entry> &blocks_entry)
+{
+	MTRACE("Blockchain::" << __func__);
+	uint64_t threads = std::min<uint64_t>(tools::threadpool::getInstance().get_max_concurrency(), m_max_prepare_blocks_threads);
+
+	// prepare_handle_incoming_blocks only uses hashes when it hashes on several threads too
+	if(blocks_entry.size() <= 1 || threads <= 1 || m_cancel)
+		return;
+
+	std::vector<block> blocks;
+	blocks.reserve(blocks_entry.size());
+	for(const auto &entry : blocks_entry)
+	{
+		block b;
+		if(!parse_and_validate_block_from_blob(entry.block, b))
+			return;
+		blocks.push_back(std::move(b));
+	}
+
+	// blocks covered by the precomputed hashes are not hashed at all
+	{
+		SHARED_CRITICAL_REGION_LOCAL(m_blockchain_lock);
+		if(get_block_height(blocks.front()) + blocks.size() < m_blocks_hash_check.size())
+			return;
+	}
+
+	// one core is left to the validation of the blocks that are being added meanwhile
+	m_pow_prefetcher.start(std::move(blocks), threads - 1);
+}
+
 //------------------------------------------------------------------
 //FIXME: unused parameter txs
 void Blockchain::output_scan_worker(const uint64_t amount, const std::vector<uint64_t> &offsets, std::vector<output_data_t> &outputs, std::unordered_map<crypto::hash, cryptonote::transaction> &txs) const
@@ -4184,6 +4504,37 @@ bool Blockchain::prepare_handle_incoming_blocks(const std::list<block_complete_e
 		if(!blocks_exist)
 		{
 			m_blocks_longhash_table.clear();
+
+			// blocks hashed ahead while the previous span was added
+			std::unordered_map<crypto::hash, crypto::hash> prefetched = m_pow_prefetcher.take();
+
+			// blocks whose PoW was verified in an earlier session need no hashing either
+			uint64_t pow_cached = 0, pow_prefetched = 0;
+			for(auto &thread_blocks : blocks)
+			{
+				auto last = std::remove_if(thread_blocks.begin(), thread_blocks.end(), [&](const block &b) {
+					crypto::hash id = get_block_hash(b);
+					auto it = prefetched.find(id);
+					if(it != prefetched.end())
+					{
+						m_blocks_longhash_table.emplace(id, it->second);
+						++pow_prefetched;
+						return true;
+					}
+					crypto::hash pow;
+					if(!m_db->get_pow_hash(id, get_block_height(b), pow))
+						return false;
+					m_blocks_longhash_table.emplace(id, pow);
+					++pow_cached;
+					return true;
+				});
+				thread_blocks.erase(last, thread_blocks.end());
+			}
+			if(pow_cached)
+				MDEBUG(pow_cached << " blocks found in the PoW cache");
+			if(pow_prefetched)
+				MDEBUG(pow_prefetched << " blocks hashed ahead");
+
 			tools::threadpool::waiter waiter;
 
 			if(m_hash_ctxes_multi.size() < threads)
@@ -4219,6 +4570,10 @@ bool Blockchain::prepare_handle_incoming_blocks(const std::list<block_complete_e
 
 	m_scan_table.clear();
 	m_check_txin_table.clear();
+	{
+		boost::lock_guard<boost::mutex> lock(m_rct_verified_txs_lock);
+		m_rct_verified_txs.clear();
+	}
 
 	TIME_MEASURE_FINISH(prepare);
 	m_fake_pow_calc_time = prepare / blocks_entry.size();
@@ -4343,6 +4698,12 @@ bool Blockchain::prepare_handle_incoming_blocks(const std::list<block_complete_e
 
 	int total_txs = 0;
 
+	// txs to verify the rct semantics of in batches, the core skips semantics in the embedded hash area
+	std::list<transaction> rct_txs;
+	std::vector<crypto::hash> rct_hashes;
+	std::vector<const rct::rctSig *> rct_sigs;
+	const bool batch_rct = m_rct_batch_size > 0 && !is_within_compiled_block_hash_area(m_db->height() + blocks_entry.size());
+
 	// now generate a table for each tx_prefix and k_image hashes
 	for(const auto &entry : blocks_entry)
 	{
@@ -4359,6 +4720,7 @@ bool Blockchain::prepare_handle_incoming_blocks(const std::list<block_complete_e
 				SCAN_TABLE_QUIT("Could not parse tx from incoming blocks.");
 
 			++total_txs;
+
 			auto its = m_scan_table.find(tx_prefix_hash);
 			if(its == m_scan_table.end())
 				SCAN_TABLE_QUIT("Tx not found on scan table from incoming blocks.");
@@ -4393,6 +4755,13 @@ bool Blockchain::prepare_handle_incoming_blocks(const std::list<block_complete_e
 
 				its->second.emplace(in_to_key.k_image, outputs);
 			}
+
+			if(batch_rct && (tx.rct_signatures.type == rct::RCTTypeSimple || tx.rct_signatures.type == rct::RCTTypeBulletproof))
+			{
+				rct_txs.push_back(std::move(tx));
+				rct_hashes.push_back(tx_hash);
+				rct_sigs.push_back(&rct_txs.back().rct_signatures);
+			}
 		}
 	}
 
@@ -4404,9 +4773,34 @@ bool Blockchain::prepare_handle_incoming_blocks(const std::list<block_complete_e
 			MDEBUG("Prepare scantable took: " << scantable << " ms");
 	}
 
+	// each batch is one multiexp, batches run side by side
+	TIME_MEASURE_START(rct_batch);
+	std::deque<bool> rct_results;
+	rct::verRctSemanticsSimple(rct_sigs, m_rct_batch_size, rct_results);
+	{
+		boost::lock_guard<boost::mutex> lock(m_rct_verified_txs_lock);
+		for(size_t i = 0; i < rct_sigs.size(); ++i)
+			if(rct_results[i])
+				m_rct_verified_txs.insert(rct_hashes[i]);
+	}
+	TIME_MEASURE_FINISH(rct_batch);
+	if(!rct_sigs.empty() && m_show_time_stats)
+		MDEBUG("Batched rct semantics of " << rct_sigs.size() << " txs took: " << rct_batch << " ms");
+
 	return true;
 }
 
+bool Blockchain::is_rct_semantics_verified(const crypto::hash &tx_hash) const
+{
+	boost::lock_guard<boost::mutex> lock(m_rct_verified_txs_lock);
+	return m_rct_verified_txs.find(tx_hash) != m_rct_verified_txs.end();
+}
+
+crypto::hash Blockchain::get_tx_verification_key(const transaction &tx, const std::vector<std::vector<rct::ctkey>> &pubkeys) const
+{
+	return tx_verification_cache::get_key(get_transaction_hash(tx), pubkeys, get_current_hard_fork_version_num());
+}
+
 void Blockchain::add_txpool_tx(transaction &tx, const txpool_tx_meta_t &meta)
 {
 	m_db->add_txpool_tx(tx, meta);
@@ -4460,6 +4854,12 @@ void Blockchain::set_user_options(uint64_t maxthreads, uint64_t blocks_per_sync,
 	m_max_prepare_blocks_threads = maxthreads;
 }
 
+void Blockchain::set_ring_point_cache_size(size_t bytes)
+{
+	rct::point_cache::getInstance().set_max_memory(bytes);
+	MINFO("Ring point cache size set to " << bytes / (1024 * 1024) << " MB");
+}
+
 void Blockchain::safesyncmode(const bool onoff)
 {
 	/* all of this is no-op'd if the user set a specific
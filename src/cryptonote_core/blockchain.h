@@ -47,6 +47,8 @@
 #pragma once
 #include <atomic>
 #include <boost/asio/io_service.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
 #include <boost/multi_index/global_fun.hpp>
 #include <boost/multi_index/hashed_index.hpp>
 #include <boost/multi_index/member.hpp>
@@ -54,22 +56,27 @@
 #include <boost/serialization/list.hpp>
 #include <boost/serialization/serialization.hpp>
 #include <boost/serialization/version.hpp>
+#include <tuple>
 #include <unordered_map>
 #include <unordered_set>
 
 #include "blockchain_db/blockchain_db.h"
 #include "checkpoints/checkpoints.h"
+#include "common/threadpool.h"
 #include "common/util.h"
 #include "crypto/hash.h"
+#include "crypto/tree_hash_builder.h"
 #include "cryptonote_basic/cryptonote_basic.h"
 #include "cryptonote_basic/difficulty.h"
 #include "cryptonote_basic/hardfork.h"
 #include "cryptonote_basic/verification_context.h"
 #include "cryptonote_protocol/cryptonote_protocol_defs.h"
 #include "cryptonote_tx_utils.h"
+#include "pow_prefetcher.h"
 #include "rpc/core_rpc_server_commands_defs.h"
 #include "string_tools.h"
 #include "syncobj.h"
+#include "tx_verification_cache.h"
 
 namespace cryptonote
 {
@@ -240,6 +247,19 @@ class Blockchain
      */
 	bool cleanup_handle_incoming_blocks(bool force_sync = false);
 
+	/**
+     * @brief starts hashing the PoW of the blocks that will be added after the current ones
+     *
+     * The hashes are computed on dedicated threads while the current blocks are being
+     * validated and committed on the threadpool, and prepare_handle_incoming_blocks uses
+     * them instead of hashing those blocks again. Only one group of blocks is hashed
+     * ahead, so a call waits for the hashing started by the previous one to finish and
+     * drops its hashes if they were not used.
+     *
+     * @param blocks a list of incoming blocks
+     */
+	void prefetch_pow_hashes(const std::list<block_complete_entry> &blocks);
+
 	/**
      * @brief search the blockchain for a transaction by hash
      *
@@ -340,6 +360,43 @@ class Blockchain
      */
 	bool create_block_template(block &b, const account_public_address &miner_address, difficulty_type &di, uint64_t &height, uint64_t &expected_reward, const blobdata &ex_nonce);
 
+	/**
+     * @brief creates a new block to mine against, along with its transaction tree root
+     *
+     * The tree is kept with the cached template, so a template that only differs
+     * in the miner tx costs log2(transactions) hashes rather than the whole tree.
+     *
+     * @param tree_root return-by-reference the tx tree root of b, as get_tx_tree_hash(b)
+     *
+     * @copydetails create_block_template(block&, const account_public_address&, difficulty_type&, uint64_t&, uint64_t&, const blobdata&)
+     */
+	bool create_block_template(block &b, const account_public_address &miner_address, difficulty_type &di, uint64_t &height, uint64_t &expected_reward, const blobdata &ex_nonce, crypto::hash &tree_root);
+
+	/**
+     * @brief gets a number that changes whenever a new block template could differ from the last one
+     *
+     * It is bumped when the top block changes and when a transaction enters or
+     * leaves the pool.
+     *
+     * @return the current block template change count
+     */
+	uint64_t get_block_template_change_count() const;
+
+	/**
+     * @brief waits until the block template change count moves away from a given value
+     *
+     * @param change_count the value of get_block_template_change_count() seen before the last template was made
+     * @param timeout_ms how long to wait at most, in milliseconds
+     *
+     * @return true if the count changed, false on timeout
+     */
+	bool wait_block_template_change(uint64_t change_count, uint64_t timeout_ms) const;
+
+	/**
+     * @brief bumps the block template change count and wakes up whoever waits on it
+     */
+	void notify_block_template_change();
+
 	/**
      * @brief checks if a block is known about with a given hash
      *
@@ -745,6 +802,44 @@ class Blockchain
      */
 	void set_show_time_stats(bool stats) { m_show_time_stats = stats; }
 
+	/**
+     * @brief set how many transactions have their range proofs verified together
+     *
+     * While syncing, prepare_handle_incoming_blocks verifies the ringct
+     * semantics of every transaction in the span in batches of this size.
+     *
+     * @param batch_size max transactions per batch, 0 to disable batching
+     */
+	void set_rct_batch_size(size_t batch_size) { m_rct_batch_size = batch_size; }
+
+	/**
+     * @brief set the memory cap of the ring member point cache
+     *
+     * Ring members are decompressed and hashed to a point once, then kept
+     * in rct::point_cache for the MLSAG checks of later transactions.
+     *
+     * @param bytes memory cap, 0 to disable the cache
+     */
+	void set_ring_point_cache_size(size_t bytes);
+
+	/**
+     * @brief gets how many transactions have their range proofs verified together
+     *
+     * @return max transactions per batch, 0 if batching is disabled
+     */
+	size_t get_rct_batch_size() const { return m_rct_batch_size; }
+
+	/**
+     * @brief checks whether a tx from the blocks being added passed batched ringct semantics verification
+     *
+     * Only valid between prepare_handle_incoming_blocks and cleanup_handle_incoming_blocks.
+     *
+     * @param tx_hash the hash of the transaction
+     *
+     * @return true if the tx's rct semantics are already known to be valid
+     */
+	bool is_rct_semantics_verified(const crypto::hash &tx_hash) const;
+
 	/**
      * @brief gets the hardfork voting state object
      *
@@ -924,11 +1019,14 @@ class Blockchain
 	/**
      * @brief computes the "short" and "long" hashes for a set of blocks
      *
-     * @param hash_ctx pow hash ctx
+     * The contexts are allocated here on first use, so that the scratchpads are faulted
+     * in (and bound) on the NUMA node of the worker thread rather than the caller's.
+     *
+     * @param hash_ctxes the pow hash contexts owned by the worker, BLOCK_LONGHASH_LANES once allocated
      * @param blocks the blocks to be hashed
      * @param map return-by-reference the hashes for each block
      */
-	void block_longhash_worker(cn_pow_hash_v2 &hash_ctx, const std::vector<block> &blocks, std::unordered_map<crypto::hash, crypto::hash> &map);
+	void block_longhash_worker(std::vector<cn_pow_hash_v2> &hash_ctxes, const std::vector<block> &blocks, std::unordered_map<crypto::hash, crypto::hash> &map);
 
 	/**
      * @brief returns a set of known alternate chains
@@ -983,7 +1081,8 @@ class Blockchain
 
 	tx_memory_pool &m_tx_pool;
 
-	mutable epee::critical_section m_blockchain_lock; // TODO: add here reader/writer lock
+	// taken shared by read-only queries, exclusively by anything that changes the chain
+	mutable epee::rw_critical_section m_blockchain_lock;
 
 	// main chain
 	transactions_container m_transactions;
@@ -993,7 +1092,16 @@ class Blockchain
 	// metadata containers
 	std::unordered_map<crypto::hash, std::unordered_map<crypto::key_image, std::vector<output_data_t>>> m_scan_table;
 	std::unordered_map<crypto::hash, crypto::hash> m_blocks_longhash_table;
+	// verified PoW hashes to write to the db's PoW cache, as {block id, height, PoW}
+	std::vector<std::tuple<crypto::hash, uint64_t, crypto::hash>> m_pow_hashes_to_store;
 	std::unordered_map<crypto::hash, std::unordered_map<crypto::key_image, bool>> m_check_txin_table;
+	// txs of the span being added whose rct semantics passed batch verification
+	std::unordered_set<crypto::hash> m_rct_verified_txs;
+	mutable boost::mutex m_rct_verified_txs_lock;
+	size_t m_rct_batch_size;
+	// txs whose ring signatures passed, by get_tx_verification_key, kept across blocks so
+	// that txs already checked when entering the pool are not checked again in a block
+	tx_verification_cache m_verified_txs;
 
 	// SHA-3 hashes for each block and for fast pow checking
 	std::vector<crypto::hash> m_blocks_hash_of_hashes;
@@ -1012,9 +1120,9 @@ class Blockchain
 	uint64_t m_fake_pow_calc_time;
 	uint64_t m_fake_scan_time;
 	uint64_t m_sync_counter;
-	std::vector<uint64_t> m_timestamps;
-	std::vector<difficulty_type> m_difficulties;
-	uint64_t m_timestamps_and_difficulties_height;
+	difficulty_window m_difficulty_window; //!< the main chain blocks get_difficulty_for_next_block works on
+	uint64_t m_difficulty_window_height; //!< the height right after the newest block in m_difficulty_window
+	boost::mutex m_difficulty_window_lock; //!< serialises readers updating m_difficulty_window under a shared m_blockchain_lock
 
 	boost::asio::io_service m_async_service;
 	boost::thread_group m_async_pool;
@@ -1027,7 +1135,38 @@ class Blockchain
 	blocks_ext_by_hash m_invalid_blocks; // crypto::hash -> block_extended_info
 
 	cn_pow_hash_v2 m_pow_ctx;
-	std::vector<cn_pow_hash_v2> m_hash_ctxes_multi;
+	boost::mutex m_pow_ctx_lock; //!< m_pow_ctx is also used by add_new_block before it takes m_blockchain_lock
+	// one set of lanes per worker, each filled in by block_longhash_worker itself
+	std::vector<std::vector<cn_pow_hash_v2>> m_hash_ctxes_multi;
+
+	// PoW of the next span of blocks, hashed by prefetch_pow_hashes
+	pow_prefetcher m_pow_prefetcher;
+
+	// the last block template handed out by create_block_template. The chain dependent part
+	// stays valid as long as the top block does, the transactions as long as the pool cookie
+	// does too, and the miner tx as long as the address and extra nonce also match.
+	struct block_template_cache
+	{
+		bool valid;
+		block bl;
+		uint64_t height;
+		difficulty_type difficulty;
+		size_t median_size;
+		uint64_t already_generated_coins;
+		uint64_t pool_cookie;
+		size_t txs_size;
+		uint64_t fee;
+		uint64_t expected_reward;
+		account_public_address miner_address;
+		blobdata ex_nonce;
+		crypto::tree_hash_builder tx_tree;
+	};
+	block_template_cache m_btc;
+	epee::critical_section m_btc_lock;
+
+	uint64_t m_btc_change_count;
+	mutable boost::mutex m_btc_change_lock;
+	mutable boost::condition_variable m_btc_change_cond;
 
 	checkpoints m_checkpoints;
 	bool m_enforce_dns_checkpoints;
@@ -1100,10 +1239,25 @@ class Blockchain
      * @param tx the transaction to validate
      * @param tvc returned information about tx verification
      * @param pmax_related_block_height return-by-pointer the height of the most recent block in the input set
+     * @param pdeferred_verification_key if not NULL, the ring signatures of simple rct transactions are
+     *        not checked, and the key to check them with check_tx_ring_signatures is returned here
+     *        instead, or null_hash if they are already known to be valid
      *
      * @return false if any validation step fails, otherwise true
      */
-	bool check_tx_inputs(transaction &tx, tx_verification_context &tvc, uint64_t *pmax_used_block_height = NULL);
+	bool check_tx_inputs(transaction &tx, tx_verification_context &tvc, uint64_t *pmax_used_block_height = NULL, crypto::hash *pdeferred_verification_key = NULL);
+
+	/**
+     * @brief checks the ring signatures of a simple rct transaction expanded by check_tx_inputs
+     *
+     * Safe to call from several threads at once, it does not access the database.
+     *
+     * @param tx the transaction, as expanded by check_tx_inputs
+     * @param verification_key the key returned by check_tx_inputs
+     *
+     * @return true if the ring signatures are valid, otherwise false
+     */
+	bool check_tx_ring_signatures(const transaction &tx, const crypto::hash &verification_key);
 
 	/**
      * @brief performs a blockchain reorganization according to the longest chain rule
@@ -1150,10 +1304,25 @@ class Blockchain
      * @param bl the block to be added
      * @param id the hash of the block
      * @param bvc metadata concerning the block's validity
+     * @param pow_hash the block's PoW hash if the caller computed it, otherwise nullptr
      *
      * @return true if the block was added successfully, otherwise false
      */
-	bool handle_block_to_main_chain(const block &bl, const crypto::hash &id, block_verification_context &bvc);
+	bool handle_block_to_main_chain(const block &bl, const crypto::hash &id, block_verification_context &bvc, const crypto::hash *pow_hash = nullptr);
+
+	/**
+     * @brief computes the PoW hash of a block about to be added to the main chain
+     *
+     * Only takes m_blockchain_lock shared, to look up whether the block
+     * goes on top of the chain and still needs hashing.
+     *
+     * @param bl the block
+     * @param id the hash of the block
+     * @param proof_of_work return-by-reference the PoW hash
+     *
+     * @return true if the block was hashed, false if it does not need to be
+     */
+	bool precompute_block_pow(const block &bl, const crypto::hash &id, crypto::hash &proof_of_work);
 
 	/**
      * @brief validate and add a new block to an alternate blockchain
@@ -1403,5 +1572,19 @@ class Blockchain
      * that implicit data.
      */
 	bool expand_transaction_2(transaction &tx, const crypto::hash &tx_prefix_hash, const std::vector<std::vector<rct::ctkey>> &pubkeys);
+
+	/**
+     * @brief gets the key of a transaction in the verification cache
+     *
+     * The key covers the transaction hash, the ring members its inputs
+     * resolved to and the current hard fork version, so a cached result
+     * is not reused if a reorg changes the rings or the rules change.
+     *
+     * @param tx the transaction
+     * @param pubkeys the resolved ring members of each input
+     *
+     * @return the key
+     */
+	crypto::hash get_tx_verification_key(const transaction &tx, const std::vector<std::vector<rct::ctkey>> &pubkeys) const;
 };
 } // namespace cryptonote
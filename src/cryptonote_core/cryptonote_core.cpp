@@ -64,6 +64,7 @@ using namespace epee;
 #include "cryptonote_tx_utils.h"
 #include "file_io_utils.h"
 #include "misc_language.h"
+#include "ringct/multiexp.h"
 #include "ringct/rctSigs.h"
 #include "ringct/rctTypes.h"
 #include "version.h"
@@ -114,6 +115,10 @@ static const command_line::arg_descriptor<uint64_t> arg_show_time_stats = {
 	"show-time-stats", "Show time-stats when processing blocks/txs and disk synchronization.", 0};
 static const command_line::arg_descriptor<size_t> arg_block_sync_size = {
 	"block-sync-size", "How many blocks to sync at once during chain synchronization (0 = adaptive).", 0};
+static const command_line::arg_descriptor<size_t> arg_rct_batch_size = {
+	"rct-batch-size", "How many synced transactions have their range proofs verified together (0 = one at a time).", RCT_VERIFY_BATCH_DEFAULT_SIZE};
+static const command_line::arg_descriptor<size_t> arg_ring_point_cache_size = {
+	"ring-point-cache-size", "Memory in MB for decompressed ring members reused across transaction checks (0 = disabled).", RING_POINT_CACHE_DEFAULT_SIZE_MB};
 static const command_line::arg_descriptor<std::string> arg_check_updates = {
 	"check-updates", "Check for new versions of ryo: [disabled|notify|download|update]", "notify"};
 static const command_line::arg_descriptor<bool> arg_fluffy_blocks = {
@@ -136,7 +141,8 @@ core::core(i_cryptonote_protocol *pprotocol) : m_mempool(m_blockchain_storage),
 											   m_disable_dns_checkpoints(false),
 											   m_threadpool(tools::threadpool::getInstance()),
 											   m_update_download(0),
-											   m_nettype(UNDEFINED)
+											   m_nettype(UNDEFINED),
+											   m_relay_tx_batcher([this](const std::list<blobdata> &tx_blobs, std::vector<tx_verification_context> &tvc) { handle_incoming_txs(tx_blobs, tvc, false, true, false); }, RELAY_TX_BATCH_WINDOW_MS, RELAY_TX_BATCH_MAX_COUNT)
 {
 	m_checkpoints_updating.clear();
 	set_cryptonote_protocol(pprotocol);
@@ -223,6 +229,8 @@ void core::init_options(boost::program_options::options_description &desc)
 	command_line::add_arg(desc, arg_fast_block_sync);
 	command_line::add_arg(desc, arg_show_time_stats);
 	command_line::add_arg(desc, arg_block_sync_size);
+	command_line::add_arg(desc, arg_rct_batch_size);
+	command_line::add_arg(desc, arg_ring_point_cache_size);
 	command_line::add_arg(desc, arg_check_updates);
 	command_line::add_arg(desc, arg_fluffy_blocks);
 	command_line::add_arg(desc, arg_no_fluffy_blocks);
@@ -365,6 +373,8 @@ bool core::init(const boost::program_options::variables_map &vm, const char *con
 	CHECK_AND_ASSERT_MES(boost::filesystem::exists(folder) || boost::filesystem::create_directories(folder), false,
 						 std::string("Failed to create directory ").append(folder.string()).c_str());
 
+	rct::multiexp_cache::set_cache_file((boost::filesystem::path(m_config_folder) / MULTIEXP_TABLES_FILENAME).string());
+
 	std::unique_ptr<BlockchainDB> db(new_db(db_type));
 	if(db == NULL)
 	{
@@ -468,6 +478,8 @@ bool core::init(const boost::program_options::variables_map &vm, const char *con
 
 	bool show_time_stats = command_line::get_arg(vm, arg_show_time_stats) != 0;
 	m_blockchain_storage.set_show_time_stats(show_time_stats);
+	m_blockchain_storage.set_rct_batch_size(command_line::get_arg(vm, arg_rct_batch_size));
+	m_blockchain_storage.set_ring_point_cache_size(command_line::get_arg(vm, arg_ring_point_cache_size) * 1024 * 1024);
 	CHECK_AND_ASSERT_MES(r, false, "Failed to initialize blockchain storage");
 
 	block_sync_size = command_line::get_arg(vm, arg_block_sync_size);
@@ -598,7 +610,7 @@ bool core::handle_incoming_tx_pre(const blobdata &tx_blob, tx_verification_conte
 	return true;
 }
 //-----------------------------------------------------------------------------------------------
-bool core::handle_incoming_tx_post(const blobdata &tx_blob, tx_verification_context &tvc, cryptonote::transaction &tx, crypto::hash &tx_hash, crypto::hash &tx_prefixt_hash, bool keeped_by_block, bool relayed, bool do_not_relay)
+bool core::handle_incoming_tx_post(const blobdata &tx_blob, tx_verification_context &tvc, cryptonote::transaction &tx, crypto::hash &tx_hash, crypto::hash &tx_prefixt_hash, bool keeped_by_block, bool relayed, bool do_not_relay, bool rct_verified)
 {
 	if(!check_tx_syntax(tx))
 	{
@@ -611,7 +623,7 @@ bool core::handle_incoming_tx_post(const blobdata &tx_blob, tx_verification_cont
 	{
 		MTRACE("Skipping semantics check for tx kept by block in embedded hash area");
 	}
-	else if(!check_tx_semantic(tx, keeped_by_block))
+	else if(!check_tx_semantic(tx, keeped_by_block, rct_verified))
 	{
 		LOG_PRINT_L1("WRONG TRANSACTION BLOB, Failed to check tx " << tx_hash << " semantic, rejected");
 		tvc.m_verifivation_failed = true;
@@ -641,6 +653,7 @@ bool core::handle_incoming_txs(const std::list<blobdata> &tx_blobs, std::vector<
 		crypto::hash prefix_hash;
 		bool in_txpool;
 		bool in_blockchain;
+		bool rct_verified;
 	};
 	std::vector<result> results(tx_blobs.size());
 
@@ -662,9 +675,14 @@ bool core::handle_incoming_txs(const std::list<blobdata> &tx_blobs, std::vector<
 		});
 	}
 	waiter.wait();
-	it = tx_blobs.begin();
-	for(size_t i = 0; i < tx_blobs.size(); i++, ++it)
+
+	// rct semantics of the new txs are verified in batches, those of synced txs may already be
+	std::vector<size_t> new_txs;
+	std::vector<const rct::rctSig *> rct_sigs;
+	const size_t rct_batch_size = m_blockchain_storage.get_rct_batch_size();
+	for(size_t i = 0; i < tx_blobs.size(); i++)
 	{
+		results[i].rct_verified = false;
 		if(!results[i].res)
 			continue;
 		if(m_mempool.have_tx(results[i].hash))
@@ -677,19 +695,43 @@ bool core::handle_incoming_txs(const std::list<blobdata> &tx_blobs, std::vector<
 		}
 		else
 		{
-			m_threadpool.submit(&waiter, [&, i, it] {
-				try
-				{
-					results[i].res = handle_incoming_tx_post(*it, tvc[i], results[i].tx, results[i].hash, results[i].prefix_hash, keeped_by_block, relayed, do_not_relay);
-				}
-				catch(const std::exception &e)
-				{
-					MERROR_VER("Exception in handle_incoming_tx_post: " << e.what());
-					results[i].res = false;
-				}
-			});
+			new_txs.push_back(i);
+			const rct::rctSig &rv = results[i].tx.rct_signatures;
+			if(keeped_by_block && m_blockchain_storage.is_rct_semantics_verified(results[i].hash))
+				results[i].rct_verified = true;
+			else if(rct_batch_size > 0 && (rv.type == rct::RCTTypeSimple || rv.type == rct::RCTTypeBulletproof))
+				rct_sigs.push_back(&rv);
+		}
+	}
+
+	if(rct_sigs.size() > 1 && !(keeped_by_block && m_blockchain_storage.is_within_compiled_block_hash_area()))
+	{
+		std::deque<bool> rct_results;
+		rct::verRctSemanticsSimple(rct_sigs, rct_batch_size, rct_results);
+		size_t n = 0;
+		for(size_t i : new_txs)
+		{
+			if(n < rct_sigs.size() && rct_sigs[n] == &results[i].tx.rct_signatures)
+				results[i].rct_verified = rct_results[n++];
 		}
 	}
+
+	for(size_t i : new_txs)
+	{
+		it = tx_blobs.begin();
+		std::advance(it, i);
+		m_threadpool.submit(&waiter, [&, i, it] {
+			try
+			{
+				results[i].res = handle_incoming_tx_post(*it, tvc[i], results[i].tx, results[i].hash, results[i].prefix_hash, keeped_by_block, relayed, do_not_relay, results[i].rct_verified);
+			}
+			catch(const std::exception &e)
+			{
+				MERROR_VER("Exception in handle_incoming_tx_post: " << e.what());
+				results[i].res = false;
+			}
+		});
+	}
 	waiter.wait();
 
 	bool ok = true;
@@ -730,6 +772,11 @@ bool core::handle_incoming_tx(const blobdata &tx_blob, tx_verification_context &
 	return r;
 }
 //-----------------------------------------------------------------------------------------------
+bool core::handle_incoming_relayed_txs(const std::list<blobdata> &tx_blobs, std::vector<tx_verification_context> &tvc)
+{
+	return m_relay_tx_batcher.handle(tx_blobs, tvc);
+}
+//-----------------------------------------------------------------------------------------------
 bool core::get_stat_info(core_stat_info &st_inf) const
 {
 	st_inf.mining_speed = m_miner.get_speed();
@@ -741,7 +788,7 @@ bool core::get_stat_info(core_stat_info &st_inf) const
 }
 
 //-----------------------------------------------------------------------------------------------
-bool core::check_tx_semantic(const transaction &tx, bool keeped_by_block) const
+bool core::check_tx_semantic(const transaction &tx, bool keeped_by_block, bool rct_verified) const
 {
 	if(!tx.vin.size())
 	{
@@ -809,6 +856,9 @@ bool core::check_tx_semantic(const transaction &tx, bool keeped_by_block) const
 		return false;
 	case rct::RCTTypeSimple:
 	case rct::RCTTypeBulletproof:
+		// Txs from synced blocks were verified together in prepare_handle_incoming_blocks
+		if(rct_verified)
+			break;
 		// Use inefficient version for now - we will be scrapping the whole system
 		// and there is very little point in polishing turds
 		if(!rct::verRctSemanticsSimple(rv))
@@ -1007,6 +1057,21 @@ bool core::get_block_template(block &b, const account_public_address &adr, diffi
 	return m_blockchain_storage.create_block_template(b, adr, diffic, height, expected_reward, ex_nonce);
 }
 //-----------------------------------------------------------------------------------------------
+bool core::get_block_template(block &b, const account_public_address &adr, difficulty_type &diffic, uint64_t &height, uint64_t &expected_reward, const blobdata &ex_nonce, crypto::hash &tree_root)
+{
+	return m_blockchain_storage.create_block_template(b, adr, diffic, height, expected_reward, ex_nonce, tree_root);
+}
+//-----------------------------------------------------------------------------------------------
+uint64_t core::get_block_template_change_count() const
+{
+	return m_blockchain_storage.get_block_template_change_count();
+}
+//-----------------------------------------------------------------------------------------------
+bool core::wait_block_template_change(uint64_t change_count, uint64_t timeout_ms) const
+{
+	return m_blockchain_storage.wait_block_template_change(change_count, timeout_ms);
+}
+//-----------------------------------------------------------------------------------------------
 bool core::find_blockchain_supplement(const std::list<crypto::hash> &qblock_ids, NOTIFY_RESPONSE_CHAIN_ENTRY::request &resp) const
 {
 	return m_blockchain_storage.find_blockchain_supplement(qblock_ids, resp);
@@ -1151,6 +1216,12 @@ bool core::cleanup_handle_incoming_blocks(bool force_sync)
 	return success;
 }
 
+//-----------------------------------------------------------------------------------------------
+void core::prefetch_pow_hashes(const std::list<block_complete_entry> &blocks)
+{
+	m_blockchain_storage.prefetch_pow_hashes(blocks);
+}
+
 //-----------------------------------------------------------------------------------------------
 bool core::handle_incoming_block(const blobdata &block_blob, block_verification_context &bvc, bool update_miner_blocktemplate)
 {
@@ -51,12 +51,15 @@
 #include <boost/interprocess/sync/file_lock.hpp>
 #include <boost/program_options/options_description.hpp>
 #include <boost/program_options/variables_map.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
 
 #include "blockchain.h"
 #include "common/command_line.h"
 #include "common/download.h"
 #include "common/threadpool.h"
 #include "crypto/hash.h"
+#include "relay_tx_batcher.h"
 #include "cryptonote_basic/connection_context.h"
 #include "cryptonote_basic/cryptonote_stat_info.h"
 #include "cryptonote_basic/miner.h"
@@ -152,6 +155,22 @@ class core : public i_miner_handler
       */
 	bool handle_incoming_txs(const std::list<blobdata> &tx_blobs, std::vector<tx_verification_context> &tvc, bool keeped_by_block, bool relayed, bool do_not_relay);
 
+	/**
+      * @brief handles a list of transactions relayed to us by a peer
+      *
+      * While relayed txs are being verified, txs relayed by other peers
+      * within RELAY_TX_BATCH_WINDOW_MS, up to RELAY_TX_BATCH_MAX_COUNT, are
+      * pooled and go through handle_incoming_txs together, so that their
+      * range proofs are verified in batches. Blocks until this call's txs
+      * are handled.
+      *
+      * @param tx_blobs the txs to handle
+      * @param tvc metadata about the transactions' validity
+      *
+      * @return true if none of the transactions failed verification, otherwise false
+      */
+	bool handle_incoming_relayed_txs(const std::list<blobdata> &tx_blobs, std::vector<tx_verification_context> &tvc);
+
 	/**
       * @brief handles an incoming block
       *
@@ -182,6 +201,13 @@ class core : public i_miner_handler
       */
 	bool cleanup_handle_incoming_blocks(bool force_sync = false);
 
+	/**
+      * @copydoc Blockchain::prefetch_pow_hashes
+      *
+      * @note see Blockchain::prefetch_pow_hashes
+      */
+	void prefetch_pow_hashes(const std::list<block_complete_entry> &blocks);
+
 	/**
       * @brief check the size of a block against the current maximum
       *
@@ -220,6 +246,27 @@ class core : public i_miner_handler
       */
 	virtual bool get_block_template(block &b, const account_public_address &adr, difficulty_type &diffic, uint64_t &height, uint64_t &expected_reward, const blobdata &ex_nonce);
 
+	/**
+      * @copydoc Blockchain::create_block_template(block&, const account_public_address&, difficulty_type&, uint64_t&, uint64_t&, const blobdata&, crypto::hash&)
+      *
+      * @note see Blockchain::create_block_template
+      */
+	bool get_block_template(block &b, const account_public_address &adr, difficulty_type &diffic, uint64_t &height, uint64_t &expected_reward, const blobdata &ex_nonce, crypto::hash &tree_root);
+
+	/**
+      * @copydoc Blockchain::get_block_template_change_count
+      *
+      * @note see Blockchain::get_block_template_change_count
+      */
+	uint64_t get_block_template_change_count() const;
+
+	/**
+      * @copydoc Blockchain::wait_block_template_change
+      *
+      * @note see Blockchain::wait_block_template_change
+      */
+	bool wait_block_template_change(uint64_t change_count, uint64_t timeout_ms) const;
+
 	/**
       * @brief called when a transaction is relayed
       */
@@ -866,13 +913,14 @@ class core : public i_miner_handler
       *
       * @param tx the transaction to check
       * @param keeped_by_block if the transaction has been in a block
+      * @param rct_verified if the ringct semantics already passed a batched check
       *
       * @return true if all the checks pass, otherwise false
       */
-	bool check_tx_semantic(const transaction &tx, bool keeped_by_block) const;
+	bool check_tx_semantic(const transaction &tx, bool keeped_by_block, bool rct_verified = false) const;
 
 	bool handle_incoming_tx_pre(const blobdata &tx_blob, tx_verification_context &tvc, cryptonote::transaction &tx, crypto::hash &tx_hash, crypto::hash &tx_prefixt_hash, bool keeped_by_block, bool relayed, bool do_not_relay);
-	bool handle_incoming_tx_post(const blobdata &tx_blob, tx_verification_context &tvc, cryptonote::transaction &tx, crypto::hash &tx_hash, crypto::hash &tx_prefixt_hash, bool keeped_by_block, bool relayed, bool do_not_relay);
+	bool handle_incoming_tx_post(const blobdata &tx_blob, tx_verification_context &tvc, cryptonote::transaction &tx, crypto::hash &tx_hash, crypto::hash &tx_prefixt_hash, bool keeped_by_block, bool relayed, bool do_not_relay, bool rct_verified);
 
 	/**
       * @copydoc miner::on_block_chain_update
@@ -998,6 +1046,8 @@ class core : public i_miner_handler
 	std::unordered_set<crypto::hash> bad_semantics_txes[2];
 	boost::mutex bad_semantics_txes_lock;
 
+	relay_tx_batcher m_relay_tx_batcher; //!< pools relayed txs from all peers for batched verification
+
 	tools::threadpool &m_threadpool;
 
 	enum
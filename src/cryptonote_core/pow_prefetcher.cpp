@@ -0,0 +1,113 @@
+// Copyright (c) 2019, Ryo Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2020
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "pow_prefetcher.h"
+
+#include <algorithm>
+
+#include "cryptonote_config.h"
+
+namespace cryptonote
+{
+pow_prefetcher::pow_prefetcher(worker_t worker) : m_worker(std::move(worker))
+{
+}
+//-----------------------------------------------------------------------------------------------
+pow_prefetcher::~pow_prefetcher()
+{
+	boost::lock_guard<boost::mutex> lock(m_lock);
+	join();
+}
+//-----------------------------------------------------------------------------------------------
+void pow_prefetcher::start(std::vector<block> blocks, size_t threads)
+{
+	boost::lock_guard<boost::mutex> lock(m_lock);
+
+	join();
+	m_maps.clear();
+	m_blocks.clear();
+
+	if(blocks.empty() || threads == 0)
+		return;
+	threads = std::min(threads, blocks.size());
+
+	m_maps.resize(threads);
+	m_blocks.resize(threads);
+	if(m_hash_ctxes.size() < threads)
+		m_hash_ctxes.resize(threads);
+
+	// consecutive blocks go to the same thread, they are likely to share a PoW variant
+	const size_t per_thread = (blocks.size() + threads - 1) / threads;
+	for(size_t n = 0; n < blocks.size(); n++)
+		m_blocks[n / per_thread].push_back(std::move(blocks[n]));
+
+	boost::thread::attributes attrs;
+	attrs.set_stack_size(THREAD_STACK_SIZE);
+	for(size_t i = 0; i < threads; i++)
+	{
+		if(m_blocks[i].empty())
+			continue;
+		m_threads.emplace_back(attrs, std::bind(m_worker, std::ref(m_hash_ctxes[i]), std::cref(m_blocks[i]), std::ref(m_maps[i])));
+	}
+}
+//-----------------------------------------------------------------------------------------------
+std::unordered_map<crypto::hash, crypto::hash> pow_prefetcher::take()
+{
+	boost::lock_guard<boost::mutex> lock(m_lock);
+
+	join();
+	std::unordered_map<crypto::hash, crypto::hash> hashes;
+	for(const auto &map : m_maps)
+		hashes.insert(map.begin(), map.end());
+	m_maps.clear();
+	m_blocks.clear();
+	return hashes;
+}
+//-----------------------------------------------------------------------------------------------
+void pow_prefetcher::join()
+{
+	for(auto &thread : m_threads)
+		thread.join();
+	m_threads.clear();
+}
+}
@@ -0,0 +1,105 @@
+// Copyright (c) 2019, Ryo Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2020
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "cryptonote_basic/cryptonote_basic.h"
+#include "cryptonote_basic/cryptonote_format_utils.h"
+#include "crypto/hash.h"
+
+namespace cryptonote
+{
+/**
+ * @brief hashes the PoW of a span of blocks ahead of the time it is needed
+ *
+ * The hashing runs on threads of its own, so the threadpool stays free for
+ * the validation of the blocks that are being added meanwhile. Only one
+ * span is held at a time, starting a new one drops the hashes of a span
+ * that nobody took.
+ */
+class pow_prefetcher
+{
+  public:
+	typedef std::function<void(std::vector<cn_pow_hash_v2> &, const std::vector<block> &, std::unordered_map<crypto::hash, crypto::hash> &)> worker_t;
+
+	explicit pow_prefetcher(worker_t worker);
+	~pow_prefetcher();
+
+	/**
+	 * @brief starts hashing blocks in the background
+	 *
+	 * Waits for the hashing of the previous span to finish and drops its
+	 * hashes if they were not taken yet.
+	 *
+	 * @param blocks the blocks to hash, consecutive ones go to the same thread
+	 * @param threads the number of threads to hash on
+	 */
+	void start(std::vector<block> blocks, size_t threads);
+
+	/**
+	 * @brief waits for the hashing to finish and hands out its results
+	 *
+	 * @return block id -> PoW hash of the blocks of the last span, empty if
+	 * there is none or it was already taken
+	 */
+	std::unordered_map<crypto::hash, crypto::hash> take();
+
+  private:
+	void join();
+
+	worker_t m_worker;
+
+	std::vector<std::vector<cn_pow_hash_v2>> m_hash_ctxes;
+	std::vector<std::vector<block>> m_blocks;
+	std::vector<std::unordered_map<crypto::hash, crypto::hash>> m_maps;
+	std::vector<boost::thread> m_threads;
+	boost::mutex m_lock;
+};
+}
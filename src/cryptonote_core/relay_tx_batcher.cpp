@@ -0,0 +1,143 @@
+// Copyright (c) 2019, Ryo Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2020
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "relay_tx_batcher.h"
+
+#include <algorithm>
+
+#include <boost/chrono.hpp>
+
+#include "misc_language.h"
+
+namespace cryptonote
+{
+relay_tx_batcher::relay_tx_batcher(handler_t handler, size_t window_ms, size_t max_count) : m_handler(std::move(handler)),
+																							  m_window_ms(window_ms),
+																							  m_max_count(max_count),
+																							  m_batch_count(0),
+																							  m_batch_open(false),
+																							  m_in_flight(0)
+{
+}
+//-----------------------------------------------------------------------------------------------
+bool relay_tx_batcher::handle(const std::list<blobdata> &tx_blobs, std::vector<tx_verification_context> &tvc)
+{
+	// the request is shared with the leader, so it stays valid whichever side returns first
+	std::shared_ptr<request> req = std::make_shared<request>();
+	req->tx_blobs = tx_blobs;
+	req->count = tx_blobs.size();
+	req->done = false;
+
+	boost::unique_lock<boost::mutex> lock(m_lock);
+	m_batch.push_back(req);
+	m_batch_count += req->count;
+	if(m_batch_open)
+	{
+		// another caller is gathering a batch, it will handle our txs too
+		if(m_batch_count >= m_max_count)
+			m_cond.notify_all();
+		while(!req->done)
+			m_cond.wait(lock);
+		tvc = std::move(req->tvc);
+		return std::none_of(tvc.begin(), tvc.end(), [](const tx_verification_context &t) { return t.m_verifivation_failed; });
+	}
+
+	if(m_in_flight > 0)
+	{
+		m_batch_open = true;
+		const boost::chrono::steady_clock::time_point deadline = boost::chrono::steady_clock::now() + boost::chrono::milliseconds(m_window_ms);
+		while(m_batch_count < m_max_count)
+		{
+			if(m_cond.wait_until(lock, deadline) == boost::cv_status::timeout)
+				break;
+		}
+		m_batch_open = false;
+	}
+
+	std::vector<std::shared_ptr<request>> batch;
+	batch.swap(m_batch);
+	m_batch_count = 0;
+	++m_in_flight;
+	lock.unlock();
+
+	std::list<blobdata> blobs;
+	for(const std::shared_ptr<request> &r : batch)
+		blobs.splice(blobs.end(), r->tx_blobs);
+
+	std::vector<tx_verification_context> tvcs(blobs.size());
+	try
+	{
+		m_handler(blobs, tvcs);
+	}
+	catch(...)
+	{
+		finish(batch, nullptr);
+		throw;
+	}
+	tvcs.resize(blobs.size());
+	finish(batch, &tvcs);
+
+	tvc = std::move(req->tvc);
+	return std::none_of(tvc.begin(), tvc.end(), [](const tx_verification_context &t) { return t.m_verifivation_failed; });
+}
+//-----------------------------------------------------------------------------------------------
+void relay_tx_batcher::finish(std::vector<std::shared_ptr<request>> &batch, const std::vector<tx_verification_context> *tvcs)
+{
+	tx_verification_context failed = AUTO_VAL_INIT(failed);
+	failed.m_verifivation_failed = true;
+
+	size_t offset = 0;
+	boost::unique_lock<boost::mutex> lock(m_lock);
+	for(const std::shared_ptr<request> &r : batch)
+	{
+		if(tvcs)
+			r->tvc.assign(tvcs->begin() + offset, tvcs->begin() + offset + r->count);
+		else
+			r->tvc.assign(r->count, failed);
+		offset += r->count;
+		r->done = true;
+	}
+	--m_in_flight;
+	m_cond.notify_all();
+}
+}
@@ -0,0 +1,111 @@
+// Copyright (c) 2019, Ryo Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2020
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <functional>
+#include <list>
+#include <memory>
+#include <vector>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "cryptonote_basic/blobdatatype.h"
+#include "cryptonote_basic/verification_context.h"
+
+namespace cryptonote
+{
+/**
+ * @brief pools txs handed in by concurrent callers and handles them together
+ *
+ * The first caller to find no open batch becomes its leader, the others
+ * join it and sleep until the leader hands them their part of the results.
+ * While another batch is being handled the leader keeps its batch open for
+ * up to window_ms, or until max_count txs have been queued, so that callers
+ * piling up behind the busy handler go in together. With no batch in flight
+ * nobody is queued behind it, so it handles its txs right away.
+ */
+class relay_tx_batcher
+{
+  public:
+	typedef std::function<void(const std::list<blobdata> &, std::vector<tx_verification_context> &)> handler_t;
+
+	relay_tx_batcher(handler_t handler, size_t window_ms, size_t max_count);
+
+	/**
+	 * @brief handles tx_blobs, possibly together with other callers' txs
+	 *
+	 * If the handler throws, every caller in the batch gets failed tvcs and
+	 * the exception is passed on to the leader's caller.
+	 *
+	 * @param tx_blobs the txs to handle
+	 * @param tvc return-by-reference one verification context per tx
+	 *
+	 * @return true if none of the txs failed verification, otherwise false
+	 */
+	bool handle(const std::list<blobdata> &tx_blobs, std::vector<tx_verification_context> &tvc);
+
+  private:
+	struct request
+	{
+		std::list<blobdata> tx_blobs;
+		size_t count;
+		std::vector<tx_verification_context> tvc;
+		bool done;
+	};
+
+	void finish(std::vector<std::shared_ptr<request>> &batch, const std::vector<tx_verification_context> *tvcs);
+
+	handler_t m_handler;
+	size_t m_window_ms;
+	size_t m_max_count;
+
+	std::vector<std::shared_ptr<request>> m_batch;
+	size_t m_batch_count;
+	bool m_batch_open;
+	size_t m_in_flight;
+	boost::mutex m_lock;
+	boost::condition_variable m_cond;
+};
+}
@@ -129,10 +129,16 @@ class LockedTXN
 }
 //---------------------------------------------------------------------------------
 //---------------------------------------------------------------------------------
-tx_memory_pool::tx_memory_pool(Blockchain &bchs) : m_blockchain(bchs), m_txpool_max_size(DEFAULT_TXPOOL_MAX_SIZE), m_txpool_size(0)
+tx_memory_pool::tx_memory_pool(Blockchain &bchs) : m_blockchain(bchs), m_txpool_max_size(DEFAULT_TXPOOL_MAX_SIZE), m_txpool_size(0), m_cookie(0)
 {
 }
 //---------------------------------------------------------------------------------
+void tx_memory_pool::on_pool_changed()
+{
+	++m_cookie;
+	m_blockchain.notify_block_template_change();
+}
+//---------------------------------------------------------------------------------
 bool tx_memory_pool::add_tx(transaction &tx, /*const crypto::hash& tx_prefix_hash,*/ const crypto::hash &id, size_t blob_size, tx_verification_context &tvc, bool kept_by_block, bool relayed, bool do_not_relay)
 {
 	// this should already be called with that lock, but let's make it explicit for clarity
@@ -244,6 +250,7 @@ bool tx_memory_pool::add_tx(transaction &tx, /*const crypto::hash& tx_prefix_has
 				if(!insert_key_images(tx, kept_by_block))
 					return false;
 				m_txs_by_fee_and_receive_time.emplace(std::pair<double, std::time_t>(fee / (double)blob_size, receive_time), id);
+				on_pool_changed();
 			}
 			catch(const std::exception &e)
 			{
@@ -287,6 +294,7 @@ bool tx_memory_pool::add_tx(transaction &tx, /*const crypto::hash& tx_prefix_has
 			if(!insert_key_images(tx, kept_by_block))
 				return false;
 			m_txs_by_fee_and_receive_time.emplace(std::pair<double, std::time_t>(fee / (double)blob_size, receive_time), id);
+			on_pool_changed();
 		}
 		catch(const std::exception &e)
 		{
@@ -373,6 +381,7 @@ void tx_memory_pool::prune(size_t bytes)
 			remove_transaction_keyimages(tx);
 			MINFO("Pruned tx " << txid << " from txpool: size: " << it->first.second << ", fee/byte: " << it->first.first);
 			m_txs_by_fee_and_receive_time.erase(it--);
+			on_pool_changed();
 		}
 		catch(const std::exception &e)
 		{
@@ -475,6 +484,7 @@ bool tx_memory_pool::take_tx(const crypto::hash &id, transaction &tx, size_t &bl
 	}
 
 	m_txs_by_fee_and_receive_time.erase(sorted_it);
+	on_pool_changed();
 	return true;
 }
 //---------------------------------------------------------------------------------
@@ -511,6 +521,7 @@ bool tx_memory_pool::remove_stuck_transactions()
 			else
 			{
 				m_txs_by_fee_and_receive_time.erase(sorted_it);
+				on_pool_changed();
 			}
 			m_timed_out_transactions.insert(txid);
 			remove.insert(txid);
@@ -1233,6 +1244,7 @@ size_t tx_memory_pool::validate()
 				else
 				{
 					m_txs_by_fee_and_receive_time.erase(sorted_it);
+					on_pool_changed();
 				}
 				++n_removed;
 			}
@@ -1253,6 +1265,7 @@ bool tx_memory_pool::init(size_t max_txpool_size)
 
 	m_txpool_max_size = max_txpool_size ? max_txpool_size : DEFAULT_TXPOOL_MAX_SIZE;
 	m_txs_by_fee_and_receive_time.clear();
+	on_pool_changed();
 	m_spent_key_images.clear();
 	m_txpool_size = 0;
 	std::vector<crypto::hash> remove;
@@ -1277,6 +1290,7 @@ bool tx_memory_pool::init(size_t max_txpool_size)
 				return false;
 			}
 			m_txs_by_fee_and_receive_time.emplace(std::pair<double, time_t>(meta.fee / (double)meta.blob_size, meta.receive_time), txid);
+			on_pool_changed();
 			m_txpool_size += meta.blob_size;
 			return true;
 		},
@@ -47,6 +47,7 @@
 #pragma once
 #include "include_base_utils.h"
 
+#include <atomic>
 #include <boost/serialization/version.hpp>
 #include <boost/utility.hpp>
 #include <queue>
@@ -361,6 +362,16 @@ class tx_memory_pool : boost::noncopyable
      */
 	size_t get_transactions_count(bool include_unrelayed_txes = true) const;
 
+	/**
+     * @brief get a number that changes whenever a transaction enters or leaves the pool
+     *
+     * Callers that cache anything derived from the pool's contents, such as
+     * block templates, can compare it to the value they saw last time.
+     *
+     * @return the current pool cookie
+     */
+	uint64_t cookie() const { return m_cookie; }
+
 	/**
      * @brief get a string containing human-readable pool information
      *
@@ -441,6 +452,11 @@ class tx_memory_pool : boost::noncopyable
 	};
 
   private:
+	/**
+     * @brief bumps the pool cookie and wakes up whoever waits for a new block template
+     */
+	void on_pool_changed();
+
 	/**
      * @brief insert key images into m_spent_key_images
      *
@@ -585,6 +601,8 @@ class tx_memory_pool : boost::noncopyable
 
 	size_t m_txpool_max_size;
 	size_t m_txpool_size;
+
+	std::atomic<uint64_t> m_cookie; //!< incremented whenever the set of transactions in the pool changes
 };
 }
 
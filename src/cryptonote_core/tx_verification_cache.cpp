@@ -0,0 +1,105 @@
+// Copyright (c) 2019, Ryo Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2020
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "tx_verification_cache.h"
+
+namespace cryptonote
+{
+tx_verification_cache::tx_verification_cache(size_t max_size) : m_max_size(max_size)
+{
+}
+//-----------------------------------------------------------------------------------------------
+crypto::hash tx_verification_cache::get_key(const crypto::hash &tx_hash, const std::vector<std::vector<rct::ctkey>> &pubkeys, uint8_t hf_version)
+{
+	size_t ring_members = 0;
+	for(const auto &ring : pubkeys)
+		ring_members += ring.size();
+
+	std::string data;
+	data.reserve(sizeof(crypto::hash) + ring_members * sizeof(rct::ctkey) + 1);
+	data.append(reinterpret_cast<const char *>(&tx_hash), sizeof(tx_hash));
+	for(const auto &ring : pubkeys)
+		for(const rct::ctkey &member : ring)
+			data.append(reinterpret_cast<const char *>(&member), sizeof(member));
+	data.push_back(static_cast<char>(hf_version));
+
+	crypto::hash key;
+	crypto::cn_fast_hash(data.data(), data.size(), key);
+	return key;
+}
+//-----------------------------------------------------------------------------------------------
+bool tx_verification_cache::contains(const crypto::hash &key) const
+{
+	boost::lock_guard<boost::mutex> lock(m_lock);
+	return m_keys.find(key) != m_keys.end();
+}
+//-----------------------------------------------------------------------------------------------
+void tx_verification_cache::add(const crypto::hash &key)
+{
+	boost::lock_guard<boost::mutex> lock(m_lock);
+	if(!m_keys.insert(key).second)
+		return;
+	m_order.push_back(key);
+	while(m_order.size() > m_max_size)
+	{
+		m_keys.erase(m_order.front());
+		m_order.pop_front();
+	}
+}
+//-----------------------------------------------------------------------------------------------
+bool tx_verification_cache::verify(const crypto::hash &key, const std::function<bool()> &check)
+{
+	if(contains(key))
+		return true;
+	if(!check())
+		return false;
+	add(key);
+	return true;
+}
+//-----------------------------------------------------------------------------------------------
+size_t tx_verification_cache::size() const
+{
+	boost::lock_guard<boost::mutex> lock(m_lock);
+	return m_order.size();
+}
+}
@@ -0,0 +1,99 @@
+// Copyright (c) 2019, Ryo Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2020
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <unordered_set>
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
+
+#include "crypto/hash.h"
+#include "ringct/rctTypes.h"
+
+namespace cryptonote
+{
+/**
+ * @brief remembers txs whose ring signatures passed verification
+ *
+ * Entries are keyed by get_key, so a result is only reused for the same
+ * tx, ring members and hard fork version. Once full, the oldest entries
+ * are dropped first.
+ */
+class tx_verification_cache
+{
+  public:
+	explicit tx_verification_cache(size_t max_size);
+
+	/**
+	 * @brief gets the key of a transaction in the cache
+	 *
+	 * @param tx_hash the transaction's hash
+	 * @param pubkeys the ring members each input resolved to
+	 * @param hf_version the hard fork version the tx is checked under
+	 *
+	 * @return the key
+	 */
+	static crypto::hash get_key(const crypto::hash &tx_hash, const std::vector<std::vector<rct::ctkey>> &pubkeys, uint8_t hf_version);
+
+	bool contains(const crypto::hash &key) const;
+	void add(const crypto::hash &key);
+
+	/**
+	 * @brief runs check unless key is cached, and caches key if it passes
+	 *
+	 * @return true if key was cached or check passed, otherwise false
+	 */
+	bool verify(const crypto::hash &key, const std::function<bool()> &check);
+
+	size_t size() const;
+
+  private:
+	size_t m_max_size;
+	std::unordered_set<crypto::hash> m_keys;
+	std::deque<crypto::hash> m_order;
+	mutable boost::mutex m_lock;
+};
+}
@@ -305,6 +305,22 @@ bool block_queue::get_next_span(uint64_t &height, std::list<cryptonote::block_co
 	return false;
 }
 
+bool block_queue::get_filled_span(uint64_t height, std::list<cryptonote::block_complete_entry> &bcel) const
+{
+	boost::unique_lock<boost::recursive_mutex> lock(mutex);
+	for(const span &s : blocks)
+	{
+		if(s.start_block_height > height)
+			break;
+		if(s.start_block_height == height && !s.blocks.empty())
+		{
+			bcel = s.blocks;
+			return true;
+		}
+	}
+	return false;
+}
+
 bool block_queue::has_next_span(const boost::uuids::uuid &connection_id, bool &filled) const
 {
 	boost::unique_lock<boost::recursive_mutex> lock(mutex);
@@ -97,6 +97,7 @@ class block_queue
 	std::pair<uint64_t, uint64_t> get_next_span_if_scheduled(std::list<crypto::hash> &hashes, boost::uuids::uuid &connection_id, boost::posix_time::ptime &time) const;
 	void set_span_hashes(uint64_t start_height, const boost::uuids::uuid &connection_id, std::list<crypto::hash> hashes);
 	bool get_next_span(uint64_t &height, std::list<cryptonote::block_complete_entry> &bcel, boost::uuids::uuid &connection_id, bool filled = true) const;
+	bool get_filled_span(uint64_t height, std::list<cryptonote::block_complete_entry> &bcel) const;
 	bool has_next_span(const boost::uuids::uuid &connection_id, bool &filled) const;
 	size_t get_data_size() const;
 	size_t get_num_filled_spans_prefix() const;
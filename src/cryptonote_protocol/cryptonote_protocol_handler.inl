@@ -768,17 +768,18 @@ int t_cryptonote_protocol_handler<t_core>::handle_notify_new_transactions(int co
 		return 1;
 	}
 
-	for(auto tx_blob_it = arg.txs.begin(); tx_blob_it != arg.txs.end();)
+	std::vector<cryptonote::tx_verification_context> tvc;
+	if(!m_core.handle_incoming_relayed_txs(arg.txs, tvc))
 	{
-		cryptonote::tx_verification_context tvc = AUTO_VAL_INIT(tvc);
-		m_core.handle_incoming_tx(*tx_blob_it, tvc, false, true, false);
-		if(tvc.m_verifivation_failed)
-		{
-			LOG_PRINT_CCONTEXT_L1("Tx verification failed, dropping connection");
-			drop_connection(context, false, false);
-			return 1;
-		}
-		if(tvc.m_should_be_relayed)
+		LOG_PRINT_CCONTEXT_L1("Tx verification failed, dropping connection");
+		drop_connection(context, false, false);
+		return 1;
+	}
+
+	size_t i = 0;
+	for(auto tx_blob_it = arg.txs.begin(); tx_blob_it != arg.txs.end(); ++i)
+	{
+		if(tvc[i].m_should_be_relayed)
 			++tx_blob_it;
 		else
 			arg.txs.erase(tx_blob_it++);
@@ -1047,6 +1048,11 @@ int t_cryptonote_protocol_handler<t_core>::try_add_next_blocks(cryptonote_connec
 
 				m_core.prepare_handle_incoming_blocks(blocks);
 
+				// hash the PoW of the next span while this one is validated and committed
+				std::list<cryptonote::block_complete_entry> next_blocks;
+				if(m_block_queue.get_filled_span(start_height + blocks.size(), next_blocks))
+					m_core.prefetch_pow_hashes(next_blocks);
+
 				uint64_t block_process_time_full = 0, transactions_process_time_full = 0;
 				size_t num_txs = 0;
 				for(const block_complete_entry &block_entry : blocks)
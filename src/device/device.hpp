@@ -166,6 +166,30 @@ class device
 	virtual bool secret_key_to_public_key(const crypto::secret_key &sec, crypto::public_key &pub) = 0;
 	virtual bool generate_key_image(const crypto::public_key &pub, const crypto::secret_key &sec, crypto::key_image &image) = 0;
 
+	// Batched forms of generate_key_derivation and derive_public_key, devices that can do better than one call per key override them
+	virtual bool generate_key_derivations(const std::vector<crypto::public_key> &pubs, const crypto::secret_key &sec, std::vector<crypto::key_derivation> &derivations, std::vector<bool> &valid)
+	{
+		bool all_valid = true;
+		derivations.resize(pubs.size());
+		valid.resize(pubs.size());
+		for(size_t i = 0; i < pubs.size(); i++)
+		{
+			valid[i] = generate_key_derivation(pubs[i], sec, derivations[i]);
+			all_valid = all_valid && valid[i];
+		}
+		return all_valid;
+	}
+	virtual bool derive_public_keys(const std::vector<crypto::key_derivation> &derivations, const std::vector<std::size_t> &output_indexes, const crypto::public_key &pub, std::vector<crypto::public_key> &derived_pubs)
+	{
+		derived_pubs.resize(derivations.size());
+		for(size_t i = 0; i < derivations.size(); i++)
+		{
+			if(!derive_public_key(derivations[i], output_indexes[i], pub, derived_pubs[i]))
+				return false;
+		}
+		return true;
+	}
+
 	// alternative prototypes available in libringct
 	rct::key scalarmultKey(const rct::key &P, const rct::key &a)
 	{
@@ -48,6 +48,8 @@
 #include "cryptonote_basic/account.h"
 #include "cryptonote_basic/subaddress_index.h"
 #include "ringct/rctOps.h"
+#include <algorithm>
+#include <memory>
 
 static constexpr uint8_t UNI_PAYMENT_ID_TAIL = 0x55;
 
@@ -298,6 +300,22 @@ bool device_default::derive_public_key(const crypto::key_derivation &derivation,
 	return crypto::derive_public_key(derivation, output_index, base, derived_key);
 }
 
+bool device_default::generate_key_derivations(const std::vector<crypto::public_key> &pubs, const crypto::secret_key &sec, std::vector<crypto::key_derivation> &derivations, std::vector<bool> &valid)
+{
+	std::unique_ptr<bool[]> ok(new bool[pubs.size()]);
+	derivations.resize(pubs.size());
+	crypto::generate_key_derivations(pubs.data(), pubs.size(), sec, derivations.data(), ok.get());
+	valid.assign(ok.get(), ok.get() + pubs.size());
+	return std::find(valid.begin(), valid.end(), false) == valid.end();
+}
+
+bool device_default::derive_public_keys(const std::vector<crypto::key_derivation> &derivations, const std::vector<std::size_t> &output_indexes, const crypto::public_key &base, std::vector<crypto::public_key> &derived_keys)
+{
+	CHECK_AND_ASSERT_MES(derivations.size() == output_indexes.size(), false, "Mismatched derivations and output indexes");
+	derived_keys.resize(derivations.size());
+	return crypto::derive_public_keys(derivations.data(), output_indexes.data(), derivations.size(), base, derived_keys.data());
+}
+
 bool device_default::secret_key_to_public_key(const crypto::secret_key &sec, crypto::public_key &pub)
 {
 	return crypto::secret_key_to_public_key(sec, pub);
@@ -118,6 +118,8 @@ class device_default : public hw::device
 	bool derive_public_key(const crypto::key_derivation &derivation, const std::size_t output_index, const crypto::public_key &pub, crypto::public_key &derived_pub) override;
 	bool secret_key_to_public_key(const crypto::secret_key &sec, crypto::public_key &pub) override;
 	bool generate_key_image(const crypto::public_key &pub, const crypto::secret_key &sec, crypto::key_image &image) override;
+	bool generate_key_derivations(const std::vector<crypto::public_key> &pubs, const crypto::secret_key &sec, std::vector<crypto::key_derivation> &derivations, std::vector<bool> &valid) override;
+	bool derive_public_keys(const std::vector<crypto::key_derivation> &derivations, const std::vector<std::size_t> &output_indexes, const crypto::public_key &pub, std::vector<crypto::public_key> &derived_pubs) override;
 
 	/* ======================================================================= */
 	/*                               TRANSACTION                               */
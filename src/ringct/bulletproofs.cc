@@ -45,6 +45,7 @@
 // Adapted from Java code by Sarang Noether
 
 #include "common/perf_timer.h"
+#include "common/threadpool.h"
 #include "misc_log_ex.h"
 #include <stdlib.h>
 extern "C" {
@@ -115,15 +116,6 @@ static void sub_acc_p3(ge_p3 *acc_p3, const rct::key &point)
 	ge_p1p1_to_p3(acc_p3, &p1);
 }
 
-static rct::key scalarmultKey(const ge_p3 &P, const rct::key &a)
-{
-	ge_p2 R;
-	ge_scalarmult(&R, a.bytes, &P);
-	rct::key aP;
-	ge_tobytes(aP.bytes, &R);
-	return aP;
-}
-
 /* Given a scalar, construct a vector of powers */
 static rct::keyV vector_powers(const rct::key &x, size_t n)
 {
@@ -159,38 +151,32 @@ static rct::key vector_power_sum(const rct::key &x, size_t n)
 	return res;
 }
 
-/* Given two scalar arrays, construct the inner product */
-static rct::key inner_product(const rct::keyV &a, const rct::keyV &b)
+/* Given two scalar arrays, construct the inner product of their first n elements */
+static rct::key inner_product(const rct::key *a, const rct::key *b, size_t n)
 {
-	CHECK_AND_ASSERT_THROW_MES(a.size() == b.size(), "Incompatible sizes of a and b");
 	rct::key res = rct::zero();
-	for(size_t i = 0; i < a.size(); ++i)
+	for(size_t i = 0; i < n; ++i)
 	{
 		sc_muladd(res.bytes, a[i].bytes, b[i].bytes, res.bytes);
 	}
 	return res;
 }
 
-/* Given two scalar arrays, construct the Hadamard product */
-static rct::keyV hadamard(const rct::keyV &a, const rct::keyV &b)
+/* Given two scalar arrays, construct the inner product */
+static rct::key inner_product(const rct::keyV &a, const rct::keyV &b)
 {
 	CHECK_AND_ASSERT_THROW_MES(a.size() == b.size(), "Incompatible sizes of a and b");
-	rct::keyV res(a.size());
-	for(size_t i = 0; i < a.size(); ++i)
-	{
-		sc_mul(res[i].bytes, a[i].bytes, b[i].bytes);
-	}
-	return res;
+	return inner_product(a.data(), b.data(), a.size());
 }
 
-/* Given two curvepoint arrays, construct the Hadamard product */
-static rct::keyV hadamard2(const rct::keyV &a, const rct::keyV &b)
+/* Given two scalar arrays, construct the Hadamard product */
+static rct::keyV hadamard(const rct::keyV &a, const rct::keyV &b)
 {
 	CHECK_AND_ASSERT_THROW_MES(a.size() == b.size(), "Incompatible sizes of a and b");
 	rct::keyV res(a.size());
 	for(size_t i = 0; i < a.size(); ++i)
 	{
-		rct::addKeys(res[i], a[i], b[i]);
+		sc_mul(res[i].bytes, a[i].bytes, b[i].bytes);
 	}
 	return res;
 }
@@ -236,17 +222,6 @@ static rct::keyV vector_dup(const rct::key &x, size_t N)
 	return rct::keyV(N, x);
 }
 
-/* Exponentiate a curve vector by a scalar */
-static rct::keyV vector_scalar2(const rct::keyV &a, const rct::key &x)
-{
-	rct::keyV res(a.size());
-	for(size_t i = 0; i < a.size(); ++i)
-	{
-		rct::scalarmultKey(res[i], a[i], x);
-	}
-	return res;
-}
-
 /* Get the sum of a vector's elements */
 static rct::key vector_sum(const rct::keyV &a)
 {
@@ -320,18 +295,106 @@ static rct::key invert(const rct::key &x)
 	return inv;
 }
 
-/* Compute the slice of a vector */
-static rct::keyV slice(const rct::keyV &a, size_t start, size_t stop)
+/* Fold a scalar vector in place to half its size, a[i] = a[i] * x + a[n + i] * y */
+static void vector_fold(rct::keyV &a, const rct::key &x, const rct::key &y)
 {
-	CHECK_AND_ASSERT_THROW_MES(start < a.size(), "Invalid start index");
-	CHECK_AND_ASSERT_THROW_MES(stop <= a.size(), "Invalid stop index");
-	CHECK_AND_ASSERT_THROW_MES(start < stop, "Invalid start/stop indices");
-	rct::keyV res(stop - start);
-	for(size_t i = start; i < stop; ++i)
+	CHECK_AND_ASSERT_THROW_MES((a.size() & 1) == 0, "Vector size should be even");
+	const size_t sz = a.size() / 2;
+	rct::key tmp;
+	for(size_t i = 0; i < sz; ++i)
 	{
-		res[i - start] = a[i];
+		sc_mul(tmp.bytes, a[sz + i].bytes, y.bytes);
+		sc_muladd(a[i].bytes, a[i].bytes, x.bytes, tmp.bytes);
 	}
-	return res;
+	a.resize(sz);
+}
+
+/* Fold a curve point vector in place to half its size, P[i] = P[i] * x * scale[i] + P[n + i] * y * scale[n + i] */
+static void hadamard_fold(std::vector<ge_p3> &P, const rct::keyV *scale, const rct::key &x, const rct::key &y)
+{
+	CHECK_AND_ASSERT_THROW_MES((P.size() & 1) == 0, "Vector size should be even");
+	CHECK_AND_ASSERT_THROW_MES(scale == nullptr || scale->size() >= P.size(), "Scale vector is too small");
+	const size_t sz = P.size() / 2;
+
+	auto fold = [&](size_t start, size_t end) {
+		ge_dsmp c0, c1;
+		rct::key sx = x, sy = y;
+		for(size_t i = start; i < end; ++i)
+		{
+			ge_dsm_precomp(c0, &P[i]);
+			ge_dsm_precomp(c1, &P[sz + i]);
+			if(scale != nullptr)
+			{
+				sc_mul(sx.bytes, x.bytes, (*scale)[i].bytes);
+				sc_mul(sy.bytes, y.bytes, (*scale)[sz + i].bytes);
+			}
+			ge_double_scalarmult_precomp_vartime2_p3(&P[i], sx.bytes, c0, sy.bytes, c1);
+		}
+	};
+
+	// Each point costs about a scalar multiplication, so only the small folds stay on one thread
+	tools::threadpool &tpool = tools::threadpool::getInstance();
+	const size_t threads = std::min<size_t>(tpool.get_max_concurrency(), sz / 32);
+	if(threads <= 1)
+	{
+		fold(0, sz);
+	}
+	else
+	{
+		tools::threadpool::waiter waiter;
+		const size_t chunk = (sz + threads - 1) / threads;
+		for(size_t start = chunk; start < sz; start += chunk)
+			tpool.submit(&waiter, [&fold, start, chunk, sz] { fold(start, std::min(start + chunk, sz)); });
+		fold(0, chunk);
+		waiter.wait();
+	}
+	P.resize(sz);
+}
+
+static const ge_p3 &get_H_p3()
+{
+	static const ge_p3 H_p3 = [] {
+		ge_p3 p3;
+		CHECK_AND_ASSERT_THROW_MES(ge_frombytes_vartime(&p3, rct::H.bytes) == 0, "ge_frombytes_vartime failed");
+		return p3;
+	}();
+	return H_p3;
+}
+
+/* Compute L or R of an inner product round (PAPER LINES 18-19) on the generators Gi and Hi * scale[i]
+ * G[G0 + i] and H[H0 + i] are multiplied by a[a0 + i] and b[b0 + i] for i < n. The scratchpad
+ * has to keep the layout of the global tables, so the unused generators get a zero scalar. */
+static rct::key compute_LR_cached(bp_cache &exp_cache, size_t size, size_t n, const rct::key &c, const rct::keyV &scale,
+								  size_t G0, const rct::keyV &a, size_t a0, size_t H0, const rct::keyV &b, size_t b0)
+{
+	rct::key tmp;
+	exp_cache.clear_pad(size * 2);
+	for(size_t i = 0; i < size; ++i)
+	{
+		exp_cache.me_pad.emplace_back(i >= G0 && i < G0 + n ? a[a0 + i - G0] : rct::zero(), multiexp_cache::Gi_p3(i));
+		if(i >= H0 && i < H0 + n)
+			sc_mul(tmp.bytes, b[b0 + i - H0].bytes, scale[i].bytes);
+		else
+			tmp = rct::zero();
+		exp_cache.me_pad.emplace_back(tmp, multiexp_cache::Hi_p3(i));
+	}
+	rct::key res = exp_cache.multiexp_higi();
+	rct::addKeys(res, res, rct::scalarmultH(c));
+	return rct::scalarmultKey(res, INV_EIGHT);
+}
+
+/* Compute L or R of an inner product round (PAPER LINES 18-19) on the folded generators */
+static rct::key compute_LR(bp_cache &exp_cache, size_t n, const rct::key &c, const std::vector<ge_p3> &G, size_t G0,
+						   const rct::keyV &a, size_t a0, const std::vector<ge_p3> &H, size_t H0, const rct::keyV &b, size_t b0)
+{
+	exp_cache.clear_pad(n * 2 + 1);
+	for(size_t i = 0; i < n; ++i)
+	{
+		exp_cache.me_pad.emplace_back(a[a0 + i], G[G0 + i]);
+		exp_cache.me_pad.emplace_back(b[b0 + i], H[H0 + i]);
+	}
+	exp_cache.me_pad.emplace_back(c, get_H_p3());
+	return rct::scalarmultKey(exp_cache.multiexp(), INV_EIGHT);
 }
 
 static rct::key hash_cache_mash(rct::key &hash_cache, const rct::key &mash0, const rct::key &mash1)
@@ -368,6 +431,73 @@ static rct::key hash_cache_mash(rct::key &hash_cache, const rct::key &mash0, con
 }
 
 /* Given a value v (0..2^N-1) and a mask gamma, construct a range proof */
+/* Run the inner product rounds (PAPER LINES 13-29) on l and r, which are folded in place down to a single element
+ * The generators start as Gi and Hi * y^-i, the first round works on the global tables and folds them, the
+ * later rounds work on the folded points. Returns false if a challenge is 0 and the proof has to be restarted. */
+static bool prove_inner_product(bp_cache &exp_cache, rct::key &hash_cache, const rct::key &y, const rct::key &x_ip,
+								rct::keyV &aprime, rct::keyV &bprime, rct::keyV &L, rct::keyV &R)
+{
+	const size_t MN = aprime.size();
+	CHECK_AND_ASSERT_THROW_MES(bprime.size() == MN, "Incompatible sizes of aprime and bprime");
+	CHECK_AND_ASSERT_THROW_MES(MN > 1 && (MN & (MN - 1)) == 0 && MN <= maxN * maxM, "Invalid inner product size");
+
+	const rct::keyV yinvpow = vector_powers(invert(y), MN);
+	std::vector<ge_p3> Gprime, Hprime;
+	size_t nprime = MN;
+	rct::key cL, cR, w, winv;
+
+	// PAPER LINE 13
+	for(size_t round = 0; nprime > 1; ++round)
+	{
+		// PAPER LINE 15
+		nprime /= 2;
+
+		// PAPER LINES 16-17
+		sc_mul(cL.bytes, inner_product(&aprime[0], &bprime[nprime], nprime).bytes, x_ip.bytes);
+		sc_mul(cR.bytes, inner_product(&aprime[nprime], &bprime[0], nprime).bytes, x_ip.bytes);
+
+		// PAPER LINES 18-19
+		if(round == 0)
+		{
+			L[round] = compute_LR_cached(exp_cache, MN, nprime, cL, yinvpow, nprime, aprime, 0, 0, bprime, nprime);
+			R[round] = compute_LR_cached(exp_cache, MN, nprime, cR, yinvpow, 0, aprime, nprime, nprime, bprime, 0);
+		}
+		else
+		{
+			L[round] = compute_LR(exp_cache, nprime, cL, Gprime, nprime, aprime, 0, Hprime, 0, bprime, nprime);
+			R[round] = compute_LR(exp_cache, nprime, cR, Gprime, 0, aprime, nprime, Hprime, nprime, bprime, 0);
+		}
+
+		// PAPER LINES 21-22
+		w = hash_cache_mash(hash_cache, L[round], R[round]);
+		if(w == rct::zero())
+		{
+			MINFO("w[round] is 0, trying again");
+			return false;
+		}
+
+		// PAPER LINES 24-25
+		winv = invert(w);
+		if(round == 0)
+		{
+			Gprime.assign(&multiexp_cache::Gi_p3(0), &multiexp_cache::Gi_p3(0) + MN);
+			Hprime.assign(&multiexp_cache::Hi_p3(0), &multiexp_cache::Hi_p3(0) + MN);
+			hadamard_fold(Gprime, nullptr, winv, w);
+			hadamard_fold(Hprime, &yinvpow, w, winv);
+		}
+		else
+		{
+			hadamard_fold(Gprime, nullptr, winv, w);
+			hadamard_fold(Hprime, nullptr, w, winv);
+		}
+
+		// PAPER LINES 28-29
+		vector_fold(aprime, w, winv);
+		vector_fold(bprime, winv, w);
+	}
+	return true;
+}
+
 Bulletproof bulletproof_PROVE(const rct::key &sv, const rct::key &gamma)
 {
 	PERF_TIMER_UNIT(PROVE, 1000000);
@@ -459,7 +589,6 @@ try_again:
 	const auto yN = vector_powers(y, N);
 
 	rct::key ip1y = vector_sum(yN);
-	rct::key tmp;
 	sc_muladd(t0.bytes, z.bytes, ip1y.bytes, t0.bytes);
 
 	rct::key zsq;
@@ -550,73 +679,20 @@ try_again:
 	// PAPER LINES 32-33
 	rct::key x_ip = hash_cache_mash(hash_cache, x, taux, mu, t);
 
-	// These are used in the inner product rounds
-	size_t nprime = N;
-	rct::keyV Gprime(N);
-	rct::keyV Hprime(N);
-	rct::keyV aprime(N);
-	rct::keyV bprime(N);
-	const rct::key yinv = invert(y);
-	rct::key yinvpow = rct::identity();
-	for(size_t i = 0; i < N; ++i)
-	{
-		Gprime[i] = multiexp_cache::Gi(i);
-		Hprime[i] = scalarmultKey(multiexp_cache::Hi_p3(i), yinvpow);
-		sc_mul(yinvpow.bytes, yinvpow.bytes, yinv.bytes);
-		aprime[i] = l[i];
-		bprime[i] = r[i];
-	}
 	rct::keyV L(logN);
 	rct::keyV R(logN);
-	int round = 0;
-	rct::keyV w(logN); // this is the challenge x in the inner product protocol
 	PERF_TIMER_STOP(PROVE_step3);
 
 	PERF_TIMER_START_BP(PROVE_step4);
-	// PAPER LINE 13
-	while(nprime > 1)
+	if(!prove_inner_product(exp_cache, hash_cache, y, x_ip, l, r, L, R))
 	{
-		// PAPER LINE 15
-		nprime /= 2;
-
-		// PAPER LINES 16-17
-		rct::key cL = inner_product(slice(aprime, 0, nprime), slice(bprime, nprime, bprime.size()));
-		rct::key cR = inner_product(slice(aprime, nprime, aprime.size()), slice(bprime, 0, nprime));
-
-		// PAPER LINES 18-19
-		L[round] = exp_cache.vector_exponent_custom(slice(Gprime, nprime, Gprime.size()), slice(Hprime, 0, nprime), slice(aprime, 0, nprime), slice(bprime, nprime, bprime.size()));
-		sc_mul(tmp.bytes, cL.bytes, x_ip.bytes);
-		rct::addKeys(L[round], L[round], rct::scalarmultH(tmp));
-		L[round] = rct::scalarmultKey(L[round], INV_EIGHT);
-		R[round] = exp_cache.vector_exponent_custom(slice(Gprime, 0, nprime), slice(Hprime, nprime, Hprime.size()), slice(aprime, nprime, aprime.size()), slice(bprime, 0, nprime));
-		sc_mul(tmp.bytes, cR.bytes, x_ip.bytes);
-		rct::addKeys(R[round], R[round], rct::scalarmultH(tmp));
-		R[round] = rct::scalarmultKey(R[round], INV_EIGHT);
-
-		// PAPER LINES 21-22
-		w[round] = hash_cache_mash(hash_cache, L[round], R[round]);
-		if(w[round] == rct::zero())
-		{
-			PERF_TIMER_STOP(PROVE_step4);
-			MINFO("w[round] is 0, trying again");
-			goto try_again;
-		}
-
-		// PAPER LINES 24-25
-		const rct::key winv = invert(w[round]);
-		Gprime = hadamard2(vector_scalar2(slice(Gprime, 0, nprime), winv), vector_scalar2(slice(Gprime, nprime, Gprime.size()), w[round]));
-		Hprime = hadamard2(vector_scalar2(slice(Hprime, 0, nprime), w[round]), vector_scalar2(slice(Hprime, nprime, Hprime.size()), winv));
-
-		// PAPER LINES 28-29
-		aprime = vector_add(vector_scalar(slice(aprime, 0, nprime), w[round]), vector_scalar(slice(aprime, nprime, aprime.size()), winv));
-		bprime = vector_add(vector_scalar(slice(bprime, 0, nprime), winv), vector_scalar(slice(bprime, nprime, bprime.size()), w[round]));
-
-		++round;
+		PERF_TIMER_STOP(PROVE_step4);
+		goto try_again;
 	}
 	PERF_TIMER_STOP(PROVE_step4);
 
 	// PAPER LINE 58 (with inclusions from PAPER LINE 8 and PAPER LINE 20)
-	return Bulletproof(V, A, S, T1, T2, taux, mu, L, R, aprime[0], bprime[0], t);
+	return Bulletproof(V, A, S, T1, T2, taux, mu, L, R, l[0], r[0], t);
 }
 
 Bulletproof bulletproof_PROVE(uint64_t v, const rct::key &gamma)
@@ -660,7 +736,6 @@ Bulletproof bulletproof_PROVE(const rct::keyV &sv, const rct::keyV &gamma)
 
 	rct::keyV V(sv.size());
 	rct::keyV aL(MN), aR(MN);
-	rct::key tmp;
 
 	PERF_TIMER_START_BP(PROVE_v);
 	for(size_t i = 0; i < sv.size(); ++i)
@@ -845,73 +920,20 @@ try_again:
 		goto try_again;
 	}
 
-	// These are used in the inner product rounds
-	size_t nprime = MN;
-	rct::keyV Gprime(MN);
-	rct::keyV Hprime(MN);
-	rct::keyV aprime(MN);
-	rct::keyV bprime(MN);
-	const rct::key yinv = invert(y);
-	rct::key yinvpow = rct::identity();
-	for(size_t i = 0; i < MN; ++i)
-	{
-		Gprime[i] = multiexp_cache::Gi(i);
-		Hprime[i] = scalarmultKey(multiexp_cache::Hi_p3(i), yinvpow);
-		sc_mul(yinvpow.bytes, yinvpow.bytes, yinv.bytes);
-		aprime[i] = l[i];
-		bprime[i] = r[i];
-	}
 	rct::keyV L(logMN);
 	rct::keyV R(logMN);
-	int round = 0;
-	rct::keyV w(logMN); // this is the challenge x in the inner product protocol
 	PERF_TIMER_STOP(PROVE_step3);
 
 	PERF_TIMER_START_BP(PROVE_step4);
-	// PAPER LINE 13
-	while(nprime > 1)
+	if(!prove_inner_product(exp_cache, hash_cache, y, x_ip, l, r, L, R))
 	{
-		// PAPER LINE 15
-		nprime /= 2;
-
-		// PAPER LINES 16-17
-		rct::key cL = inner_product(slice(aprime, 0, nprime), slice(bprime, nprime, bprime.size()));
-		rct::key cR = inner_product(slice(aprime, nprime, aprime.size()), slice(bprime, 0, nprime));
-
-		// PAPER LINES 18-19
-		L[round] = exp_cache.vector_exponent_custom(slice(Gprime, nprime, Gprime.size()), slice(Hprime, 0, nprime), slice(aprime, 0, nprime), slice(bprime, nprime, bprime.size()));
-		sc_mul(tmp.bytes, cL.bytes, x_ip.bytes);
-		rct::addKeys(L[round], L[round], rct::scalarmultH(tmp));
-		L[round] = rct::scalarmultKey(L[round], INV_EIGHT);
-		R[round] = exp_cache.vector_exponent_custom(slice(Gprime, 0, nprime), slice(Hprime, nprime, Hprime.size()), slice(aprime, nprime, aprime.size()), slice(bprime, 0, nprime));
-		sc_mul(tmp.bytes, cR.bytes, x_ip.bytes);
-		rct::addKeys(R[round], R[round], rct::scalarmultH(tmp));
-		R[round] = rct::scalarmultKey(R[round], INV_EIGHT);
-
-		// PAPER LINES 21-22
-		w[round] = hash_cache_mash(hash_cache, L[round], R[round]);
-		if(w[round] == rct::zero())
-		{
-			PERF_TIMER_STOP(PROVE_step4);
-			MINFO("w[round] is 0, trying again");
-			goto try_again;
-		}
-
-		// PAPER LINES 24-25
-		const rct::key winv = invert(w[round]);
-		Gprime = hadamard2(vector_scalar2(slice(Gprime, 0, nprime), winv), vector_scalar2(slice(Gprime, nprime, Gprime.size()), w[round]));
-		Hprime = hadamard2(vector_scalar2(slice(Hprime, 0, nprime), w[round]), vector_scalar2(slice(Hprime, nprime, Hprime.size()), winv));
-
-		// PAPER LINES 28-29
-		aprime = vector_add(vector_scalar(slice(aprime, 0, nprime), w[round]), vector_scalar(slice(aprime, nprime, aprime.size()), winv));
-		bprime = vector_add(vector_scalar(slice(bprime, 0, nprime), winv), vector_scalar(slice(bprime, nprime, bprime.size()), w[round]));
-
-		++round;
+		PERF_TIMER_STOP(PROVE_step4);
+		goto try_again;
 	}
 	PERF_TIMER_STOP(PROVE_step4);
 
 	// PAPER LINE 58 (with inclusions from PAPER LINE 8 and PAPER LINE 20)
-	return Bulletproof(V, A, S, T1, T2, taux, mu, L, R, aprime[0], bprime[0], t);
+	return Bulletproof(V, A, S, T1, T2, taux, mu, L, R, l[0], r[0], t);
 }
 
 Bulletproof bulletproof_PROVE(const std::vector<uint64_t> &v, const rct::keyV &gamma)
@@ -45,12 +45,20 @@
 // Adapted from Python code by Sarang Noether
 
 #include "common/perf_timer.h"
+#include "common/threadpool.h"
 #include "misc_log_ex.h"
 extern "C" {
 #include "crypto/crypto-ops.h"
 }
 #include "multiexp.h"
 #include "rctOps.h"
+#include "string_tools.h"
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
 
 #undef MONERO_DEFAULT_LOG_CATEGORY
 #define MONERO_DEFAULT_LOG_CATEGORY "multiexp"
@@ -349,29 +357,200 @@ static rct::key get_exponent(const rct::key &base, size_t idx)
 	return e;
 }
 
-multiexp_cache::multiexp_cache()
+// Layout of the tables, as kept in memory and in the cache file
+struct multiexp_tables_header
 {
+	char magic[16];
+	uint32_t version;
+	uint32_t fe_limbs;
+	uint32_t points;
+	uint32_t straus_points;
+	uint32_t straus_c;
+	uint32_t reserved[11];
+};
+static_assert(sizeof(multiexp_tables_header) == 80, "Unexpected multiexp_tables_header size");
+
+static constexpr char MULTIEXP_TABLES_MAGIC[16] = "ryo-bp-tables";
+static constexpr uint32_t MULTIEXP_TABLES_VERSION = 2;
+static constexpr size_t MULTIEXP_TABLES_HEADER_SIZE = 128;
+static constexpr size_t MULTIEXP_TABLES_POINTS = maxN * maxM;
+
+
+// Keccak of the tables after the header, as built by this code for each field element
+// layout. They feed consensus verification, so a file is only used if it hashes to this,
+// and freshly built tables that don't are not saved. Update these whenever anything that
+// goes into the tables changes (generators, maxN, maxM, STRAUS_SIZE_LIMIT or the layout).
+#if defined(CRYPTO_FE51)
+static const char MULTIEXP_TABLES_DIGEST[] = "a05ff052ab3875beb80541377ea638166eddd2905bb0bd5938e9ba2c5eac0bf1";
+#else
+static const char MULTIEXP_TABLES_DIGEST[] = "c2078f4cc36b72043458a7e547c5a20a68396b032819b3962c0e671b5d4ca97f";
+#endif
+
+static std::string multiexp_cache_file;
+
+static multiexp_tables_header make_tables_header(size_t straus_points)
+{
+	multiexp_tables_header hdr;
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, MULTIEXP_TABLES_MAGIC, sizeof(hdr.magic));
+	hdr.version = MULTIEXP_TABLES_VERSION;
+	hdr.fe_limbs = std::extent<fe>::value;
+	hdr.points = MULTIEXP_TABLES_POINTS;
+	hdr.straus_points = straus_points;
+	hdr.straus_c = straus_cache::STRAUS_C;
+	return hdr;
+}
+
+static bool check_tables_digest(const uint8_t *base, size_t size)
+{
+	const crypto::hash digest = crypto::cn_fast_hash(base + MULTIEXP_TABLES_HEADER_SIZE, size - MULTIEXP_TABLES_HEADER_SIZE);
+	return epee::string_tools::pod_to_hex(digest) == MULTIEXP_TABLES_DIGEST;
+}
+
+size_t multiexp_cache::get_tables_size()
+{
+	return MULTIEXP_TABLES_HEADER_SIZE +
+		   MULTIEXP_TABLES_POINTS * 2 * (sizeof(rct::key) + sizeof(ge_p3)) +
+		   (straus_cache::cache_entries(STRAUS_SIZE_LIMIT) + pippenger_cache::cache_entries(MULTIEXP_TABLES_POINTS * 2)) * sizeof(ge_cached_pad);
+}
+
+void multiexp_cache::set_cache_file(const std::string &path)
+{
+	multiexp_cache_file = path;
+}
+
+const std::string &multiexp_cache::get_cache_file()
+{
+	return multiexp_cache_file;
+}
+
+void multiexp_cache::set_tables(uint8_t *base)
+{
+	uint8_t *ptr = base + MULTIEXP_TABLES_HEADER_SIZE;
+	Hi_cache = reinterpret_cast<const rct::key *>(ptr);
+	ptr += MULTIEXP_TABLES_POINTS * sizeof(rct::key);
+	Gi_cache = reinterpret_cast<const rct::key *>(ptr);
+	ptr += MULTIEXP_TABLES_POINTS * sizeof(rct::key);
+	Hi_p3_cache = reinterpret_cast<const ge_p3 *>(ptr);
+	ptr += MULTIEXP_TABLES_POINTS * sizeof(ge_p3);
+	Gi_p3_cache = reinterpret_cast<const ge_p3 *>(ptr);
+	ptr += MULTIEXP_TABLES_POINTS * sizeof(ge_p3);
+	s_cache.attach_cache(reinterpret_cast<ge_cached_pad *>(ptr), STRAUS_SIZE_LIMIT);
+	ptr += straus_cache::cache_entries(STRAUS_SIZE_LIMIT) * sizeof(ge_cached_pad);
+	p_cache.attach_cache(reinterpret_cast<ge_cached_pad *>(ptr), MULTIEXP_TABLES_POINTS * 2);
+}
+
+bool multiexp_cache::load_tables(const std::string &path)
+{
+	namespace bip = boost::interprocess;
+	try
+	{
+		boost::system::error_code ec;
+		if(boost::filesystem::file_size(path, ec) != get_tables_size() || ec)
+			return false;
+
+		bip::file_mapping mapping(path.c_str(), bip::read_only);
+		std::unique_ptr<bip::mapped_region> region(new bip::mapped_region(mapping, bip::read_only));
+		if(region->get_size() != get_tables_size())
+			return false;
+
+		const uint8_t *base = static_cast<const uint8_t *>(region->get_address());
+		const multiexp_tables_header hdr = make_tables_header(STRAUS_SIZE_LIMIT);
+		if(memcmp(base, &hdr, sizeof(hdr)) != 0)
+		{
+			MWARNING("Bulletproof tables in " << path << " are stale, rebuilding them");
+			return false;
+		}
+		if(!check_tables_digest(base, get_tables_size()))
+		{
+			MWARNING("Bulletproof tables in " << path << " are corrupt, rebuilding them");
+			return false;
+		}
+
+		// The mapping is read-only, nothing writes through the pointers once init is done
+		set_tables(const_cast<uint8_t *>(base));
+		tables_region = std::move(region);
+		return true;
+	}
+	catch(const std::exception &e)
+	{
+		MWARNING("Failed to map bulletproof tables from " << path << ": " << e.what());
+		return false;
+	}
+}
+
+void multiexp_cache::save_tables(const std::string &path) const
+{
+	try
+	{
+		// Written under a unique name and renamed, so readers never see a partial file
+		const boost::filesystem::path tmp = boost::filesystem::unique_path(path + ".%%%%-%%%%");
+		{
+			std::ofstream out(tmp.string(), std::ios::binary | std::ios::trunc);
+			out.write(reinterpret_cast<const char *>(tables.get()), get_tables_size());
+			if(!out.good())
+			{
+				MWARNING("Failed to write bulletproof tables to " << tmp.string());
+				boost::filesystem::remove(tmp);
+				return;
+			}
+		}
+		boost::filesystem::rename(tmp, path);
+		MINFO("Saved bulletproof tables to " << path);
+	}
+	catch(const std::exception &e)
+	{
+		MWARNING("Failed to save bulletproof tables to " << path << ": " << e.what());
+	}
+}
+
+multiexp_cache::multiexp_cache(const std::string &path)
+{
+	if(!path.empty() && load_tables(path))
+	{
+		MINFO("Mapped bulletproof tables from " << path);
+		return;
+	}
+
+	tables = make_aligned_array<uint8_t>(4096, get_tables_size());
+	set_tables(tables.get());
+
+	rct::key *Hi = const_cast<rct::key *>(Hi_cache), *Gi = const_cast<rct::key *>(Gi_cache);
+	ge_p3 *Hi_p3 = const_cast<ge_p3 *>(Hi_p3_cache), *Gi_p3 = const_cast<ge_p3 *>(Gi_p3_cache);
 	std::vector<MultiexpData> data;
-	for(size_t i = 0; i < maxN * maxM; ++i)
+	data.reserve(MULTIEXP_TABLES_POINTS * 2);
+	for(size_t i = 0; i < MULTIEXP_TABLES_POINTS; ++i)
 	{
-		Hi_cache[i] = get_exponent(rct::H, i * 2);
-		CHECK_AND_ASSERT_THROW_MES(ge_frombytes_vartime(&Hi_p3_cache[i], Hi_cache[i].bytes) == 0, "ge_frombytes_vartime failed");
-		Gi_cache[i] = get_exponent(rct::H, i * 2 + 1);
-		CHECK_AND_ASSERT_THROW_MES(ge_frombytes_vartime(&Gi_p3_cache[i], Gi_cache[i].bytes) == 0, "ge_frombytes_vartime failed");
+		Hi[i] = get_exponent(rct::H, i * 2);
+		CHECK_AND_ASSERT_THROW_MES(ge_frombytes_vartime(&Hi_p3[i], Hi[i].bytes) == 0, "ge_frombytes_vartime failed");
+		Gi[i] = get_exponent(rct::H, i * 2 + 1);
+		CHECK_AND_ASSERT_THROW_MES(ge_frombytes_vartime(&Gi_p3[i], Gi[i].bytes) == 0, "ge_frombytes_vartime failed");
 
-		data.push_back({rct::zero(), Gi_cache[i]});
-		data.push_back({rct::zero(), Hi_cache[i]});
+		data.emplace_back(rct::zero(), Gi_p3[i]);
+		data.emplace_back(rct::zero(), Hi_p3[i]);
 	}
 
 	s_cache.init_cache(data, STRAUS_SIZE_LIMIT);
 	p_cache.init_cache(data, 0, false);
 
-	MINFO("Hi/Gi cache size: " << (sizeof(Hi_cache) + sizeof(Gi_cache)) / 1024 << " kB");
-	MINFO("Hi_p3/Gi_p3 cache size: " << (sizeof(Hi_p3_cache) + sizeof(Gi_p3_cache)) / 1024 << " kB");
-	MINFO("Straus cache size: " << sizeof(straus_cache) / 1024 << " kB");
-	MINFO("Pippenger cache size: " << sizeof(pippenger_cache) / 1024 << " kB");
-	size_t cache_size = (sizeof(Hi_cache) + sizeof(Hi_p3_cache)) * 2 + sizeof(straus_cache) + sizeof(pippenger_cache);
-	MINFO("Total cache size: " << cache_size / 1024 << "kB");
+	const multiexp_tables_header hdr = make_tables_header(STRAUS_SIZE_LIMIT);
+	memset(tables.get(), 0, MULTIEXP_TABLES_HEADER_SIZE);
+	memcpy(tables.get(), &hdr, sizeof(hdr));
+
+	MINFO("Bulletproof tables size: " << get_tables_size() / 1024 << " kB");
+
+	if(path.empty())
+		return;
+	if(!check_tables_digest(tables.get(), get_tables_size()))
+	{
+		MERROR("Bulletproof tables do not match their expected digest, not saving them to " << path);
+		return;
+	}
+	save_tables(path);
+}
+
+multiexp_cache::~multiexp_cache()
+{
 }
 
 void straus_cache::init_cache(const std::vector<MultiexpData> &data, size_t N)
@@ -387,7 +566,8 @@ void straus_cache::init_cache(const std::vector<MultiexpData> &data, size_t N)
 	if(cache == nullptr || alloc_size < N)
 	{
 		alloc_size = std::max<size_t>(N, 64);
-		cache = make_aligned_array<ge_cached_pad>(4096, ((1<<STRAUS_C)-1) * alloc_size);
+		cache_alloc = make_aligned_array<ge_cached_pad>(4096, cache_entries(alloc_size));
+		cache = cache_alloc.get();
 	}
 
 	for (size_t j=0;j<N;++j)
@@ -403,6 +583,13 @@ void straus_cache::init_cache(const std::vector<MultiexpData> &data, size_t N)
 	MULTIEXP_PERF(PERF_TIMER_STOP(multiples));
 }
 
+void straus_cache::attach_cache(ge_cached_pad *mem, size_t N)
+{
+	cache_alloc.reset();
+	cache = mem;
+	size = alloc_size = N;
+}
+
 rct::key straus_cache::straus(const std::vector<MultiexpData> &data, size_t STEP) const
 {
 	CHECK_AND_ASSERT_THROW_MES(cache != nullptr, "null cache");
@@ -522,7 +709,8 @@ void pippenger_cache::init_cache(const std::vector<MultiexpData> &data, size_t N
 		else
 			alloc_size = N;
 
-		cache = make_aligned_array<ge_cached_pad>(4096, alloc_size);
+		cache_alloc = make_aligned_array<ge_cached_pad>(4096, cache_entries(alloc_size));
+		cache = cache_alloc.get();
 	}
 
 	for(size_t i = 0; i < N; ++i)
@@ -531,7 +719,49 @@ void pippenger_cache::init_cache(const std::vector<MultiexpData> &data, size_t N
 	MULTIEXP_PERF(PERF_TIMER_STOP(pippenger_init_cache));
 }
 
-rct::key pippenger_cache::pippenger(const std::vector<MultiexpData> &data, aligned_ptr<ge_p3[]>& buckets, size_t c) const
+void pippenger_cache::attach_cache(ge_cached_pad *mem, size_t N)
+{
+	cache_alloc.reset();
+	cache = mem;
+	size = alloc_size = N;
+}
+
+void pippenger_cache::pippenger_window(const std::vector<MultiexpData> &data, ge_p3 *buckets, size_t c, size_t k, ge_p3 &window) const
+{
+	for(size_t i = 0; i < (1u << c); ++i)
+		buckets[i] = ge_p3_identity;
+
+	// partition scalars into buckets
+	for(size_t i = 0; i < data.size(); ++i)
+	{
+		unsigned int bucket = 0;
+		for(size_t j = 0; j < c; ++j)
+			if(test(data[i].scalar, k * c + j))
+				bucket |= 1 << j;
+		if(bucket == 0)
+			continue;
+		CHECK_AND_ASSERT_THROW_MES(bucket < (1u << c), "bucket overflow");
+		if(!ge_p3_is_point_at_infinity(&buckets[bucket]))
+		{
+			add(buckets[bucket], pp_offset(i));
+		}
+		else
+			buckets[bucket] = data[i].point;
+	}
+
+	// sum the buckets
+	ge_p3 pail = ge_p3_identity;
+	window = ge_p3_identity;
+	for(size_t i = (1 << c) - 1; i > 0; --i)
+	{
+		if(!ge_p3_is_point_at_infinity(&buckets[i]))
+			add(pail, buckets[i]);
+		if(!ge_p3_is_point_at_infinity(&pail))
+			add(window, pail);
+	}
+}
+
+rct::key pippenger_cache::pippenger(const std::vector<MultiexpData> &data, aligned_ptr<ge_p3[]>& buckets, size_t c, size_t threads) const
 {
 	CHECK_AND_ASSERT_THROW_MES(cache != nullptr, "null cache");
 	CHECK_AND_ASSERT_THROW_MES(size >= data.size(), "Cache is too small");
@@ -558,6 +788,29 @@ rct::key pippenger_cache::pippenger(const std::vector<MultiexpData> &data, align
 		++groups;
 	groups = (groups + c - 1) / c;
 
+	tools::threadpool &tpool = tools::threadpool::getInstance();
+	if(threads == 0)
+		threads = data.size() >= PIPPENGER_PARALLEL_THRESHOLD ? tpool.get_max_concurrency() : 1;
+	threads = std::min(threads, groups);
+
+	// windows are independent, each thread sums a share of them into its own buckets
+	std::vector<ge_p3> windows(groups);
+	if(threads > 1)
+	{
+		tools::threadpool::waiter waiter;
+		for(size_t t = 1; t < threads; ++t)
+		{
+			tpool.submit(&waiter, [&, t] {
+				aligned_ptr<ge_p3[]> t_buckets = make_aligned_array<ge_p3>(4096, 1 << c);
+				for(size_t k = t; k < groups; k += threads)
+					pippenger_window(data, t_buckets.get(), c, k, windows[k]);
+			});
+		}
+		for(size_t k = 0; k < groups; k += threads)
+			pippenger_window(data, buckets.get(), c, k, windows[k]);
+		waiter.wait();
+	}
+
 	for(size_t k = groups; k-- > 0;)
 	{
 		if(!ge_p3_is_point_at_infinity(&result))
@@ -574,36 +827,10 @@ rct::key pippenger_cache::pippenger(const std::vector<MultiexpData> &data, align
 					ge_p1p1_to_p2(&p2, &p1);
 			}
 		}
-		for(size_t i = 0; i < (1u << c); ++i)
-			buckets[i] = ge_p3_identity;
-
-		// partition scalars into buckets
-		for(size_t i = 0; i < data.size(); ++i)
-		{
-			unsigned int bucket = 0;
-			for(size_t j = 0; j < c; ++j)
-				if(test(data[i].scalar, k * c + j))
-					bucket |= 1 << j;
-			if(bucket == 0)
-				continue;
-			CHECK_AND_ASSERT_THROW_MES(bucket < (1u << c), "bucket overflow");
-			if(!ge_p3_is_point_at_infinity(&buckets[bucket]))
-			{
-				add(buckets[bucket], pp_offset(i));
-			}
-			else
-				buckets[bucket] = data[i].point;
-		}
-
-		// sum the buckets
-		ge_p3 pail = ge_p3_identity;
-		for(size_t i = (1 << c) - 1; i > 0; --i)
-		{
-			if(!ge_p3_is_point_at_infinity(&buckets[i]))
-				add(pail, buckets[i]);
-			if(!ge_p3_is_point_at_infinity(&pail))
-				add(result, pail);
-		}
+		if(threads <= 1)
+			pippenger_window(data, buckets.get(), c, k, windows[k]);
+		if(!ge_p3_is_point_at_infinity(&windows[k]))
+			add(result, windows[k]);
 	}
 
 	rct::key res;
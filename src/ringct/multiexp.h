@@ -50,9 +50,19 @@
 #include "crypto/crypto.h"
 #include "misc_log_ex.h"
 #include "rctTypes.h"
+#include <memory>
+#include <string>
 #include <vector>
 #include <boost/align/aligned_delete.hpp>
 
+namespace boost
+{
+namespace interprocess
+{
+class mapped_region;
+}
+}
+
 //Unfortunately this is a C++17 feature... but we can roll our own
 template<typename T>
 using aligned_ptr = std::unique_ptr<T, boost::alignment::aligned_delete>;
@@ -74,6 +84,7 @@ enum test_multiexp_algorithm
 };
 template <test_multiexp_algorithm algorithm, size_t npoints, size_t c>
 class test_multiexp;
+class test_multiexp_tables;
 
 namespace rct
 {
@@ -105,7 +116,7 @@ struct alignas(8) ge_cached_pad
 class pippenger_cache
 {
 public:
-	pippenger_cache() : size(0), alloc_size(0) {}	
+	pippenger_cache() : size(0), alloc_size(0), cache(nullptr) {}	
 
 	inline ge_cached* pp_offset(size_t n) { return &cache[n].gec; };
 	inline const ge_cached& pp_offset(size_t n) const { return cache[n].gec; };
@@ -113,7 +124,16 @@ public:
 	inline size_t get_size() { return size * sizeof(ge_cached_pad); };
 	void init_cache(const std::vector<MultiexpData> &data, size_t N = 0, bool over_alloc = true);
 
-	rct::key pippenger(const std::vector<MultiexpData> &data, aligned_ptr<ge_p3[]>& buckets, size_t c = 0) const;
+	// Use externally owned memory of cache_entries(N) elements, init_cache will fill it in place
+	static inline size_t cache_entries(size_t N) { return N; }
+	void attach_cache(ge_cached_pad *mem, size_t N);
+
+	// Above this many points the bucket windows are split over the threadpool. Jobs
+	// submitted from a pool thread run inline, so callers should stay off the pool
+	static constexpr size_t PIPPENGER_PARALLEL_THRESHOLD = 512;
+
+	// threads == 0 picks the thread count automatically, buckets are only used by the calling thread
+	rct::key pippenger(const std::vector<MultiexpData> &data, aligned_ptr<ge_p3[]>& buckets, size_t c = 0, size_t threads = 0) const;
 
 	static inline size_t get_pippenger_c(size_t N)
 	{
@@ -139,16 +159,19 @@ public:
 	}
 
 private:
+	void pippenger_window(const std::vector<MultiexpData> &data, ge_p3 *buckets, size_t c, size_t k, ge_p3 &window) const;
+
 	size_t size;
 	size_t alloc_size;
-	aligned_ptr<ge_cached_pad[]> cache;
+	aligned_ptr<ge_cached_pad[]> cache_alloc;
+	ge_cached_pad *cache;
 };
 
 // Algorithm specific cache
 class straus_cache
 {
 public:
-	straus_cache() : size(0) {}	
+	straus_cache() : size(0), alloc_size(0), cache(nullptr) {}	
 
 	static constexpr size_t STRAUS_C = 4;
 
@@ -158,33 +181,55 @@ public:
 	inline size_t get_size() { return size * sizeof(ge_cached_pad); };
 	void init_cache(const std::vector<MultiexpData> &data, size_t N = 0);
 
+	// Use externally owned memory of cache_entries(N) elements, init_cache will fill it in place
+	static inline size_t cache_entries(size_t N) { return ((1<<STRAUS_C)-1) * N; }
+	void attach_cache(ge_cached_pad *mem, size_t N);
+
 	rct::key straus(const std::vector<MultiexpData> &data, size_t STEP) const;
 
 private:
 	size_t size;
 	size_t alloc_size;
-	aligned_ptr<ge_cached_pad[]> cache;
+	aligned_ptr<ge_cached_pad[]> cache_alloc;
+	ge_cached_pad *cache;
 };
 
 // This cache is global and read-only
+// If a cache file is set before first use, the tables are mapped from it read-only, so
+// that they load quickly and their pages are shared by all processes using the same file
 class multiexp_cache
 {
+friend class ::test_multiexp_tables;
+
 private:
 	static constexpr size_t STRAUS_SIZE_LIMIT = 128;
 	static constexpr size_t PIPPENGER_SIZE_LIMIT = maxN * maxM;
 
 	straus_cache s_cache;
 	pippenger_cache p_cache;
-	alignas(16) rct::key Hi_cache[maxN * maxM], Gi_cache[maxN * maxM];
-	alignas(16) ge_p3 Hi_p3_cache[maxN * maxM], Gi_p3_cache[maxN * maxM];
+	const rct::key *Hi_cache, *Gi_cache;
+	const ge_p3 *Hi_p3_cache, *Gi_p3_cache;
 
-	multiexp_cache();
+	aligned_ptr<uint8_t[]> tables;
+	std::unique_ptr<boost::interprocess::mapped_region> tables_region;
+
+	explicit multiexp_cache(const std::string &path);
+	~multiexp_cache();
+
+	static const std::string &get_cache_file();
+	void set_tables(uint8_t *base);
+	bool load_tables(const std::string &path);
+	void save_tables(const std::string &path) const;
 
 public:
+	static size_t get_tables_size();
+	// Has no effect once the cache is in use
+	static void set_cache_file(const std::string &path);
+
 	inline static const multiexp_cache& inst()
 	{
 		static_assert(128 <= STRAUS_SIZE_LIMIT, "Straus in precalc mode can only be calculated till STRAUS_SIZE_LIMIT");
-		static multiexp_cache th;
+		static multiexp_cache th(get_cache_file());
 		return th;
 	}
 
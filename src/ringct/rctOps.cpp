@@ -241,18 +241,43 @@ key scalarmult8(const key & P)
 	return res;
 }
 
+//Window table for H in the layout of ge_base, built on first use
+static const ge_precomp (*H_table())[8]
+{
+	struct table
+	{
+		ge_precomp data[32][8];
+		table() { ge_precomp_table_init(data, &ge_p3_H); }
+	};
+	static const table H_precomp;
+	return H_precomp.data;
+}
+
 //Computes aH where H= toPoint(cn_fast_hash(G)), G the basepoint
 key scalarmultH(const key &a)
 {
-	ge_p3 A;
-	ge_p2 R;
-	CHECK_AND_ASSERT_THROW_MES_L1(ge_frombytes_vartime(&A, H.bytes) == 0, "ge_frombytes_vartime failed at " + boost::lexical_cast<std::string>(__LINE__));
-	ge_scalarmult(&R, a.bytes, &A);
+	ge_p3 R;
+	ge_scalarmult_precomp(&R, a.bytes, H_table());
 	key aP;
-	ge_tobytes(aP.bytes, &R);
+	ge_p3_tobytes(aP.bytes, &R);
 	return aP;
 }
 
+//aGbH = aG + bH where a, b are scalars, both from precomputed tables
+void addKeysGH(key &aGbH, const key &a, const key &b)
+{
+	ge_p3 aG, bH;
+	ge_cached bH_cached;
+	ge_p1p1 sum;
+	ge_p2 rv;
+	ge_scalarmult_base(&aG, a.bytes);
+	ge_scalarmult_precomp(&bH, b.bytes, H_table());
+	ge_p3_to_cached(&bH_cached, &bH);
+	ge_add(&sum, &aG, &bH_cached);
+	ge_p1p1_to_p2(&rv, &sum);
+	ge_tobytes(aGbH.bytes, &rv);
+}
+
 //Curve addition / subtractions
 
 //for curve points: AB = A + B
@@ -530,6 +555,16 @@ void hashToPoint(key &pointk, const key &hh)
 	ge_p3_tobytes(pointk.bytes, &res);
 }
 
+void hash_to_p3(ge_p3 &out, const key &in)
+{
+	ge_p2 point;
+	ge_p1p1 point2;
+	key h = cn_fast_hash(in);
+	ge_fromfe_frombytes_vartime(&point, h.bytes);
+	ge_mul8(&point2, &point);
+	ge_p1p1_to_p3(&out, &point2);
+}
+
 //sums a vector of curve points (for scalars use sc_add)
 void sumKeys(key &Csum, const keyV &Cis)
 {
@@ -136,6 +136,8 @@ void scalarmultKey(key &aP, const key &P, const key &a);
 key scalarmultKey(const key &P, const key &a);
 //Computes aH where H= toPoint(cn_fast_hash(G)), G the basepoint
 key scalarmultH(const key &a);
+//aGbH = aG + bH where a, b are scalars, e.g. the commitment for a mask and an amount
+void addKeysGH(key &aGbH, const key &a, const key &b);
 // multiplies a point by 8
 key scalarmult8(const key & P);
 
@@ -188,6 +190,8 @@ key hash_to_scalar(const key64 keys);
 key hashToPointSimple(const key &in);
 key hashToPoint(const key &in);
 void hashToPoint(key &out, const key &in);
+//hashToPoint without the round trip through the compressed form
+void hash_to_p3(ge_p3 &out, const key &in);
 
 //sums a vector of curve points (for scalars use sc_add)
 void sumKeys(key &Csum, const key &Cis);
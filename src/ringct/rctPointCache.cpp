@@ -0,0 +1,146 @@
+// Copyright (c) 2019, Ryo Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2020
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "rctPointCache.h"
+#include "rctOps.h"
+
+namespace rct
+{
+void point_cache::set_max_memory(size_t bytes)
+{
+	max_memory = bytes;
+	max_shard_entries = bytes / ENTRY_MEMORY / SHARDS;
+	if(bytes == 0)
+	{
+		clear();
+		return;
+	}
+
+	for(shard &s : shards)
+	{
+		boost::unique_lock<boost::mutex> lock(s.lock);
+		while(s.lru.size() > max_shard_entries)
+		{
+			s.index.erase(s.lru.back().first);
+			s.lru.pop_back();
+			++evictions;
+		}
+	}
+}
+
+std::shared_ptr<const point_cache::entry> point_cache::make_entry(const key &k)
+{
+	std::shared_ptr<entry> e = std::make_shared<entry>();
+	if(ge_frombytes_vartime(&e->P, k.bytes) != 0)
+		return nullptr;
+	ge_p3 Hi;
+	hash_to_p3(Hi, k);
+	if(ge_p3_is_point_at_infinity(&Hi))
+		return nullptr;
+	ge_dsm_precomp(e->Hi, &Hi);
+	return e;
+}
+
+std::shared_ptr<const point_cache::entry> point_cache::get(const key &k)
+{
+	if(!enabled())
+		return make_entry(k);
+
+	shard &s = get_shard(k);
+	{
+		boost::unique_lock<boost::mutex> lock(s.lock);
+		auto it = s.index.find(k);
+		if(it != s.index.end())
+		{
+			s.lru.splice(s.lru.begin(), s.lru, it->second);
+			++hits;
+			return it->second->second;
+		}
+	}
+
+	++misses;
+	std::shared_ptr<const entry> e = make_entry(k);
+	if(!e)
+		return e;
+
+	boost::unique_lock<boost::mutex> lock(s.lock);
+	if(s.index.find(k) == s.index.end() && max_shard_entries > 0)
+	{
+		s.lru.emplace_front(k, e);
+		s.index.emplace(k, s.lru.begin());
+		while(s.lru.size() > max_shard_entries)
+		{
+			s.index.erase(s.lru.back().first);
+			s.lru.pop_back();
+			++evictions;
+		}
+	}
+	return e;
+}
+
+point_cache::stats point_cache::get_stats() const
+{
+	stats st;
+	st.hits = hits;
+	st.misses = misses;
+	st.evictions = evictions;
+	st.entries = 0;
+	for(const shard &s : shards)
+	{
+		boost::unique_lock<boost::mutex> lock(s.lock);
+		st.entries += s.lru.size();
+	}
+	st.memory = st.entries * ENTRY_MEMORY;
+	return st;
+}
+
+void point_cache::clear()
+{
+	for(shard &s : shards)
+	{
+		boost::unique_lock<boost::mutex> lock(s.lock);
+		s.index.clear();
+		s.lru.clear();
+	}
+}
+}
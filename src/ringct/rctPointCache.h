@@ -0,0 +1,118 @@
+// Copyright (c) 2019, Ryo Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2020
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "rctTypes.h"
+#include <atomic>
+#include <boost/thread/mutex.hpp>
+#include <list>
+#include <memory>
+#include <unordered_map>
+
+namespace rct
+{
+// Decompressed ring member keys, as used by MLSAG_Ver, shared by all verification threads
+// Entries are looked up by compressed key and the least recently used ones are evicted
+// once the memory cap is reached; a cap of 0 disables the cache
+class point_cache
+{
+  public:
+	struct entry
+	{
+		ge_p3 P;
+		ge_dsmp Hi; // precomputed hash to point of the key
+	};
+
+	struct stats
+	{
+		uint64_t hits;
+		uint64_t misses;
+		uint64_t evictions;
+		size_t entries;
+		size_t memory;
+	};
+
+	static point_cache &getInstance()
+	{
+		static point_cache instance;
+		return instance;
+	}
+
+	void set_max_memory(size_t bytes);
+	size_t get_max_memory() const { return max_memory; }
+	bool enabled() const { return max_memory != 0; }
+
+	// nullptr if the key is not a valid point, or hashes to the point at infinity
+	static std::shared_ptr<const entry> make_entry(const key &k);
+	// Returns the cached entry for k, computing it on a miss
+	std::shared_ptr<const entry> get(const key &k);
+
+	stats get_stats() const;
+	void clear();
+
+  private:
+	static constexpr size_t SHARDS = 16;
+	// Rough size of an entry with its list and map nodes
+	static constexpr size_t ENTRY_MEMORY = sizeof(entry) + 160;
+
+	struct shard
+	{
+		typedef std::list<std::pair<key, std::shared_ptr<const entry>>> lru_list;
+		mutable boost::mutex lock;
+		lru_list lru;
+		std::unordered_map<key, lru_list::iterator> index;
+	};
+
+	point_cache() : max_memory(0), max_shard_entries(0), hits(0), misses(0), evictions(0) {}
+
+	shard &get_shard(const key &k) { return shards[k.bytes[0] % SHARDS]; }
+
+	shard shards[SHARDS];
+	std::atomic<size_t> max_memory;
+	std::atomic<size_t> max_shard_entries;
+	std::atomic<uint64_t> hits;
+	std::atomic<uint64_t> misses;
+	std::atomic<uint64_t> evictions;
+};
+}
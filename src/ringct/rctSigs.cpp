@@ -51,6 +51,10 @@
 #include "common/util.h"
 #include "cryptonote_basic/cryptonote_format_utils.h"
 #include "misc_log_ex.h"
+#include "rctPointCache.h"
+#include <atomic>
+#include <exception>
+#include <unordered_map>
 
 using namespace crypto;
 using namespace std;
@@ -299,9 +303,8 @@ mgSig MLSAG_Gen(const key &message, const keyM &pk, const keyV &xx, const multis
 // Gen creates a signature which proves that for some column in the keymatrix "pk"
 //   the signer knows a secret key for each row in that column
 // Ver verifies that the MG sig was created correctly
-bool MLSAG_Ver(const key &message, const keyM &pk, const mgSig &rv, size_t dsRows)
+static bool MLSAG_Ver_check(const keyM &pk, const mgSig &rv, size_t dsRows)
 {
-
 	size_t cols = pk.size();
 	CHECK_AND_ASSERT_MES(cols >= 2, false, "Error! What is c if cols = 1!");
 	size_t rows = pk[0].size();
@@ -322,9 +325,24 @@ bool MLSAG_Ver(const key &message, const keyM &pk, const mgSig &rv, size_t dsRow
 		for(size_t j = 0; j < rv.ss[i].size(); ++j)
 			CHECK_AND_ASSERT_MES(sc_check(rv.ss[i][j].bytes) == 0, false, "Bad ss slot");
 	CHECK_AND_ASSERT_MES(sc_check(rv.cc.bytes) == 0, false, "Bad cc");
+	return true;
+}
 
+// a decompressed pk entry, and its precomputed hash to point if it is in a double spendable row
+struct mlsag_point
+{
+	const ge_p3 *P;
+	const ge_cached *Hi;
+};
+
+// pts[i * rows + j] is the mlsag_point of pk[i][j]
+static bool MLSAG_Ver_ring(const key &message, const keyM &pk, const mgSig &rv, size_t dsRows, const std::vector<mlsag_point> &pts)
+{
+	size_t cols = pk.size();
+	size_t rows = pk[0].size();
 	size_t i = 0, j = 0, ii = 0;
-	key c, L, R, Hi;
+	key c, L, R;
+	ge_p2 p2;
 	key c_old = copy(rv.cc);
 	vector<geDsmp> Ip(dsRows);
 	for(i = 0; i < dsRows; i++)
@@ -340,17 +358,19 @@ bool MLSAG_Ver(const key &message, const keyM &pk, const mgSig &rv, size_t dsRow
 		sc_0(c.bytes);
 		for(j = 0; j < dsRows; j++)
 		{
-			addKeys2(L, rv.ss[i][j], c_old, pk[i][j]);
-			hashToPoint(Hi, pk[i][j]);
-			CHECK_AND_ASSERT_MES(!(Hi == rct::identity()), false, "Data hashed to point at infinity");
-			addKeys3(R, rv.ss[i][j], Hi, c_old, Ip[j].k);
+			const mlsag_point &pt = pts[i * rows + j];
+			ge_double_scalarmult_base_vartime(&p2, c_old.bytes, pt.P, rv.ss[i][j].bytes);
+			ge_tobytes(L.bytes, &p2);
+			ge_double_scalarmult_precomp_vartime2(&p2, rv.ss[i][j].bytes, pt.Hi, c_old.bytes, Ip[j].k);
+			ge_tobytes(R.bytes, &p2);
 			toHash[3 * j + 1] = pk[i][j];
 			toHash[3 * j + 2] = L;
 			toHash[3 * j + 3] = R;
 		}
 		for(j = dsRows, ii = 0; j < rows; j++, ii++)
 		{
-			addKeys2(L, rv.ss[i][j], c_old, pk[i][j]);
+			ge_double_scalarmult_base_vartime(&p2, c_old.bytes, pts[i * rows + j].P, rv.ss[i][j].bytes);
+			ge_tobytes(L.bytes, &p2);
 			toHash[ndsRows + 2 * ii + 1] = pk[i][j];
 			toHash[ndsRows + 2 * ii + 2] = L;
 		}
@@ -362,6 +382,122 @@ bool MLSAG_Ver(const key &message, const keyM &pk, const mgSig &rv, size_t dsRow
 	return sc_isnonzero(c.bytes) == 0;
 }
 
+bool MLSAG_Ver(const key &message, const keyM &pk, const mgSig &rv, size_t dsRows)
+{
+	return MLSAG_Ver(message, std::vector<const keyM *>{&pk}, std::vector<const mgSig *>{&rv}, dsRows);
+}
+
+bool MLSAG_Ver(const key &message, const std::vector<const keyM *> &pk, const std::vector<const mgSig *> &rv, size_t dsRows)
+{
+	CHECK_AND_ASSERT_MES(pk.size() == rv.size(), false, "Mismatched pk and rv sizes");
+	for(size_t n = 0; n < pk.size(); ++n)
+	{
+		if(!MLSAG_Ver_check(*pk[n], *rv[n], dsRows))
+			return false;
+	}
+
+	// rings of the inputs of a tx often share members, so the points are set up once per distinct key
+	std::unordered_map<key, size_t> index;
+	std::vector<const key *> keys;
+	std::vector<uint8_t> need_hi;
+	std::vector<std::vector<size_t>> key_idx(pk.size());
+	for(size_t n = 0; n < pk.size(); ++n)
+	{
+		const keyM &m = *pk[n];
+		const size_t rows = m[0].size();
+		key_idx[n].resize(m.size() * rows);
+		for(size_t i = 0; i < m.size(); ++i)
+		{
+			for(size_t j = 0; j < rows; ++j)
+			{
+				auto res = index.emplace(m[i][j], keys.size());
+				if(res.second)
+				{
+					keys.push_back(&m[i][j]);
+					need_hi.push_back(0);
+				}
+				if(j < dsRows)
+					need_hi[res.first->second] = 1;
+				key_idx[n][i * rows + j] = res.first->second;
+			}
+		}
+	}
+
+	// ring members (double spendable rows) go through the shared point cache, the rest are per tx
+	std::atomic<bool> failed(false);
+	point_cache &pcache = point_cache::getInstance();
+	std::vector<mlsag_point> points(keys.size());
+	std::vector<std::shared_ptr<const point_cache::entry>> entries(keys.size());
+	std::vector<ge_p3> p3s(keys.size());
+	auto setup_points = [&](size_t start, size_t end) {
+		for(size_t k = start; k < end && !failed; ++k)
+		{
+			if(need_hi[k])
+			{
+				entries[k] = pcache.get(*keys[k]);
+				if(!entries[k])
+				{
+					MCERROR("verify", "Bad point in pk, or it hashed to point at infinity: " << *keys[k]);
+					failed = true;
+					continue;
+				}
+				points[k].P = &entries[k]->P;
+				points[k].Hi = entries[k]->Hi;
+			}
+			else
+			{
+				if(ge_frombytes_vartime(&p3s[k], keys[k]->bytes) != 0)
+				{
+					MCERROR("verify", "Bad point in pk: " << *keys[k]);
+					failed = true;
+					continue;
+				}
+				points[k].P = &p3s[k];
+				points[k].Hi = nullptr;
+			}
+		}
+	};
+	auto verify_ring = [&](size_t n) {
+		if(failed)
+			return;
+		try
+		{
+			std::vector<mlsag_point> pts(key_idx[n].size());
+			for(size_t e = 0; e < pts.size(); ++e)
+				pts[e] = points[key_idx[n][e]];
+			if(!MLSAG_Ver_ring(message, *pk[n], *rv[n], dsRows, pts))
+				failed = true;
+		}
+		catch(const std::exception &e)
+		{
+			LOG_PRINT_L1("Error in MLSAG_Ver: " << e.what());
+			failed = true;
+		}
+	};
+
+	if(pk.size() == 1)
+	{
+		setup_points(0, keys.size());
+		verify_ring(0);
+		return !failed;
+	}
+
+	tools::threadpool &tpool = tools::threadpool::getInstance();
+	tools::threadpool::waiter waiter;
+	const size_t threads = std::max<int>(1, tpool.get_max_concurrency());
+	const size_t chunk = (keys.size() + threads - 1) / threads;
+	for(size_t start = 0; start < keys.size(); start += chunk)
+		tpool.submit(&waiter, [&, start] { setup_points(start, std::min(start + chunk, keys.size())); });
+	waiter.wait();
+	if(failed)
+		return false;
+
+	for(size_t n = 0; n < pk.size(); ++n)
+		tpool.submit(&waiter, [&, n] { verify_ring(n); });
+	waiter.wait();
+	return !failed;
+}
+
 //proveRange and verRange
 //proveRange gives C, and mask such that \sumCi = C
 //   c.f. http://eprint.iacr.org/2015/1098 section 5.1
@@ -658,6 +794,18 @@ bool verRctMG(const mgSig &mg, const ctkeyM &pubs, const ctkeyV &outPk, key txnF
 //Ver:
 //This does a simplified version, assuming only post Rct
 //inputs
+static void getMGSimpleMatrix(keyM &M, const ctkeyV &pubs, const key &C)
+{
+	size_t cols = pubs.size();
+	M.assign(cols, keyV(2));
+	//create the matrix to mg sig
+	for(size_t i = 0; i < cols; i++)
+	{
+		M[i][0] = pubs[i].dest;
+		subKeys(M[i][1], pubs[i].mask, C);
+	}
+}
+
 bool verRctMGSimple(const key &message, const mgSig &mg, const ctkeyV &pubs, const key &C)
 {
 	try
@@ -665,17 +813,9 @@ bool verRctMGSimple(const key &message, const mgSig &mg, const ctkeyV &pubs, con
 		PERF_TIMER(verRctMGSimple);
 		//setup vars
 		size_t rows = 1;
-		size_t cols = pubs.size();
-		CHECK_AND_ASSERT_MES(cols >= 1, false, "Empty pubs");
-		keyV tmp(rows + 1);
-		size_t i;
-		keyM M(cols, tmp);
-		//create the matrix to mg sig
-		for(i = 0; i < cols; i++)
-		{
-			M[i][0] = pubs[i].dest;
-			subKeys(M[i][1], pubs[i].mask, C);
-		}
+		CHECK_AND_ASSERT_MES(pubs.size() >= 1, false, "Empty pubs");
+		keyM M;
+		getMGSimpleMatrix(M, pubs, C);
 		//DP(C);
 		return MLSAG_Ver(message, M, mg, rows);
 	}
@@ -913,9 +1053,37 @@ rctSig genRctSimple(const key &message, const ctkeyV &inSk, const keyV &destinat
 	key full_message = get_pre_mlsag_hash(rv, hwdev);
 	if(msout)
 		msout->c.resize(inamounts.size());
-	for(i = 0; i < inamounts.size(); i++)
+	// The inputs are signed independently, but hardware devices keep state across a signature, so only
+	// the software device signs them concurrently
+	tools::threadpool &tpool = tools::threadpool::getInstance();
+	if(&hwdev == &hw::get_device("default") && inamounts.size() > 1 && tpool.get_max_concurrency() > 1)
+	{
+		tools::threadpool::waiter waiter;
+		std::vector<std::exception_ptr> errors(inamounts.size());
+		for(i = 0; i < inamounts.size(); i++)
+		{
+			tpool.submit(&waiter, [&, i] {
+				try
+				{
+					rv.p.MGs[i] = proveRctMGSimple(full_message, rv.mixRing[i], inSk[i], a[i], pseudoOuts[i], kLRki ? &(*kLRki)[i] : NULL, msout ? &msout->c[i] : NULL, index[i], hwdev);
+				}
+				catch(...)
+				{
+					errors[i] = std::current_exception();
+				}
+			});
+		}
+		waiter.wait();
+		for(const std::exception_ptr &e : errors)
+			if(e)
+				std::rethrow_exception(e);
+	}
+	else
 	{
-		rv.p.MGs[i] = proveRctMGSimple(full_message, rv.mixRing[i], inSk[i], a[i], pseudoOuts[i], kLRki ? &(*kLRki)[i] : NULL, msout ? &msout->c[i] : NULL, index[i], hwdev);
+		for(i = 0; i < inamounts.size(); i++)
+		{
+			rv.p.MGs[i] = proveRctMGSimple(full_message, rv.mixRing[i], inSk[i], a[i], pseudoOuts[i], kLRki ? &(*kLRki)[i] : NULL, msout ? &msout->c[i] : NULL, index[i], hwdev);
+		}
 	}
 	return rv;
 }
@@ -1020,7 +1188,7 @@ bool verRctSemanticsSimple(const std::vector<const rctSig *> &rvv)
 		PERF_TIMER(verRctSemanticsSimple);
 
 		tools::threadpool &tpool = tools::threadpool::getInstance();
-		tools::threadpool::waiter waiter;
+		// declared before the waiter, whose dtor waits for the jobs writing into it
 		std::deque<bool> results;
 		std::vector<const Bulletproof *> proofs;
 		size_t max_non_bp_proofs = 0, offset = 0;
@@ -1047,16 +1215,6 @@ bool verRctSemanticsSimple(const std::vector<const rctSig *> &rvv)
 			}
 			CHECK_AND_ASSERT_MES(rv.outPk.size() == rv.ecdhInfo.size(), false, "Mismatched sizes of outPk and rv.ecdhInfo");
 
-			if(!bulletproof)
-				max_non_bp_proofs += rv.p.rangeSigs.size();
-		}
-
-		results.resize(max_non_bp_proofs);
-		for(const rctSig *rvp : rvv)
-		{
-			const rctSig &rv = *rvp;
-
-			const bool bulletproof = rv.type == RCTTypeBulletproof;
 			const keyV &pseudoOuts = bulletproof ? rv.p.pseudoOuts : rv.pseudoOuts;
 
 			rct::keyV masks(rv.outPk.size());
@@ -1079,7 +1237,17 @@ bool verRctSemanticsSimple(const std::vector<const rctSig *> &rvv)
 				return false;
 			}
 
-			if(bulletproof)
+			if(!bulletproof)
+				max_non_bp_proofs += rv.p.rangeSigs.size();
+		}
+
+		// every cheap check passed before any range proof job is submitted
+		tools::threadpool::waiter waiter;
+		results.resize(max_non_bp_proofs);
+		for(const rctSig *rvp : rvv)
+		{
+			const rctSig &rv = *rvp;
+			if(rv.type == RCTTypeBulletproof)
 			{
 				for(size_t i = 0; i < rv.p.bulletproofs.size(); i++)
 					proofs.push_back(&rv.p.bulletproofs[i]);
@@ -1087,17 +1255,18 @@ bool verRctSemanticsSimple(const std::vector<const rctSig *> &rvv)
 			else
 			{
 				for(size_t i = 0; i < rv.p.rangeSigs.size(); i++)
-					tpool.submit(&waiter, [&, i, offset] { results[i + offset] = verRange(rv.outPk[i].mask, rv.p.rangeSigs[i]); });
+					tpool.submit(&waiter, [&results, rvp, i, offset] { results[i + offset] = verRange(rvp->outPk[i].mask, rvp->p.rangeSigs[i]); });
 				offset += rv.p.rangeSigs.size();
 			}
 		}
-		if(!proofs.empty() && !verBulletproof(proofs))
+		const bool bulletproofs_ok = proofs.empty() || verBulletproof(proofs);
+		waiter.wait();
+		if(!bulletproofs_ok)
 		{
 			LOG_PRINT_L1("Aggregate range proof verified failed");
 			return false;
 		}
 
-		waiter.wait();
 		for(size_t i = 0; i < results.size(); ++i)
 		{
 			if(!results[i])
@@ -1127,6 +1296,43 @@ bool verRctSemanticsSimple(const rctSig &rv)
 	return verRctSemanticsSimple(std::vector<const rctSig *>(1, &rv));
 }
 
+static void verRctSemanticsSimpleBisect(const std::vector<const rctSig *> &rvv, size_t begin, size_t end, std::deque<bool> &results)
+{
+	if(verRctSemanticsSimple(std::vector<const rctSig *>(rvv.begin() + begin, rvv.begin() + end)))
+	{
+		for(size_t i = begin; i < end; ++i)
+			results[i] = true;
+		return;
+	}
+	if(end - begin == 1)
+		return;
+
+	LOG_PRINT_L1("Batched semantics check failed for " << end - begin << " rct sigs, bisecting");
+	const size_t middle = begin + (end - begin) / 2;
+	verRctSemanticsSimpleBisect(rvv, begin, middle, results);
+	verRctSemanticsSimpleBisect(rvv, middle, end, results);
+}
+
+void verRctSemanticsSimple(const std::vector<const rctSig *> &rvv, size_t batch_size, std::deque<bool> &results)
+{
+	PERF_TIMER(verRctSemanticsSimple_batches);
+
+	results.assign(rvv.size(), false);
+	if(batch_size == 0)
+		batch_size = 1;
+
+	// The last batch runs on the calling thread: jobs submitted from a pool thread run
+	// inline, so a lone batch on the pool could not split its multiexp over the pool
+	tools::threadpool &tpool = tools::threadpool::getInstance();
+	tools::threadpool::waiter waiter;
+	size_t i = 0;
+	for(; i + batch_size < rvv.size(); i += batch_size)
+		tpool.submit(&waiter, [&, i] { verRctSemanticsSimpleBisect(rvv, i, i + batch_size, results); });
+	if(i < rvv.size())
+		verRctSemanticsSimpleBisect(rvv, i, rvv.size(), results);
+	waiter.wait();
+}
+
 //ver RingCT simple
 //assumes only post-rct style inputs (at least for max anonymity)
 bool verRctNonSemanticsSimple(const rctSig &rv)
@@ -1143,9 +1349,9 @@ bool verRctNonSemanticsSimple(const rctSig &rv)
 		else
 			CHECK_AND_ASSERT_MES(rv.pseudoOuts.size() == rv.mixRing.size(), false, "Mismatched sizes of rv.pseudoOuts and mixRing");
 
-		const size_t threads = std::max(rv.outPk.size(), rv.mixRing.size());
+		CHECK_AND_ASSERT_MES(rv.p.MGs.size() == rv.mixRing.size(), false, "Mismatched sizes of rv.p.MGs and mixRing");
 
-		std::deque<bool> results(threads);
+		std::deque<bool> results(rv.mixRing.size());
 		tools::threadpool &tpool = tools::threadpool::getInstance();
 		tools::threadpool::waiter waiter;
 
@@ -1153,12 +1359,20 @@ bool verRctNonSemanticsSimple(const rctSig &rv)
 
 		const key message = get_pre_mlsag_hash(rv, hw::get_device("default"));
 
-		results.clear();
-		results.resize(rv.mixRing.size());
+		std::vector<keyM> M(rv.mixRing.size());
 		for(size_t i = 0; i < rv.mixRing.size(); i++)
 		{
 			tpool.submit(&waiter, [&, i] {
-				results[i] = verRctMGSimple(message, rv.p.MGs[i], rv.mixRing[i], pseudoOuts[i]);
+				try
+				{
+					results[i] = !rv.mixRing[i].empty();
+					if(results[i])
+						getMGSimpleMatrix(M[i], rv.mixRing[i], pseudoOuts[i]);
+				}
+				catch(...)
+				{
+					results[i] = false;
+				}
 			});
 		}
 		waiter.wait();
@@ -1167,11 +1381,24 @@ bool verRctNonSemanticsSimple(const rctSig &rv)
 		{
 			if(!results[i])
 			{
-				LOG_PRINT_L1("verRctMGSimple failed for input " << i);
+				LOG_PRINT_L1("Bad ring for input " << i);
 				return false;
 			}
 		}
 
+		std::vector<const keyM *> pks(M.size());
+		std::vector<const mgSig *> mgs(M.size());
+		for(size_t i = 0; i < M.size(); ++i)
+		{
+			pks[i] = &M[i];
+			mgs[i] = &rv.p.MGs[i];
+		}
+		if(!MLSAG_Ver(message, pks, mgs, 1))
+		{
+			LOG_PRINT_L1("MLSAG_Ver failed");
+			return false;
+		}
+
 		return true;
 	}
 	// we can get deep throws from ge_frombytes_vartime if input isn't valid
@@ -1214,7 +1441,7 @@ ryo_amount decodeRct(const rctSig &rv, const key &sk, unsigned int i, key &mask,
 	key Ctmp;
 	CHECK_AND_ASSERT_THROW_MES(sc_check(mask.bytes) == 0, "warning, bad ECDH mask");
 	CHECK_AND_ASSERT_THROW_MES(sc_check(amount.bytes) == 0, "warning, bad ECDH amount");
-	addKeys2(Ctmp, mask, amount, H);
+	addKeysGH(Ctmp, mask, amount);
 	DP("Ctmp");
 	DP(Ctmp);
 	if(equalKeys(C, Ctmp) == false)
@@ -1247,7 +1474,7 @@ ryo_amount decodeRctSimple(const rctSig &rv, const key &sk, unsigned int i, key
 	key Ctmp;
 	CHECK_AND_ASSERT_THROW_MES(sc_check(mask.bytes) == 0, "warning, bad ECDH mask");
 	CHECK_AND_ASSERT_THROW_MES(sc_check(amount.bytes) == 0, "warning, bad ECDH amount");
-	addKeys2(Ctmp, mask, amount, H);
+	addKeysGH(Ctmp, mask, amount);
 	DP("Ctmp");
 	DP(Ctmp);
 	if(equalKeys(C, Ctmp) == false)
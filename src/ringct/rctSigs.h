@@ -52,6 +52,7 @@
 #define RCTSIGS_H
 
 #include <cstddef>
+#include <deque>
 #include <tuple>
 #include <vector>
 
@@ -93,6 +94,9 @@ bool verifyBorromean(const boroSig &bb, const key64 P1, const key64 P2);
 // Ver verifies that the MG sig was created correctly
 mgSig MLSAG_Gen(const key &message, const keyM &pk, const keyV &xx, const multisig_kLRki *kLRki, key *mscout, const unsigned int index, size_t dsRows, hw::device &hwdev);
 bool MLSAG_Ver(const key &message, const keyM &pk, const mgSig &sig, size_t dsRows);
+// Verifies several MG sigs over the same message, each distinct key is decompressed and hashed to
+// a point only once; the rings are checked concurrently and checking stops at the first failure
+bool MLSAG_Ver(const key &message, const std::vector<const keyM *> &pk, const std::vector<const mgSig *> &sig, size_t dsRows);
 //mgSig MLSAG_Gen_Old(const keyM & pk, const keyV & xx, const int index);
 
 //proveRange and verRange
@@ -143,6 +147,9 @@ rctSig genRctSimple(const key & message, const ctkeyV & inSk, const keyV & desti
 bool verRct(const rctSig & rv, bool semantics);
 bool verRctSemanticsSimple(const rctSig & rv);
 bool verRctSemanticsSimple(const std::vector<const rctSig*> & rv);
+//   checks each rctSig on its own, verifying up to batch_size of them at once on the threadpool and
+//   bisecting failed batches; results[i] is the outcome for rv[i]
+void verRctSemanticsSimple(const std::vector<const rctSig*> & rv, size_t batch_size, std::deque<bool> & results);
 bool verRctNonSemanticsSimple(const rctSig & rv);
 ryo_amount decodeRct(const rctSig & rv, const key & sk, unsigned int i, key & mask, hw::device &hwdev);
 ryo_amount decodeRct(const rctSig & rv, const key & sk, unsigned int i, hw::device &hwdev);
@@ -98,7 +98,7 @@ void core_rpc_server::init_options(boost::program_options::options_description &
 //------------------------------------------------------------------------------------------------------------------------------
 core_rpc_server::core_rpc_server(
 	core &cr, nodetool::node_server<cryptonote::t_cryptonote_protocol_handler<cryptonote::core>> &p2p)
-	: m_core(cr), m_p2p(p2p)
+	: m_core(cr), m_p2p(p2p), m_longpoll_waiters(0)
 {
 }
 //------------------------------------------------------------------------------------------------------------------------------
@@ -1163,7 +1163,8 @@ bool core_rpc_server::on_getblocktemplate(const COMMAND_RPC_GETBLOCKTEMPLATE::re
 	block b = AUTO_VAL_INIT(b);
 	cryptonote::blobdata blob_reserve;
 	blob_reserve.resize(req.reserve_size, 0);
-	if(!m_core.get_block_template(b, info.address, res.difficulty, res.height, res.expected_reward, blob_reserve))
+	crypto::hash tree_root;
+	if(!m_core.get_block_template(b, info.address, res.difficulty, res.height, res.expected_reward, blob_reserve, tree_root))
 	{
 		error_resp.code = CORE_RPC_ERROR_CODE_INTERNAL_ERROR;
 		error_resp.message = "Internal error: failed to create block template";
@@ -1195,14 +1196,64 @@ bool core_rpc_server::on_getblocktemplate(const COMMAND_RPC_GETBLOCKTEMPLATE::re
 		LOG_ERROR("Failed to calculate offset for ");
 		return false;
 	}
-	blobdata hashing_blob = get_block_hashing_blob(b);
+	blobdata hashing_blob = get_block_hashing_blob(b, tree_root);
 	res.prev_hash = string_tools::pod_to_hex(b.prev_id);
 	res.blocktemplate_blob = string_tools::buff_to_hex_nodelimer(block_blob);
 	res.blockhashing_blob = string_tools::buff_to_hex_nodelimer(hashing_blob);
+	// the template only really changes with the parent block or the transactions in it
+	std::string longpoll_data(reinterpret_cast<const char *>(&b.prev_id), sizeof(b.prev_id));
+	for(const crypto::hash &tx_hash : b.tx_hashes)
+		longpoll_data.append(reinterpret_cast<const char *>(&tx_hash), sizeof(tx_hash));
+	res.longpoll_id = string_tools::pod_to_hex(crypto::cn_fast_hash(longpoll_data.data(), longpoll_data.size()));
 	res.status = CORE_RPC_STATUS_OK;
 	return true;
 }
 //------------------------------------------------------------------------------------------------------------------------------
+bool core_rpc_server::on_getblocktemplate_longpoll(const COMMAND_RPC_GETBLOCKTEMPLATE_LONGPOLL::request &req, COMMAND_RPC_GETBLOCKTEMPLATE_LONGPOLL::response &res, epee::json_rpc::error &error_resp)
+{
+	PERF_TIMER(on_getblocktemplate_longpoll);
+	bool r;
+	if(use_bootstrap_daemon_if_necessary<COMMAND_RPC_GETBLOCKTEMPLATE_LONGPOLL>(invoke_http_mode::JON_RPC, "getblocktemplate_longpoll", req, res, r))
+		return r;
+
+	COMMAND_RPC_GETBLOCKTEMPLATE::request template_req;
+	template_req.reserve_size = req.reserve_size;
+	template_req.wallet_address = req.wallet_address;
+
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(std::min<uint64_t>(req.timeout, GETBLOCKTEMPLATE_LONGPOLL_MAX_TIMEOUT));
+
+	// taken before the template is made so that a change while making it is not missed
+	uint64_t change_count = m_core.get_block_template_change_count();
+	if(!on_getblocktemplate(template_req, res, error_resp))
+		return false;
+	if(req.longpoll_id.empty() || res.longpoll_id != req.longpoll_id)
+		return true;
+
+	// a waiting long poll holds an RPC thread, so only a few may wait at once
+	if(m_longpoll_waiters.fetch_add(1) >= GETBLOCKTEMPLATE_LONGPOLL_MAX_WAITERS)
+	{
+		--m_longpoll_waiters;
+		error_resp.code = CORE_RPC_ERROR_CODE_CORE_BUSY;
+		error_resp.message = "Too many long polls waiting, use getblocktemplate instead";
+		return false;
+	}
+	epee::misc_utils::auto_scope_leave_caller waiter_release = epee::misc_utils::create_scope_leave_handler([this]() { --m_longpoll_waiters; });
+
+	while(true)
+	{
+		const auto now = std::chrono::steady_clock::now();
+		if(now >= deadline)
+			return true;
+		m_core.wait_block_template_change(change_count, std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count());
+
+		change_count = m_core.get_block_template_change_count();
+		if(!on_getblocktemplate(template_req, res, error_resp))
+			return false;
+		if(res.longpoll_id != req.longpoll_id)
+			return true;
+	}
+}
+//------------------------------------------------------------------------------------------------------------------------------
 bool core_rpc_server::on_submitblock(const COMMAND_RPC_SUBMITBLOCK::request &req, COMMAND_RPC_SUBMITBLOCK::response &res, epee::json_rpc::error &error_resp)
 {
 	PERF_TIMER(on_submitblock);
@@ -46,6 +46,8 @@
 
 #pragma once
 
+#include <atomic>
+
 #include <boost/program_options/options_description.hpp>
 #include <boost/program_options/variables_map.hpp>
 
@@ -137,6 +139,8 @@ class core_rpc_server : public epee::http_server_impl_base<core_rpc_server>
 	MAP_JON_RPC_WE("on_getblockhash", on_getblockhash, COMMAND_RPC_GETBLOCKHASH)
 	MAP_JON_RPC_WE("get_block_template", on_getblocktemplate, COMMAND_RPC_GETBLOCKTEMPLATE)
 	MAP_JON_RPC_WE("getblocktemplate", on_getblocktemplate, COMMAND_RPC_GETBLOCKTEMPLATE)
+	MAP_JON_RPC_WE_IF("get_block_template_longpoll", on_getblocktemplate_longpoll, COMMAND_RPC_GETBLOCKTEMPLATE_LONGPOLL, !m_restricted)
+	MAP_JON_RPC_WE_IF("getblocktemplate_longpoll", on_getblocktemplate_longpoll, COMMAND_RPC_GETBLOCKTEMPLATE_LONGPOLL, !m_restricted)
 	MAP_JON_RPC_WE("submit_block", on_submitblock, COMMAND_RPC_SUBMITBLOCK)
 	MAP_JON_RPC_WE("submitblock", on_submitblock, COMMAND_RPC_SUBMITBLOCK)
 	MAP_JON_RPC_WE("get_last_block_header", on_get_last_block_header, COMMAND_RPC_GET_LAST_BLOCK_HEADER)
@@ -202,6 +206,7 @@ class core_rpc_server : public epee::http_server_impl_base<core_rpc_server>
 	bool on_getblockcount(const COMMAND_RPC_GETBLOCKCOUNT::request &req, COMMAND_RPC_GETBLOCKCOUNT::response &res);
 	bool on_getblockhash(const COMMAND_RPC_GETBLOCKHASH::request &req, COMMAND_RPC_GETBLOCKHASH::response &res, epee::json_rpc::error &error_resp);
 	bool on_getblocktemplate(const COMMAND_RPC_GETBLOCKTEMPLATE::request &req, COMMAND_RPC_GETBLOCKTEMPLATE::response &res, epee::json_rpc::error &error_resp);
+	bool on_getblocktemplate_longpoll(const COMMAND_RPC_GETBLOCKTEMPLATE_LONGPOLL::request &req, COMMAND_RPC_GETBLOCKTEMPLATE_LONGPOLL::response &res, epee::json_rpc::error &error_resp);
 	bool on_submitblock(const COMMAND_RPC_SUBMITBLOCK::request &req, COMMAND_RPC_SUBMITBLOCK::response &res, epee::json_rpc::error &error_resp);
 	bool on_get_last_block_header(const COMMAND_RPC_GET_LAST_BLOCK_HEADER::request &req, COMMAND_RPC_GET_LAST_BLOCK_HEADER::response &res, epee::json_rpc::error &error_resp);
 	bool on_get_block_header_by_hash(const COMMAND_RPC_GET_BLOCK_HEADER_BY_HASH::request &req, COMMAND_RPC_GET_BLOCK_HEADER_BY_HASH::response &res, epee::json_rpc::error &error_resp);
@@ -250,6 +255,7 @@ class core_rpc_server : public epee::http_server_impl_base<core_rpc_server>
 	bool m_was_bootstrap_ever_used;
 	network_type m_nettype;
 	bool m_restricted;
+	std::atomic<unsigned> m_longpoll_waiters;
 };
 }
 
@@ -57,6 +57,10 @@ namespace cryptonote
 #define CORE_RPC_STATUS_BUSY "BUSY"
 #define CORE_RPC_STATUS_NOT_MINING "NOT MINING"
 
+#define GETBLOCKTEMPLATE_LONGPOLL_MAX_TIMEOUT 60
+// the daemon serves RPC on two threads, a waiting long poll holds one of them
+#define GETBLOCKTEMPLATE_LONGPOLL_MAX_WAITERS 1
+
 // When making *any* change here, bump minor
 // If the change is incompatible, then bump major and set minor to 0
 // This ensures CORE_RPC_VERSION always increases, that every change
@@ -65,7 +69,7 @@ namespace cryptonote
 // advance which version they will stop working with
 // Don't go over 32767 for any of these
 #define CORE_RPC_VERSION_MAJOR 1
-#define CORE_RPC_VERSION_MINOR 19
+#define CORE_RPC_VERSION_MINOR 20
 #define MAKE_CORE_RPC_VERSION(major, minor) (((major) << 16) | (minor))
 #define CORE_RPC_VERSION MAKE_CORE_RPC_VERSION(CORE_RPC_VERSION_MAJOR, CORE_RPC_VERSION_MINOR)
 
@@ -1122,6 +1126,7 @@ struct COMMAND_RPC_GETBLOCKTEMPLATE
 		std::string prev_hash;
 		blobdata blocktemplate_blob;
 		blobdata blockhashing_blob;
+		std::string longpoll_id;
 		std::string status;
 		bool untrusted;
 
@@ -1133,12 +1138,33 @@ struct COMMAND_RPC_GETBLOCKTEMPLATE
 		KV_SERIALIZE(prev_hash)
 		KV_SERIALIZE(blocktemplate_blob)
 		KV_SERIALIZE(blockhashing_blob)
+		KV_SERIALIZE(longpoll_id)
 		KV_SERIALIZE(status)
 		KV_SERIALIZE(untrusted)
 		END_KV_SERIALIZE_MAP()
 	};
 };
 
+struct COMMAND_RPC_GETBLOCKTEMPLATE_LONGPOLL
+{
+	struct request
+	{
+		uint64_t reserve_size; //max 255 bytes
+		std::string wallet_address;
+		std::string longpoll_id; // from the template the caller already has, empty to return at once
+		uint64_t timeout;		 // seconds, at most GETBLOCKTEMPLATE_LONGPOLL_MAX_TIMEOUT
+
+		BEGIN_KV_SERIALIZE_MAP()
+		KV_SERIALIZE(reserve_size)
+		KV_SERIALIZE(wallet_address)
+		KV_SERIALIZE(longpoll_id)
+		KV_SERIALIZE_OPT(timeout, (uint64_t)GETBLOCKTEMPLATE_LONGPOLL_MAX_TIMEOUT)
+		END_KV_SERIALIZE_MAP()
+	};
+
+	typedef COMMAND_RPC_GETBLOCKTEMPLATE::response response;
+};
+
 struct COMMAND_RPC_SUBMITBLOCK
 {
 	typedef std::vector<std::string> request;
@@ -604,6 +604,39 @@ uint32_t get_subaddress_clamped_sum(uint32_t idx, uint32_t extra)
 	return idx + extra;
 }
 
+// Calls build(i) for every i < count, on the threadpool if parallel is set, the first exception is rethrown
+template <typename F>
+void build_txes(size_t count, bool parallel, const F &build)
+{
+	if(!parallel || count < 2 || tools::threadpool::getInstance().get_max_concurrency() < 2)
+	{
+		for(size_t i = 0; i < count; ++i)
+			build(i);
+		return;
+	}
+
+	tools::threadpool &tpool = tools::threadpool::getInstance();
+	tools::threadpool::waiter waiter;
+	std::vector<std::exception_ptr> errors(count);
+	for(size_t i = 0; i < count; ++i)
+	{
+		tpool.submit(&waiter, [&build, &errors, i] {
+			try
+			{
+				build(i);
+			}
+			catch(...)
+			{
+				errors[i] = std::current_exception();
+			}
+		});
+	}
+	waiter.wait();
+	for(const std::exception_ptr &e : errors)
+		if(e)
+			std::rethrow_exception(e);
+}
+
 //-----------------------------------------------------------------
 } //namespace
 
@@ -1139,13 +1172,15 @@ void wallet2::process_new_transaction(const crypto::hash &txid, const cryptonote
 		// additional tx pubkeys and derivations for multi-destination transfers involving one or more subaddresses
 		additional_tx_pub_keys = get_additional_tx_pub_keys_from_extra(tx);
 
-		for(size_t i = 0; i < additional_tx_pub_keys.size(); ++i)
+		std::vector<bool> additional_valid;
+		if(!hwdev.generate_key_derivations(additional_tx_pub_keys, keys.m_view_secret_key, additional_derivations, additional_valid))
 		{
-			additional_derivations.push_back({});
-			if(!hwdev.generate_key_derivation(additional_tx_pub_keys[i], keys.m_view_secret_key, additional_derivations.back()))
+			for(size_t i = additional_tx_pub_keys.size(); i-- > 0;)
 			{
+				if(additional_valid[i])
+					continue;
 				MWARNING("Failed to generate key derivation from tx pubkey, skipping");
-				additional_derivations.pop_back();
+				additional_derivations.erase(additional_derivations.begin() + i);
 			}
 		}
 
@@ -6977,9 +7012,10 @@ std::vector<wallet2::pending_tx> wallet2::create_transactions_2(std::vector<cryp
 	LOG_PRINT_L1("Done creating " << txes.size() << " transactions, " << print_money(accumulated_fee) << " total fee, " << print_money(accumulated_change) << " total change");
 
 	hwdev.set_mode(hw::device::TRANSACTION_CREATE_REAL);
-	for(std::vector<TX>::iterator i = txes.begin(); i != txes.end(); ++i)
-	{
-		TX &tx = *i;
+	// The txes are independent, so they can be built concurrently when the device has no per-tx state
+	const bool parallel = can_build_txes_in_parallel() && std::all_of(txes.begin(), txes.end(), [](const TX &tx) { return !tx.outs.empty(); });
+	build_txes(txes.size(), parallel, [&](size_t n) {
+		TX &tx = txes[n];
 		cryptonote::transaction test_tx;
 		pending_tx test_ptx;
 		transfer_selected_rct(tx.dsts,				 /* NOMOD std::vector<cryptonote::tx_destination_entry> dsts,*/
@@ -6996,7 +7032,7 @@ std::vector<wallet2::pending_tx> wallet2::create_transactions_2(std::vector<cryp
 		tx.tx = test_tx;
 		tx.ptx = test_ptx;
 		tx.bytes = txBlob.size();
-	}
+	});
 
 	std::vector<wallet2::pending_tx> ptx_vector;
 	for(std::vector<TX>::iterator i = txes.begin(); i != txes.end(); ++i)
@@ -7212,9 +7248,9 @@ std::vector<wallet2::pending_tx> wallet2::create_transactions_from(const crypton
 	LOG_PRINT_L1("Done creating " << txes.size() << " transactions, " << print_money(accumulated_fee) << " total fee, " << print_money(accumulated_change) << " total change");
 
 	hwdev.set_mode(hw::device::TRANSACTION_CREATE_REAL);
-	for(std::vector<TX>::iterator i = txes.begin(); i != txes.end(); ++i)
-	{
-		TX &tx = *i;
+	const bool parallel = can_build_txes_in_parallel() && std::all_of(txes.begin(), txes.end(), [](const TX &tx) { return !tx.outs.empty(); });
+	build_txes(txes.size(), parallel, [&](size_t n) {
+		TX &tx = txes[n];
 		cryptonote::transaction test_tx;
 		pending_tx test_ptx;
 		transfer_selected_rct(tx.dsts, tx.selected_transfers, fake_outs_count, tx.outs, unlock_time, tx.fee, payment_id,
@@ -7223,7 +7259,7 @@ std::vector<wallet2::pending_tx> wallet2::create_transactions_from(const crypton
 		tx.tx = test_tx;
 		tx.ptx = test_ptx;
 		tx.bytes = txBlob.size();
-	}
+	});
 
 	std::vector<wallet2::pending_tx> ptx_vector;
 	for(std::vector<TX>::iterator i = txes.begin(); i != txes.end(); ++i)
@@ -7267,6 +7303,12 @@ bool wallet2::use_fork_rules(cryptonote::hard_fork_feature ft, int64_t early_blo
 	return close_enough;
 }
 //----------------------------------------------------------------------------------------------------
+bool wallet2::can_build_txes_in_parallel() const
+{
+	// Multisig txes share state through the wallet, and hardware devices keep state across a tx
+	return !m_multisig && &m_account.get_device() == &hw::get_device("default");
+}
+//----------------------------------------------------------------------------------------------------
 uint64_t wallet2::get_upper_transaction_size_limit() const
 {
 	if(m_upper_transaction_size_limit > 0)
@@ -8692,12 +8734,9 @@ uint64_t wallet2::import_key_images(const std::vector<std::pair<crypto::key_imag
 		THROW_WALLET_EXCEPTION_IF(!r, error::wallet_internal_error, "Failed to generate key derivation");
 		const std::vector<crypto::public_key> additional_tx_pub_keys = get_additional_tx_pub_keys_from_extra(spent_tx);
 		std::vector<crypto::key_derivation> additional_derivations;
-		for(size_t i = 0; i < additional_tx_pub_keys.size(); ++i)
-		{
-			additional_derivations.push_back({});
-			r = hwdev.generate_key_derivation(additional_tx_pub_keys[i], keys.m_view_secret_key, additional_derivations.back());
-			THROW_WALLET_EXCEPTION_IF(!r, error::wallet_internal_error, "Failed to generate key derivation");
-		}
+		std::vector<bool> additional_valid;
+		r = hwdev.generate_key_derivations(additional_tx_pub_keys, keys.m_view_secret_key, additional_derivations, additional_valid);
+		THROW_WALLET_EXCEPTION_IF(!r, error::wallet_internal_error, "Failed to generate key derivation");
 		size_t output_index = 0;
 		for(const cryptonote::tx_out &out : spent_tx.vout)
 		{
@@ -1113,6 +1113,7 @@ class wallet2
 	void check_acc_out_precomp_once(const cryptonote::tx_out &o, const crypto::key_derivation &derivation, const std::vector<crypto::key_derivation> &additional_derivations, size_t i, tx_scan_info_t &tx_scan_info, bool &already_seen) const;
 	void check_acc_out_precomp(const cryptonote::tx_out &o, const crypto::key_derivation &derivation, const std::vector<crypto::key_derivation> &additional_derivations, size_t i, tx_scan_info_t &tx_scan_info) const;
 	void parse_block_round(const cryptonote::blobdata &blob, cryptonote::block &bl, crypto::hash &bl_id, bool &error) const;
+	bool can_build_txes_in_parallel() const;
 	uint64_t get_upper_transaction_size_limit() const;
 	std::vector<uint64_t> get_unspent_amounts_vector() const;
 	float get_output_relatedness(const transfer_details &td0, const transfer_details &td1) const;
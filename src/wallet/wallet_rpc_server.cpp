@@ -53,6 +53,7 @@ using namespace epee;
 
 #include "common/command_line.h"
 #include "common/i18n.h"
+#include "common/util.h"
 #include "crypto/hash.h"
 #include "cryptonote_basic/account.h"
 #include "cryptonote_basic/cryptonote_format_utils.h"
@@ -60,6 +61,7 @@ using namespace epee;
 #include "misc_language.h"
 #include "mnemonics/electrum-words.h"
 #include "multisig/multisig.h"
+#include "ringct/multiexp.h"
 #include "rpc/core_rpc_server_commands_defs.h"
 #include "rpc/rpc_args.h"
 #include "string_coding.h"
@@ -3010,6 +3012,11 @@ int main(int argc, char **argv)
 		return vm_error_code;
 	}
 
+	// share the bulletproof tables with the daemon and other wallets on this host
+	const boost::filesystem::path data_dir = tools::get_default_data_dir();
+	if(boost::filesystem::is_directory(data_dir))
+		rct::multiexp_cache::set_cache_file((data_dir / MULTIEXP_TABLES_FILENAME).string());
+
 	cryptonote::network_type net_type = cryptonote::UNDEFINED;
 	std::unique_ptr<tools::wallet2> wal;
 	try
@@ -193,6 +193,11 @@ bool tests::proxy_core::handle_incoming_txs(const std::list<blobdata> &tx_blobs,
 	return true;
 }
 
+bool tests::proxy_core::handle_incoming_relayed_txs(const std::list<blobdata> &tx_blobs, std::vector<tx_verification_context> &tvc)
+{
+	return handle_incoming_txs(tx_blobs, tvc, false, true, false);
+}
+
 bool tests::proxy_core::handle_incoming_block(const cryptonote::blobdata &block_blob, cryptonote::block_verification_context &bvc, bool update_miner_blocktemplate)
 {
 	block b = AUTO_VAL_INIT(b);
@@ -0,0 +1,186 @@
+// Copyright (c) 2019, Ryo Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2020
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "block_template.h"
+
+#include <algorithm>
+
+using namespace cryptonote;
+
+namespace
+{
+const uint64_t LONGPOLL_TIMEOUT_MS = 60000;
+
+bool has_tx(const block &b, const crypto::hash &tx_hash)
+{
+	return std::find(b.tx_hashes.begin(), b.tx_hashes.end(), tx_hash) != b.tx_hashes.end();
+}
+}
+
+gen_block_template_cache::gen_block_template_cache()
+	: m_longpoll_changed(false)
+{
+	m_miner.generate_new(false);
+	REGISTER_CALLBACK_METHOD(gen_block_template_cache, check_template_cached);
+	REGISTER_CALLBACK_METHOD(gen_block_template_cache, start_longpoll);
+	REGISTER_CALLBACK_METHOD(gen_block_template_cache, check_longpoll_returned);
+	REGISTER_CALLBACK_METHOD(gen_block_template_cache, check_tx_removed);
+}
+
+gen_block_template_cache::~gen_block_template_cache()
+{
+	// the core wakes up waiters when it stops, should a check have failed before the join
+	if(m_longpoll.joinable())
+		m_longpoll.join();
+}
+
+bool gen_block_template_cache::generate(std::vector<test_event_entry> &events) const
+{
+	rct_chain chain;
+	if(!generate_rct_chain(events, chain))
+		return false;
+
+	const int mixin = 2;
+	const int out_idx[] = {1, -1};
+	const uint64_t amount_paid = 10000;
+	transaction tx;
+	if(!construct_rct_spend(chain, out_idx, mixin, amount_paid, 0, NULL, tx))
+		return false;
+
+	DO_CALLBACK(events, "check_template_cached");
+	DO_CALLBACK(events, "start_longpoll");
+	events.push_back(tx);
+	DO_CALLBACK(events, "check_longpoll_returned");
+	DO_CALLBACK(events, "check_tx_removed");
+
+	return true;
+}
+
+bool gen_block_template_cache::make_template(cryptonote::core &c, const blobdata &ex_nonce, block &b) const
+{
+	difficulty_type diffic;
+	uint64_t height, expected_reward;
+	crypto::hash tree_root;
+	CHECK_AND_ASSERT_MES(c.get_block_template(b, m_miner.get_keys().m_account_address, diffic, height, expected_reward, ex_nonce, tree_root), false, "Failed to create block template");
+
+	// the tree of a cached template is only patched for the new miner tx, it must still match
+	CHECK_AND_ASSERT_MES(tree_root == get_tx_tree_hash(b), false, "Block template tree root does not match its txs");
+	return true;
+}
+
+bool gen_block_template_cache::check_template_cached(cryptonote::core &c, size_t ev_index, const std::vector<test_event_entry> &events)
+{
+	DEFINE_TESTS_ERROR_CONTEXT("gen_block_template_cache::check_template_cached");
+
+	const blobdata nonce_a(8, 'a'), nonce_b(8, 'b');
+	block b1, b2, b3;
+	CHECK_TEST_CONDITION(make_template(c, nonce_a, b1));
+	CHECK_TEST_CONDITION(make_template(c, nonce_a, b2));
+	CHECK_EQ(b1.prev_id, c.get_tail_id());
+	CHECK_TEST_CONDITION(b1.tx_hashes.empty());
+
+	// served from the cache, down to the random tx key of the miner tx
+	CHECK_EQ(get_transaction_hash(b1.miner_tx), get_transaction_hash(b2.miner_tx));
+
+	// another extra nonce only gets a new miner tx
+	CHECK_TEST_CONDITION(make_template(c, nonce_b, b3));
+	CHECK_NOT_EQ(get_transaction_hash(b1.miner_tx), get_transaction_hash(b3.miner_tx));
+	CHECK_EQ(b1.prev_id, b3.prev_id);
+	CHECK_EQ(b1.tx_hashes.size(), b3.tx_hashes.size());
+
+	// with nothing changing, a long poll runs into its timeout
+	CHECK_TEST_CONDITION(!c.wait_block_template_change(c.get_block_template_change_count(), 10));
+
+	return true;
+}
+
+bool gen_block_template_cache::start_longpoll(cryptonote::core &c, size_t ev_index, const std::vector<test_event_entry> &events)
+{
+	DEFINE_TESTS_ERROR_CONTEXT("gen_block_template_cache::start_longpoll");
+
+	const uint64_t change_count = c.get_block_template_change_count();
+	m_longpoll = boost::thread([this, &c, change_count]() {
+		m_longpoll_changed = c.wait_block_template_change(change_count, LONGPOLL_TIMEOUT_MS);
+	});
+
+	return true;
+}
+
+bool gen_block_template_cache::check_longpoll_returned(cryptonote::core &c, size_t ev_index, const std::vector<test_event_entry> &events)
+{
+	DEFINE_TESTS_ERROR_CONTEXT("gen_block_template_cache::check_longpoll_returned");
+
+	// adding the tx to the pool woke up the long poll before its timeout
+	const auto start = boost::chrono::steady_clock::now();
+	m_longpoll.join();
+	CHECK_TEST_CONDITION(m_longpoll_changed);
+	CHECK_TEST_CONDITION(boost::chrono::steady_clock::now() - start < boost::chrono::milliseconds(LONGPOLL_TIMEOUT_MS / 2));
+
+	// and the new pool cookie makes the next template pick the tx up
+	const crypto::hash tx_hash = get_transaction_hash(boost::get<transaction>(events[ev_index - 1]));
+	block b;
+	CHECK_TEST_CONDITION(make_template(c, blobdata(8, 'a'), b));
+	CHECK_TEST_CONDITION(has_tx(b, tx_hash));
+
+	return true;
+}
+
+bool gen_block_template_cache::check_tx_removed(cryptonote::core &c, size_t ev_index, const std::vector<test_event_entry> &events)
+{
+	DEFINE_TESTS_ERROR_CONTEXT("gen_block_template_cache::check_tx_removed");
+
+	const crypto::hash tx_hash = get_transaction_hash(boost::get<transaction>(events[ev_index - 2]));
+	block b1, b2;
+	CHECK_TEST_CONDITION(make_template(c, blobdata(8, 'a'), b1));
+	CHECK_TEST_CONDITION(has_tx(b1, tx_hash));
+
+	// removing the tx from the pool changes the cookie too, the template drops it
+	const uint64_t change_count = c.get_block_template_change_count();
+	CHECK_TEST_CONDITION(c.get_blockchain_storage().flush_txes_from_pool(std::list<crypto::hash>{tx_hash}));
+	CHECK_NOT_EQ(c.get_block_template_change_count(), change_count);
+	CHECK_TEST_CONDITION(make_template(c, blobdata(8, 'a'), b2));
+	CHECK_TEST_CONDITION(!has_tx(b2, tx_hash));
+	CHECK_EQ(b1.prev_id, b2.prev_id);
+
+	return true;
+}
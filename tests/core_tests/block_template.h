@@ -0,0 +1,75 @@
+// Copyright (c) 2019, Ryo Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2020
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <boost/thread/thread.hpp>
+
+#include "chaingen.h"
+#include "rct.h"
+
+// block templates are served from the cache until the pool or the top block changes,
+// and a long poll waiting for a new template wakes up when a tx enters the pool
+struct gen_block_template_cache : public gen_rct_tx_validation_base
+{
+	gen_block_template_cache();
+	~gen_block_template_cache();
+
+	bool generate(std::vector<test_event_entry> &events) const;
+
+	bool check_template_cached(cryptonote::core &c, size_t ev_index, const std::vector<test_event_entry> &events);
+	bool start_longpoll(cryptonote::core &c, size_t ev_index, const std::vector<test_event_entry> &events);
+	bool check_longpoll_returned(cryptonote::core &c, size_t ev_index, const std::vector<test_event_entry> &events);
+	bool check_tx_removed(cryptonote::core &c, size_t ev_index, const std::vector<test_event_entry> &events);
+
+  private:
+	bool make_template(cryptonote::core &c, const cryptonote::blobdata &ex_nonce, cryptonote::block &b) const;
+
+	cryptonote::account_base m_miner;
+	boost::thread m_longpoll;
+	bool m_longpoll_changed;
+};
+template <>
+struct get_test_options<gen_block_template_cache> : public get_test_options<gen_rct_tx_validation_base>
+{
+};
@@ -46,7 +46,7 @@ bool lift_up_difficulty(std::vector<test_event_entry> &events, std::vector<uint6
 	for(size_t i = 0; i < new_block_count; ++i)
 	{
 		block blk_next;
-		difficulty_type diffic = next_difficulty_v1(timestamps, cummulative_difficulties, common_config::DIFFICULTY_TARGET);
+		difficulty_type diffic = next_difficulty_v1(epee::to_span(timestamps), epee::to_span(cummulative_difficulties), common_config::DIFFICULTY_TARGET);
 		if(!generator.construct_block_manually(blk_next, blk_prev, miner_account,
 											   test_generator::bf_timestamp | test_generator::bf_diffic, 0, 0, blk_prev.timestamp, crypto::hash(), diffic))
 			return false;
@@ -176,7 +176,7 @@ bool gen_block_invalid_nonce::generate(std::vector<test_event_entry> &events) co
 		return false;
 
 	// Create invalid nonce
-	difficulty_type diffic = next_difficulty_v1(timestamps, commulative_difficulties, common_config::DIFFICULTY_TARGET);
+	difficulty_type diffic = next_difficulty_v1(epee::to_span(timestamps), epee::to_span(commulative_difficulties), common_config::DIFFICULTY_TARGET);
 	assert(1 < diffic);
 	const block &blk_last = boost::get<block>(events.back());
 	uint64_t timestamp = blk_last.timestamp;
@@ -572,7 +572,7 @@ bool gen_block_invalid_binary_format::generate(std::vector<test_event_entry> &ev
 	do
 	{
 		blk_last = boost::get<block>(events.back());
-		diffic = next_difficulty_v1(timestamps, cummulative_difficulties, common_config::DIFFICULTY_TARGET);
+		diffic = next_difficulty_v1(epee::to_span(timestamps), epee::to_span(cummulative_difficulties), common_config::DIFFICULTY_TARGET);
 		if(!lift_up_difficulty(events, timestamps, cummulative_difficulties, generator, 1, blk_last, miner_account))
 			return false;
 		std::cout << "Block #" << events.size() << ", difficulty: " << diffic << std::endl;
@@ -586,7 +586,7 @@ bool gen_block_invalid_binary_format::generate(std::vector<test_event_entry> &ev
 	std::vector<crypto::hash> tx_hashes;
 	tx_hashes.push_back(get_transaction_hash(tx_0));
 	size_t txs_size = get_object_blobsize(tx_0);
-	diffic = next_difficulty_v1(timestamps, cummulative_difficulties, common_config::DIFFICULTY_TARGET);
+	diffic = next_difficulty_v1(epee::to_span(timestamps), epee::to_span(cummulative_difficulties), common_config::DIFFICULTY_TARGET);
 	if(!generator.construct_block_manually(blk_test, blk_last, miner_account,
 										   test_generator::bf_diffic | test_generator::bf_timestamp | test_generator::bf_tx_hashes, 0, 0, blk_last.timestamp,
 										   crypto::hash(), diffic, transaction(), tx_hashes, txs_size))
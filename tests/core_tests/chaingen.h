@@ -104,14 +104,17 @@ struct event_visitor_settings
 {
 	int valid_mask;
 	bool txs_keeped_by_block;
+	bool sync_span;
 
 	enum settings
 	{
-		set_txs_keeped_by_block = 1 << 0
+		set_txs_keeped_by_block = 1 << 0,
+		// the blocks and txs up to the next sync_span = false come in as one synced span
+		set_sync_span = 1 << 1
 	};
 
-	event_visitor_settings(int a_valid_mask = 0, bool a_txs_keeped_by_block = false)
-		: valid_mask(a_valid_mask), txs_keeped_by_block(a_txs_keeped_by_block)
+	event_visitor_settings(int a_valid_mask = 0, bool a_txs_keeped_by_block = false, bool a_sync_span = false)
+		: valid_mask(a_valid_mask), txs_keeped_by_block(a_txs_keeped_by_block), sync_span(a_sync_span)
 	{
 	}
 
@@ -123,6 +126,7 @@ struct event_visitor_settings
 	{
 		ar &valid_mask;
 		ar &txs_keeped_by_block;
+		ar &sync_span;
 	}
 };
 
@@ -291,10 +295,12 @@ struct push_core_event_visitor : public boost::static_visitor<bool>
 	size_t m_ev_index;
 
 	bool m_txs_keeped_by_block;
+	bool m_sync_span;
+	mutable std::vector<size_t> m_span_events;
 
   public:
 	push_core_event_visitor(cryptonote::core &c, const std::vector<test_event_entry> &events, t_test_class &validator)
-		: m_c(c), m_events(events), m_validator(validator), m_ev_index(0), m_txs_keeped_by_block(false)
+		: m_c(c), m_events(events), m_validator(validator), m_ev_index(0), m_txs_keeped_by_block(false), m_sync_span(false)
 	{
 	}
 
@@ -312,12 +318,27 @@ struct push_core_event_visitor : public boost::static_visitor<bool>
 			m_txs_keeped_by_block = settings.txs_keeped_by_block;
 		}
 
+		if(settings.valid_mask & event_visitor_settings::set_sync_span)
+		{
+			bool r = true;
+			if(m_sync_span && !settings.sync_span)
+				r = sync_span();
+			m_sync_span = settings.sync_span;
+			m_span_events.clear();
+			return r;
+		}
+
 		return true;
 	}
 
 	bool operator()(const cryptonote::transaction &tx) const
 	{
 		log_event("cryptonote::transaction");
+		if(m_sync_span)
+		{
+			m_span_events.push_back(m_ev_index);
+			return true;
+		}
 
 		cryptonote::tx_verification_context tvc = AUTO_VAL_INIT(tvc);
 		size_t pool_size = m_c.get_pool_transactions_count();
@@ -331,6 +352,11 @@ struct push_core_event_visitor : public boost::static_visitor<bool>
 	bool operator()(const cryptonote::block &b) const
 	{
 		log_event("cryptonote::block");
+		if(m_sync_span)
+		{
+			m_span_events.push_back(m_ev_index);
+			return true;
+		}
 
 		cryptonote::block_verification_context bvc = AUTO_VAL_INIT(bvc);
 		m_c.handle_incoming_block(t_serializable_object_to_blob(b), bvc);
@@ -342,6 +368,11 @@ struct push_core_event_visitor : public boost::static_visitor<bool>
 	bool operator()(const callback_entry &cb) const
 	{
 		log_event(std::string("callback_entry ") + cb.callback_name);
+		if(m_sync_span)
+		{
+			m_span_events.push_back(m_ev_index);
+			return true;
+		}
 		return m_validator.verify(cb.callback_name, m_c, m_ev_index, m_events);
 	}
 
@@ -401,6 +432,94 @@ struct push_core_event_visitor : public boost::static_visitor<bool>
 	{
 		MGINFO_YELLOW("=== EVENT # " << m_ev_index << ": " << event_type);
 	}
+
+	// Adds the buffered span the way the protocol handler adds a downloaded span. Callbacks in
+	// the span run once it is prepared, before any of its blocks is added. Like the handler, the
+	// rest of the span is dropped after the first block (or tx of a block) that fails.
+	bool sync_span() const
+	{
+		std::unordered_map<crypto::hash, size_t> tx_events;
+		for(size_t idx : m_span_events)
+		{
+			if(typeid(cryptonote::transaction) == m_events[idx].type())
+				tx_events[cryptonote::get_transaction_hash(boost::get<cryptonote::transaction>(m_events[idx]))] = idx;
+		}
+
+		std::list<cryptonote::block_complete_entry> entries;
+		std::vector<size_t> block_events;
+		for(size_t idx : m_span_events)
+		{
+			if(typeid(cryptonote::block) != m_events[idx].type())
+				continue;
+			const cryptonote::block &b = boost::get<cryptonote::block>(m_events[idx]);
+			cryptonote::block_complete_entry entry;
+			entry.block = t_serializable_object_to_blob(b);
+			for(const crypto::hash &tx_hash : b.tx_hashes)
+			{
+				auto it = tx_events.find(tx_hash);
+				CHECK_AND_ASSERT_MES(it != tx_events.end(), false, "tx " << tx_hash << " of a span block is not in the span");
+				entry.txs.push_back(t_serializable_object_to_blob(boost::get<cryptonote::transaction>(m_events[it->second])));
+			}
+			entries.push_back(std::move(entry));
+			block_events.push_back(idx);
+		}
+
+		MGINFO_YELLOW("=== SYNC SPAN of " << entries.size() << " blocks");
+		m_c.prepare_handle_incoming_blocks(entries);
+
+		for(size_t idx : m_span_events)
+		{
+			if(typeid(callback_entry) != m_events[idx].type())
+				continue;
+			if(!m_validator.verify(boost::get<callback_entry>(m_events[idx]).callback_name, m_c, idx, m_events))
+			{
+				m_c.cleanup_handle_incoming_blocks();
+				return false;
+			}
+		}
+
+		bool r = true;
+		auto block_event = block_events.begin();
+		for(auto entry = entries.begin(); entry != entries.end() && r; ++entry, ++block_event)
+		{
+			const cryptonote::block &b = boost::get<cryptonote::block>(m_events[*block_event]);
+			cryptonote::block_verification_context bvc = AUTO_VAL_INIT(bvc);
+
+			std::vector<cryptonote::tx_verification_context> tvc;
+			m_c.handle_incoming_txs(entry->txs, tvc, true, true, false);
+			for(size_t i = 0; i < b.tx_hashes.size(); ++i)
+			{
+				const size_t tx_event = tx_events[b.tx_hashes[i]];
+				const cryptonote::transaction &tx = boost::get<cryptonote::transaction>(m_events[tx_event]);
+				if(!check_tx_verification_context(tvc[i], !tvc[i].m_verifivation_failed, tx_event, tx, m_validator))
+				{
+					MERROR("span tx verification context check failed");
+					r = false;
+				}
+				if(tvc[i].m_verifivation_failed)
+					bvc.m_verifivation_failed = true;
+			}
+			if(!r)
+				break;
+
+			if(!bvc.m_verifivation_failed)
+				m_c.handle_incoming_block(entry->block, bvc, false);
+			if(!check_block_verification_context(bvc, *block_event, b, m_validator))
+			{
+				MERROR("span block verification context check failed");
+				r = false;
+			}
+			if(bvc.m_verifivation_failed)
+				break;
+		}
+
+		if(!m_c.cleanup_handle_incoming_blocks())
+		{
+			MERROR("Failure in cleanup_handle_incoming_blocks");
+			return false;
+		}
+		return r;
+	}
 };
 //--------------------------------------------------------------------------
 template <class t_test_class>
@@ -435,15 +554,29 @@ struct get_test_options
 	get_test_options() : hard_forks{std::make_pair((uint8_t)1, (uint64_t)0), std::make_pair((uint8_t)0, (uint64_t)0)} {}
 };
 
+//--------------------------------------------------------------------------
+// Command line arguments for the core come from an args member of the test options, if there is one
+template <class t_test_options>
+auto get_test_args(const t_test_options &gto, int) -> decltype(std::vector<std::string>(gto.args))
+{
+	return gto.args;
+}
+//--------------------------------------------------------------------------
+template <class t_test_options>
+std::vector<std::string> get_test_args(const t_test_options &, long)
+{
+	return std::vector<std::string>();
+}
 //--------------------------------------------------------------------------
 template <class t_test_class>
 inline bool do_replay_events(std::vector<test_event_entry> &events)
 {
+	get_test_options<t_test_class> gto;
 	boost::program_options::options_description desc("Allowed options");
 	cryptonote::core::init_options(desc);
 	boost::program_options::variables_map vm;
 	bool r = command_line::handle_error_helper(desc, [&]() {
-		boost::program_options::store(boost::program_options::basic_parsed_options<char>(&desc), vm);
+		boost::program_options::store(boost::program_options::command_line_parser(get_test_args(gto, 0)).options(desc).run(), vm);
 		boost::program_options::notify(vm);
 		return true;
 	});
@@ -454,7 +587,6 @@ inline bool do_replay_events(std::vector<test_event_entry> &events)
 	cryptonote::core c(&pr);
 	// FIXME: make sure that vm has arg_testnet_on set to true or false if
 	// this test needs for it to be so.
-	get_test_options<t_test_class> gto;
 	if(!c.init(vm, NULL, &gto.test_options))
 	{
 		MERROR("Failed to init core");
@@ -631,6 +763,8 @@ inline bool do_replay_file(const std::string &filename)
 
 #define SET_EVENT_VISITOR_SETT(VEC_EVENTS, SETT, VAL) VEC_EVENTS.push_back(event_visitor_settings(SETT, VAL));
 
+#define SET_SYNC_SPAN(VEC_EVENTS, VAL) VEC_EVENTS.push_back(event_visitor_settings(event_visitor_settings::set_sync_span, false, VAL));
+
 #define GENERATE(filename, genclass)                                      \
 	{                                                                     \
 		std::vector<test_event_entry> events;                             \
@@ -195,6 +195,16 @@ int main(int argc, char *argv[])
 		GENERATE_AND_PLAY(gen_rct_tx_pre_rct_add_vout);
 		GENERATE_AND_PLAY(gen_rct_tx_rct_add_vout);
 		GENERATE_AND_PLAY(gen_rct_tx_pre_rct_increase_vin_and_fee);
+		GENERATE_AND_PLAY(gen_rct_tx_batch_semantics<0>);
+		GENERATE_AND_PLAY(gen_rct_tx_batch_semantics<1>);
+		GENERATE_AND_PLAY(gen_rct_tx_batch_semantics<3>);
+		GENERATE_AND_PLAY(gen_rct_tx_batch_semantics<RCT_VERIFY_BATCH_DEFAULT_SIZE>);
+		GENERATE_AND_PLAY(gen_rct_tx_batch_bad_sum<0>);
+		GENERATE_AND_PLAY(gen_rct_tx_batch_bad_sum<1>);
+		GENERATE_AND_PLAY(gen_rct_tx_batch_bad_sum<3>);
+		GENERATE_AND_PLAY(gen_rct_tx_batch_bad_sum<RCT_VERIFY_BATCH_DEFAULT_SIZE>);
+		GENERATE_AND_PLAY(gen_rct_tx_block_bad_ring_sig);
+		GENERATE_AND_PLAY(gen_block_template_cache);
 
 		GENERATE_AND_PLAY(gen_multisig_tx_valid_22_1_2);
 		GENERATE_AND_PLAY(gen_multisig_tx_valid_22_1_2_many_inputs);
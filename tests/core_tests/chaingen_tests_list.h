@@ -31,6 +31,7 @@
 #pragma once
 
 #include "block_reward.h"
+#include "block_template.h"
 #include "block_validation.h"
 #include "chain_split_1.h"
 #include "chain_switch_1.h"
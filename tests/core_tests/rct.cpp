@@ -40,20 +40,24 @@ using namespace cryptonote;
 //----------------------------------------------------------------------------------------------------------------------
 // Tests
 
-bool gen_rct_tx_validation_base::generate_with(std::vector<test_event_entry> &events,
-											   const int *out_idx, int mixin, uint64_t amount_paid, bool valid,
-											   const std::function<void(std::vector<tx_source_entry> &sources, std::vector<tx_destination_entry> &destinations)> &pre_tx,
-											   const std::function<void(transaction &tx)> &post_tx) const
+bool gen_rct_tx_validation_base::generate_rct_chain(std::vector<test_event_entry> &events, rct_chain &chain) const
 {
 	uint64_t ts_start = 1338224400;
-
-	GENERATE_ACCOUNT(miner_account);
-	MAKE_GENESIS_BLOCK(events, blk_0, miner_account, ts_start);
+	test_generator &generator = chain.generator;
+	cryptonote::account_base &miner_account = chain.miner_account;
+	cryptonote::account_base *miner_accounts = chain.miner_accounts;
+	cryptonote::block *blocks = chain.blocks;
+	transaction *rct_txes = chain.rct_txes;
+	rct::key *rct_tx_masks = chain.rct_tx_masks;
+	cryptonote::block &blk_last = chain.blk_last;
+
+	miner_account.generate_new(false);
+	cryptonote::block blk_0;
+	generator.construct_block(blk_0, miner_account, ts_start);
+	events.push_back(blk_0);
 
 	// create 4 miner accounts, and have them mine the next 4 blocks
-	cryptonote::account_base miner_accounts[4];
 	const cryptonote::block *prev_block = &blk_0;
-	cryptonote::block blocks[4];
 	for(size_t n = 0; n < 4; ++n)
 	{
 		miner_accounts[n].generate_new(false);
@@ -68,7 +72,6 @@ bool gen_rct_tx_validation_base::generate_with(std::vector<test_event_entry> &ev
 	}
 
 	// rewind
-	cryptonote::block blk_r, blk_last;
 	{
 		blk_last = blocks[3];
 		for(size_t i = 0; i < CRYPTONOTE_MINED_MONEY_UNLOCK_WINDOW; ++i)
@@ -82,12 +85,9 @@ bool gen_rct_tx_validation_base::generate_with(std::vector<test_event_entry> &ev
 			events.push_back(blk);
 			blk_last = blk;
 		}
-		blk_r = blk_last;
 	}
 
 	// create 4 txes from these miners in another block, to generate some rct outputs
-	transaction rct_txes[4];
-	rct::key rct_tx_masks[16];
 	cryptonote::block blk_txes[4];
 	for(size_t n = 0; n < 4; ++n)
 	{
@@ -163,13 +163,23 @@ bool gen_rct_tx_validation_base::generate_with(std::vector<test_event_entry> &ev
 			events.push_back(blk);
 			blk_last = blk;
 		}
-		blk_r = blk_last;
 	}
 
+	return true;
+}
+
+bool gen_rct_tx_validation_base::construct_rct_spend(const rct_chain &chain, const int *out_idx, int mixin, uint64_t amount_paid, size_t first_rct_out,
+													 const std::function<void(std::vector<tx_source_entry> &sources, std::vector<tx_destination_entry> &destinations)> &pre_tx,
+													 transaction &tx, bool bulletproof) const
+{
+	const transaction *rct_txes = chain.rct_txes;
+	const rct::key *rct_tx_masks = chain.rct_tx_masks;
+	const cryptonote::block *blocks = chain.blocks;
+
 	// create a tx from the requested ouputs
 	std::vector<tx_source_entry> sources;
-	size_t global_rct_idx = 6; // skip first coinbase (6 outputs)
-	size_t rct_idx = 0;
+	size_t global_rct_idx = 6 + (first_rct_out / 4) * 10 + (first_rct_out & 3); // skip first coinbase (6 outputs)
+	size_t rct_idx = first_rct_out;
 	size_t pre_rct_idx = 0;
 	for(size_t out_idx_idx = 0; out_idx[out_idx_idx] >= 0; ++out_idx_idx)
 	{
@@ -215,7 +225,7 @@ bool gen_rct_tx_validation_base::generate_with(std::vector<test_event_entry> &ev
 
 	//fill outputs entry
 	tx_destination_entry td;
-	td.addr = miner_account.get_keys().m_account_address;
+	td.addr = chain.miner_account.get_keys().m_account_address;
 	td.amount = amount_paid;
 	std::vector<tx_destination_entry> destinations;
 	destinations.push_back(td);
@@ -223,13 +233,29 @@ bool gen_rct_tx_validation_base::generate_with(std::vector<test_event_entry> &ev
 	if(pre_tx)
 		pre_tx(sources, destinations);
 
-	transaction tx;
+	// the real rct output belongs to the miner that made the rct tx holding it
+	const cryptonote::account_base &sender = chain.miner_accounts[first_rct_out / 4];
 	crypto::secret_key tx_key;
 	std::vector<crypto::secret_key> additional_tx_keys;
 	std::unordered_map<crypto::public_key, cryptonote::subaddress_index> subaddresses;
-	subaddresses[miner_accounts[0].get_keys().m_account_address.m_spend_public_key] = {0, 0};
-	bool r = construct_tx_and_get_tx_key(miner_accounts[0].get_keys(), subaddresses, sources, destinations, cryptonote::account_public_address{}, nullptr, tx, 0, tx_key, additional_tx_keys, true);
+	subaddresses[sender.get_keys().m_account_address.m_spend_public_key] = {0, 0};
+	bool r = construct_tx_and_get_tx_key(sender.get_keys(), subaddresses, sources, destinations, cryptonote::account_public_address{}, nullptr, tx, 0, tx_key, additional_tx_keys, bulletproof);
 	CHECK_AND_ASSERT_MES(r, false, "failed to construct transaction");
+	return true;
+}
+
+bool gen_rct_tx_validation_base::generate_with(std::vector<test_event_entry> &events,
+											   const int *out_idx, int mixin, uint64_t amount_paid, bool valid,
+											   const std::function<void(std::vector<tx_source_entry> &sources, std::vector<tx_destination_entry> &destinations)> &pre_tx,
+											   const std::function<void(transaction &tx)> &post_tx) const
+{
+	rct_chain chain;
+	if(!generate_rct_chain(events, chain))
+		return false;
+
+	transaction tx;
+	if(!construct_rct_spend(chain, out_idx, mixin, amount_paid, 0, pre_tx, tx))
+		return false;
 
 	if(post_tx)
 		post_tx(tx);
@@ -492,3 +518,256 @@ bool gen_rct_tx_rct_add_vout::generate(std::vector<test_event_entry> &events) co
 						 NULL, [](transaction &tx) { tx.vout.push_back(tx.vout.back()); });
 }
 
+bool gen_rct_tx_batch_semantics_base::generate(std::vector<test_event_entry> &events) const
+{
+	rct_chain chain;
+	if(!generate_rct_chain(events, chain))
+		return false;
+
+	// five txs spending distinct rct outputs, the third one with a broken range proof
+	const int mixin = 2;
+	const int out_idx[] = {1, -1};
+	const uint64_t amount_paid = 10000;
+	transaction txes[5];
+	for(size_t n = 0; n < 5; ++n)
+	{
+		if(!construct_rct_spend(chain, out_idx, mixin, amount_paid, n * (mixin + 1), NULL, txes[n]))
+			return false;
+	}
+	rct::rctSigPrunable &bad = txes[2].rct_signatures.p;
+	if(!bad.rangeSigs.empty())
+		bad.rangeSigs[0].asig.ee = rct::skGen();
+	else
+		bad.bulletproofs[0].taux = rct::skGen();
+
+	SET_SYNC_SPAN(events, true);
+	DO_CALLBACK(events, "check_rct_batch");
+	for(size_t n = 0; n < 5; ++n)
+	{
+		if(n == 2)
+			DO_CALLBACK(events, "mark_invalid_tx");
+		events.push_back(txes[n]);
+	}
+
+	// the bad tx goes in the last block, so that its batch also holds valid txs of earlier blocks
+	const std::vector<std::vector<size_t>> block_txes = {{0, 1}, {3}, {2, 4}};
+	for(size_t n = 0; n < block_txes.size(); ++n)
+	{
+		std::vector<crypto::hash> tx_hashes;
+		for(size_t i : block_txes[n])
+			tx_hashes.push_back(get_transaction_hash(txes[i]));
+
+		cryptonote::block blk;
+		CHECK_AND_ASSERT_MES(chain.generator.construct_block_manually(blk, chain.blk_last, chain.miner_account,
+																	  test_generator::bf_major_ver | test_generator::bf_minor_ver | test_generator::bf_timestamp | test_generator::bf_tx_hashes | test_generator::bf_hf_version | test_generator::bf_max_outs,
+																	  4, 4, chain.blk_last.timestamp + DIFFICULTY_BLOCKS_ESTIMATE_TIMESPAN * 2, // v2 has blocks twice as long
+																	  crypto::hash(), 0, transaction(), tx_hashes, 0, 6, 4),
+							 false, "Failed to generate block");
+		if(n == 2)
+			DO_CALLBACK(events, "mark_invalid_block");
+		events.push_back(blk);
+		chain.blk_last = blk;
+	}
+	SET_SYNC_SPAN(events, false);
+	DO_CALLBACK(events, "check_span_added");
+
+	return true;
+}
+
+bool gen_rct_tx_batch_bad_sum_base::generate(std::vector<test_event_entry> &events) const
+{
+	rct_chain chain;
+	if(!generate_rct_chain(events, chain))
+		return false;
+
+	// three RCTTypeSimple txs with two inputs each, the second one with a fee its outputs don't add up to,
+	// then two bulletproof txs. Rings overlap but every real output is distinct.
+	const int mixin = 2;
+	const int simple_out_idx[] = {1, 1, -1};
+	const int out_idx[] = {1, -1};
+	const uint64_t amount_paid = 10000;
+	transaction txes[5];
+	for(size_t n = 0; n < 3; ++n)
+	{
+		if(!construct_rct_spend(chain, simple_out_idx, mixin, amount_paid, n * 4, NULL, txes[n], false))
+			return false;
+		CHECK_AND_ASSERT_MES(txes[n].rct_signatures.type == rct::RCTTypeSimple, false, "Expected a RCTTypeSimple tx");
+	}
+	for(size_t n = 0; n < 2; ++n)
+	{
+		if(!construct_rct_spend(chain, out_idx, mixin, amount_paid, 12 + n, NULL, txes[3 + n]))
+			return false;
+	}
+	txes[1].rct_signatures.txnFee += 1;
+	txes[1].invalidate_hashes();
+
+	SET_SYNC_SPAN(events, true);
+	DO_CALLBACK(events, "check_rct_batch");
+	for(size_t n = 0; n < 5; ++n)
+	{
+		if(n == 1)
+			DO_CALLBACK(events, "mark_invalid_tx");
+		events.push_back(txes[n]);
+	}
+
+	// the bad tx shares the last block with a valid RCTTypeSimple tx
+	const std::vector<std::vector<size_t>> block_txes = {{0, 3}, {4}, {1, 2}};
+	for(size_t n = 0; n < block_txes.size(); ++n)
+	{
+		std::vector<crypto::hash> tx_hashes;
+		for(size_t i : block_txes[n])
+			tx_hashes.push_back(get_transaction_hash(txes[i]));
+
+		cryptonote::block blk;
+		CHECK_AND_ASSERT_MES(chain.generator.construct_block_manually(blk, chain.blk_last, chain.miner_account,
+																	  test_generator::bf_major_ver | test_generator::bf_minor_ver | test_generator::bf_timestamp | test_generator::bf_tx_hashes | test_generator::bf_hf_version | test_generator::bf_max_outs,
+																	  4, 4, chain.blk_last.timestamp + DIFFICULTY_BLOCKS_ESTIMATE_TIMESPAN * 2, // v2 has blocks twice as long
+																	  crypto::hash(), 0, transaction(), tx_hashes, 0, 6, 4),
+							 false, "Failed to generate block");
+		if(n == 2)
+			DO_CALLBACK(events, "mark_invalid_block");
+		events.push_back(blk);
+		chain.blk_last = blk;
+	}
+	SET_SYNC_SPAN(events, false);
+	DO_CALLBACK(events, "check_span_added");
+
+	return true;
+}
+
+bool gen_rct_tx_batch_semantics_base::check_rct_batch(cryptonote::core &c, size_t ev_index, const std::vector<test_event_entry> &events)
+{
+	DEFINE_TESTS_ERROR_CONTEXT("gen_rct_tx_batch_semantics::check_rct_batch");
+
+	// --rct-batch-size reaches the blockchain
+	const Blockchain &bc = c.get_blockchain_storage();
+	CHECK_EQ(bc.get_rct_batch_size(), m_batch_size);
+
+	// the span is prepared, every tx but the bad one is verified unless batching is off
+	size_t verified = 0, bad = 0, txes = 0;
+	for(size_t i = ev_index + 1; i < events.size() && typeid(event_visitor_settings) != events[i].type(); ++i)
+	{
+		if(typeid(transaction) != events[i].type())
+			continue;
+		const transaction &tx = boost::get<transaction>(events[i]);
+		const bool valid = rct::verRctSemanticsSimple(tx.rct_signatures);
+		CHECK_EQ(bc.is_rct_semantics_verified(get_transaction_hash(tx)), valid && m_batch_size > 0);
+		++txes;
+		if(!valid)
+			++bad;
+		else if(m_batch_size > 0)
+			++verified;
+	}
+	CHECK_EQ(bad, 1);
+	CHECK_EQ(verified, m_batch_size > 0 ? txes - 1 : 0);
+
+	return true;
+}
+
+bool gen_rct_tx_batch_semantics_base::check_span_added(cryptonote::core &c, size_t ev_index, const std::vector<test_event_entry> &events)
+{
+	DEFINE_TESTS_ERROR_CONTEXT("gen_rct_tx_batch_semantics::check_span_added");
+
+	// the blocks of the span are added up to the one with the bad tx, which is not
+	size_t span_start = ev_index - 1;
+	while(typeid(event_visitor_settings) != events[span_start - 1].type())
+		--span_start;
+
+	std::unordered_map<crypto::hash, bool> tx_valid;
+	for(size_t i = span_start; i < ev_index; ++i)
+	{
+		if(typeid(transaction) == events[i].type())
+		{
+			const transaction &tx = boost::get<transaction>(events[i]);
+			tx_valid[get_transaction_hash(tx)] = rct::verRctSemanticsSimple(tx.rct_signatures);
+		}
+	}
+
+	size_t added = 0;
+	bool rejected = false;
+	for(size_t i = span_start; i < ev_index; ++i)
+	{
+		if(typeid(block) != events[i].type())
+			continue;
+		const block &b = boost::get<block>(events[i]);
+		for(const crypto::hash &tx_hash : b.tx_hashes)
+			rejected = rejected || !tx_valid[tx_hash];
+		CHECK_EQ(c.get_blockchain_storage().have_block(get_block_hash(b)), !rejected);
+		if(!rejected)
+			++added;
+	}
+	CHECK_EQ(added, 2);
+	CHECK_TEST_CONDITION(rejected);
+
+	return true;
+}
+
+bool gen_rct_tx_block_bad_ring_sig::generate(std::vector<test_event_entry> &events) const
+{
+	rct_chain chain;
+	if(!generate_rct_chain(events, chain))
+		return false;
+
+	// four txs spending distinct rct outputs, the second and the fourth with a broken MLSAG
+	const int mixin = 2;
+	const int out_idx[] = {1, -1};
+	const uint64_t amount_paid = 10000;
+	transaction txes[4];
+	for(size_t n = 0; n < 4; ++n)
+	{
+		if(!construct_rct_spend(chain, out_idx, mixin, amount_paid, n * (mixin + 1), NULL, txes[n]))
+			return false;
+	}
+	for(size_t n : {1, 3})
+	{
+		txes[n].rct_signatures.p.MGs[0].ss[0][0] = rct::skGen();
+		txes[n].invalidate_hashes();
+	}
+
+	// the pool only takes the bad txs as kept by a block, which is how they reach the block check
+	SET_EVENT_VISITOR_SETT(events, event_visitor_settings::set_txs_keeped_by_block, true);
+	std::vector<crypto::hash> tx_hashes;
+	for(size_t n = 0; n < 4; ++n)
+	{
+		events.push_back(txes[n]);
+		tx_hashes.push_back(get_transaction_hash(txes[n]));
+	}
+	SET_EVENT_VISITOR_SETT(events, event_visitor_settings::set_txs_keeped_by_block, false);
+
+	cryptonote::block blk;
+	CHECK_AND_ASSERT_MES(chain.generator.construct_block_manually(blk, chain.blk_last, chain.miner_account,
+																  test_generator::bf_major_ver | test_generator::bf_minor_ver | test_generator::bf_timestamp | test_generator::bf_tx_hashes | test_generator::bf_hf_version | test_generator::bf_max_outs,
+																  4, 4, chain.blk_last.timestamp + DIFFICULTY_BLOCKS_ESTIMATE_TIMESPAN * 2, // v2 has blocks twice as long
+																  crypto::hash(), 0, transaction(), tx_hashes, 0, 6, 4),
+						 false, "Failed to generate block");
+	DO_CALLBACK(events, "mark_invalid_block");
+	events.push_back(blk);
+	DO_CALLBACK(events, "check_block_rejected");
+
+	return true;
+}
+
+bool gen_rct_tx_block_bad_ring_sig::check_block_verification_context(const cryptonote::block_verification_context &bvc, size_t event_idx, const cryptonote::block &block)
+{
+	if(bvc.m_verifivation_failed)
+		m_bad_tx_id = bvc.m_bad_tx_id;
+	return gen_rct_tx_validation_base::check_block_verification_context(bvc, event_idx, block);
+}
+
+bool gen_rct_tx_block_bad_ring_sig::check_block_rejected(cryptonote::core &c, size_t ev_index, const std::vector<test_event_entry> &events)
+{
+	DEFINE_TESTS_ERROR_CONTEXT("gen_rct_tx_block_bad_ring_sig::check_block_rejected");
+
+	const block &b = boost::get<block>(events[ev_index - 1]);
+	CHECK_TEST_CONDITION(!c.have_block(get_block_hash(b)));
+
+	// the first bad tx in block order is reported, whichever check finished first
+	CHECK_EQ(m_bad_tx_id, b.tx_hashes[1]);
+
+	// all the txs of the block went back to the pool
+	CHECK_EQ(c.get_pool_transactions_count(), b.tx_hashes.size());
+	for(const crypto::hash &tx_hash : b.tx_hashes)
+		CHECK_TEST_CONDITION(c.pool_has_tx(tx_hash));
+
+	return true;
+}
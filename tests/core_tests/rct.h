@@ -29,6 +29,8 @@
 // Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
 
 #pragma once
+#include <string>
+
 #include "chaingen.h"
 
 struct gen_rct_tx_validation_base : public test_chain_unit_base
@@ -73,6 +75,26 @@ struct gen_rct_tx_validation_base : public test_chain_unit_base
 					   const std::function<void(std::vector<cryptonote::tx_source_entry> &sources, std::vector<cryptonote::tx_destination_entry> &destinations)> &pre_tx,
 					   const std::function<void(cryptonote::transaction &tx)> &post_tx) const;
 
+	// a chain with 16 spendable rct outputs (4 per tx in rct_txes) and pre rct outputs in blocks
+	struct rct_chain
+	{
+		test_generator generator;
+		cryptonote::account_base miner_account;
+		cryptonote::account_base miner_accounts[4];
+		cryptonote::block blocks[4];
+		cryptonote::transaction rct_txes[4];
+		rct::key rct_tx_masks[16];
+		cryptonote::block blk_last;
+	};
+
+	bool generate_rct_chain(std::vector<test_event_entry> &events, rct_chain &chain) const;
+
+	// rct rings are taken from consecutive rct outputs starting at first_rct_out, the real one first
+	// without bulletproofs a tx needs two inputs or more to get RCTTypeSimple rather than RCTTypeFull
+	bool construct_rct_spend(const rct_chain &chain, const int *out_idx, int mixin, uint64_t amount_paid, size_t first_rct_out,
+							 const std::function<void(std::vector<cryptonote::tx_source_entry> &sources, std::vector<cryptonote::tx_destination_entry> &destinations)> &pre_tx,
+							 cryptonote::transaction &tx, bool bulletproof = true) const;
+
   private:
 	size_t m_invalid_tx_index;
 	size_t m_invalid_block_index;
@@ -326,3 +348,80 @@ struct get_test_options<gen_rct_tx_rct_add_vout> : public get_test_options<gen_r
 {
 };
 
+// batched semantics of a synced span, with a bad range proof in the middle of it
+struct gen_rct_tx_batch_semantics_base : public gen_rct_tx_validation_base
+{
+	gen_rct_tx_batch_semantics_base(size_t batch_size)
+		: m_batch_size(batch_size)
+	{
+		REGISTER_CALLBACK_METHOD(gen_rct_tx_batch_semantics_base, check_rct_batch);
+		REGISTER_CALLBACK_METHOD(gen_rct_tx_batch_semantics_base, check_span_added);
+	}
+
+	bool generate(std::vector<test_event_entry> &events) const;
+	bool check_rct_batch(cryptonote::core &c, size_t ev_index, const std::vector<test_event_entry> &events);
+	bool check_span_added(cryptonote::core &c, size_t ev_index, const std::vector<test_event_entry> &events);
+
+  private:
+	size_t m_batch_size;
+};
+
+template <size_t batch_size>
+struct gen_rct_tx_batch_semantics : public gen_rct_tx_batch_semantics_base
+{
+	gen_rct_tx_batch_semantics()
+		: gen_rct_tx_batch_semantics_base(batch_size)
+	{
+	}
+};
+template <size_t batch_size>
+struct get_test_options<gen_rct_tx_batch_semantics<batch_size>> : public get_test_options<gen_rct_tx_validation_base>
+{
+	const std::vector<std::string> args = {"--rct-batch-size=" + std::to_string(batch_size)};
+};
+
+// same span checks, with RCTTypeSimple txs next to bulletproof ones and a bad sum instead of a bad range proof
+struct gen_rct_tx_batch_bad_sum_base : public gen_rct_tx_batch_semantics_base
+{
+	gen_rct_tx_batch_bad_sum_base(size_t batch_size)
+		: gen_rct_tx_batch_semantics_base(batch_size)
+	{
+	}
+
+	bool generate(std::vector<test_event_entry> &events) const;
+};
+
+template <size_t batch_size>
+struct gen_rct_tx_batch_bad_sum : public gen_rct_tx_batch_bad_sum_base
+{
+	gen_rct_tx_batch_bad_sum()
+		: gen_rct_tx_batch_bad_sum_base(batch_size)
+	{
+	}
+};
+template <size_t batch_size>
+struct get_test_options<gen_rct_tx_batch_bad_sum<batch_size>> : public get_test_options<gen_rct_tx_validation_base>
+{
+	const std::vector<std::string> args = {"--rct-batch-size=" + std::to_string(batch_size)};
+};
+
+// a block whose second and fourth txs have bad ring signatures, checked after all its txs passed the other input checks
+struct gen_rct_tx_block_bad_ring_sig : public gen_rct_tx_validation_base
+{
+	gen_rct_tx_block_bad_ring_sig()
+		: m_bad_tx_id(crypto::null_hash)
+	{
+		REGISTER_CALLBACK_METHOD(gen_rct_tx_block_bad_ring_sig, check_block_rejected);
+	}
+
+	bool generate(std::vector<test_event_entry> &events) const;
+	bool check_block_verification_context(const cryptonote::block_verification_context &bvc, size_t event_idx, const cryptonote::block &block);
+	bool check_block_rejected(cryptonote::core &c, size_t ev_index, const std::vector<test_event_entry> &events);
+
+  private:
+	crypto::hash m_bad_tx_id;
+};
+template <>
+struct get_test_options<gen_rct_tx_block_bad_ring_sig> : public get_test_options<gen_rct_tx_validation_base>
+{
+};
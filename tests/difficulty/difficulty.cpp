@@ -70,8 +70,8 @@ int main(int argc, char *argv[])
 			begin = end - common_config::DIFFICULTY_WINDOW_V1;
 		}
 		uint64_t res = next_difficulty_v3(
-			vector<uint64_t>(timestamps.begin() + begin, timestamps.begin() + end),
-			vector<uint64_t>(cumulative_difficulties.begin() + begin, cumulative_difficulties.begin() + end));
+			epee::span<const uint64_t>(timestamps.data() + begin, end - begin),
+			epee::span<const uint64_t>(cumulative_difficulties.data() + begin, end - begin));
 		if(res != difficulty)
 		{
 			cerr << "Wrong difficulty for block " << n << endl
@@ -0,0 +1,83 @@
+// Copyright (c) 2017-2018, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "cryptonote_basic/blobdatatype.h"
+#include "cryptonote_config.h"
+#include "file_io_utils.h"
+#include "fuzzer.h"
+#include "include_base_utils.h"
+#include "ringct/bulletproofs.h"
+#include "serialization/binary_utils.h"
+
+class BulletproofFuzzer : public Fuzzer
+{
+  public:
+	virtual int run(const std::string &filename);
+
+  private:
+};
+
+int BulletproofFuzzer::run(const std::string &filename)
+{
+	std::string s;
+
+	if(!epee::file_io_utils::load_file_to_string(filename, s))
+	{
+		std::cout << "Error: failed to load file " << filename << std::endl;
+		return 1;
+	}
+	rct::Bulletproof proof = AUTO_VAL_INIT(proof);
+	if(!::serialization::parse_binary(s, proof))
+	{
+		std::cout << "Error: failed to parse bulletproof from file  " << filename << std::endl;
+		return 1;
+	}
+
+	// V is not serialized, give the proof as many commitments as its L vector can cover
+	size_t outputs = 1;
+	for(size_t n = 6; n < proof.L.size() && outputs < cryptonote::common_config::BULLETPROOF_MAX_OUTPUTS; ++n)
+		outputs <<= 1;
+	proof.V.assign(outputs, rct::H);
+
+	try
+	{
+		bool valid = rct::bulletproof_VERIFY(proof);
+		std::cout << "Bulletproof " << (valid ? "valid" : "invalid") << std::endl;
+	}
+	catch(const std::exception &e)
+	{
+		std::cerr << "Failed to verify bulletproof: " << e.what() << std::endl;
+	}
+	return 0;
+}
+
+int main(int argc, const char **argv)
+{
+	BulletproofFuzzer fuzzer;
+	return run_fuzzer(argc, argv, fuzzer);
+}
@@ -33,10 +33,12 @@
 #include <iomanip>
 #include <ios>
 #include <string>
+#include <vector>
 
 #include "../io.h"
 #include "crypto/pow_hash/cn_slow_hash.hpp"
 #include "crypto/hash.h"
+#include "crypto/tree_hash_builder.h"
 #include "crypto/pow_hash/aux_hash.h"
 #include "warnings.h"
 
@@ -44,6 +46,40 @@ using namespace std;
 using namespace crypto;
 typedef crypto::hash chash;
 
+// Hashes N distinct inputs at once, lane 0 gets the test vector and lane i the vector followed by i
+// bytes of value i. Every lane must agree with the single lane kernel on its own input.
+template <typename ctx_t, size_t N>
+static void pow_hash_lanes(const void *data, size_t length, char *hash)
+{
+	ctx_t ctx[N];
+	ctx_t *lanes[N];
+	vector<char> inputs[N];
+	const void *in[N];
+	size_t len[N];
+	char lane_hash[N][HASH_SIZE];
+	void *out[N];
+	for(size_t i = 0; i < N; i++)
+	{
+		inputs[i].assign((const char *)data, (const char *)data + length);
+		inputs[i].insert(inputs[i].end(), i, (char)i);
+		lanes[i] = &ctx[i];
+		in[i] = inputs[i].data();
+		len[i] = inputs[i].size();
+		out[i] = lane_hash[i];
+	}
+	ctx_t::template hash_n<N>(lanes, in, len, out);
+	for(size_t i = 0; i < N; i++)
+	{
+		char single[HASH_SIZE];
+		ctx[0].hash(in[i], len[i], single);
+		if(memcmp(single, lane_hash[i], HASH_SIZE) != 0)
+		{
+			throw ios_base::failure("Hash lane disagrees with the single lane kernel");
+		}
+	}
+	memcpy(hash, lane_hash[0], HASH_SIZE);
+}
+
 PUSH_WARNINGS
 DISABLE_VS_WARNINGS(4297)
 extern "C" {
@@ -55,6 +91,68 @@ static void hash_tree(const void *data, size_t length, char *hash)
 	}
 	tree_hash((const char(*)[crypto::HASH_SIZE])data, length >> 5, hash);
 }
+static void hash_tree_builder(const void *data, size_t length, char *hash)
+{
+	if((length & 31) != 0)
+	{
+		throw ios_base::failure("Invalid input length for tree_hash");
+	}
+	const chash *leaves = reinterpret_cast<const chash *>(data);
+	size_t count = length >> 5;
+	chash expected;
+
+	// every prefix of the leaves, grown one at a time
+	tree_hash_builder builder;
+	for(size_t i = 0; i < count; i++)
+	{
+		builder.push_back(leaves[i]);
+		tree_hash(leaves, i + 1, expected);
+		if(builder.root() != expected)
+		{
+			throw ios_base::failure("Incremental tree root disagrees after append");
+		}
+	}
+
+	// every leaf swapped for a different one and back
+	vector<chash> changed(leaves, leaves + count);
+	for(size_t i = 0; i < count; i++)
+	{
+		changed[i] = cn_fast_hash(&leaves[i], sizeof(chash));
+		builder.replace(i, changed[i]);
+		tree_hash(changed.data(), count, expected);
+		if(builder.root() != expected)
+		{
+			throw ios_base::failure("Incremental tree root disagrees after replace");
+		}
+		changed[i] = leaves[i];
+		builder.replace(i, leaves[i]);
+	}
+	memcpy(hash, &builder.root(), HASH_SIZE);
+}
+static void hash_fast_batch(const void *data, size_t length, char *hash)
+{
+	// hash the input among copies of its prefixes so that lanes finish at different times
+	const size_t count = 7;
+	const void *in[count];
+	size_t len[count];
+	char out[count][HASH_SIZE];
+	for(size_t i = 0; i < count; i++)
+	{
+		in[i] = data;
+		len[i] = length - length * i / count;
+	}
+	cn_fast_hash_batch(in, len, count, out[0]);
+	for(size_t i = 1; i < count; i++)
+	{
+		char single[HASH_SIZE];
+		cn_fast_hash(in[i], len[i], single);
+		if(memcmp(single, out[i], HASH_SIZE) != 0)
+		{
+			throw ios_base::failure("Batched hash disagrees");
+		}
+	}
+	memcpy(hash, out[0], HASH_SIZE);
+}
 static void cn_pow_hash_original(const void *data, size_t length, char *hash)
 {
 	cn_pow_hash_v2 ctx;
@@ -66,6 +164,47 @@ static void cn_pow_hash_heavy(const void *data, size_t length, char *hash)
 	cn_pow_hash_v2 ctx;
 	ctx.hash(data, length, hash);
 }
+static void cn_pow_hash_heavy_lanes(const void *data, size_t length, char *hash)
+{
+	cn_pow_hash_v2 ctx[2];
+	cn_pow_hash_v2 *lanes[2] = {&ctx[0], &ctx[1]};
+	const void *in[2] = {data, data};
+	size_t len[2] = {length, length};
+	char lane_hash[32];
+	void *out[2] = {hash, lane_hash};
+	cn_pow_hash_v2::hash_n<2>(lanes, in, len, out);
+	if(memcmp(hash, lane_hash, sizeof(lane_hash)) != 0)
+	{
+		throw ios_base::failure("Hash lanes disagree");
+	}
+	pow_hash_lanes<cn_pow_hash_v2, 4>(data, length, hash);
+}
+// The portable kernel is only dispatched to when nothing faster passes its self-test, check it here
+static void cn_pow_hash_heavy_soft(const void *data, size_t length, char *hash)
+{
+	cn_pow_hash_v2 ctx;
+	ctx.hash_with(cn_kernel::soft, data, length, hash);
+}
+static void cn_pow_hash_original_lanes(const void *data, size_t length, char *hash)
+{
+	pow_hash_lanes<cn_pow_hash_v1, 2>(data, length, hash);
+	pow_hash_lanes<cn_pow_hash_v1, 4>(data, length, hash);
+}
+static void cn_pow_hash_gpu(const void *data, size_t length, char *hash)
+{
+	cn_pow_hash_v3 ctx;
+	ctx.hash(data, length, hash);
+}
+static void cn_pow_hash_gpu_lanes(const void *data, size_t length, char *hash)
+{
+	pow_hash_lanes<cn_pow_hash_v3, 2>(data, length, hash);
+	pow_hash_lanes<cn_pow_hash_v3, 4>(data, length, hash);
+}
+static void cn_pow_hash_gpu_soft(const void *data, size_t length, char *hash)
+{
+	cn_pow_hash_v3 ctx;
+	ctx.hash_with(cn_kernel::soft, data, length, hash);
+}
 static void hash_extra_blake(const void *data, size_t length, char *hash)
 {
 	if(length != 200)
@@ -108,13 +247,21 @@ struct hash_func
 	hash_f &f;
 } hashes[] = {
 	{"fast", cn_fast_hash},
+	{"fast-batch", hash_fast_batch},
 	{"pow-original", cn_pow_hash_original},
 	{"tree", hash_tree},
+	{"tree-builder", hash_tree_builder},
 	{"extra-blake", hash_extra_blake},
 	{"extra-groestl", hash_extra_groestl},
 	{"extra-jh", hash_extra_jh},
 	{"extra-skein", hash_extra_skein},
-	{"pow-heavy", cn_pow_hash_heavy}
+	{"pow-heavy", cn_pow_hash_heavy},
+	{"pow-heavy-lanes", cn_pow_hash_heavy_lanes},
+	{"pow-heavy-soft", cn_pow_hash_heavy_soft},
+	{"pow-original-lanes", cn_pow_hash_original_lanes},
+	{"pow-gpu", cn_pow_hash_gpu},
+	{"pow-gpu-lanes", cn_pow_hash_gpu_lanes},
+	{"pow-gpu-soft", cn_pow_hash_gpu_soft}
 };
 
 int main(int argc, char *argv[])
@@ -55,3 +55,33 @@ class test_cn_fast_hash
   private:
 	std::array<uint8_t, bytes> m_data;
 };
+
+template <size_t count, size_t bytes>
+class test_cn_fast_hash_batch
+{
+  public:
+	static const size_t loop_count = bytes < 256 ? 100000 / count : 10000 / count;
+
+	bool init()
+	{
+		for(size_t i = 0; i < count; ++i)
+		{
+			crypto::rand(bytes, m_data[i].data());
+			m_ptrs[i] = m_data[i].data();
+			m_lengths[i] = bytes;
+		}
+		return true;
+	}
+
+	bool test()
+	{
+		crypto::cn_fast_hash_batch(m_ptrs, m_lengths, count, m_hashes);
+		return true;
+	}
+
+  private:
+	std::array<uint8_t, bytes> m_data[count];
+	const void *m_ptrs[count];
+	size_t m_lengths[count];
+	crypto::hash m_hashes[count];
+};
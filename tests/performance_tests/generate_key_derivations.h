@@ -0,0 +1,114 @@
+// Copyright (c) 2014-2018, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
+
+#pragma once
+
+#include "crypto/crypto.h"
+#include "cryptonote_basic/cryptonote_basic.h"
+
+template <size_t count, bool batched>
+class test_generate_key_derivations
+{
+  public:
+	static const size_t loop_count = 10000 / count;
+
+	bool init()
+	{
+		crypto::public_key view_public_key;
+		crypto::secret_key tx_secret_key;
+		crypto::generate_legacy_keys(view_public_key, m_view_secret_key);
+		for(size_t i = 0; i < count; ++i)
+			crypto::generate_legacy_keys(m_tx_pub_keys[i], tx_secret_key);
+		return true;
+	}
+
+	bool test()
+	{
+		if(batched)
+		{
+			bool valid[count];
+			crypto::generate_key_derivations(m_tx_pub_keys, count, m_view_secret_key, m_derivations, valid);
+			return std::all_of(valid, valid + count, [](bool v) { return v; });
+		}
+		for(size_t i = 0; i < count; ++i)
+		{
+			if(!crypto::generate_key_derivation(m_tx_pub_keys[i], m_view_secret_key, m_derivations[i]))
+				return false;
+		}
+		return true;
+	}
+
+  private:
+	crypto::secret_key m_view_secret_key;
+	crypto::public_key m_tx_pub_keys[count];
+	crypto::key_derivation m_derivations[count];
+};
+
+template <size_t count, bool batched>
+class test_derive_public_keys
+{
+  public:
+	static const size_t loop_count = 10000 / count;
+
+	bool init()
+	{
+		crypto::public_key tx_pub_key;
+		crypto::secret_key view_secret_key, tx_secret_key;
+		crypto::generate_legacy_keys(m_spend_public_key, view_secret_key);
+		crypto::generate_legacy_keys(tx_pub_key, tx_secret_key);
+		crypto::key_derivation derivation;
+		if(!crypto::generate_key_derivation(tx_pub_key, view_secret_key, derivation))
+			return false;
+		for(size_t i = 0; i < count; ++i)
+		{
+			m_derivations[i] = derivation;
+			m_output_indexes[i] = i;
+		}
+		return true;
+	}
+
+	bool test()
+	{
+		if(batched)
+			return crypto::derive_public_keys(m_derivations, m_output_indexes, count, m_spend_public_key, m_derived_keys);
+		for(size_t i = 0; i < count; ++i)
+		{
+			if(!crypto::derive_public_key(m_derivations[i], m_output_indexes[i], m_spend_public_key, m_derived_keys[i]))
+				return false;
+		}
+		return true;
+	}
+
+  private:
+	crypto::public_key m_spend_public_key;
+	crypto::key_derivation m_derivations[count];
+	size_t m_output_indexes[count];
+	crypto::public_key m_derived_keys[count];
+};
@@ -49,6 +49,7 @@
 #include "ge_frombytes_vartime.h"
 #include "ge_tobytes.h"
 #include "generate_key_derivation.h"
+#include "generate_key_derivations.h"
 #include "generate_key_image.h"
 #include "generate_key_image_helper.h"
 #include "generate_keypair.h"
@@ -140,6 +141,10 @@ int main(int argc, char **argv)
 	TEST_PERFORMANCE0(filter, p, test_generate_key_image);
 	TEST_PERFORMANCE0(filter, p, test_derive_public_key);
 	TEST_PERFORMANCE0(filter, p, test_derive_secret_key);
+	TEST_PERFORMANCE2(filter, p, test_generate_key_derivations, 16, false);
+	TEST_PERFORMANCE2(filter, p, test_generate_key_derivations, 16, true);
+	TEST_PERFORMANCE2(filter, p, test_derive_public_keys, 16, false);
+	TEST_PERFORMANCE2(filter, p, test_derive_public_keys, 16, true);
 	TEST_PERFORMANCE0(filter, p, test_ge_frombytes_vartime);
 	TEST_PERFORMANCE0(filter, p, test_ge_tobytes);
 	TEST_PERFORMANCE0(filter, p, test_generate_keypair);
@@ -154,6 +159,8 @@ int main(int argc, char **argv)
 	TEST_PERFORMANCE1(filter, p, test_cn_slow_hash, true);
 	TEST_PERFORMANCE1(filter, p, test_cn_fast_hash, 32);
 	TEST_PERFORMANCE1(filter, p, test_cn_fast_hash, 16384);
+	TEST_PERFORMANCE2(filter, p, test_cn_fast_hash_batch, 64, 64);
+	TEST_PERFORMANCE2(filter, p, test_cn_fast_hash_batch, 64, 512);
 
 	TEST_PERFORMANCE3(filter, p, test_ringct_mlsag, 1, 3, false);
 	TEST_PERFORMANCE3(filter, p, test_ringct_mlsag, 1, 5, false);
@@ -506,6 +513,23 @@ int main(int argc, char **argv)
 	TEST_PERFORMANCE3(filter, p, test_multiexp, multiexp_pippenger, 4096, 9);
 #endif
 
+	TEST_PERFORMANCE2(filter, p, test_multiexp_threads, 512, 1);
+	TEST_PERFORMANCE2(filter, p, test_multiexp_threads, 512, 2);
+	TEST_PERFORMANCE2(filter, p, test_multiexp_threads, 512, 4);
+	TEST_PERFORMANCE2(filter, p, test_multiexp_threads, 512, 8);
+	TEST_PERFORMANCE2(filter, p, test_multiexp_threads, 1024, 1);
+	TEST_PERFORMANCE2(filter, p, test_multiexp_threads, 1024, 2);
+	TEST_PERFORMANCE2(filter, p, test_multiexp_threads, 1024, 4);
+	TEST_PERFORMANCE2(filter, p, test_multiexp_threads, 1024, 8);
+	TEST_PERFORMANCE2(filter, p, test_multiexp_threads, 2048, 1);
+	TEST_PERFORMANCE2(filter, p, test_multiexp_threads, 2048, 2);
+	TEST_PERFORMANCE2(filter, p, test_multiexp_threads, 2048, 4);
+	TEST_PERFORMANCE2(filter, p, test_multiexp_threads, 2048, 8);
+	TEST_PERFORMANCE2(filter, p, test_multiexp_threads, 4096, 1);
+	TEST_PERFORMANCE2(filter, p, test_multiexp_threads, 4096, 2);
+	TEST_PERFORMANCE2(filter, p, test_multiexp_threads, 4096, 4);
+	TEST_PERFORMANCE2(filter, p, test_multiexp_threads, 4096, 8);
+
 	std::cout << "Tests finished. Elapsed time: " << timer.elapsed_ms() / 1000 << " sec" << std::endl;
 
 	return 0;
@@ -85,3 +85,39 @@ public:
 	rct::bp_cache cache_b;
 	rct::key res;
 };
+
+// Pippenger with a fixed number of threadpool workers, to see how the parallel path scales
+template <size_t npoints, size_t threads>
+class test_multiexp_threads
+{
+public:
+	static const size_t loop_count = npoints >= 1024 ? 10 : 100;
+
+	bool init()
+	{
+		data.resize(npoints);
+		res = rct::identity();
+		for(size_t n = 0; n < npoints; ++n)
+		{
+			data[n].scalar = rct::skGen();
+			rct::key point = rct::scalarmultBase(rct::skGen());
+			if(ge_frombytes_vartime(&data[n].point, point.bytes))
+				return false;
+			rct::key kn = rct::scalarmultKey(point, data[n].scalar);
+			res = rct::addKeys(res, kn);
+		}
+		cache.init_cache(data);
+		return true;
+	}
+
+	bool test()
+	{
+		return res == cache.pippenger(data, buckets, 0, threads);
+	}
+
+  private:
+	std::vector<rct::MultiexpData> data;
+	rct::pippenger_cache cache;
+	aligned_ptr<ge_p3[]> buckets;
+	rct::key res;
+};
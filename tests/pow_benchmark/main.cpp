@@ -0,0 +1,289 @@
+// Copyright (c) 2019, Ryo Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2020
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Measures every PoW variant with every kernel the CPU supports, for a range of thread counts
+// and with and without huge pages. Results are printed to stdout as a JSON array.
+
+#include <algorithm>
+#include <boost/algorithm/string.hpp>
+#include <boost/chrono.hpp>
+#include <boost/thread/barrier.hpp>
+#include <boost/thread/thread.hpp>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "common/command_line.h"
+#include "crypto/pow_hash/cn_slow_hash.hpp"
+
+namespace po = boost::program_options;
+
+namespace
+{
+typedef boost::chrono::steady_clock clock_type;
+
+struct worker_result
+{
+	cn_pad_mode pad_mode;
+	clock_type::time_point start;
+	clock_type::time_point end;
+	std::vector<uint64_t> latencies_ns;
+};
+
+struct run_result
+{
+	std::string variant;
+	cn_kernel kernel;
+	cn_pad_mode requested_pad;
+	cn_pad_mode pad_mode;
+	size_t threads;
+	size_t hashes;
+	double seconds;
+	std::vector<uint64_t> latencies_ns;
+};
+
+template <typename hash_t>
+void hash_worker(cn_kernel kernel, size_t count, uint32_t nonce, boost::barrier& barrier, worker_result& res)
+{
+	// The scratchpad is allocated by the thread that uses it, like the miner does
+	hash_t ctx;
+	res.pad_mode = ctx.get_pad_mode();
+	res.latencies_ns.reserve(count);
+
+	// Same size as a block hashing blob, the nonce makes every input different
+	uint8_t blob[76] = {};
+	uint8_t hash[32];
+
+	barrier.wait();
+	res.start = clock_type::now();
+	for(size_t i = 0; i < count; i++, nonce++)
+	{
+		memcpy(blob + 39, &nonce, sizeof(nonce));
+		clock_type::time_point t = clock_type::now();
+		ctx.hash_with(kernel, blob, sizeof(blob), hash);
+		res.latencies_ns.push_back(boost::chrono::duration_cast<boost::chrono::nanoseconds>(clock_type::now() - t).count());
+	}
+	res.end = clock_type::now();
+}
+
+template <typename hash_t>
+run_result run_benchmark(const std::string& variant, cn_kernel kernel, cn_pad_mode pad, size_t threads, size_t count)
+{
+	cn_set_pad_policy(pad);
+
+	std::vector<worker_result> workers(threads);
+	boost::barrier barrier(threads);
+	boost::thread_group group;
+	for(size_t t = 0; t < threads; t++)
+		group.create_thread(boost::bind(&hash_worker<hash_t>, kernel, count, uint32_t(t * count), boost::ref(barrier), boost::ref(workers[t])));
+	group.join_all();
+
+	run_result res;
+	res.variant = variant;
+	res.kernel = kernel;
+	res.requested_pad = pad;
+	res.pad_mode = workers.front().pad_mode;
+	res.threads = threads;
+	res.hashes = threads * count;
+
+	clock_type::time_point start = workers.front().start;
+	clock_type::time_point end = workers.front().end;
+	for(const worker_result& w : workers)
+	{
+		start = std::min(start, w.start);
+		end = std::max(end, w.end);
+		// report the weakest allocation any thread ended up with
+		res.pad_mode = std::min(res.pad_mode, w.pad_mode);
+		res.latencies_ns.insert(res.latencies_ns.end(), w.latencies_ns.begin(), w.latencies_ns.end());
+	}
+	res.seconds = boost::chrono::duration_cast<boost::chrono::duration<double>>(end - start).count();
+	std::sort(res.latencies_ns.begin(), res.latencies_ns.end());
+	return res;
+}
+
+double percentile_us(const std::vector<uint64_t>& sorted, double q)
+{
+	if(sorted.empty())
+		return 0.0;
+	size_t idx = std::min(sorted.size() - 1, size_t(q * sorted.size()));
+	return sorted[idx] / 1000.0;
+}
+
+void print_result(const run_result& r, bool first)
+{
+	std::cout << (first ? "  " : ",\n  ") << std::fixed << std::setprecision(3)
+			  << "{\"variant\": \"" << r.variant << "\""
+			  << ", \"kernel\": \"" << cn_kernel_str(r.kernel) << "\""
+			  << ", \"requested_pages\": \"" << cn_pad_mode_str(r.requested_pad) << "\""
+			  << ", \"pages\": \"" << cn_pad_mode_str(r.pad_mode) << "\""
+			  << ", \"threads\": " << r.threads
+			  << ", \"hashes\": " << r.hashes
+			  << ", \"seconds\": " << r.seconds
+			  << ", \"hashes_per_sec\": " << (r.seconds > 0 ? r.hashes / r.seconds : 0.0)
+			  << ", \"latency_us\": {\"p50\": " << percentile_us(r.latencies_ns, 0.50)
+			  << ", \"p90\": " << percentile_us(r.latencies_ns, 0.90)
+			  << ", \"p99\": " << percentile_us(r.latencies_ns, 0.99)
+			  << ", \"max\": " << percentile_us(r.latencies_ns, 1.0) << "}}";
+}
+
+template <typename hash_t>
+void run_variant(const std::string& variant, const std::vector<cn_kernel>& kernels, const std::vector<cn_pad_mode>& pads,
+				 const std::vector<size_t>& thread_counts, size_t count, bool& first)
+{
+	for(cn_kernel kernel : kernels)
+	{
+		if(!hash_t::kernel_supported(kernel))
+		{
+			std::cerr << "Skipping " << variant << " with the " << cn_kernel_str(kernel) << " kernel, not supported" << std::endl;
+			continue;
+		}
+
+		// Timing a kernel that gets the wrong answer is meaningless
+		if(!hash_t::kernel_self_test(kernel))
+		{
+			std::cerr << "Skipping " << variant << " with the " << cn_kernel_str(kernel) << " kernel, it fails the self-test" << std::endl;
+			continue;
+		}
+
+		for(cn_pad_mode pad : pads)
+		{
+			for(size_t threads : thread_counts)
+			{
+				print_result(run_benchmark<hash_t>(variant, kernel, pad, threads, count), first);
+				first = false;
+			}
+		}
+	}
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+	po::options_description desc_options("Command line options");
+	const command_line::arg_descriptor<std::string> arg_variants = {"variants", "Comma separated PoW variants to run (v1, v2, v3)", "v1,v2,v3"};
+	const command_line::arg_descriptor<std::string> arg_kernels = {"kernels", "Comma separated kernels to run (soft, aes, avx2)", "soft,aes,avx2"};
+	const command_line::arg_descriptor<std::string> arg_pages = {"pages", "Scratchpad pages to test (aligned, huge or both)", "both"};
+	const command_line::arg_descriptor<unsigned> arg_threads = {"threads", "Maximum number of threads, runs 1, 2, 4, ... up to this", boost::thread::hardware_concurrency()};
+	const command_line::arg_descriptor<unsigned> arg_hashes = {"hashes", "Hashes per thread for each run", 16};
+	command_line::add_arg(desc_options, arg_variants);
+	command_line::add_arg(desc_options, arg_kernels);
+	command_line::add_arg(desc_options, arg_pages);
+	command_line::add_arg(desc_options, arg_threads);
+	command_line::add_arg(desc_options, arg_hashes);
+	command_line::add_arg(desc_options, command_line::arg_help);
+
+	po::variables_map vm;
+	bool r = command_line::handle_error_helper(desc_options, [&]() {
+		po::store(po::parse_command_line(argc, argv, desc_options), vm);
+		po::notify(vm);
+		return true;
+	});
+	if(!r)
+		return 1;
+
+	if(command_line::get_arg(vm, command_line::arg_help))
+	{
+		std::cout << desc_options << std::endl;
+		return 0;
+	}
+
+	std::vector<std::string> variants, kernel_names;
+	boost::split(variants, command_line::get_arg(vm, arg_variants), boost::is_any_of(","));
+	boost::split(kernel_names, command_line::get_arg(vm, arg_kernels), boost::is_any_of(","));
+
+	std::vector<cn_kernel> kernels;
+	for(const std::string& name : kernel_names)
+	{
+		if(name == "soft")
+			kernels.push_back(cn_kernel::soft);
+		else if(name == "aes")
+			kernels.push_back(cn_kernel::aes);
+		else if(name == "avx2")
+			kernels.push_back(cn_kernel::avx2);
+		else
+		{
+			std::cerr << "Unknown kernel " << name << std::endl;
+			return 1;
+		}
+	}
+
+	std::vector<cn_pad_mode> pads;
+	const std::string pages = command_line::get_arg(vm, arg_pages);
+	if(pages == "aligned" || pages == "both")
+		pads.push_back(cn_pad_mode::aligned);
+	if(pages == "huge" || pages == "both")
+		pads.push_back(cn_pad_mode::huge_tlb);
+	if(pads.empty())
+	{
+		std::cerr << "Unknown pages " << pages << std::endl;
+		return 1;
+	}
+
+	const size_t max_threads = std::max(1u, command_line::get_arg(vm, arg_threads));
+	std::vector<size_t> thread_counts;
+	for(size_t t = 1; t < max_threads; t *= 2)
+		thread_counts.push_back(t);
+	thread_counts.push_back(max_threads);
+
+	const size_t count = std::max(1u, command_line::get_arg(vm, arg_hashes));
+
+	const cn_cpu_features& cpu = cn_get_cpu_features();
+	std::cerr << "CPU features: sse2 " << cpu.sse2 << ", aes " << cpu.aes << ", avx2 " << cpu.avx2 << ", bmi2 " << cpu.bmi2 << std::endl;
+
+	bool first = true;
+	std::cout << "[\n";
+	for(const std::string& variant : variants)
+	{
+		if(variant == "v1")
+			run_variant<cn_pow_hash_v1>(variant, kernels, pads, thread_counts, count, first);
+		else if(variant == "v2")
+			run_variant<cn_pow_hash_v2>(variant, kernels, pads, thread_counts, count, first);
+		else if(variant == "v3")
+			run_variant<cn_pow_hash_v3>(variant, kernels, pads, thread_counts, count, first);
+		else
+			std::cerr << "Unknown variant " << variant << std::endl;
+	}
+	std::cout << "\n]" << std::endl;
+	return 0;
+}
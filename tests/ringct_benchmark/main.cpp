@@ -0,0 +1,440 @@
+// Copyright (c) 2019, Ryo Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2020
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Benchmarks of the ringct primitives over a sweep of ring sizes, input and output counts and
+// range proof batch sizes. Each result is the median time and the mean number of heap
+// allocations per operation. Results can be saved as a baseline, and later runs compared
+// against it, failing if any benchmark got slower or allocates more than the thresholds allow.
+// Results are printed to stdout as a JSON array.
+
+#include <algorithm>
+#include <atomic>
+#include <boost/algorithm/string.hpp>
+#include <boost/chrono.hpp>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "common/command_line.h"
+#include "device/device.hpp"
+#include "misc_log_ex.h"
+#include "ringct/bulletproofs.h"
+#include "ringct/rctOps.h"
+#include "ringct/rctSigs.h"
+
+namespace po = boost::program_options;
+
+// Every heap allocation of the process is counted, including those made on the threadpool
+static std::atomic<uint64_t> allocation_count(0);
+
+void *operator new(size_t size)
+{
+	allocation_count.fetch_add(1, std::memory_order_relaxed);
+	void *ptr = std::malloc(size == 0 ? 1 : size);
+	if(ptr == nullptr)
+		throw std::bad_alloc();
+	return ptr;
+}
+
+void operator delete(void *ptr) noexcept
+{
+	std::free(ptr);
+}
+
+namespace
+{
+typedef boost::chrono::steady_clock clock_type;
+
+struct bench_result
+{
+	std::string name;
+	double ns_per_op;
+	double allocs_per_op;
+	bool failed;
+};
+
+struct baseline_entry
+{
+	double ns_per_op;
+	double allocs_per_op;
+};
+
+// Inputs, rings and destinations of a simple rct tx, the real input is at a different ring index for each input
+struct rct_sample
+{
+	rct::ctkeyV in_sk;
+	rct::keyV destinations;
+	std::vector<rct::ryo_amount> in_amounts, out_amounts;
+	rct::ctkeyM mix_ring;
+	rct::keyV amount_keys;
+	std::vector<unsigned int> index;
+	rct::ryo_amount fee = 1000;
+
+	rct_sample(size_t ring_size, size_t inputs, size_t outputs)
+	{
+		rct::ryo_amount total = 0;
+		for(size_t n = 0; n < inputs; ++n)
+		{
+			rct::ctkey sk, pk;
+			const rct::ryo_amount amount = 1000000 + n;
+			std::tie(sk, pk) = rct::ctskpkGen(amount);
+			in_sk.push_back(sk);
+			in_amounts.push_back(amount);
+			total += amount;
+
+			index.push_back(n % ring_size);
+			mix_ring.emplace_back(ring_size);
+			for(size_t m = 0; m < ring_size; ++m)
+				mix_ring.back()[m] = m == index.back() ? pk : rct::ctkey{rct::pkGen(), rct::pkGen()};
+		}
+
+		for(size_t n = 0; n < outputs; ++n)
+		{
+			out_amounts.push_back((total - fee) / outputs + (n == 0 ? (total - fee) % outputs : 0));
+			destinations.push_back(rct::pkGen());
+			amount_keys.push_back(rct::skGen());
+		}
+	}
+
+	rct::rctSig sign() const
+	{
+		rct::ctkeyV out_sk;
+		return rct::genRctSimple(rct::zero(), in_sk, destinations, in_amounts, out_amounts, fee, mix_ring, amount_keys,
+								 nullptr, nullptr, index, out_sk, true, hw::get_device("default"));
+	}
+};
+
+// Runs op once to warm up the caches, then times it, ops is the number of operations a call does
+template <typename F>
+bench_result measure(const std::string &name, size_t iterations, size_t ops, const F &op)
+{
+	bench_result res = {name, 0.0, 0.0, false};
+	try
+	{
+		res.failed = !op();
+		std::vector<uint64_t> ns;
+		ns.reserve(iterations);
+		const uint64_t allocs = allocation_count.load();
+		for(size_t i = 0; i < iterations && !res.failed; ++i)
+		{
+			clock_type::time_point t = clock_type::now();
+			res.failed = !op();
+			ns.push_back(boost::chrono::duration_cast<boost::chrono::nanoseconds>(clock_type::now() - t).count());
+		}
+		res.allocs_per_op = double(allocation_count.load() - allocs) / (iterations * ops);
+		if(!ns.empty())
+		{
+			std::sort(ns.begin(), ns.end());
+			res.ns_per_op = double(ns[ns.size() / 2]) / ops;
+		}
+	}
+	catch(const std::exception &e)
+	{
+		std::cerr << name << " threw: " << e.what() << std::endl;
+		res.failed = true;
+	}
+	return res;
+}
+
+std::string make_name(const std::string &bench, const std::vector<std::pair<const char *, size_t>> &params)
+{
+	std::string name = bench;
+	for(const auto &p : params)
+		name += "/" + std::string(p.first) + "=" + std::to_string(p.second);
+	return name;
+}
+
+bool parse_sizes(const std::string &str, std::vector<size_t> &sizes)
+{
+	std::vector<std::string> fields;
+	boost::split(fields, str, boost::is_any_of(","));
+	for(const std::string &f : fields)
+	{
+		try
+		{
+			const size_t v = std::stoul(f);
+			if(v == 0)
+				return false;
+			sizes.push_back(v);
+		}
+		catch(const std::exception &e)
+		{
+			return false;
+		}
+	}
+	return !sizes.empty();
+}
+
+// Baseline files have one "<name> <ns per op> <allocations per op>" line per benchmark, # starts a comment
+bool load_baseline(const std::string &path, std::map<std::string, baseline_entry> &baseline)
+{
+	std::ifstream file(path);
+	if(!file)
+		return false;
+	std::string line;
+	while(std::getline(file, line))
+	{
+		if(line.empty() || line[0] == '#')
+			continue;
+		std::istringstream iss(line);
+		std::string name;
+		baseline_entry e;
+		if(!(iss >> name >> e.ns_per_op >> e.allocs_per_op))
+			return false;
+		baseline[name] = e;
+	}
+	return true;
+}
+
+bool save_baseline(const std::string &path, const std::vector<bench_result> &results)
+{
+	std::ofstream file(path);
+	if(!file)
+		return false;
+	file << "# name ns_per_op allocs_per_op" << std::endl;
+	file << std::fixed << std::setprecision(1);
+	for(const bench_result &r : results)
+		if(!r.failed)
+			file << r.name << " " << r.ns_per_op << " " << r.allocs_per_op << std::endl;
+	return bool(file);
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+	// keep stdout for the JSON results
+	mlog_configure(mlog_get_default_log_path("ringct_benchmark.log"), false);
+
+	po::options_description desc_options("Command line options");
+	const command_line::arg_descriptor<std::string> arg_benchmarks = {"benchmarks", "Comma separated benchmarks to run (sign, verify_mlsag, verify_semantics, prove)", "sign,verify_mlsag,verify_semantics,prove"};
+	const command_line::arg_descriptor<std::string> arg_ring_sizes = {"ring-sizes", "Comma separated ring sizes", "11,25"};
+	const command_line::arg_descriptor<std::string> arg_inputs = {"inputs", "Comma separated input counts", "1,2,8"};
+	const command_line::arg_descriptor<std::string> arg_outputs = {"outputs", "Comma separated output counts", "2,16"};
+	const command_line::arg_descriptor<std::string> arg_batch_sizes = {"batch-sizes", "Comma separated numbers of txs verified in one batch", "1,16,64"};
+	const command_line::arg_descriptor<unsigned> arg_iterations = {"iterations", "Timed calls of each benchmark", 10};
+	const command_line::arg_descriptor<std::string> arg_baseline = {"baseline", "Compare the results against this baseline file", ""};
+	const command_line::arg_descriptor<std::string> arg_save_baseline = {"save-baseline", "Save the results as a baseline file", ""};
+	const command_line::arg_descriptor<double> arg_max_time_regression = {"max-time-regression", "Allowed increase of the time per op over the baseline, in percent", 10.0};
+	const command_line::arg_descriptor<double> arg_max_alloc_regression = {"max-alloc-regression", "Allowed increase of the allocations per op over the baseline, in percent", 5.0};
+	command_line::add_arg(desc_options, arg_benchmarks);
+	command_line::add_arg(desc_options, arg_ring_sizes);
+	command_line::add_arg(desc_options, arg_inputs);
+	command_line::add_arg(desc_options, arg_outputs);
+	command_line::add_arg(desc_options, arg_batch_sizes);
+	command_line::add_arg(desc_options, arg_iterations);
+	command_line::add_arg(desc_options, arg_baseline);
+	command_line::add_arg(desc_options, arg_save_baseline);
+	command_line::add_arg(desc_options, arg_max_time_regression);
+	command_line::add_arg(desc_options, arg_max_alloc_regression);
+	command_line::add_arg(desc_options, command_line::arg_help);
+
+	po::variables_map vm;
+	bool r = command_line::handle_error_helper(desc_options, [&]() {
+		po::store(po::parse_command_line(argc, argv, desc_options), vm);
+		po::notify(vm);
+		return true;
+	});
+	if(!r)
+		return 1;
+
+	if(command_line::get_arg(vm, command_line::arg_help))
+	{
+		std::cout << desc_options << std::endl;
+		return 0;
+	}
+
+	std::vector<std::string> benchmarks;
+	boost::split(benchmarks, command_line::get_arg(vm, arg_benchmarks), boost::is_any_of(","));
+
+	std::vector<size_t> ring_sizes, inputs, outputs, batch_sizes;
+	if(!parse_sizes(command_line::get_arg(vm, arg_ring_sizes), ring_sizes) || !parse_sizes(command_line::get_arg(vm, arg_inputs), inputs) ||
+	   !parse_sizes(command_line::get_arg(vm, arg_outputs), outputs) || !parse_sizes(command_line::get_arg(vm, arg_batch_sizes), batch_sizes))
+	{
+		std::cerr << "Sizes must be comma separated positive numbers" << std::endl;
+		return 1;
+	}
+	for(size_t n : outputs)
+	{
+		if(n > cryptonote::common_config::BULLETPROOF_MAX_OUTPUTS)
+		{
+			std::cerr << "At most " << cryptonote::common_config::BULLETPROOF_MAX_OUTPUTS << " outputs are supported" << std::endl;
+			return 1;
+		}
+	}
+
+	const size_t iterations = std::max(1u, command_line::get_arg(vm, arg_iterations));
+
+	std::map<std::string, baseline_entry> baseline;
+	const std::string baseline_path = command_line::get_arg(vm, arg_baseline);
+	if(!baseline_path.empty() && !load_baseline(baseline_path, baseline))
+	{
+		std::cerr << "Failed to load baseline " << baseline_path << std::endl;
+		return 1;
+	}
+
+	std::vector<bench_result> results;
+	for(const std::string &bench : benchmarks)
+	{
+		if(bench == "sign")
+		{
+			for(size_t ring_size : ring_sizes)
+				for(size_t in : inputs)
+					for(size_t out : outputs)
+					{
+						const rct_sample sample(ring_size, in, out);
+						results.push_back(measure(make_name(bench, {{"ring", ring_size}, {"inputs", in}, {"outputs", out}}), iterations, 1, [&] {
+							sample.sign();
+							return true;
+						}));
+					}
+		}
+		else if(bench == "verify_mlsag")
+		{
+			for(size_t ring_size : ring_sizes)
+				for(size_t in : inputs)
+				{
+					const rct::rctSig sig = rct_sample(ring_size, in, 2).sign();
+					results.push_back(measure(make_name(bench, {{"ring", ring_size}, {"inputs", in}}), iterations, 1, [&] {
+						return rct::verRctNonSemanticsSimple(sig);
+					}));
+				}
+		}
+		else if(bench == "verify_semantics")
+		{
+			// one op is one tx of the batch, each tx of a batch is a different one
+			const size_t max_batch = *std::max_element(batch_sizes.begin(), batch_sizes.end());
+			for(size_t out : outputs)
+			{
+				std::vector<rct::rctSig> sigs;
+				sigs.reserve(max_batch);
+				for(size_t n = 0; n < max_batch; ++n)
+					sigs.push_back(rct_sample(ring_sizes.front(), 1, out).sign());
+
+				for(size_t batch : batch_sizes)
+				{
+					std::vector<const rct::rctSig *> batch_sigs;
+					for(size_t n = 0; n < batch; ++n)
+						batch_sigs.push_back(&sigs[n]);
+					results.push_back(measure(make_name(bench, {{"outputs", out}, {"batch", batch}}), iterations, batch, [&] {
+						return rct::verRctSemanticsSimple(batch_sigs);
+					}));
+				}
+			}
+		}
+		else if(bench == "prove")
+		{
+			for(size_t out : outputs)
+			{
+				const std::vector<uint64_t> amounts(out, 1000000);
+				const rct::keyV masks = rct::skvGen(out);
+				results.push_back(measure(make_name(bench, {{"outputs", out}}), iterations, 1, [&] {
+					rct::bulletproof_PROVE(amounts, masks);
+					return true;
+				}));
+			}
+		}
+		else
+		{
+			std::cerr << "Unknown benchmark " << bench << std::endl;
+			return 1;
+		}
+	}
+
+	const double max_time_regression = command_line::get_arg(vm, arg_max_time_regression);
+	const double max_alloc_regression = command_line::get_arg(vm, arg_max_alloc_regression);
+	size_t failed = 0, regressed = 0;
+	std::cout << "[\n";
+	for(size_t i = 0; i < results.size(); ++i)
+	{
+		const bench_result &res = results[i];
+		std::cout << (i == 0 ? "  " : ",\n  ") << std::fixed << std::setprecision(1)
+				  << "{\"name\": \"" << res.name << "\""
+				  << ", \"failed\": " << (res.failed ? "true" : "false")
+				  << ", \"ns_per_op\": " << res.ns_per_op
+				  << ", \"allocs_per_op\": " << res.allocs_per_op;
+		if(res.failed)
+			++failed;
+
+		auto it = baseline.find(res.name);
+		if(!res.failed && it != baseline.end())
+		{
+			const baseline_entry &base = it->second;
+			const double time_change = base.ns_per_op > 0 ? (res.ns_per_op - base.ns_per_op) * 100.0 / base.ns_per_op : 0.0;
+			// allocation counts are small integers, so less than one more allocation is never a regression
+			const bool alloc_regression = res.allocs_per_op - base.allocs_per_op >= 1.0 &&
+										  res.allocs_per_op > base.allocs_per_op * (1.0 + max_alloc_regression / 100.0);
+			const bool regression = time_change > max_time_regression || alloc_regression;
+			std::cout << ", \"baseline_ns_per_op\": " << base.ns_per_op
+					  << ", \"baseline_allocs_per_op\": " << base.allocs_per_op
+					  << ", \"time_change_pct\": " << time_change
+					  << ", \"regression\": " << (regression ? "true" : "false");
+			if(regression)
+			{
+				std::cerr << "Regression in " << res.name << ": " << res.ns_per_op << " ns/op (" << base.ns_per_op << "), "
+						  << res.allocs_per_op << " allocs/op (" << base.allocs_per_op << ")" << std::endl;
+				++regressed;
+			}
+		}
+		std::cout << "}";
+	}
+	std::cout << "\n]" << std::endl;
+
+	const std::string save_path = command_line::get_arg(vm, arg_save_baseline);
+	if(!save_path.empty() && !save_baseline(save_path, results))
+	{
+		std::cerr << "Failed to save baseline " << save_path << std::endl;
+		return 1;
+	}
+
+	if(failed)
+		std::cerr << failed << " benchmarks failed" << std::endl;
+	if(regressed)
+		std::cerr << regressed << " benchmarks regressed against " << baseline_path << std::endl;
+	return failed || regressed ? 1 : 0;
+}
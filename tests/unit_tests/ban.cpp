@@ -66,6 +66,7 @@ class test_core
 	}
 	bool handle_incoming_tx(const cryptonote::blobdata &tx_blob, cryptonote::tx_verification_context &tvc, bool keeped_by_block, bool relayed, bool do_not_relay) { return true; }
 	bool handle_incoming_txs(const std::list<cryptonote::blobdata> &tx_blob, std::vector<cryptonote::tx_verification_context> &tvc, bool keeped_by_block, bool relayed, bool do_not_relay) { return true; }
+	bool handle_incoming_relayed_txs(const std::list<cryptonote::blobdata> &tx_blobs, std::vector<cryptonote::tx_verification_context> &tvc) { tvc.resize(tx_blobs.size()); return true; }
 	bool handle_incoming_block(const cryptonote::blobdata &block_blob, cryptonote::block_verification_context &bvc, bool update_miner_blocktemplate = true) { return true; }
 	void pause_mine() {}
 	void resume_mine() {}
@@ -77,6 +78,7 @@ class test_core
 	bool get_test_drop_download_height() const { return true; }
 	bool prepare_handle_incoming_blocks(const std::list<cryptonote::block_complete_entry> &blocks) { return true; }
 	bool cleanup_handle_incoming_blocks(bool force_sync = false) { return true; }
+	void prefetch_pow_hashes(const std::list<cryptonote::block_complete_entry> &blocks) {}
 	uint64_t get_target_blockchain_height() const { return 1; }
 	size_t get_block_sync_size(uint64_t height) const { return BLOCKS_SYNCHRONIZING_DEFAULT_COUNT; }
 	virtual void on_transaction_relayed(const cryptonote::blobdata &tx) {}
@@ -85,3 +85,20 @@ TEST(block_queue, flush_uuid)
 	bq.add_blocks(0, 200, uuid1());
 	ASSERT_EQ(bq.get_max_block_height(), 399);
 }
+
+TEST(block_queue, get_filled_span)
+{
+	cryptonote::block_queue bq;
+	std::list<cryptonote::block_complete_entry> bcel;
+
+	bq.add_blocks(0, std::list<cryptonote::block_complete_entry>(2), uuid1(), 1.0f, 0);
+	bq.add_blocks(2, 10, uuid2());
+	ASSERT_TRUE(bq.get_filled_span(0, bcel));
+	ASSERT_EQ(bcel.size(), 2);
+	ASSERT_FALSE(bq.get_filled_span(1, bcel));
+	ASSERT_FALSE(bq.get_filled_span(2, bcel));
+
+	bq.add_blocks(2, std::list<cryptonote::block_complete_entry>(3), uuid2(), 1.0f, 0);
+	ASSERT_TRUE(bq.get_filled_span(2, bcel));
+	ASSERT_EQ(bcel.size(), 3);
+}
@@ -448,4 +448,41 @@ TYPED_TEST(BlockchainDBTest, RetrieveBlockData)
 	ASSERT_HASH_EQ(get_block_hash(this->m_blocks[1]), hashes[1]);
 }
 
+TYPED_TEST(BlockchainDBTest, PowHashCache)
+{
+	boost::filesystem::path tempPath = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+	std::string dirPath = tempPath.string();
+
+	this->set_prefix(dirPath);
+
+	ASSERT_NO_THROW(this->m_db->open(dirPath));
+	this->get_filenames();
+
+	crypto::hash id0 = get_block_hash(this->m_blocks[0]);
+	crypto::hash id1 = get_block_hash(this->m_blocks[1]);
+	crypto::hash pow0 = crypto::cn_fast_hash(&id0, sizeof(id0));
+	crypto::hash pow1 = crypto::cn_fast_hash(&id1, sizeof(id1));
+	crypto::hash pow;
+
+	ASSERT_FALSE(this->m_db->get_pow_hash(id0, 10, pow));
+
+	ASSERT_NO_THROW(this->m_db->add_pow_hash(id0, 10, pow0));
+	ASSERT_NO_THROW(this->m_db->add_pow_hash(id1, 10, pow1));
+	ASSERT_NO_THROW(this->m_db->add_pow_hash(id1, 11, pow1));
+	// adding an entry twice is fine
+	ASSERT_NO_THROW(this->m_db->add_pow_hash(id0, 10, pow0));
+
+	ASSERT_TRUE(this->m_db->get_pow_hash(id0, 10, pow));
+	ASSERT_HASH_EQ(pow0, pow);
+	ASSERT_TRUE(this->m_db->get_pow_hash(id1, 10, pow));
+	ASSERT_HASH_EQ(pow1, pow);
+	ASSERT_FALSE(this->m_db->get_pow_hash(id0, 11, pow));
+
+	ASSERT_NO_THROW(this->m_db->prune_pow_hashes(11));
+	ASSERT_FALSE(this->m_db->get_pow_hash(id0, 10, pow));
+	ASSERT_FALSE(this->m_db->get_pow_hash(id1, 10, pow));
+	ASSERT_TRUE(this->m_db->get_pow_hash(id1, 11, pow));
+	ASSERT_HASH_EQ(pow1, pow);
+}
+
 } // anonymous namespace
@@ -35,6 +35,10 @@
 
 #include "cryptonote_basic/cryptonote_basic_impl.h"
 
+extern "C" {
+#include "crypto/crypto-ops.h"
+}
+
 namespace
 {
 static constexpr const std::uint8_t source[] = {
@@ -96,3 +100,76 @@ TEST(Crypto, verify_32)
 		}
 	}
 }
+
+TEST(Crypto, batched_derivations)
+{
+	const size_t count = 9;
+	crypto::public_key spend_public_key, tx_pub_keys[count];
+	crypto::secret_key view_secret_key, tx_secret_key;
+	crypto::generate_legacy_keys(spend_public_key, view_secret_key);
+	for(size_t i = 0; i < count; ++i)
+		crypto::generate_legacy_keys(tx_pub_keys[i], tx_secret_key);
+	memset(tx_pub_keys[4].data, 0xff, sizeof(tx_pub_keys[4].data)); // not a point
+
+	crypto::key_derivation derivations[count];
+	bool valid[count];
+	crypto::generate_key_derivations(tx_pub_keys, count, view_secret_key, derivations, valid);
+	for(size_t i = 0; i < count; ++i)
+	{
+		crypto::key_derivation derivation;
+		ASSERT_EQ(valid[i], crypto::generate_key_derivation(tx_pub_keys[i], view_secret_key, derivation));
+		if(valid[i])
+			ASSERT_EQ(memcmp(&derivation, &derivations[i], sizeof(derivation)), 0);
+		else
+			derivations[i] = derivations[0];
+	}
+
+	size_t output_indexes[count];
+	crypto::public_key derived_keys[count];
+	for(size_t i = 0; i < count; ++i)
+		output_indexes[i] = 3 * i;
+	ASSERT_TRUE(crypto::derive_public_keys(derivations, output_indexes, count, spend_public_key, derived_keys));
+	for(size_t i = 0; i < count; ++i)
+	{
+		crypto::public_key derived_key;
+		ASSERT_TRUE(crypto::derive_public_key(derivations[i], output_indexes[i], spend_public_key, derived_key));
+		ASSERT_EQ(derived_key, derived_keys[i]);
+	}
+	ASSERT_FALSE(crypto::derive_public_keys(derivations, output_indexes, count, tx_pub_keys[4], derived_keys));
+}
+
+TEST(Crypto, point_at_infinity_by_value)
+{
+	ASSERT_TRUE(ge_p3_is_point_at_infinity(&ge_p3_identity));
+	ASSERT_FALSE(ge_p3_is_point_at_infinity(&ge_p3_H));
+
+	// P - P comes out of the point arithmetic with unreduced limbs
+	ge_p3 p, q;
+	ge_cached cached;
+	ge_p1p1 p1;
+	crypto::public_key pub;
+	crypto::secret_key sec;
+	crypto::generate_legacy_keys(pub, sec);
+	ASSERT_EQ(ge_frombytes_vartime(&p, (const unsigned char *)pub.data), 0);
+	ASSERT_FALSE(ge_p3_is_point_at_infinity(&p));
+	ge_p3_to_cached(&cached, &p);
+	ge_sub(&p1, &p, &cached);
+	ge_p1p1_to_p3(&q, &p1);
+	ASSERT_TRUE(ge_p3_is_point_at_infinity(&q));
+
+	// Y = 1 and Z = 1 + (2^255 - 19) are the same value with different limbs
+	ge_p3 r = ge_p3_identity;
+#if defined(CRYPTO_FE51)
+	const uint64_t mask = (uint64_t(1) << 51) - 1;
+	r.Z[0] = mask - 17;
+	for(size_t i = 1; i < 5; i++)
+		r.Z[i] = mask;
+#else
+	for(size_t i = 0; i < 10; i++)
+		r.Z[i] = (i & 1) ? (1 << 25) - 1 : (1 << 26) - 1;
+	r.Z[0] -= 17;
+#endif
+	ASSERT_TRUE(ge_p3_is_point_at_infinity(&r));
+	r.Z[1] -= 1;
+	ASSERT_FALSE(ge_p3_is_point_at_infinity(&r));
+}
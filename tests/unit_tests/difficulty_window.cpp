@@ -0,0 +1,170 @@
+// Copyright (c) 2019, Ryo Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2020
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+#include "cryptonote_basic/difficulty.h"
+#include "cryptonote_config.h"
+
+#include <algorithm>
+#include <deque>
+#include <random>
+
+using namespace cryptonote;
+
+namespace
+{
+void check_window(const difficulty_window &window, const std::deque<uint64_t> &timestamps, const std::deque<difficulty_type> &difficulties)
+{
+	ASSERT_EQ(window.size(), timestamps.size());
+	ASSERT_TRUE(std::equal(timestamps.begin(), timestamps.end(), window.timestamps().begin()));
+	ASSERT_TRUE(std::equal(difficulties.begin(), difficulties.end(), window.cumulative_difficulties().begin()));
+
+	std::vector<uint64_t> sorted(timestamps.begin(), timestamps.begin() + std::min(timestamps.size(), window.sorted_count()));
+	std::sort(sorted.begin(), sorted.end());
+	ASSERT_EQ(window.sorted_timestamps().size(), sorted.size());
+	ASSERT_TRUE(std::equal(sorted.begin(), sorted.end(), window.sorted_timestamps().begin()));
+}
+
+// runs random pushes and pops on both ends of the window and compares every step with a deque
+void run_window(size_t max_size, size_t sorted_count)
+{
+	std::mt19937 rng(max_size);
+	difficulty_window window;
+	window.reset(max_size, sorted_count);
+	std::deque<uint64_t> timestamps;
+	std::deque<difficulty_type> difficulties;
+	difficulty_type cumulative = 1000;
+
+	for(size_t i = 0; i < 20 * max_size; ++i)
+	{
+		// timestamps go mostly up, with some out of order ones and duplicates
+		const uint64_t timestamp = 1000000 + i * common_config::DIFFICULTY_TARGET + rng() % (4 * common_config::DIFFICULTY_TARGET);
+		const unsigned int op = rng() % 10;
+		if(op < 6)
+		{
+			cumulative += 1 + rng() % 100;
+			window.push_back(timestamp, cumulative);
+			timestamps.push_back(timestamp);
+			difficulties.push_back(cumulative);
+			if(timestamps.size() > max_size)
+			{
+				timestamps.pop_front();
+				difficulties.pop_front();
+			}
+		}
+		else if(op < 8 && !timestamps.empty())
+		{
+			window.pop_back();
+			timestamps.pop_back();
+			difficulties.pop_back();
+		}
+		else if(op < 9 && timestamps.size() < max_size)
+		{
+			const difficulty_type front = difficulties.empty() ? cumulative : difficulties.front();
+			window.push_front(timestamp, front - 1);
+			timestamps.push_front(timestamp);
+			difficulties.push_front(front - 1);
+		}
+		else if(!timestamps.empty())
+		{
+			window.pop_front();
+			timestamps.pop_front();
+			difficulties.pop_front();
+		}
+		check_window(window, timestamps, difficulties);
+		if(::testing::Test::HasFatalFailure())
+			return;
+	}
+
+	window.clear();
+	ASSERT_EQ(window.size(), 0);
+	ASSERT_EQ(window.max_size(), max_size);
+	ASSERT_EQ(window.sorted_timestamps().size(), 0);
+}
+}
+
+TEST(difficulty_window, v1)
+{
+	run_window(common_config::DIFFICULTY_BLOCKS_COUNT_V1, common_config::DIFFICULTY_WINDOW_V1);
+}
+
+TEST(difficulty_window, v2)
+{
+	run_window(common_config::DIFFICULTY_BLOCKS_COUNT_V2, common_config::DIFFICULTY_BLOCKS_COUNT_V2);
+}
+
+TEST(difficulty_window, unsorted)
+{
+	run_window(common_config::DIFFICULTY_BLOCKS_COUNT_V4, 0);
+}
+
+TEST(difficulty_window, sorted_difficulty_matches)
+{
+	std::mt19937 rng(42);
+	difficulty_window window_v1, window_v2;
+	window_v1.reset(common_config::DIFFICULTY_BLOCKS_COUNT_V1, common_config::DIFFICULTY_WINDOW_V1);
+	window_v2.reset(common_config::DIFFICULTY_BLOCKS_COUNT_V2, common_config::DIFFICULTY_BLOCKS_COUNT_V2);
+	std::vector<uint64_t> timestamps;
+	std::vector<difficulty_type> difficulties;
+	difficulty_type cumulative = 0;
+
+	for(size_t i = 0; i < 2 * common_config::DIFFICULTY_BLOCKS_COUNT_V1; ++i)
+	{
+		const uint64_t timestamp = 1000000 + i * common_config::DIFFICULTY_TARGET + rng() % (4 * common_config::DIFFICULTY_TARGET);
+		cumulative += 100000 + rng() % 100000;
+		window_v1.push_back(timestamp, cumulative);
+		window_v2.push_back(timestamp, cumulative);
+		timestamps.push_back(timestamp);
+		difficulties.push_back(cumulative);
+
+		const size_t v1_begin = timestamps.size() - window_v1.size();
+		ASSERT_EQ(next_difficulty_v1_sorted(window_v1.sorted_timestamps(), window_v1.cumulative_difficulties(), common_config::DIFFICULTY_TARGET),
+			next_difficulty_v1(epee::span<const uint64_t>(timestamps.data() + v1_begin, window_v1.size()),
+				epee::span<const difficulty_type>(difficulties.data() + v1_begin, window_v1.size()), common_config::DIFFICULTY_TARGET));
+
+		const size_t v2_begin = timestamps.size() - window_v2.size();
+		ASSERT_EQ(next_difficulty_v2_sorted(window_v2.sorted_timestamps(), window_v2.cumulative_difficulties(), common_config::DIFFICULTY_TARGET),
+			next_difficulty_v2(epee::span<const uint64_t>(timestamps.data() + v2_begin, window_v2.size()),
+				epee::span<const difficulty_type>(difficulties.data() + v2_begin, window_v2.size()), common_config::DIFFICULTY_TARGET));
+	}
+}
@@ -30,10 +30,12 @@
 #include <boost/endian/conversion.hpp>
 #include <boost/range/algorithm/equal.hpp>
 #include <boost/range/algorithm_ext/iota.hpp>
+#include <boost/thread/thread.hpp>
 #include <cstdint>
 #include <gtest/gtest.h>
 #include <iterator>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
@@ -49,6 +51,7 @@
 #include "p2p/net_peerlist_boost_serialization.h"
 #include "span.h"
 #include "string_tools.h"
+#include "syncobj.h"
 
 namespace
 {
@@ -665,3 +668,97 @@ TEST(NetUtils, PrivateRanges)
 	ASSERT_EQ(is_local("0.0.30.172"), false);
 	ASSERT_EQ(is_local("0.0.30.127"), false);
 }
+
+namespace
+{
+bool try_lock_elsewhere(epee::rw_critical_section &lock)
+{
+	bool locked = false;
+	boost::thread t([&] {
+		locked = lock.tryLock();
+		if(locked)
+			lock.unlock();
+	});
+	t.join();
+	return locked;
+}
+
+// returns once another thread got the lock shared and released it again
+void lock_shared_elsewhere(epee::rw_critical_section &lock)
+{
+	boost::thread t([&] {
+		lock.lock_shared();
+		lock.unlock_shared();
+	});
+	t.join();
+}
+}
+
+TEST(RwCriticalSection, SharedReentry)
+{
+	epee::rw_critical_section lock;
+	lock.lock_shared();
+	lock.lock_shared();
+	lock_shared_elsewhere(lock);
+	EXPECT_FALSE(try_lock_elsewhere(lock));
+
+	lock.unlock_shared();
+	EXPECT_FALSE(try_lock_elsewhere(lock));
+	lock.unlock_shared();
+	EXPECT_TRUE(try_lock_elsewhere(lock));
+}
+
+TEST(RwCriticalSection, ExclusiveReentry)
+{
+	epee::rw_critical_section lock;
+	lock.lock();
+	EXPECT_TRUE(lock.tryLock());
+	lock.lock();
+	lock.unlock();
+	lock.unlock();
+	EXPECT_FALSE(try_lock_elsewhere(lock));
+	lock.unlock();
+	EXPECT_TRUE(try_lock_elsewhere(lock));
+}
+
+TEST(RwCriticalSection, OwnerTakesShared)
+{
+	epee::rw_critical_section lock;
+	lock.lock();
+	lock.lock_shared();
+	lock.lock_shared();
+	lock.unlock_shared();
+	EXPECT_FALSE(try_lock_elsewhere(lock));
+	lock.unlock_shared();
+	EXPECT_FALSE(try_lock_elsewhere(lock));
+	lock.unlock();
+	EXPECT_TRUE(try_lock_elsewhere(lock));
+
+	// releasing the exclusive lock first leaves it held shared
+	lock.lock();
+	lock.lock_shared();
+	lock.unlock();
+	lock_shared_elsewhere(lock);
+	EXPECT_FALSE(try_lock_elsewhere(lock));
+	EXPECT_THROW(lock.lock(), std::logic_error);
+	lock.unlock_shared();
+	EXPECT_TRUE(try_lock_elsewhere(lock));
+}
+
+TEST(RwCriticalSection, SharedHolderCannotLockExclusive)
+{
+	epee::rw_critical_section lock;
+	lock.lock_shared();
+	EXPECT_THROW(lock.lock(), std::logic_error);
+	EXPECT_FALSE(lock.tryLock());
+	{
+		SHARED_CRITICAL_REGION_LOCAL(lock);
+		EXPECT_THROW(CRITICAL_REGION_LOCAL1(lock), std::logic_error);
+	}
+	lock.unlock_shared();
+
+	// nothing was left locked by the failed attempts
+	EXPECT_TRUE(try_lock_elsewhere(lock));
+	lock.lock();
+	lock.unlock();
+}
@@ -124,6 +124,9 @@ class TestDB : public BlockchainDB
 	virtual bool get_txpool_tx_blob(const crypto::hash &txid, cryptonote::blobdata &bd) const { return false; }
 	virtual cryptonote::blobdata get_txpool_tx_blob(const crypto::hash &txid) const { return ""; }
 	virtual bool for_all_txpool_txes(std::function<bool(const crypto::hash &, const txpool_tx_meta_t &, const cryptonote::blobdata *)>, bool include_blob = false, bool include_unrelayed_txes = false) const { return false; }
+	virtual void add_pow_hash(const crypto::hash &blk_hash, uint64_t height, const crypto::hash &pow) {}
+	virtual bool get_pow_hash(const crypto::hash &blk_hash, uint64_t height, crypto::hash &pow) const { return false; }
+	virtual void prune_pow_hashes(uint64_t min_height) {}
 
 	virtual void add_block(const block &blk, const size_t &block_size, const difficulty_type &cumulative_difficulty, const uint64_t &coins_generated, const crypto::hash &blk_hash)
 	{
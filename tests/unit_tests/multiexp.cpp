@@ -32,6 +32,9 @@
 #include "ringct/multiexp.h"
 #include "ringct/rctOps.h"
 
+#include <boost/filesystem.hpp>
+#include <fstream>
+
 static const rct::key TESTSCALAR = rct::skGen();
 static const rct::key TESTPOW2SCALAR = {{0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}};
 static const rct::key TESTSMALLSCALAR = {{5, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}};
@@ -254,3 +257,169 @@ TEST(multiexp, pippenger_cached)
 		ASSERT_TRUE(basic(exp.me_pad) == exp.multiexp_p());
 	}
 }
+
+TEST(multiexp, attached_cache)
+{
+	static constexpr size_t N = 64;
+	std::vector<rct::MultiexpData> P(N);
+	for(size_t n = 0; n < N; ++n)
+		P[n] = {rct::skGen(), get_p3(rct::scalarmultBase(rct::skGen()))};
+
+	aligned_ptr<rct::ge_cached_pad[]> s_mem = make_aligned_array<rct::ge_cached_pad>(4096, rct::straus_cache::cache_entries(N));
+	rct::straus_cache s_cache;
+	s_cache.attach_cache(s_mem.get(), N);
+	s_cache.init_cache(P);
+	ASSERT_TRUE(s_cache.st_offset(0, 1) == &s_mem[0].gec);
+	ASSERT_TRUE(basic(P) == s_cache.straus(P, 0));
+
+	aligned_ptr<rct::ge_cached_pad[]> p_mem = make_aligned_array<rct::ge_cached_pad>(4096, rct::pippenger_cache::cache_entries(N));
+	aligned_ptr<ge_p3[]> buckets;
+	rct::pippenger_cache p_cache;
+	p_cache.attach_cache(p_mem.get(), N);
+	p_cache.init_cache(P);
+	ASSERT_TRUE(p_cache.pp_offset(0) == &p_mem[0].gec);
+	ASSERT_TRUE(basic(P) == p_cache.pippenger(P, buckets, rct::pippenger_cache::get_pippenger_c(N)));
+}
+
+TEST(multiexp, pippenger_threads)
+{
+	static constexpr size_t N = 256;
+	std::vector<rct::MultiexpData> P(N);
+	for(size_t n = 0; n < N; ++n)
+		P[n] = {rct::skGen(), get_p3(rct::scalarmultBase(rct::skGen()))};
+	const rct::key res = basic(P);
+
+	rct::pippenger_cache cache;
+	cache.init_cache(P);
+	aligned_ptr<ge_p3[]> buckets;
+	for(size_t threads = 1; threads <= 8; ++threads)
+		ASSERT_TRUE(res == cache.pippenger(P, buckets, 0, threads));
+}
+
+// Builds or maps its own copy of the bulletproof tables from the given file
+class test_multiexp_tables
+{
+public:
+	explicit test_multiexp_tables(const std::string &path) : cache(path) {}
+
+	bool mapped() const { return cache.tables_region != nullptr; }
+
+	// the same generators and precomputed tables as the global cache
+	bool same_as_global() const
+	{
+		const size_t points = rct::maxN * rct::maxM;
+		std::vector<rct::MultiexpData> data;
+		for(size_t i = 0; i < points; ++i)
+		{
+			if(!(cache.Hi_cache[i] == rct::multiexp_cache::Hi(i)) || !(cache.Gi_cache[i] == rct::multiexp_cache::Gi(i)))
+				return false;
+			if(memcmp(&cache.Hi_p3_cache[i], &rct::multiexp_cache::Hi_p3(i), sizeof(ge_p3)) || memcmp(&cache.Gi_p3_cache[i], &rct::multiexp_cache::Gi_p3(i), sizeof(ge_p3)))
+				return false;
+			data.emplace_back(rct::skGen(), cache.Gi_p3_cache[i]);
+			data.emplace_back(rct::skGen(), cache.Hi_p3_cache[i]);
+		}
+
+		aligned_ptr<ge_p3[]> buckets;
+		const rct::key res = basic(data);
+		if(!(res == cache.p_cache.pippenger(data, buckets, rct::pippenger_cache::get_pippenger_c(data.size()))))
+			return false;
+		data.resize(128);
+		return basic(data) == cache.s_cache.straus(data, 0);
+	}
+
+private:
+	rct::multiexp_cache cache;
+};
+
+class multiexp_tables : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		dir = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+		boost::filesystem::create_directories(dir);
+		path = (dir / "bulletproof_tables.bin").string();
+	}
+
+	void TearDown() override
+	{
+		boost::filesystem::remove_all(dir);
+	}
+
+	size_t files_in_dir() const
+	{
+		return std::distance(boost::filesystem::directory_iterator(dir), boost::filesystem::directory_iterator());
+	}
+
+	void poke(const std::string &file, size_t offset) const
+	{
+		std::fstream f(file, std::ios::in | std::ios::out | std::ios::binary);
+		f.seekg(offset);
+		const char c = f.get() ^ 0x01;
+		f.seekp(offset);
+		f.put(c);
+	}
+
+	boost::filesystem::path dir;
+	std::string path;
+};
+
+TEST_F(multiexp_tables, save_and_load)
+{
+	{
+		test_multiexp_tables built(path);
+		ASSERT_FALSE(built.mapped());
+		ASSERT_TRUE(built.same_as_global());
+	}
+	// written to a temporary name and renamed into place
+	ASSERT_EQ(boost::filesystem::file_size(path), rct::multiexp_cache::get_tables_size());
+	ASSERT_EQ(files_in_dir(), 1);
+
+	test_multiexp_tables loaded(path);
+	ASSERT_TRUE(loaded.mapped());
+	ASSERT_TRUE(loaded.same_as_global());
+}
+
+TEST_F(multiexp_tables, corrupt_file_is_rebuilt)
+{
+	{
+		test_multiexp_tables built(path);
+	}
+	// the rebuilt file must replace this one rather than be written through it
+	const std::string link = (dir / "link.bin").string();
+	boost::filesystem::create_hard_link(path, link);
+	poke(path, rct::multiexp_cache::get_tables_size() - 1);
+	{
+		test_multiexp_tables rebuilt(path);
+		ASSERT_FALSE(rebuilt.mapped());
+		ASSERT_TRUE(rebuilt.same_as_global());
+	}
+	ASSERT_FALSE(test_multiexp_tables(link).mapped());
+	ASSERT_EQ(files_in_dir(), 2);
+
+	test_multiexp_tables loaded(path);
+	ASSERT_TRUE(loaded.mapped());
+	ASSERT_TRUE(loaded.same_as_global());
+}
+
+TEST_F(multiexp_tables, stale_file_is_rebuilt)
+{
+	{
+		test_multiexp_tables built(path);
+	}
+	// the format version
+	poke(path, 16);
+	{
+		test_multiexp_tables rebuilt(path);
+		ASSERT_FALSE(rebuilt.mapped());
+	}
+	ASSERT_TRUE(test_multiexp_tables(path).mapped());
+
+	boost::filesystem::resize_file(path, rct::multiexp_cache::get_tables_size() / 2);
+	{
+		test_multiexp_tables rebuilt(path);
+		ASSERT_FALSE(rebuilt.mapped());
+		ASSERT_TRUE(rebuilt.same_as_global());
+	}
+	ASSERT_TRUE(test_multiexp_tables(path).mapped());
+}
@@ -0,0 +1,176 @@
+// Copyright (c) 2019, Ryo Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2020
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+#include "cryptonote_core/pow_prefetcher.h"
+
+#include <boost/thread/condition_variable.hpp>
+#include <cstring>
+#include <set>
+
+using namespace cryptonote;
+
+namespace
+{
+crypto::hash make_hash(uint32_t n, uint8_t tag)
+{
+	crypto::hash h = crypto::null_hash;
+	memcpy(h.data, &n, sizeof(n));
+	h.data[31] = tag;
+	return h;
+}
+
+std::vector<block> make_blocks(uint32_t first, size_t count)
+{
+	std::vector<block> blocks(count);
+	for(size_t i = 0; i < count; i++)
+		blocks[i].nonce = first + i;
+	return blocks;
+}
+
+// "hashes" blocks by their nonce and can be held at a gate until released
+struct test_worker
+{
+	boost::mutex lock;
+	boost::condition_variable cond;
+	std::set<boost::thread::id> threads;
+	size_t calls = 0;
+	bool gate_closed = false;
+
+	void operator()(std::vector<cn_pow_hash_v2> &, const std::vector<block> &blocks, std::unordered_map<crypto::hash, crypto::hash> &map)
+	{
+		{
+			boost::unique_lock<boost::mutex> l(lock);
+			calls++;
+			threads.insert(boost::this_thread::get_id());
+			cond.notify_all();
+			while(gate_closed)
+				cond.wait(l);
+		}
+		for(const block &b : blocks)
+			map.emplace(make_hash(b.nonce, 1), make_hash(b.nonce, 2));
+	}
+
+	void open_gate()
+	{
+		boost::lock_guard<boost::mutex> l(lock);
+		gate_closed = false;
+		cond.notify_all();
+	}
+};
+
+pow_prefetcher::worker_t bind_worker(test_worker &w)
+{
+	return [&w](std::vector<cn_pow_hash_v2> &ctxes, const std::vector<block> &blocks, std::unordered_map<crypto::hash, crypto::hash> &map) { w(ctxes, blocks, map); };
+}
+}
+
+TEST(pow_prefetcher, prefetched_hashes_are_taken)
+{
+	test_worker w;
+	pow_prefetcher prefetcher(bind_worker(w));
+
+	prefetcher.start(make_blocks(0, 10), 3);
+	std::unordered_map<crypto::hash, crypto::hash> hashes = prefetcher.take();
+	ASSERT_EQ(10, hashes.size());
+	for(uint32_t n = 0; n < 10; n++)
+	{
+		auto it = hashes.find(make_hash(n, 1));
+		ASSERT_TRUE(it != hashes.end());
+		ASSERT_EQ(make_hash(n, 2), it->second);
+	}
+	ASSERT_EQ(3, w.calls);
+
+	// they are handed out only once
+	ASSERT_TRUE(prefetcher.take().empty());
+}
+
+TEST(pow_prefetcher, untaken_span_is_dropped)
+{
+	test_worker w;
+	pow_prefetcher prefetcher(bind_worker(w));
+
+	prefetcher.start(make_blocks(0, 4), 2);
+	prefetcher.start(make_blocks(100, 4), 2);
+	std::unordered_map<crypto::hash, crypto::hash> hashes = prefetcher.take();
+	ASSERT_EQ(4, hashes.size());
+	for(uint32_t n = 0; n < 4; n++)
+	{
+		ASSERT_EQ(0, hashes.count(make_hash(n, 1)));
+		ASSERT_EQ(1, hashes.count(make_hash(100 + n, 1)));
+	}
+}
+
+TEST(pow_prefetcher, hashes_on_own_threads)
+{
+	test_worker w;
+	w.gate_closed = true;
+	pow_prefetcher prefetcher(bind_worker(w));
+
+	// start returns while every worker is still held at the gate
+	prefetcher.start(make_blocks(0, 8), 4);
+	{
+		boost::unique_lock<boost::mutex> l(w.lock);
+		while(w.calls < 4)
+			w.cond.wait(l);
+		ASSERT_EQ(4, w.threads.size());
+		ASSERT_EQ(0, w.threads.count(boost::this_thread::get_id()));
+	}
+
+	w.open_gate();
+	ASSERT_EQ(8, prefetcher.take().size());
+}
+
+TEST(pow_prefetcher, no_more_threads_than_blocks)
+{
+	test_worker w;
+	pow_prefetcher prefetcher(bind_worker(w));
+
+	prefetcher.start(make_blocks(0, 2), 8);
+	ASSERT_EQ(2, prefetcher.take().size());
+	ASSERT_EQ(2, w.calls);
+
+	prefetcher.start(std::vector<block>(), 8);
+	ASSERT_TRUE(prefetcher.take().empty());
+	ASSERT_EQ(2, w.calls);
+}
@@ -0,0 +1,255 @@
+// Copyright (c) 2019, Ryo Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2020
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+#include "cryptonote_core/relay_tx_batcher.h"
+
+#include <boost/chrono.hpp>
+#include <boost/thread/thread.hpp>
+#include <stdexcept>
+#include <string>
+
+using namespace cryptonote;
+
+namespace
+{
+// records the batches it is called with, blobs starting with 'x' fail
+// verification and the first call can be held until released
+struct test_handler
+{
+	boost::mutex lock;
+	boost::condition_variable cond;
+	std::vector<std::list<blobdata>> calls;
+	bool hold_first = false;
+	bool holding = false;
+	bool throw_next = false;
+
+	void operator()(const std::list<blobdata> &tx_blobs, std::vector<tx_verification_context> &tvc)
+	{
+		boost::unique_lock<boost::mutex> l(lock);
+		calls.push_back(tx_blobs);
+		if(calls.size() == 1 && hold_first)
+		{
+			holding = true;
+			cond.notify_all();
+			while(holding)
+				cond.wait(l);
+		}
+		if(throw_next)
+			throw std::runtime_error("handler failed");
+		size_t i = 0;
+		for(const blobdata &blob : tx_blobs)
+		{
+			tvc[i].m_verifivation_failed = blob[0] == 'x';
+			tvc[i].m_added_to_pool = blob[0] != 'x';
+			++i;
+		}
+	}
+
+	void wait_held()
+	{
+		boost::unique_lock<boost::mutex> l(lock);
+		while(!holding)
+			cond.wait(l);
+	}
+
+	void release()
+	{
+		boost::unique_lock<boost::mutex> l(lock);
+		holding = false;
+		cond.notify_all();
+	}
+};
+
+struct caller
+{
+	std::list<blobdata> tx_blobs;
+	std::vector<tx_verification_context> tvc;
+	bool result = false;
+	bool threw = false;
+
+	void run(relay_tx_batcher &batcher)
+	{
+		try
+		{
+			result = batcher.handle(tx_blobs, tvc);
+		}
+		catch(const std::exception &)
+		{
+			threw = true;
+		}
+	}
+};
+
+void check_split(const caller &c)
+{
+	ASSERT_EQ(c.tvc.size(), c.tx_blobs.size());
+	bool all_good = true;
+	size_t i = 0;
+	for(const blobdata &blob : c.tx_blobs)
+	{
+		ASSERT_EQ(c.tvc[i].m_verifivation_failed, blob[0] == 'x');
+		ASSERT_EQ(c.tvc[i].m_added_to_pool, blob[0] != 'x');
+		all_good = all_good && blob[0] != 'x';
+		++i;
+	}
+	ASSERT_EQ(c.result, all_good);
+}
+}
+
+TEST(relay_tx_batcher, lone_caller_skips_window)
+{
+	test_handler handler;
+	relay_tx_batcher batcher(std::ref(handler), 60 * 1000, 64);
+	caller c;
+	c.tx_blobs = {"a0", "x1", "a2"};
+
+	const boost::chrono::steady_clock::time_point start = boost::chrono::steady_clock::now();
+	c.run(batcher);
+	ASSERT_LT(boost::chrono::steady_clock::now() - start, boost::chrono::seconds(10));
+
+	ASSERT_EQ(handler.calls.size(), 1);
+	ASSERT_EQ(handler.calls[0], c.tx_blobs);
+	check_split(c);
+}
+
+TEST(relay_tx_batcher, accumulates_while_busy)
+{
+	test_handler handler;
+	handler.hold_first = true;
+	relay_tx_batcher batcher(std::ref(handler), 60 * 1000, 6);
+
+	caller busy;
+	busy.tx_blobs = {"b0"};
+	boost::thread busy_thread([&] { busy.run(batcher); });
+	handler.wait_held();
+
+	// these pile up behind the busy handler and only go once 6 txs are queued
+	caller callers[3];
+	callers[0].tx_blobs = {"a0"};
+	callers[1].tx_blobs = {"c0", "x1"};
+	callers[2].tx_blobs = {"x0", "d1", "d2"};
+	boost::thread threads[3];
+	for(size_t i = 0; i < 3; ++i)
+		threads[i] = boost::thread([&, i] { callers[i].run(batcher); });
+	for(size_t i = 0; i < 3; ++i)
+		threads[i].join();
+
+	handler.release();
+	busy_thread.join();
+
+	ASSERT_EQ(handler.calls.size(), 2);
+	ASSERT_EQ(handler.calls[0], busy.tx_blobs);
+	ASSERT_EQ(handler.calls[1].size(), 6);
+	check_split(busy);
+	for(const caller &c : callers)
+	{
+		ASSERT_FALSE(c.threw);
+		check_split(c);
+	}
+}
+
+TEST(relay_tx_batcher, window_closes_below_max_count)
+{
+	test_handler handler;
+	handler.hold_first = true;
+	relay_tx_batcher batcher(std::ref(handler), 20, 64);
+
+	caller busy;
+	busy.tx_blobs = {"b0"};
+	boost::thread busy_thread([&] { busy.run(batcher); });
+	handler.wait_held();
+
+	caller c;
+	c.tx_blobs = {"a0", "a1"};
+	c.run(batcher);
+
+	handler.release();
+	busy_thread.join();
+
+	ASSERT_EQ(handler.calls.size(), 2);
+	ASSERT_EQ(handler.calls[1], c.tx_blobs);
+	check_split(c);
+	check_split(busy);
+}
+
+TEST(relay_tx_batcher, handler_exception_fails_whole_batch)
+{
+	test_handler handler;
+	handler.hold_first = true;
+	relay_tx_batcher batcher(std::ref(handler), 60 * 1000, 4);
+
+	caller busy;
+	busy.tx_blobs = {"b0"};
+	boost::thread busy_thread([&] { busy.run(batcher); });
+	handler.wait_held();
+	{
+		boost::unique_lock<boost::mutex> l(handler.lock);
+		handler.throw_next = true;
+	}
+
+	caller callers[2];
+	callers[0].tx_blobs = {"a0", "a1"};
+	callers[1].tx_blobs = {"c0", "c1"};
+	boost::thread threads[2];
+	for(size_t i = 0; i < 2; ++i)
+		threads[i] = boost::thread([&, i] { callers[i].run(batcher); });
+	for(size_t i = 0; i < 2; ++i)
+		threads[i].join();
+
+	handler.release();
+	busy_thread.join();
+
+	// the leader of the second batch gets the exception, the other caller failed tvcs
+	ASSERT_EQ(handler.calls.size(), 2);
+	ASSERT_NE(callers[0].threw, callers[1].threw);
+	const caller &follower = callers[0].threw ? callers[1] : callers[0];
+	ASSERT_FALSE(follower.result);
+	ASSERT_EQ(follower.tvc.size(), 2);
+	for(const tx_verification_context &tvc : follower.tvc)
+	{
+		ASSERT_TRUE(tvc.m_verifivation_failed);
+		ASSERT_FALSE(tvc.m_added_to_pool);
+	}
+	ASSERT_TRUE(busy.threw);
+}
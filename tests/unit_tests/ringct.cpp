@@ -36,6 +36,7 @@
 
 #include "device/device.hpp"
 #include "ringct/rctOps.h"
+#include "ringct/rctPointCache.h"
 #include "ringct/rctSigs.h"
 #include "ringct/rctTypes.h"
 
@@ -144,6 +145,101 @@ TEST(ringct, MG_sigs)
 	ASSERT_FALSE(MLSAG_Ver(message, P, IIccss, R));
 }
 
+TEST(ringct, MG_sigs_batch)
+{
+	// rings share some of their members, as inputs of the same tx may
+	const size_t N = 4, R = 2, ind = 1;
+	keyM xm = keyMInit(R, N);
+	keyM P = keyMInit(R, N);
+	for(size_t i = 0; i < N; i++)
+	{
+		for(size_t j = 0; j < R; j++)
+		{
+			xm[i][j] = skGen();
+			P[i][j] = scalarmultBase(xm[i][j]);
+		}
+	}
+	keyV sk(R);
+	for(size_t j = 0; j < R; j++)
+		sk[j] = xm[ind][j];
+
+	const key message = skGen();
+	std::vector<keyM> pks;
+	std::vector<mgSig> mgs;
+	for(size_t n = 0; n < 5; ++n)
+	{
+		keyM Pn = P;
+		for(size_t i = 0; i < N; i++)
+		{
+			if(i != ind && (i + n) % 2)
+				Pn[i][0] = scalarmultBase(skGen());
+			Pn[i][1] = scalarmultBase(skGen());
+		}
+		Pn[ind][1] = scalarmultBase(sk[1]);
+		pks.push_back(Pn);
+		mgs.push_back(MLSAG_Gen(message, Pn, sk, NULL, NULL, ind, 1, hw::get_device("default")));
+		ASSERT_TRUE(MLSAG_Ver(message, Pn, mgs.back(), 1));
+	}
+
+	std::vector<const keyM *> pk_ptrs;
+	std::vector<const mgSig *> mg_ptrs;
+	for(size_t n = 0; n < pks.size(); ++n)
+	{
+		pk_ptrs.push_back(&pks[n]);
+		mg_ptrs.push_back(&mgs[n]);
+	}
+	ASSERT_TRUE(MLSAG_Ver(message, pk_ptrs, mg_ptrs, 1));
+	ASSERT_FALSE(MLSAG_Ver(skGen(), pk_ptrs, mg_ptrs, 1));
+
+	mgs[3].ss[2][0] = skGen();
+	ASSERT_FALSE(MLSAG_Ver(message, pk_ptrs, mg_ptrs, 1));
+	mg_ptrs.erase(mg_ptrs.begin() + 3);
+	pk_ptrs.erase(pk_ptrs.begin() + 3);
+	ASSERT_TRUE(MLSAG_Ver(message, pk_ptrs, mg_ptrs, 1));
+}
+
+TEST(ringct, point_cache)
+{
+	point_cache &pcache = point_cache::getInstance();
+	const size_t old_size = pcache.get_max_memory();
+	pcache.set_max_memory(1024 * 1024);
+
+	const key k = scalarmultBase(skGen());
+	const point_cache::stats st0 = pcache.get_stats();
+	std::shared_ptr<const point_cache::entry> e0 = pcache.get(k);
+	std::shared_ptr<const point_cache::entry> e1 = pcache.get(k);
+	const point_cache::stats st1 = pcache.get_stats();
+	ASSERT_TRUE(e0 != nullptr);
+	ASSERT_EQ(e0, e1);
+	ASSERT_EQ(st1.misses - st0.misses, 1u);
+	ASSERT_EQ(st1.hits - st0.hits, 1u);
+
+	key P;
+	ge_p3_tobytes(P.bytes, &e0->P);
+	ASSERT_EQ(P, k);
+	ge_p3 Hi;
+	hash_to_p3(Hi, k);
+	ge_dsmp Hi_dsmp;
+	ge_dsm_precomp(Hi_dsmp, &Hi);
+	ASSERT_EQ(memcmp(Hi_dsmp, e0->Hi, sizeof(ge_dsmp)), 0);
+
+	// not a point
+	key bad = identity();
+	bad.bytes[0] = 2;
+	ASSERT_TRUE(pcache.get(bad) == nullptr);
+
+	// the cap is honoured, entries still in use stay valid
+	for(size_t n = 0; n < 2000; ++n)
+		ASSERT_TRUE(pcache.get(scalarmultBase(skGen())) != nullptr);
+	const point_cache::stats st2 = pcache.get_stats();
+	ASSERT_LE(st2.memory, 1024u * 1024u);
+	ASSERT_GT(st2.evictions, st1.evictions);
+	ge_p3_tobytes(P.bytes, &e0->P);
+	ASSERT_EQ(P, k);
+
+	pcache.set_max_memory(old_size);
+}
+
 TEST(ringct, range_proofs)
 {
 	//Ring CT Stuff
@@ -1115,6 +1211,42 @@ TEST(ringct, H)
 	ASSERT_EQ(memcmp(&p3, &ge_p3_H, sizeof(ge_p3)), 0);
 }
 
+TEST(ringct, H_table)
+{
+	for(int n = 0; n < 64; ++n)
+	{
+		const rct::key a = rct::skGen(), b = rct::skGen();
+		ASSERT_EQ(rct::scalarmultH(b), rct::scalarmultKey(rct::H, b));
+		rct::key aGbH, manual;
+		rct::addKeysGH(aGbH, a, b);
+		rct::addKeys2(manual, a, b, rct::H);
+		ASSERT_EQ(aGbH, manual);
+	}
+	ASSERT_EQ(rct::scalarmultH(rct::identity()), rct::H);
+}
+
+TEST(ringct, point_at_infinity)
+{
+	ASSERT_TRUE(ge_p3_is_point_at_infinity(&ge_p3_identity));
+	ASSERT_FALSE(ge_p3_is_point_at_infinity(&ge_p3_H));
+	for(int n = 0; n < 16; ++n)
+	{
+		// P - P goes through the field subtraction, so the limbs need not be canonical
+		const rct::key k = rct::skGen();
+		ge_p3 p3, res;
+		ge_cached cached;
+		ge_p1p1 p1;
+		ge_scalarmult_base(&p3, k.bytes);
+		ge_p3_to_cached(&cached, &p3);
+		ge_sub(&p1, &p3, &cached);
+		ge_p1p1_to_p3(&res, &p1);
+		ASSERT_TRUE(ge_p3_is_point_at_infinity(&res));
+		ge_add(&p1, &p3, &cached);
+		ge_p1p1_to_p3(&res, &p1);
+		ASSERT_FALSE(ge_p3_is_point_at_infinity(&res));
+	}
+}
+
 TEST(ringct, mul8)
 {
 	ASSERT_EQ(rct::scalarmult8(rct::identity()), rct::identity());
@@ -1138,3 +1270,70 @@ TEST(ringct, aggregated)
 
 	ASSERT_TRUE(verRctSemanticsSimple(sp));
 }
+
+static rct::rctSig make_sample_bulletproof_rct_sig(uint64_t input_amount, uint64_t output_amount, uint64_t fee)
+{
+	const size_t mixin = 3, real = 1;
+	ctkey sc, pc;
+	tie(sc, pc) = ctskpkGen(input_amount);
+	ctkeyM mixRing(1);
+	for(size_t j = 0; j <= mixin; ++j)
+		mixRing[0].push_back(j == real ? pc : ctkey{scalarmultBase(skGen()), scalarmultBase(skGen())});
+
+	key Sk, Pk;
+	skpkGen(Sk, Pk);
+	ctkeyV outSk;
+	return genRctSimple(rct::zero(), {sc}, {Pk}, {input_amount}, {output_amount}, fee, mixRing, {hash_to_scalar(zero())}, NULL, NULL, {real}, outSk, true, hw::get_device("default"));
+}
+
+// a batch fails as a whole while the range proof jobs of its Borromean sigs are still running
+TEST(ringct, batch_borromean_with_bad_sum)
+{
+	static const uint64_t inputs[] = {1000, 1000};
+	static const uint64_t outputs[] = {500, 1500};
+	std::vector<rctSig> s;
+	for(size_t n = 0; n < 4; ++n)
+		s.push_back(make_sample_simple_rct_sig(NELTS(inputs), inputs, NELTS(outputs), outputs, 0));
+	ASSERT_EQ(s[0].type, RCTTypeSimple);
+	s.push_back(s.back());
+	s.back().txnFee += 1;
+	ASSERT_FALSE(verRctSemanticsSimple(s.back()));
+
+	std::vector<const rctSig *> sp;
+	for(const rctSig &sig : s)
+		sp.push_back(&sig);
+	for(size_t n = 0; n < 8; ++n)
+		ASSERT_FALSE(verRctSemanticsSimple(sp));
+
+	std::deque<bool> results;
+	verRctSemanticsSimple(sp, sp.size(), results);
+	ASSERT_EQ(results.size(), s.size());
+	for(size_t n = 0; n < s.size(); ++n)
+		ASSERT_EQ(results[n], n + 1 < s.size());
+}
+
+TEST(ringct, batch_borromean_with_bad_bulletproof)
+{
+	static const uint64_t inputs[] = {1000, 1000};
+	static const uint64_t outputs[] = {500, 1500};
+	std::vector<rctSig> s;
+	for(size_t n = 0; n < 4; ++n)
+		s.push_back(make_sample_simple_rct_sig(NELTS(inputs), inputs, NELTS(outputs), outputs, 0));
+	s.push_back(make_sample_bulletproof_rct_sig(2000, 1900, 100));
+	ASSERT_EQ(s.back().type, RCTTypeBulletproof);
+	ASSERT_TRUE(verRctSemanticsSimple(s.back()));
+	s.back().p.bulletproofs[0].taux = skGen();
+	ASSERT_FALSE(verRctSemanticsSimple(s.back()));
+
+	std::vector<const rctSig *> sp;
+	for(const rctSig &sig : s)
+		sp.push_back(&sig);
+	for(size_t n = 0; n < 8; ++n)
+		ASSERT_FALSE(verRctSemanticsSimple(sp));
+
+	std::deque<bool> results;
+	verRctSemanticsSimple(sp, sp.size(), results);
+	ASSERT_EQ(results.size(), s.size());
+	for(size_t n = 0; n < s.size(); ++n)
+		ASSERT_EQ(results[n], n + 1 < s.size());
+}
@@ -126,6 +126,9 @@ class BaseTestDB : public cryptonote::BlockchainDB
 	virtual uint64_t get_database_size() const { return 0; }
 	virtual cryptonote::blobdata get_txpool_tx_blob(const crypto::hash &txid) const { return ""; }
 	virtual bool for_all_txpool_txes(std::function<bool(const crypto::hash &, const cryptonote::txpool_tx_meta_t &, const cryptonote::blobdata *)>, bool include_blob = false, bool include_unrelayed_txes = false) const { return false; }
+	virtual void add_pow_hash(const crypto::hash &blk_hash, uint64_t height, const crypto::hash &pow) {}
+	virtual bool get_pow_hash(const crypto::hash &blk_hash, uint64_t height, crypto::hash &pow) const { return false; }
+	virtual void prune_pow_hashes(uint64_t min_height) {}
 
 	virtual void add_block(const cryptonote::block &blk, size_t block_weight, const cryptonote::difficulty_type &cumulative_difficulty, const uint64_t &coins_generated, uint64_t num_rct_outs, const crypto::hash &blk_hash) {}
 	virtual cryptonote::block get_block_from_height(const uint64_t &height) const { return cryptonote::block(); }
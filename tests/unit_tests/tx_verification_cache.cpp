@@ -0,0 +1,143 @@
+// Copyright (c) 2019, Ryo Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2020
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+#include "cryptonote_config.h"
+#include "cryptonote_core/tx_verification_cache.h"
+#include "ringct/rctOps.h"
+
+using namespace cryptonote;
+
+namespace
+{
+crypto::hash make_hash(uint64_t n)
+{
+	crypto::hash h = crypto::null_hash;
+	memcpy(&h, &n, sizeof(n));
+	return h;
+}
+
+std::vector<std::vector<rct::ctkey>> make_rings(size_t inputs, size_t mixin)
+{
+	std::vector<std::vector<rct::ctkey>> rings(inputs);
+	for(auto &ring : rings)
+		for(size_t i = 0; i <= mixin; ++i)
+			ring.push_back({rct::pkGen(), rct::pkGen()});
+	return rings;
+}
+}
+
+TEST(tx_verification_cache, hit_skips_check)
+{
+	tx_verification_cache cache(TX_VERIFICATION_CACHE_SIZE);
+	const crypto::hash key = tx_verification_cache::get_key(make_hash(1), make_rings(2, 4), 2);
+	size_t checks = 0;
+	auto check = [&checks] { ++checks; return true; };
+
+	ASSERT_TRUE(cache.verify(key, check));
+	ASSERT_EQ(checks, 1);
+	ASSERT_TRUE(cache.contains(key));
+	ASSERT_TRUE(cache.verify(key, check));
+	ASSERT_EQ(checks, 1);
+}
+
+TEST(tx_verification_cache, failed_check_not_cached)
+{
+	tx_verification_cache cache(TX_VERIFICATION_CACHE_SIZE);
+	const crypto::hash key = tx_verification_cache::get_key(make_hash(1), make_rings(1, 4), 2);
+	size_t checks = 0;
+	auto check = [&checks] { ++checks; return false; };
+
+	ASSERT_FALSE(cache.verify(key, check));
+	ASSERT_FALSE(cache.verify(key, check));
+	ASSERT_EQ(checks, 2);
+	ASSERT_FALSE(cache.contains(key));
+	ASSERT_EQ(cache.size(), 0);
+}
+
+TEST(tx_verification_cache, key_covers_rings_and_version)
+{
+	tx_verification_cache cache(TX_VERIFICATION_CACHE_SIZE);
+	const crypto::hash tx_hash = make_hash(7);
+	std::vector<std::vector<rct::ctkey>> rings = make_rings(2, 4);
+	const crypto::hash key = tx_verification_cache::get_key(tx_hash, rings, 2);
+	cache.add(key);
+	ASSERT_TRUE(cache.contains(tx_verification_cache::get_key(tx_hash, rings, 2)));
+
+	// same tx checked under another hard fork version
+	ASSERT_FALSE(cache.contains(tx_verification_cache::get_key(tx_hash, rings, 3)));
+
+	// a reorg resolved one ring member to another output, or its commitment changed
+	std::vector<std::vector<rct::ctkey>> moved = rings;
+	moved[1][3].dest = rct::pkGen();
+	ASSERT_FALSE(cache.contains(tx_verification_cache::get_key(tx_hash, moved, 2)));
+	moved = rings;
+	moved[0][0].mask = rct::pkGen();
+	ASSERT_FALSE(cache.contains(tx_verification_cache::get_key(tx_hash, moved, 2)));
+
+	ASSERT_FALSE(cache.contains(tx_verification_cache::get_key(make_hash(8), rings, 2)));
+}
+
+TEST(tx_verification_cache, fifo_eviction)
+{
+	tx_verification_cache cache(TX_VERIFICATION_CACHE_SIZE);
+	for(uint64_t i = 0; i < TX_VERIFICATION_CACHE_SIZE; ++i)
+		cache.add(make_hash(i));
+	ASSERT_EQ(cache.size(), TX_VERIFICATION_CACHE_SIZE);
+
+	// re-adding does not refresh an entry
+	cache.add(make_hash(0));
+	ASSERT_EQ(cache.size(), TX_VERIFICATION_CACHE_SIZE);
+
+	cache.add(make_hash(TX_VERIFICATION_CACHE_SIZE));
+	ASSERT_EQ(cache.size(), TX_VERIFICATION_CACHE_SIZE);
+	ASSERT_FALSE(cache.contains(make_hash(0)));
+	ASSERT_TRUE(cache.contains(make_hash(1)));
+	ASSERT_TRUE(cache.contains(make_hash(TX_VERIFICATION_CACHE_SIZE)));
+
+	size_t checks = 0;
+	ASSERT_TRUE(cache.verify(make_hash(0), [&checks] { ++checks; return true; }));
+	ASSERT_EQ(checks, 1);
+	ASSERT_FALSE(cache.contains(make_hash(1)));
+	ASSERT_TRUE(cache.contains(make_hash(2)));
+}